@@ -6,11 +6,17 @@
  */
 
 #include "base_cmd.h"
+
+#include <optional>
+#include <set>
+
 #include "common.h"
 #include "config.h"
 #include "log.h"
 #include "pikiwidb.h"
 #include "praft/praft.h"
+#include "pstd/scope_record_lock.h"
+#include "replication.h"
 
 namespace pikiwidb {
 
@@ -43,26 +49,125 @@ void BaseCmd::Execute(PClient* client) {
 
     // 2. If PRAFT is initialized and the current node is not the leader, return a redirection message for write
     // commands.
-    if (HasFlag(kCmdFlagsWrite) && !PRAFT.IsLeader()) {
+    if (PRaft::GroupNum() == 1 && HasFlag(kCmdFlagsWrite) && !PRAFT.IsLeader()) {
       return client->SetRes(CmdRes::kErrOther, fmt::format("MOVED {}", PRAFT.GetLeaderAddress()));
     }
+
+    // 3. With raft-linearizable-read, a read first waits until this node applied the logs the leader committed
+    // before it, so the followers serve reads that are not stale.
+    if (PRaft::GroupNum() == 1 && HasFlag(kCmdFlagsReadonly) && !HasFlag(kCmdFlagsAdmin) &&
+        g_config.raft_linearizable_read.load()) {
+      if (auto status = PRAFT.ReadBarrier(); !status.ok()) {
+        return client->SetRes(CmdRes::kErrOther, status.error_str());
+      }
+    }
   }
 
+  // 4. Without raft the writes are propagated to the slaves. The barrier keeps a write out of the checkpoint a
+  // full sync takes unless the write is also propagated after it, and the keys of the write stay locked until it
+  // is queued for the slaves, so the slaves see the writes of a key in the order they were applied. With no
+  // slaves and no bgsave pending the write takes no barrier and is not propagated.
+  std::optional<PReplication::WriteGuard> barrier;
+  std::shared_ptr<pstd::lock::DeferredUnlock> keys;
+  if (!g_config.use_raft.load() && HasFlag(kCmdFlagsWrite) && name_ != kCmdNameShutdown) {
+    barrier.emplace(PREPL);
+    if (barrier->Barriered() && PREPL.HasSlaves()) {
+      keys = std::make_shared<pstd::lock::DeferredUnlock>();
+    }
+  }
+  bool propagate = barrier && barrier->Barriered();
+
   auto dbIndex = client->GetCurrentDB();
   if (!HasFlag(kCmdFlagsExclusive)) {
     PSTORE.GetBackend(dbIndex)->LockShared();
   }
 
+  // 5. With a raft group per instance, 2 and 3 are checked for the groups of the keys of the command
+  bool check_groups = g_config.use_raft.load() && PRaft::GroupNum() > 1;
+  if (check_groups) {
+    client->ClearKeys();
+  }
   if (!DoInitial(client)) {
+    if (!HasFlag(kCmdFlagsExclusive)) {
+      PSTORE.GetBackend(dbIndex)->UnLockShared();
+    }
     return;
   }
+  if (check_groups && !CheckRaftGroups(client, dbIndex)) {
+    if (!HasFlag(kCmdFlagsExclusive)) {
+      PSTORE.GetBackend(dbIndex)->UnLockShared();
+    }
+    return;
+  }
+  if (keys) {
+    pstd::lock::DeferredUnlock::SetCurrent(keys);
+  }
   DoCmd(client);
+  if (keys) {
+    pstd::lock::DeferredUnlock::SetCurrent(nullptr);
+  }
+  if (propagate && client->Ok()) {
+    PREPL.SendToSlaves(dbIndex, client->argv_);
+  }
+  if (keys) {
+    keys->Release();
+  }
 
   if (!HasFlag(kCmdFlagsExclusive)) {
     PSTORE.GetBackend(dbIndex)->UnLockShared();
   }
 }
 
+bool BaseCmd::CheckRaftGroups(PClient* client, int db_index) {
+  bool is_write = HasFlag(kCmdFlagsWrite);
+  bool is_read = HasFlag(kCmdFlagsReadonly) && !HasFlag(kCmdFlagsAdmin) && g_config.raft_linearizable_read.load();
+  if (!is_write && !is_read) {
+    return true;
+  }
+  // the group of a key is the instance of its slot, a command without keys
+  // involves all the groups
+  std::set<size_t> groups;
+  auto& storage = PSTORE.GetBackend(db_index)->GetStorage();
+  for (const auto& key : client->Keys()) {
+    groups.insert(storage->GetInstanceIndex(key));
+  }
+  if (groups.empty()) {
+    for (size_t i = 0; i < PRaft::GroupNum(); i++) {
+      groups.insert(i);
+    }
+  }
+
+  if (is_write) {
+    for (auto index : groups) {
+      if (auto& group = PRaft::Group(index); !group.IsLeader()) {
+        client->SetRes(CmdRes::kErrOther, fmt::format("MOVED {}", group.GetLeaderAddress()));
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // the barrier waits for the logs of the group, which may load a snapshot
+  // under the lock of the db
+  if (!HasFlag(kCmdFlagsExclusive)) {
+    PSTORE.GetBackend(db_index)->UnLockShared();
+  }
+  butil::Status status;
+  for (auto index : groups) {
+    if (status = PRaft::Group(index).ReadBarrier(); !status.ok()) {
+      break;
+    }
+  }
+  if (!HasFlag(kCmdFlagsExclusive)) {
+    PSTORE.GetBackend(db_index)->LockShared();
+  }
+  if (!status.ok()) {
+    client->SetRes(CmdRes::kErrOther, status.error_str());
+    return false;
+  }
+  return true;
+}
+
 std::string BaseCmd::ToBinlog(uint32_t exec_time, uint32_t term_id, uint64_t logic_id, uint32_t filenum,
                               uint64_t offset) {
   return "";
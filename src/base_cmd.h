@@ -42,6 +42,7 @@ const std::string kCmdNameRenameNX = "renamenx";
 // raft cmd
 const std::string kCmdNameRaftCluster = "raft.cluster";
 const std::string kCmdNameRaftNode = "raft.node";
+const std::string kCmdNameRaftWriteAck = "raft.writeack";
 
 // string cmd
 const std::string kCmdNameSet = "set";
@@ -61,12 +62,18 @@ const std::string kCmdNamePSetEx = "psetex";
 const std::string kCmdNameBitOp = "bitop";
 const std::string kCmdNameGetBit = "getbit";
 const std::string kCmdNameBitCount = "bitcount";
+const std::string kCmdNameBitPos = "bitpos";
 const std::string kCmdNameGetRange = "getrange";
 const std::string kCmdNameSetRange = "setrange";
 const std::string kCmdNameDecr = "decr";
 const std::string kCmdNameIncr = "incr";
 const std::string kCmdNameMSetnx = "msetnx";
 
+// hyperloglog cmd
+const std::string kCmdNamePfAdd = "pfadd";
+const std::string kCmdNamePfCount = "pfcount";
+const std::string kCmdNamePfMerge = "pfmerge";
+
 // multi
 const std::string kCmdNameMulti = "multi";
 const std::string kCmdNameExec = "exec";
@@ -89,6 +96,11 @@ const std::string kSubCmdNameDebugOOM = "oom";
 const std::string kSubCmdNameDebugSegfault = "segfault";
 const std::string kCmdNameInfo = "info";
 
+// replication cmd
+const std::string kCmdNameSlaveof = "slaveof";
+const std::string kCmdNameReplconf = "replconf";
+const std::string kCmdNameSync = "sync";
+
 // hash cmd
 const std::string kCmdNameHSet = "hset";
 const std::string kCmdNameHGet = "hget";
@@ -338,6 +350,11 @@ class BaseCmd : public std::enable_shared_from_this<BaseCmd> {
   // If this function returns false, then Do Cmd will not be executed
   virtual bool DoInitial(PClient* client) = 0;
 
+  // With raft-group-per-instance, the checks of Execute for the raft groups of
+  // the keys the command has once DoInitial parsed them. false if the command
+  // is not run, with the error set in client.
+  bool CheckRaftGroups(PClient* client, int db_index);
+
   //  virtual void Clear(){};
   //  BaseCmd& operator=(const BaseCmd&);
 };
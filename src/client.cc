@@ -7,6 +7,8 @@
 
 #include "client.h"
 
+#include <unistd.h>
+
 #include <algorithm>
 #include <memory>
 
@@ -223,26 +225,9 @@ static int ProcessMaster(const char* start, const char* end) {
       }
       break;
 
-    case kPReplStateWaitRdb: {
-      const char* ptr = start;
-      // recv RDB file
-      if (PREPL.GetRdbSize() == static_cast<std::size_t>(-1)) {
-        ++ptr;  // skip $
-        int s;
-        if (PParseResult::kOK == GetIntUntilCRLF(ptr, end - ptr, s)) {
-          assert(s > 0);  // check error for your masterauth or master config
-
-          PREPL.SetRdbSize(s);
-          INFO("recv rdb size {}", s);
-        }
-      } else {
-        auto rdb = static_cast<std::size_t>(end - ptr);
-        PREPL.SaveTmpRdb(ptr, rdb);
-        ptr += rdb;
-      }
-
-      return static_cast<int>(ptr - start);
-    }
+    case kPReplStateWaitCheckpoint:
+      // recv the checkpoint files
+      return PREPL.OnCheckpointData(start, end);
 
     case kPReplStateOnline:
       break;
@@ -321,6 +306,11 @@ int PClient::handlePacket(const char* start, int bytes) {
   cmdName_ = params_[0];
   pstd::StringToLower(cmdName_);
 
+  if (IsFlagOn(kClientFlagMaster) && PREPL.GetMasterState() == kPReplStateOnline) {
+    executeMasterCommand();
+    return static_cast<int>(ptr - start);
+  }
+
   if (!auth_) {
     if (cmdName_ == kCmdNameAuth) {
       auto now = ::time(nullptr);
@@ -413,6 +403,23 @@ void PClient::executeCommand() {
   //  cmdPtr->Execute(this);
 }
 
+// The writes the master propagates run one after another in this thread, in
+// the order of the stream, and the master gets no reply.
+void PClient::executeMasterCommand() {
+  auto cmd = PREPL.GetMasterCommand(cmdName_, this);
+  if (!cmd || !cmd->CheckArg(params_.size())) {
+    WARN("Skip the command {} of the master, it can't run here", cmdName_);
+  } else {
+    cmd->Execute(this);
+    if (!Ok()) {
+      WARN("The command {} of the master failed: {}", cmdName_, Message());
+    }
+  }
+
+  Clear();
+  reset();
+}
+
 PClient* PClient::Current() { return s_current; }
 
 PClient::PClient(TcpConnection* obj)
@@ -513,6 +520,15 @@ bool PClient::SendPacket(const evbuffer_iovec* iovecs, size_t nvecs) {
   return false;
 }
 
+bool PClient::SendFile(int fd, size_t size, std::function<void()> on_sent) {
+  if (auto c = getTcpConnection(); c) {
+    return c->SendFile(fd, size, std::move(on_sent));
+  }
+
+  ::close(fd);
+  return false;
+}
+
 void PClient::WriteReply2Client() {
   if (auto c = getTcpConnection(); c) {
     c->SendPacket(Message());
@@ -107,6 +107,14 @@ enum class ClientState {
   kClosed,
 };
 
+// when a write is replied in raft mode, see RAFT.WRITEACK
+enum class RaftWriteAck : int8_t {
+  kDefault = -1,  // raft-write-ack
+  kApply,         // once this node applied the raft logs of the write
+  kCommit,        // once a quorum stored them, before they are applied
+  kAccepted,      // once the leader accepted them, before they are replicated
+};
+
 class DB;
 struct PSlaveInfo;
 
@@ -126,6 +134,8 @@ class PClient : public std::enable_shared_from_this<PClient>, public CmdRes {
   bool SendPacket(const void* data, size_t size);
   bool SendPacket(UnboundedBuffer& data);
   bool SendPacket(const evbuffer_iovec* iovecs, size_t nvecs);
+  // see TcpConnection::SendFile, fd is closed either way
+  bool SendFile(int fd, size_t size, std::function<void()> on_sent);
 
   void WriteReply2Client();
 
@@ -136,6 +146,9 @@ class PClient : public std::enable_shared_from_this<PClient>, public CmdRes {
 
   int GetCurrentDB() { return dbno_; }
 
+  void SetRaftWriteAck(RaftWriteAck ack) { raft_write_ack_ = ack; }
+  RaftWriteAck GetRaftWriteAck() const { return raft_write_ack_; }
+
   static PClient* Current();
 
   // multi
@@ -186,6 +199,7 @@ class PClient : public std::enable_shared_from_this<PClient>, public CmdRes {
     keys_.emplace_back(name);
   }
   void SetKey(std::vector<std::string>& names);
+  void ClearKeys() { keys_.clear(); }
   const std::string& Key() const { return keys_.at(0); }
   const std::vector<std::string>& Keys() const { return keys_; }
   std::vector<storage::FieldValue>& Fvs() { return fvs_; }
@@ -219,6 +233,7 @@ class PClient : public std::enable_shared_from_this<PClient>, public CmdRes {
   std::shared_ptr<TcpConnection> getTcpConnection() const { return tcp_connection_.lock(); }
   int handlePacket(const char*, int);
   void executeCommand();
+  void executeMasterCommand();
   int processInlineCmd(const char*, size_t, std::vector<std::string>&);
   void reset();
   bool isPeerMaster() const;
@@ -232,6 +247,7 @@ class PClient : public std::enable_shared_from_this<PClient>, public CmdRes {
   PProtoParser parser_;
 
   int dbno_;
+  RaftWriteAck raft_write_ack_ = RaftWriteAck::kDefault;
 
   std::unordered_set<std::string> channels_;
   std::unordered_set<std::string> pattern_channels_;
@@ -14,11 +14,27 @@
 #include "pikiwidb.h"
 #include "praft/praft.h"
 #include "pstd/env.h"
+#include "pstd/pstd_string.h"
 
+#include "replication.h"
 #include "store.h"
 
 namespace pikiwidb {
 
+// Clears db under its exclusive lock. The range tombstones take no record
+// locks, so no write may read a meta value before them and write it back
+// after, and in raft mode the lock is held until they are applied, not only
+// appended.
+static rocksdb::Status FlushDBExclusive(int db_index) {
+  auto reply = PRaftPendingReply::Current();
+  PRaftPendingReply::SetCurrent(nullptr);
+  PSTORE.GetBackend(db_index)->Lock();
+  auto s = PSTORE.GetBackend(db_index)->GetStorage()->FlushDB();
+  PSTORE.GetBackend(db_index)->UnLock();
+  PRaftPendingReply::SetCurrent(std::move(reply));
+  return s;
+}
+
 CmdConfig::CmdConfig(const std::string& name, int arity) : BaseCmdGroup(name, kCmdFlagsAdmin, kAclCategoryAdmin) {}
 
 bool CmdConfig::HasSubCommand() const { return true; }
@@ -57,18 +73,11 @@ FlushdbCmd::FlushdbCmd(const std::string& name, int16_t arity)
 bool FlushdbCmd::DoInitial(PClient* client) { return true; }
 
 void FlushdbCmd::DoCmd(PClient* client) {
-  int currentDBIndex = client->GetCurrentDB();
-  PSTORE.GetBackend(currentDBIndex).get()->Lock();
-
-  std::string db_path = g_config.db_path.ToString() + std::to_string(currentDBIndex);
-  std::string path_temp = db_path;
-  path_temp.append("_deleting/");
-  pstd::RenameFile(db_path, path_temp);
-
-  auto s = PSTORE.GetBackend(currentDBIndex)->Open();
-  assert(s.ok());
-  auto f = std::async(std::launch::async, [&path_temp]() { pstd::DeleteDir(path_temp); });
-  PSTORE.GetBackend(currentDBIndex).get()->UnLock();
+  auto s = FlushDBExclusive(client->GetCurrentDB());
+  if (!s.ok()) {
+    client->SetRes(CmdRes::kErrOther, s.ToString());
+    return;
+  }
   client->SetRes(CmdRes::kOK);
 }
 
@@ -80,16 +89,11 @@ bool FlushallCmd::DoInitial(PClient* client) { return true; }
 
 void FlushallCmd::DoCmd(PClient* client) {
   for (size_t i = 0; i < g_config.databases; ++i) {
-    PSTORE.GetBackend(i).get()->Lock();
-    std::string db_path = g_config.db_path.ToString() + std::to_string(i);
-    std::string path_temp = db_path;
-    path_temp.append("_deleting/");
-    pstd::RenameFile(db_path, path_temp);
-
-    auto s = PSTORE.GetBackend(i)->Open();
-    assert(s.ok());
-    auto f = std::async(std::launch::async, [&path_temp]() { pstd::DeleteDir(path_temp); });
-    PSTORE.GetBackend(i).get()->UnLock();
+    auto s = FlushDBExclusive(static_cast<int>(i));
+    if (!s.ok()) {
+      client->SetRes(CmdRes::kErrOther, s.ToString());
+      return;
+    }
   }
   client->SetRes(CmdRes::kOK);
 }
@@ -151,6 +155,8 @@ void InfoCmd::DoCmd(PClient* client) {
     InfoRaft(client);
   } else if (!strcasecmp(cmd.c_str(), "data")) {
     InfoData(client);
+  } else if (!strcasecmp(cmd.c_str(), "replication")) {
+    InfoReplication(client);
   } else {
     client->SetRes(CmdRes::kErrOther, "the cmd is not supported");
   }
@@ -166,6 +172,21 @@ void InfoCmd::DoCmd(PClient* client) {
     raft_is_voting:yes
     raft_leader_id:1733428433
     raft_current_term:1
+    raft_groups:3
+    raft_group0:role=FOLLOWER,leader=127.0.0.1:8231:0,term=1
+    raft_group1:role=LEADER,leader=127.0.0.1:8221:0,term=2
+    raft_group2:role=FOLLOWER,leader=127.0.0.1:8241:0,term=2
+    raft_binlog_compression:none
+    raft_binlog_compressed_logs:0
+    raft_binlog_compressed_raw_bytes:0
+    raft_binlog_compressed_bytes:0
+    raft_binlog_decompressed_logs:0
+    raft_binlog_decompress_failures:0
+    raft_write_ack:apply
+    raft_write_acks_apply:120
+    raft_write_acks_commit:0
+    raft_write_acks_accepted:0
+    raft_write_ack_failures:0
     raft_num_nodes:2
     raft_num_voting_nodes:2
     raft_node1:id=1733428433,state=connected,voting=yes,addr=localhost,port=5001,last_conn_secs=5,conn_errors=0,conn_oks=1
@@ -197,6 +218,45 @@ void InfoCmd::InfoRaft(PClient* client) {
   message += "raft_leader_id:" + node_status.leader_id.to_string() + "\r\n";
   message += "raft_current_term:" + std::to_string(node_status.term) + "\r\n";
 
+  // with a raft group per instance, the fields above are the ones of group 0
+  if (PRaft::GroupNum() > 1) {
+    message += "raft_groups:" + std::to_string(PRaft::GroupNum()) + "\r\n";
+    for (size_t i = 0; i < PRaft::GroupNum(); i++) {
+      auto group_status = PRaft::Group(i).GetNodeStatus();
+      message += "raft_group" + std::to_string(i) + ":role=" + braft::state2str(group_status.state) +
+                 ",leader=" + group_status.leader_id.to_string() + ",term=" + std::to_string(group_status.term) +
+                 "\r\n";
+    }
+  }
+
+  // of all the groups
+  PRaft::BinlogCompressionStats compression;
+  compression.enabled = true;
+  for (size_t i = 0; i < PRaft::GroupNum(); i++) {
+    auto stats = PRaft::Group(i).GetBinlogCompressionStats();
+    compression.enabled = compression.enabled && stats.enabled;
+    compression.compressed_logs += stats.compressed_logs;
+    compression.raw_bytes += stats.raw_bytes;
+    compression.compressed_bytes += stats.compressed_bytes;
+    compression.decompressed_logs += stats.decompressed_logs;
+    compression.decompress_failures += stats.decompress_failures;
+  }
+  message += "raft_binlog_compression:" + std::string(compression.enabled ? "lzf" : "none") + "\r\n";
+  message += "raft_binlog_compressed_logs:" + std::to_string(compression.compressed_logs) + "\r\n";
+  message += "raft_binlog_compressed_raw_bytes:" + std::to_string(compression.raw_bytes) + "\r\n";
+  message += "raft_binlog_compressed_bytes:" + std::to_string(compression.compressed_bytes) + "\r\n";
+  message += "raft_binlog_decompressed_logs:" + std::to_string(compression.decompressed_logs) + "\r\n";
+  message += "raft_binlog_decompress_failures:" + std::to_string(compression.decompress_failures) + "\r\n";
+
+  // the writes replied at each level, and the ones that failed after their reply
+  auto acks = PRaftPendingReply::GetWriteAckStats();
+  message += "raft_write_ack:" + g_config.raft_write_ack.ToString() + "\r\n";
+  for (auto ack : {RaftWriteAck::kApply, RaftWriteAck::kCommit, RaftWriteAck::kAccepted}) {
+    message += "raft_write_acks_" + std::string(RaftWriteAckName(ack)) + ":" +
+               std::to_string(acks.replies[static_cast<int>(ack)]) + "\r\n";
+  }
+  message += "raft_write_ack_failures:" + std::to_string(acks.failed_after_ack) + "\r\n";
+
   if (PRAFT.IsLeader()) {
     std::vector<braft::PeerId> peers;
     auto status = PRAFT.GetListPeers(&peers);
@@ -222,10 +282,124 @@ void InfoCmd::InfoData(PClient* client) {
   message += DATABASES_NUM + std::string(":") + std::to_string(pikiwidb::g_config.databases) + "\r\n";
   message += ROCKSDB_NUM + std::string(":") + std::to_string(pikiwidb::g_config.db_instance_num) + "\r\n";
   message += ROCKSDB_VERSION + std::string(":") + ROCKSDB_NAMESPACE::GetRocksVersionAsString() + "\r\n";
+  message += RAFT_GROUPS_NUM + std::string(":") + std::to_string(PRaft::GroupNum()) + "\r\n";
+
+  // space amplification of every RocksDB instance, the current db is already
+  // locked by the command
+  for (int i = 0; i < static_cast<int>(pikiwidb::g_config.databases); ++i) {
+    std::vector<storage::SpaceUsage> usages;
+    if (i != client->GetCurrentDB()) {
+      PSTORE.GetBackend(i)->LockShared();
+    }
+    auto s = PSTORE.GetBackend(i)->GetStorage()->GetSpaceUsage(&usages);
+    if (i != client->GetCurrentDB()) {
+      PSTORE.GetBackend(i)->UnLockShared();
+    }
+    if (!s.ok()) {
+      return client->SetRes(CmdRes::kErrOther, s.ToString());
+    }
+    for (const auto& usage : usages) {
+      double dead_ratio =
+          usage.entries == 0 ? 0 : static_cast<double>(usage.dead_entries) / static_cast<double>(usage.entries);
+      message += fmt::format(
+          "db{}_rocksdb{}:sst_files_size={},live_data_size={},space_amplification={:.2f},dead_entries={},"
+          "dead_ratio={:.2f}\r\n",
+          i, usage.inst_index, usage.sst_files_size, usage.live_data_size, usage.SpaceAmplification(),
+          usage.dead_entries, dead_ratio);
+    }
+  }
 
   client->AppendString(message);
 }
 
+void InfoCmd::InfoReplication(PClient* client) {
+  if (client->argv_.size() != 2) {
+    return client->SetRes(CmdRes::kWrongNum, client->CmdName());
+  }
+
+  UnboundedBuffer info;
+  PREPL.OnInfoCommand(info);
+  client->AppendString(std::string(info.ReadAddr(), info.ReadableSize()));
+}
+
+SlaveofCmd::SlaveofCmd(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsAdmin, kAclCategoryAdmin | kAclCategoryDangerous) {}
+
+bool SlaveofCmd::DoInitial(PClient* client) {
+  if (g_config.use_raft.load()) {
+    client->SetRes(CmdRes::kErrOther, "SLAVEOF is not supported in raft mode");
+    return false;
+  }
+  return true;
+}
+
+void SlaveofCmd::DoCmd(PClient* client) {
+  if (!strcasecmp(client->argv_[1].c_str(), "no") && !strcasecmp(client->argv_[2].c_str(), "one")) {
+    PREPL.SetMasterAddr(nullptr, 0);
+    return client->SetRes(CmdRes::kOK);
+  }
+
+  int64_t port = 0;
+  if (!pstd::String2int(client->argv_[2], &port) || port <= 0 || port > UINT16_MAX) {
+    return client->SetRes(CmdRes::kInvalidInt);
+  }
+  SocketAddr master(client->argv_[1].c_str(), static_cast<uint16_t>(port));
+  if (PREPL.GetMasterAddr() != master) {
+    PREPL.SetMasterAddr(client->argv_[1].c_str(), static_cast<uint16_t>(port));
+    PREPL.SetMasterState(kPReplStateNone);
+  }
+  client->SetRes(CmdRes::kOK);
+}
+
+ReplconfCmd::ReplconfCmd(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsAdmin, kAclCategoryAdmin) {}
+
+bool ReplconfCmd::DoInitial(PClient* client) {
+  if (client->argv_.size() % 2 == 0) {
+    client->SetRes(CmdRes::kSyntaxErr);
+    return false;
+  }
+  return true;
+}
+
+void ReplconfCmd::DoCmd(PClient* client) {
+  for (size_t i = 1; i < client->argv_.size(); i += 2) {
+    if (strcasecmp(client->argv_[i].c_str(), "listening-port") != 0) {
+      continue;
+    }
+
+    int64_t port = 0;
+    if (!pstd::String2int(client->argv_[i + 1], &port)) {
+      return client->SetRes(CmdRes::kInvalidInt);
+    }
+    if (!client->GetSlaveInfo()) {
+      client->SetSlaveInfo();
+      PREPL.AddSlave(client);
+    }
+    client->GetSlaveInfo()->listenPort = static_cast<uint16_t>(port);
+  }
+  client->SetRes(CmdRes::kOK);
+}
+
+SyncCmd::SyncCmd(const std::string& name, int16_t arity) : BaseCmd(name, arity, kCmdFlagsAdmin, kAclCategoryAdmin) {}
+
+bool SyncCmd::DoInitial(PClient* client) {
+  if (g_config.use_raft.load()) {
+    client->SetRes(CmdRes::kErrOther, "the nodes of a raft cluster sync by raft");
+    return false;
+  }
+  return true;
+}
+
+// no reply, the checkpoint stream follows, see PReplication
+void SyncCmd::DoCmd(PClient* client) {
+  if (!client->GetSlaveInfo()) {
+    client->SetSlaveInfo();
+    PREPL.AddSlave(client);
+  }
+  PREPL.Sync(client);
+}
+
 CmdDebug::CmdDebug(const std::string& name, int arity) : BaseCmdGroup(name, kCmdFlagsAdmin, kAclCategoryAdmin) {}
 
 bool CmdDebug::HasSubCommand() const { return true; }
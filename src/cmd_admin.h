@@ -124,6 +124,48 @@ class InfoCmd : public BaseCmd {
 
   void InfoRaft(PClient* client);
   void InfoData(PClient* client);
+  void InfoReplication(PClient* client);
+};
+
+/* SLAVEOF <host> <port> | SLAVEOF NO ONE
+ *   Replicates the master at host:port, which streams a checkpoint of its
+ *   dbs and then its writes, see PReplication. Not with use-raft.
+ * Reply:
+ *   +OK
+ */
+class SlaveofCmd : public BaseCmd {
+ public:
+  SlaveofCmd(const std::string& name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient* client) override;
+
+ private:
+  void DoCmd(PClient* client) override;
+};
+
+// REPLCONF listening-port <port>, sent by a slave before SYNC
+class ReplconfCmd : public BaseCmd {
+ public:
+  ReplconfCmd(const std::string& name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient* client) override;
+
+ private:
+  void DoCmd(PClient* client) override;
+};
+
+// SYNC, sent by a slave for a full sync, replied with the checkpoint stream
+class SyncCmd : public BaseCmd {
+ public:
+  SyncCmd(const std::string& name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient* client) override;
+
+ private:
+  void DoCmd(PClient* client) override;
 };
 
 class CmdDebug : public BaseCmdGroup {
@@ -249,6 +249,52 @@ void BitCountCmd::DoCmd(PClient* client) {
   }
 }
 
+BitPosCmd::BitPosCmd(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryBitmap) {}
+
+bool BitPosCmd::DoInitial(PClient* client) {
+  if (client->argv_.size() > 5) {
+    client->SetRes(CmdRes::kSyntaxErr, kCmdNameBitPos);
+    return false;
+  }
+  client->SetKey(client->argv_[1]);
+  return true;
+}
+
+void BitPosCmd::DoCmd(PClient* client) {
+  int64_t bit = 0;
+  if (pstd::String2int(client->argv_[2], &bit) == 0 || (bit != 0 && bit != 1)) {
+    client->SetRes(CmdRes::kInvalidBitPosArgument);
+    return;
+  }
+  int64_t start_offset = 0;
+  int64_t end_offset = 0;
+  if ((client->argv_.size() > 3 && pstd::String2int(client->argv_[3], &start_offset) == 0) ||
+      (client->argv_.size() > 4 && pstd::String2int(client->argv_[4], &end_offset) == 0)) {
+    client->SetRes(CmdRes::kInvalidInt);
+    return;
+  }
+
+  auto storage = PSTORE.GetBackend(client->GetCurrentDB())->GetStorage();
+  int64_t pos = 0;
+  storage::Status s;
+  if (client->argv_.size() == 3) {
+    s = storage->BitPos(client->Key(), static_cast<int32_t>(bit), &pos);
+  } else if (client->argv_.size() == 4) {
+    s = storage->BitPos(client->Key(), static_cast<int32_t>(bit), start_offset, &pos);
+  } else {
+    s = storage->BitPos(client->Key(), static_cast<int32_t>(bit), start_offset, end_offset, &pos);
+  }
+  if (s.ok()) {
+    client->AppendInteger(pos);
+  } else if (s.IsNotFound()) {
+    // a missing key is all zero bits
+    client->AppendInteger(bit == 1 ? -1 : 0);
+  } else {
+    client->SetRes(CmdRes::kErrOther, s.ToString());
+  }
+}
+
 DecrCmd::DecrCmd(const std::string& name, int16_t arity)
     : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryString) {}
 
@@ -685,4 +731,61 @@ void MSetnxCmd::DoCmd(PClient* client) {
   }
 }
 
+PfAddCmd::PfAddCmd(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryHyperloglog) {}
+
+bool PfAddCmd::DoInitial(PClient* client) {
+  client->SetKey(client->argv_[1]);
+  return true;
+}
+
+void PfAddCmd::DoCmd(PClient* client) {
+  std::vector<std::string> values(client->argv_.begin() + 2, client->argv_.end());
+  bool update = false;
+  storage::Status s = PSTORE.GetBackend(client->GetCurrentDB())->GetStorage()->PfAdd(client->Key(), values, &update);
+  if (s.ok()) {
+    client->AppendInteger(update ? 1 : 0);
+  } else {
+    client->SetRes(CmdRes::kErrOther, s.ToString());
+  }
+}
+
+PfCountCmd::PfCountCmd(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsReadonly, kAclCategoryRead | kAclCategoryHyperloglog) {}
+
+bool PfCountCmd::DoInitial(PClient* client) {
+  std::vector<std::string> keys(client->argv_.begin() + 1, client->argv_.end());
+  client->SetKey(keys);
+  return true;
+}
+
+void PfCountCmd::DoCmd(PClient* client) {
+  int64_t count = 0;
+  storage::Status s = PSTORE.GetBackend(client->GetCurrentDB())->GetStorage()->PfCount(client->Keys(), &count);
+  if (s.ok()) {
+    client->AppendInteger(count);
+  } else {
+    client->SetRes(CmdRes::kErrOther, s.ToString());
+  }
+}
+
+PfMergeCmd::PfMergeCmd(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsWrite, kAclCategoryWrite | kAclCategoryHyperloglog) {}
+
+bool PfMergeCmd::DoInitial(PClient* client) {
+  std::vector<std::string> keys(client->argv_.begin() + 1, client->argv_.end());
+  client->SetKey(keys);
+  return true;
+}
+
+void PfMergeCmd::DoCmd(PClient* client) {
+  std::string value;
+  storage::Status s = PSTORE.GetBackend(client->GetCurrentDB())->GetStorage()->PfMerge(client->Keys(), value);
+  if (s.ok()) {
+    client->SetRes(CmdRes::kOK);
+  } else {
+    client->SetRes(CmdRes::kErrOther, s.ToString());
+  }
+}
+
 }  // namespace pikiwidb
@@ -209,6 +209,17 @@ class SetBitCmd : public BaseCmd {
   void DoCmd(PClient *client) override;
 };
 
+class BitPosCmd : public BaseCmd {
+ public:
+  BitPosCmd(const std::string &name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient *client) override;
+
+ private:
+  void DoCmd(PClient *client) override;
+};
+
 class GetBitCmd : public BaseCmd {
  public:
   GetBitCmd(const std::string &name, int16_t arity);
@@ -264,4 +275,37 @@ class MSetnxCmd : public BaseCmd {
   void DoCmd(PClient *client) override;
 };
 
+class PfAddCmd : public BaseCmd {
+ public:
+  PfAddCmd(const std::string &name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient *client) override;
+
+ private:
+  void DoCmd(PClient *client) override;
+};
+
+class PfCountCmd : public BaseCmd {
+ public:
+  PfCountCmd(const std::string &name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient *client) override;
+
+ private:
+  void DoCmd(PClient *client) override;
+};
+
+class PfMergeCmd : public BaseCmd {
+ public:
+  PfMergeCmd(const std::string &name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient *client) override;
+
+ private:
+  void DoCmd(PClient *client) override;
+};
+
 }  // namespace pikiwidb
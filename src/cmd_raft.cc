@@ -30,8 +30,8 @@ bool RaftNodeCmd::DoInitial(PClient* client) {
   auto cmd = client->argv_[1];
   pstd::StringToUpper(cmd);
 
-  if (cmd != kAddCmd && cmd != kRemoveCmd && cmd != kDoSnapshot) {
-    client->SetRes(CmdRes::kErrOther, "RAFT.NODE supports ADD / REMOVE / DOSNAPSHOT only");
+  if (cmd != kAddCmd && cmd != kRemoveCmd && cmd != kDoSnapshot && cmd != kTransferCmd) {
+    client->SetRes(CmdRes::kErrOther, "RAFT.NODE supports ADD / REMOVE / DOSNAPSHOT / TRANSFER only");
     return false;
   }
   return true;
@@ -46,8 +46,10 @@ void RaftNodeCmd::DoCmd(PClient* client) {
     DoCmdRemove(client);
   } else if (cmd == kDoSnapshot) {
     DoCmdSnapshot(client);
+  } else if (cmd == kTransferCmd) {
+    DoCmdTransfer(client);
   } else {
-    client->SetRes(CmdRes::kErrOther, "RAFT.NODE supports ADD / REMOVE / DOSNAPSHOT only");
+    client->SetRes(CmdRes::kErrOther, "RAFT.NODE supports ADD / REMOVE / DOSNAPSHOT / TRANSFER only");
   }
 }
 
@@ -122,9 +124,28 @@ void RaftNodeCmd::DoCmdRemove(PClient* client) {
 }
 
 void RaftNodeCmd::DoCmdSnapshot(PClient* client) {
-  auto s = PRAFT.DoSnapshot();
+  // each raft group saves the snapshot of its instances
+  for (size_t i = 0; i < PRaft::GroupNum(); i++) {
+    if (auto s = PRaft::Group(i).DoSnapshot(); !s.ok()) {
+      return;
+    }
+  }
+  client->SetRes(CmdRes::kOK);
+}
+
+void RaftNodeCmd::DoCmdTransfer(PClient* client) {
+  if (client->argv_.size() != 3) {
+    return client->SetRes(CmdRes::kWrongNum, client->CmdName());
+  }
+  if (!PRAFT.IsLeader()) {
+    return client->SetRes(CmdRes::kErrOther, fmt::format("MOVED {}", PRAFT.GetLeaderAddress()));
+  }
+
+  auto s = PRAFT.TransferLeader(client->argv_[2]);
   if (s.ok()) {
     client->SetRes(CmdRes::kOK);
+  } else {
+    client->SetRes(CmdRes::kErrOther, fmt::format("Failed to transfer leader: {}", s.error_str()));
   }
 }
 
@@ -177,6 +198,36 @@ void RaftClusterCmd::DoCmdInit(PClient* client) {
   client->SetRes(CmdRes::kOK);
 }
 
+RaftWriteAckCmd::RaftWriteAckCmd(const std::string& name, int16_t arity)
+    : BaseCmd(name, arity, kCmdFlagsRaft, kAclCategoryRaft) {}
+
+bool RaftWriteAckCmd::DoInitial(PClient* client) {
+  if (client->argv_.size() > 2) {
+    client->SetRes(CmdRes::kWrongNum, client->CmdName());
+    return false;
+  }
+  return true;
+}
+
+void RaftWriteAckCmd::DoCmd(PClient* client) {
+  if (client->argv_.size() == 1) {
+    auto ack = client->GetRaftWriteAck();
+    if (ack == RaftWriteAck::kDefault && !ParseRaftWriteAck(g_config.raft_write_ack.ToString(), &ack)) {
+      ack = RaftWriteAck::kApply;
+    }
+    return client->AppendString(RaftWriteAckName(ack));
+  }
+
+  auto level = client->argv_[1];
+  pstd::StringToUpper(level);
+  RaftWriteAck ack = RaftWriteAck::kDefault;
+  if (level != kDefault && !ParseRaftWriteAck(level, &ack)) {
+    return client->SetRes(CmdRes::kErrOther, "RAFT.WRITEACK supports APPLY / COMMIT / LEADER / DEFAULT only");
+  }
+  client->SetRaftWriteAck(ack);
+  client->SetRes(CmdRes::kOK);
+}
+
 static inline std::optional<std::pair<std::string, int32_t>> GetIpAndPortFromEndPoint(const std::string& endpoint) {
   auto pos = endpoint.find(':');
   if (pos == std::string::npos) {
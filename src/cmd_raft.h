@@ -33,6 +33,12 @@ namespace pikiwidb {
  *   -CLUSTERDOWN ||
  *   -MOVED <slot> <addr>:<port> ||
  *   +OK
+ *
+ * RAFT.NODE TRANSFER [id]
+ *   Hand the raft groups this node leads over to another node.
+ * Reply:
+ *   -MOVED <addr>:<port> ||
+ *   +OK
  */
 class RaftNodeCmd : public BaseCmd {
  public:
@@ -46,10 +52,12 @@ class RaftNodeCmd : public BaseCmd {
   void DoCmdAdd(PClient *client);
   void DoCmdRemove(PClient *client);
   void DoCmdSnapshot(PClient *client);
+  void DoCmdTransfer(PClient *client);
 
   static constexpr std::string_view kAddCmd = "ADD";
   static constexpr std::string_view kRemoveCmd = "REMOVE";
   static constexpr std::string_view kDoSnapshot = "DOSNAPSHOT";
+  static constexpr std::string_view kTransferCmd = "TRANSFER";
 };
 
 /* RAFT.CLUSTER INIT <id>
@@ -80,4 +88,26 @@ class RaftClusterCmd : public BaseCmd {
   static constexpr std::string_view kJoinCmd = "JOIN";
 };
 
+/* RAFT.WRITEACK [APPLY | COMMIT | ACCEPTED | DEFAULT]
+ *   Sets when the writes of this connection are replied, see raft-write-ack,
+ *   DEFAULT goes back to raft-write-ack. Without an argument, replies the
+ *   level of the connection. With COMMIT or ACCEPTED a read of this connection
+ *   may not see its own writes yet, its writes of a key still see each other.
+ * Reply:
+ *   +OK ||
+ *   $<apply | commit | accepted>
+ */
+class RaftWriteAckCmd : public BaseCmd {
+ public:
+  RaftWriteAckCmd(const std::string &name, int16_t arity);
+
+ protected:
+  bool DoInitial(PClient *client) override;
+
+ private:
+  void DoCmd(PClient *client) override;
+
+  static constexpr std::string_view kDefault = "DEFAULT";
+};
+
 }  // namespace pikiwidb
@@ -67,9 +67,15 @@ void CmdTableManager::InitCmdTable() {
   // info
   ADD_COMMAND(Info, -1);
 
+  // replication
+  ADD_COMMAND(Slaveof, 3);
+  ADD_COMMAND(Replconf, -3);
+  ADD_COMMAND(Sync, 1);
+
   // raft
   ADD_COMMAND(RaftCluster, -1);
   ADD_COMMAND(RaftNode, -2);
+  ADD_COMMAND(RaftWriteAck, -1);
 
   // keyspace
   ADD_COMMAND(Del, -2);
@@ -103,6 +109,7 @@ void CmdTableManager::InitCmdTable() {
   ADD_COMMAND(PSetEx, 4);
   ADD_COMMAND(BitOp, -4);
   ADD_COMMAND(BitCount, -2);
+  ADD_COMMAND(BitPos, -3);
   ADD_COMMAND(GetBit, 3);
   ADD_COMMAND(GetRange, 4);
   ADD_COMMAND(SetRange, 4);
@@ -110,6 +117,11 @@ void CmdTableManager::InitCmdTable() {
   ADD_COMMAND(SetBit, 4);
   ADD_COMMAND(MSetnx, -3);
 
+  // hyperloglog
+  ADD_COMMAND(PfAdd, -2);
+  ADD_COMMAND(PfCount, -2);
+  ADD_COMMAND(PfMerge, -2);
+
   // hash
   ADD_COMMAND(HSet, -4);
   ADD_COMMAND(HGet, 3);
@@ -8,6 +8,7 @@
 #include "cmd_thread_pool_worker.h"
 #include "log.h"
 #include "pikiwidb.h"
+#include "praft/praft.h"
 
 namespace pikiwidb {
 
@@ -35,6 +36,16 @@ void CmdWorkThreadPoolWorker::Work() {
         g_pikiwidb->PushWriteTask(task->Client());
         continue;
       }
+      if (cmdPtr->HasFlag(kCmdFlagsWrite) && PRAFT.IsInitialized()) {
+        // the reply is pushed once the raft logs of the command are applied,
+        // the worker goes on with the next command meanwhile
+        auto reply = std::make_shared<PRaftPendingReply>(task->Client());
+        PRaftPendingReply::SetCurrent(reply);
+        task->Run(cmdPtr);
+        PRaftPendingReply::SetCurrent(nullptr);
+        reply->CommandDone();
+        continue;
+      }
       task->Run(cmdPtr);
       g_pikiwidb->PushWriteTask(task->Client());
     }
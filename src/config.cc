@@ -50,6 +50,14 @@ static Status CheckLogLevel(const std::string& value) {
   return Status::OK();
 }
 
+static Status CheckRaftWriteAck(const std::string& value) {
+  if (!pstd::StringEqualCaseInsensitive(value, "apply") && !pstd::StringEqualCaseInsensitive(value, "commit") &&
+      !pstd::StringEqualCaseInsensitive(value, "accepted")) {
+    return Status::InvalidArgument("The value must be apply / commit / accepted.");
+  }
+  return Status::OK();
+}
+
 Status BaseValue::Set(const std::string& value, bool init_stage) {
   if (!init_stage && !rewritable_) {
     return Status::NotSupported("Dynamic modification is not supported.");
@@ -124,7 +132,23 @@ PConfig::PConfig() {
   AddString("runid", false, {&run_id});
   AddNumber("small-compaction-threshold", true, &small_compaction_threshold);
   AddNumber("small-compaction-duration-threshold", true, &small_compaction_duration_threshold);
+  AddNumber("expire-reap-keys-per-second", false, &expire_reap_keys_per_second);
+  AddNumber("density-compaction-percent", false, &density_compaction_percent);
+  AddNumber("density-compaction-max-ranges", false, &density_compaction_max_ranges);
   AddBool("use-raft", &CheckYesNo, false, &use_raft);
+  AddNumber("raft-timeout-s", true, &raft_timeout_s);
+  AddNumber("raft-group-commit-window-us", true, &raft_group_commit_window_us);
+  AddNumber("raft-group-commit-max-bytes", true, &raft_group_commit_max_bytes);
+  AddBool("raft-binlog-compression", &CheckYesNo, true, &raft_binlog_compression);
+  AddNumber("raft-binlog-compression-threshold", true, &raft_binlog_compression_threshold);
+  AddBool("raft-linearizable-read", &CheckYesNo, true, &raft_linearizable_read);
+  AddNumber("raft-snapshot-max-bytes-per-second", false, &raft_snapshot_max_bytes_per_second);
+  AddNumber("raft-snapshot-chunk-bytes", false, &raft_snapshot_chunk_bytes);
+  AddNumber("raft-max-replay-logs", false, &raft_max_replay_logs);
+  AddNumber("raft-max-replay-bytes", false, &raft_max_replay_bytes);
+  AddNumber("raft-replay-flush-interval-ms", false, &raft_replay_flush_interval_ms);
+  AddBool("raft-group-per-instance", &CheckYesNo, false, &raft_group_per_instance);
+  AddStrinWithFunc("raft-write-ack", &CheckRaftWriteAck, true, {&raft_write_ack});
 
   // rocksdb config
   AddNumber("rocksdb-max-subcompactions", false, &rocksdb_max_subcompactions);
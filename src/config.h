@@ -141,12 +141,43 @@ class PConfig {
   std::atomic_uint64_t max_client_response_size = 1073741824;
   std::atomic_uint64_t small_compaction_threshold = 604800;
   std::atomic_uint64_t small_compaction_duration_threshold = 259200;
+  std::atomic_uint64_t expire_reap_keys_per_second = 1000;
+  std::atomic_uint64_t density_compaction_percent = 50;
+  std::atomic_uint64_t density_compaction_max_ranges = 8;
 
   std::atomic_bool daemonize = false;
   AtomicString pid_file = "./pikiwidb.pid";
   AtomicString ip = "127.0.0.1";
   std::atomic_uint16_t port = 9221;
   std::atomic_uint16_t raft_port_offset = 10;
+  // seconds a write waits for its raft logs to be applied before it fails
+  std::atomic_uint32_t raft_timeout_s = 10;
+  // the binlogs appended in this many microseconds are committed as one raft
+  // log, unless they reach raft_group_commit_max_bytes first, 0 disables it
+  std::atomic_uint32_t raft_group_commit_window_us = 100;
+  std::atomic_uint32_t raft_group_commit_max_bytes = 256 * 1024;
+  // raft logs of at least raft_binlog_compression_threshold bytes are
+  // compressed with LZF, once all the peers read compressed logs
+  std::atomic_bool raft_binlog_compression = false;
+  std::atomic_uint32_t raft_binlog_compression_threshold = 4096;
+  // reads wait for a read index of the leader, so any node serves them
+  // linearizably, see PRaft::ReadBarrier
+  std::atomic_bool raft_linearizable_read = false;
+  // the snapshot files a node sends or receives per second, 0 is no limit
+  std::atomic_uint64_t raft_snapshot_max_bytes_per_second = 0;
+  // bytes of a snapshot file copied in one RPC
+  std::atomic_uint32_t raft_snapshot_chunk_bytes = 4 * 1024 * 1024;
+  // the raft logs a restart replays, kept under these by flushing the column
+  // families of the oldest ones at most once in raft_replay_flush_interval_ms
+  std::atomic_int64_t raft_max_replay_logs = 100000;
+  std::atomic_uint64_t raft_max_replay_bytes = 256 * 1024 * 1024;
+  std::atomic_uint32_t raft_replay_flush_interval_ms = 1000;
+  // a raft group for each storage instance instead of one for the node, see
+  // PRaft::Group
+  std::atomic_bool raft_group_per_instance = false;
+  // when the writes of the connections without RAFT.WRITEACK are replied,
+  // apply, commit or accepted, see RaftWriteAck
+  AtomicString raft_write_ack = "apply";
   AtomicString db_path = "./db/";
   AtomicString log_dir = "stdout";  // the log directory, differ from redis
   AtomicString log_level = "warning";
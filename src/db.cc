@@ -16,6 +16,25 @@ extern pikiwidb::PConfig g_config;
 
 namespace pikiwidb {
 
+// The binlogs of an instance go to the raft group of the instance, which is
+// the group of the node unless raft-group-per-instance.
+static void SetRaftOptions(storage::StorageOptions* storage_options) {
+  storage_options->append_log_function = [](storage::BinlogWriter&& log, std::promise<rocksdb::Status>&& promise) {
+    PRaft::Group(log.SlotIdx()).AppendLog(std::move(log), std::move(promise));
+  };
+  storage_options->do_snapshot_function = [](int32_t index, int64_t log_index, bool sync) {
+    PRaft::Group(index).DoSnapshot(log_index, sync);
+  };
+  storage_options->is_leader_function = [](int32_t index) {
+    auto& group = PRaft::Group(index);
+    return group.IsInitialized() && group.IsLeader();
+  };
+  storage_options->raft_timeout_s = g_config.raft_timeout_s.load();
+  storage_options->max_gap = g_config.raft_max_replay_logs.load();
+  storage_options->max_gap_bytes = g_config.raft_max_replay_bytes.load();
+  storage_options->gap_flush_interval_ms = g_config.raft_replay_flush_interval_ms.load();
+}
+
 DB::DB(int db_index, const std::string& db_path)
     : db_index_(db_index), db_path_(db_path + std::to_string(db_index_) + '/') {}
 
@@ -32,13 +51,12 @@ rocksdb::Status DB::Open() {
 
   storage_options.small_compaction_threshold = g_config.small_compaction_threshold.load();
   storage_options.small_compaction_duration_threshold = g_config.small_compaction_duration_threshold.load();
+  storage_options.expire_reap_keys_per_second = g_config.expire_reap_keys_per_second.load();
+  storage_options.density_compaction_percent = g_config.density_compaction_percent.load();
+  storage_options.density_compaction_max_ranges = g_config.density_compaction_max_ranges.load();
 
   if (g_config.use_raft.load(std::memory_order_relaxed)) {
-    storage_options.append_log_function = [&r = PRAFT](const Binlog& log, std::promise<rocksdb::Status>&& promise) {
-      r.AppendLog(log, std::move(promise));
-    };
-    storage_options.do_snapshot_function =
-        std::bind(&pikiwidb::PRaft::DoSnapshot, &pikiwidb::PRAFT, std::placeholders::_1, std::placeholders::_2);
+    SetRaftOptions(&storage_options);
   }
 
   storage_options.db_instance_num = g_config.db_instance_num.load();
@@ -61,23 +79,28 @@ rocksdb::Status DB::Open() {
   return rocksdb::Status::OK();
 }
 
-void DB::CreateCheckpoint(const std::string& checkpoint_path, bool sync) {
+rocksdb::Status DB::CreateCheckpoint(const std::string& checkpoint_path, bool sync, uint64_t log_size_for_flush,
+                                     int instance) {
   auto checkpoint_sub_path = checkpoint_path + '/' + std::to_string(db_index_);
   if (0 != pstd::CreatePath(checkpoint_sub_path)) {
     WARN("Create dir {} fail !", checkpoint_sub_path);
-    return;
+    return rocksdb::Status::IOError("Create dir fail", checkpoint_sub_path);
   }
 
   std::shared_lock sharedLock(storage_mutex_);
-  auto result = storage_->CreateCheckpoint(checkpoint_sub_path);
+  auto result = storage_->CreateCheckpoint(checkpoint_sub_path, log_size_for_flush, instance);
+  rocksdb::Status status;
   if (sync) {
     for (auto& r : result) {
-      r.get();
+      if (auto s = r.get(); !s.ok() && status.ok()) {
+        status = s;
+      }
     }
   }
+  return status;
 }
 
-void DB::LoadDBFromCheckpoint(const std::string& checkpoint_path, bool sync [[maybe_unused]]) {
+void DB::LoadDBFromCheckpoint(const std::string& checkpoint_path, bool sync [[maybe_unused]], int instance) {
   auto checkpoint_sub_path = checkpoint_path + '/' + std::to_string(db_index_);
   if (0 != pstd::IsDir(checkpoint_sub_path)) {
     WARN("Checkpoint dir {} does not exist!", checkpoint_sub_path);
@@ -91,6 +114,16 @@ void DB::LoadDBFromCheckpoint(const std::string& checkpoint_path, bool sync [[ma
   }
 
   std::lock_guard<std::shared_mutex> lock(storage_mutex_);
+  if (instance != -1) {
+    if (auto s = storage_->LoadInstanceCheckpoint(checkpoint_sub_path, db_path_, instance); !s.ok()) {
+      ERROR("DB{} load the checkpoint of RocksDB{} from {} failed, {}", db_index_, instance, checkpoint_path,
+            s.ToString());
+      return;
+    }
+    INFO("DB{} load the checkpoint of RocksDB{} from {} success!", db_index_, instance, checkpoint_path);
+    return;
+  }
+
   opened_ = false;
   auto result = storage_->LoadCheckpoint(checkpoint_sub_path, db_path_);
 
@@ -102,17 +135,16 @@ void DB::LoadDBFromCheckpoint(const std::string& checkpoint_path, bool sync [[ma
   storage_options.options = g_config.GetRocksDBOptions();
   storage_options.db_instance_num = g_config.db_instance_num.load();
   storage_options.db_id = db_index_;
+  storage_options.expire_reap_keys_per_second = g_config.expire_reap_keys_per_second.load();
+  storage_options.density_compaction_percent = g_config.density_compaction_percent.load();
+  storage_options.density_compaction_max_ranges = g_config.density_compaction_max_ranges.load();
 
   // options for CF
   storage_options.options.ttl = g_config.rocksdb_ttl_second.load(std::memory_order_relaxed);
   storage_options.options.periodic_compaction_seconds =
       g_config.rocksdb_periodic_second.load(std::memory_order_relaxed);
   if (g_config.use_raft.load(std::memory_order_relaxed)) {
-    storage_options.append_log_function = [&r = PRAFT](const Binlog& log, std::promise<rocksdb::Status>&& promise) {
-      r.AppendLog(log, std::move(promise));
-    };
-    storage_options.do_snapshot_function =
-        std::bind(&pikiwidb::PRaft::DoSnapshot, &pikiwidb::PRAFT, std::placeholders::_1, std::placeholders::_2);
+    SetRaftOptions(&storage_options);
   }
   storage_ = std::make_unique<storage::Storage>();
 
@@ -33,9 +33,12 @@ class DB {
 
   void UnLockShared() { storage_mutex_.unlock_shared(); }
 
-  void CreateCheckpoint(const std::string& path, bool sync);
+  // the status of the checkpoint is only known when sync, instance is -1 for
+  // all the instances
+  rocksdb::Status CreateCheckpoint(const std::string& path, bool sync, uint64_t log_size_for_flush = storage::kFlush,
+                                   int instance = -1);
 
-  void LoadDBFromCheckpoint(const std::string& path, bool sync = true);
+  void LoadDBFromCheckpoint(const std::string& path, bool sync = true, int instance = -1);
 
   int GetDbIndex() { return db_index_; }
 
@@ -8,6 +8,7 @@
 #include "tcp_connection.h"
 
 #include <netinet/tcp.h>
+#include <unistd.h>
 
 #include <cassert>
 #include <memory>
@@ -174,6 +175,38 @@ bool TcpConnection::SendPacket(const evbuffer_iovec* iovecs, size_t nvecs) {
   return true;
 }
 
+bool TcpConnection::SendFile(int fd, size_t size, std::function<void()> on_sent) {
+  if (state_ != State::kConnected) {
+    ERROR("send tcp file in wrong state {}", static_cast<int>(state_));
+    ::close(fd);
+    return false;
+  }
+
+  if (!loop_->InThisLoop()) {
+    auto w_obj(weak_from_this());
+    loop_->Execute([w_obj, fd, size, on_sent = std::move(on_sent)]() mutable {
+      auto c = w_obj.lock();
+      if (!c) {
+        ::close(fd);
+        return;  // connection already lost
+      }
+
+      std::static_pointer_cast<TcpConnection>(c)->SendFile(fd, size, std::move(on_sent));
+    });
+    return true;
+  }
+
+  auto output = bufferevent_get_output(bev_);
+  if (evbuffer_add_file(output, fd, 0, static_cast<ev_off_t>(size)) != 0) {
+    ERROR("add file of {} bytes to the output of {}:{} failed", size, peer_ip_, peer_port_);
+    ::close(fd);
+    return false;
+  }
+  on_sent_ = std::move(on_sent);
+  bufferevent_setcb(bev_, &TcpConnection::OnRecvData, &TcpConnection::OnWriteDone, &TcpConnection::OnEvent, this);
+  return true;
+}
+
 void TcpConnection::HandleConnect() {
   assert(loop_->InThisLoop());
   assert(state_ == State::kNone || state_ == State::kConnecting);
@@ -260,6 +293,19 @@ bool TcpConnection::CheckIdleTimeout() const {
   return false;
 }
 
+void TcpConnection::OnWriteDone(struct bufferevent* bev, void* obj) {
+  auto me = std::static_pointer_cast<TcpConnection>(reinterpret_cast<TcpConnection*>(obj)->shared_from_this());
+
+  assert(me->loop_->InThisLoop());
+  assert(me->bev_ == bev);
+
+  // the output is empty, on_sent may send the next file
+  if (auto on_sent = std::move(me->on_sent_)) {
+    me->on_sent_ = nullptr;
+    on_sent();
+  }
+}
+
 void TcpConnection::OnRecvData(struct bufferevent* bev, void* obj) {
   auto me = std::static_pointer_cast<TcpConnection>(reinterpret_cast<TcpConnection*>(obj)->shared_from_this());
 
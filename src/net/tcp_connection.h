@@ -42,6 +42,10 @@ class TcpConnection : public EventObject {
   bool SendPacket(const void*, size_t);
   bool SendPacket(UnboundedBuffer& data) { return SendPacket(data.ReadAddr(), data.ReadableSize()); }
   bool SendPacket(const evbuffer_iovec* iovecs, size_t nvecs);
+  // Sends the size bytes of the file fd with sendfile where the platform has
+  // it, without reading them into memory, and closes fd. on_sent is called in
+  // the loop once they and the data before them are written to the socket.
+  bool SendFile(int fd, size_t size, std::function<void()> on_sent);
 
   void SetNewConnCallback(NewTcpConnectionCallback cb) { on_new_conn_ = std::move(cb); }
   void SetOnDisconnect(TcpDisconnectCallback cb) { on_disconnect_ = std::move(cb); }
@@ -76,6 +80,7 @@ class TcpConnection : public EventObject {
   bool CheckIdleTimeout() const;
 
   static void OnRecvData(struct bufferevent* bev, void* ctx);
+  static void OnWriteDone(struct bufferevent* bev, void* ctx);
   static void OnEvent(struct bufferevent* bev, short what, void* ctx);
 
   void HandleConnect();
@@ -103,6 +108,8 @@ class TcpConnection : public EventObject {
   TcpDisconnectCallback on_disconnect_;
   TcpConnectionFailCallback on_fail_;
   NewTcpConnectionCallback on_new_conn_;
+  // of the last SendFile
+  std::function<void()> on_sent_;
 
   TimerId idle_timer_ = -1;
   int idle_timeout_ms_ = 0;
@@ -168,8 +168,8 @@ bool PikiwiDB::Init() {
   auto loop = worker_threads_.BaseLoop();
   loop->ScheduleRepeatedly(1000, &PReplication::Cron, &PREPL);
 
-  // master ip
-  if (!g_config.ip.empty()) {
+  // master ip, the nodes of a raft cluster replicate by raft instead
+  if (!g_config.use_raft.load() && !g_config.master_ip.empty()) {
     PREPL.SetMasterAddr(g_config.master_ip.ToString().c_str(), g_config.master_port.load());
   }
 
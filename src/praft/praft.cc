@@ -7,16 +7,30 @@
 
 #include "praft.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <tuple>
 
+#include "braft/cli.h"
 #include "braft/snapshot.h"
 #include "braft/util.h"
+#include "brpc/channel.h"
 #include "brpc/server.h"
+#include "butil/time.h"
+#include "gflags/gflags.h"
 
 #include "pstd/log.h"
 #include "pstd/pstd_string.h"
 
+extern "C" {
+#include "net/lzf/lzf.h"
+}
+
 #include "binlog.pb.h"
+
 #include "config.h"
 #include "pikiwidb.h"
 #include "replication.h"
@@ -33,6 +47,236 @@
 
 namespace pikiwidb {
 
+namespace {
+
+thread_local std::shared_ptr<PRaftPendingReply> current_pending_reply;
+
+std::atomic<uint64_t> write_ack_replies[3];
+std::atomic<uint64_t> write_ack_failures;
+
+}  // namespace
+
+const char* RaftWriteAckName(RaftWriteAck ack) {
+  switch (ack) {
+    case RaftWriteAck::kCommit:
+      return "commit";
+    case RaftWriteAck::kAccepted:
+      return "accepted";
+    default:
+      return "apply";
+  }
+}
+
+bool ParseRaftWriteAck(const std::string& name, RaftWriteAck* ack) {
+  for (auto level : {RaftWriteAck::kApply, RaftWriteAck::kCommit, RaftWriteAck::kAccepted}) {
+    if (pstd::StringEqualCaseInsensitive(name, RaftWriteAckName(level))) {
+      *ack = level;
+      return true;
+    }
+  }
+  return false;
+}
+
+PRaftPendingReply::PRaftPendingReply(std::shared_ptr<PClient> client)
+    : client_(std::move(client)), ack_(client_->GetRaftWriteAck()) {
+  if (ack_ == RaftWriteAck::kDefault && !ParseRaftWriteAck(g_config.raft_write_ack.ToString(), &ack_)) {
+    ack_ = RaftWriteAck::kApply;
+  }
+}
+
+const std::shared_ptr<PRaftPendingReply>& PRaftPendingReply::Current() { return current_pending_reply; }
+
+void PRaftPendingReply::SetCurrent(std::shared_ptr<PRaftPendingReply> reply) {
+  current_pending_reply = std::move(reply);
+  pstd::lock::DeferredUnlock::SetCurrent(nullptr);
+}
+
+void PRaftPendingReply::AddLog() {
+  std::lock_guard lock(mutex_);
+  if (pending_logs_++ == 0 && timer_arg_ == nullptr) {
+    timer_arg_ = new std::weak_ptr<PRaftPendingReply>(weak_from_this());
+    auto abstime = butil::seconds_from_now(g_config.raft_timeout_s.load());
+    if (bthread_timer_add(&timer_, abstime, &PRaftPendingReply::OnTimeout, timer_arg_) != 0) {
+      delete timer_arg_;
+      timer_arg_ = nullptr;
+    }
+  }
+}
+
+void PRaftPendingReply::LogDone(const rocksdb::Status& status) {
+  std::lock_guard lock(mutex_);
+  if (status_.ok() && !status.ok()) {
+    status_ = status;
+  }
+  pending_logs_--;
+  MaybeReply();
+}
+
+void PRaftPendingReply::CommandDone() {
+  std::lock_guard lock(mutex_);
+  command_done_ = true;
+  MaybeReply();
+}
+
+void PRaftPendingReply::LogFailedAfterAck() { write_ack_failures++; }
+
+PRaftPendingReply::WriteAckStats PRaftPendingReply::GetWriteAckStats() {
+  WriteAckStats stats;
+  for (int i = 0; i < 3; i++) {
+    stats.replies[i] = write_ack_replies[i].load();
+  }
+  stats.failed_after_ack = write_ack_failures.load();
+  return stats;
+}
+
+void PRaftPendingReply::OnTimeout(void* arg) {
+  auto weak_reply = static_cast<std::weak_ptr<PRaftPendingReply>*>(arg);
+  if (auto reply = weak_reply->lock()) {
+    std::lock_guard lock(reply->mutex_);
+    reply->timed_out_ = true;
+    reply->MaybeReply();
+  }
+  delete weak_reply;
+}
+
+void PRaftPendingReply::MaybeReply() {
+  if (replied_ || !command_done_ || (pending_logs_ > 0 && !timed_out_)) {
+    return;
+  }
+  replied_ = true;
+  if (pending_logs_ > 0 && status_.ok()) {
+    status_ = rocksdb::Status::Incomplete("Wait for write timeout");
+  }
+  // a running timer deletes its arg itself
+  if (timer_arg_ != nullptr && !timed_out_ && bthread_timer_del(timer_) == 0) {
+    delete timer_arg_;
+  }
+  timer_arg_ = nullptr;
+  if (!status_.ok()) {
+    // the command has written its reply already, the error replaces it
+    client_->Clear();
+    client_->SetRes(CmdRes::kErrOther, status_.ToString());
+  }
+  write_ack_replies[static_cast<int>(ack_)]++;
+  g_pikiwidb->PushWriteTask(client_);
+}
+
+void PRaftWriteDoneClosure::Run() {
+  // braft runs the closure without applying the log when the node is not, or
+  // no longer, the leader
+  if (!status().ok()) {
+    result_ = rocksdb::Status::Aborted("Raft log not applied", status().error_cstr());
+  }
+  if (reply_) {
+    keys_->Release();
+    if (!acked_) {
+      reply_->LogDone(result_);
+    } else if (!result_.ok()) {
+      PRaftPendingReply::LogFailedAfterAck();
+    }
+  } else {
+    promise_.set_value(result_);
+  }
+  delete this;
+}
+
+void PRaftWriteDoneClosure::Ack(RaftWriteAck ack) {
+  if (reply_ && !acked_ && reply_->Ack() == ack) {
+    acked_ = true;
+    reply_->LogDone(rocksdb::Status::OK());
+  }
+}
+
+/*
+ * The closure of a group commit, the raft log of the binlogs appended in the
+ * group commit window. The binlogs of the same db and slot are merged into
+ * one, so a log still makes one write batch per instance, and each write
+ * gets the status of the binlog it was merged into.
+ */
+class PRaftGroupDoneClosure : public braft::Closure {
+ public:
+  void Add(storage::BinlogWriter&& log, PRaftWriteDoneClosure* done) {
+    auto [it, inserted] = binlogs_.try_emplace({log.DbId(), log.SlotIdx(), log.KeyFormat()}, group_.size());
+    if (inserted) {
+      group_.emplace_back();
+      results_.emplace_back(rocksdb::Status::Aborted("Unknown error"));
+    }
+    bytes_ += log.Size();
+    group_[it->second].push_back(std::move(log));
+    members_.emplace_back(it->second, done);
+  }
+
+  // Moves the buffers of the binlogs into data, the merged binlog of each db
+  // and slot is its binlogs one after another.
+  bool Serialize(butil::IOBuf* data) {
+    for (auto& binlogs : group_) {
+      size_t size = 0;
+      for (const auto& binlog : binlogs) {
+        size += binlog.Size();
+      }
+      data->append(storage::BinlogWriter::GroupHeader(size));
+      for (auto& binlog : binlogs) {
+        size = binlog.Size();
+        char* buf = binlog.Release();
+        if (data->append_user_data(buf, size, free) != 0) {
+          free(buf);
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  size_t ByteSize() const { return bytes_; }
+
+  void Ack(RaftWriteAck ack) {
+    for (auto [_, done] : members_) {
+      done->Ack(ack);
+    }
+  }
+
+  void SetStatus(int binlog, rocksdb::Status status) { results_[binlog] = std::move(status); }
+  void SetStatus(const rocksdb::Status& status) { std::fill(results_.begin(), results_.end(), status); }
+
+  void Run() override {
+    for (auto [binlog, done] : members_) {
+      if (status().ok()) {
+        done->SetStatus(results_[binlog]);
+      } else {
+        done->status() = status();
+      }
+      done->Run();
+    }
+    delete this;
+  }
+
+ private:
+  // the binlogs of each db, slot and key format in the order of the group
+  std::vector<std::vector<storage::BinlogWriter>> group_;
+  // the index in group_ of the binlogs of each db, slot and key format
+  std::map<std::tuple<uint32_t, uint32_t, uint32_t>, int> binlogs_;
+  std::vector<std::pair<int, PRaftWriteDoneClosure*>> members_;
+  std::vector<rocksdb::Status> results_;
+  size_t bytes_ = 0;
+};
+
+// The closure of a read barrier of ReadIndex, an empty raft log. Once it is
+// applied the node was still the leader when it was committed.
+class PRaftReadBarrierClosure : public braft::Closure {
+ public:
+  std::future<std::pair<butil::Status, int64_t>> GetFuture() { return promise_.get_future(); }
+  void SetIndex(int64_t index) { index_ = index; }
+
+  void Run() override {
+    promise_.set_value({status(), index_});
+    delete this;
+  }
+
+ private:
+  std::promise<std::pair<butil::Status, int64_t>> promise_;
+  int64_t index_ = 0;
+};
+
 bool ClusterCmdContext::Set(ClusterCmdType cluster_cmd_type, PClient* client, std::string&& peer_ip, int port,
                             std::string&& peer_id) {
   std::unique_lock<std::mutex> lck(mtx_);
@@ -84,7 +328,29 @@ PRaft& PRaft::Instance() {
   return store;
 }
 
+PRaft& PRaft::Group(size_t index) {
+  static std::vector<std::unique_ptr<PRaft>> groups = [] {
+    std::vector<std::unique_ptr<PRaft>> groups;
+    for (size_t i = 1; i < GroupNum(); i++) {
+      groups.push_back(std::make_unique<PRaft>(i));
+    }
+    return groups;
+  }();
+  return index == 0 || index > groups.size() ? Instance() : *groups[index - 1];
+}
+
+size_t PRaft::GroupNum() {
+  // the instances are opened once, with the number of the config file
+  static const size_t group_num =
+      g_config.raft_group_per_instance.load() ? std::max<size_t>(1, g_config.db_instance_num.load()) : 1;
+  return group_num;
+}
+
 butil::Status PRaft::Init(std::string& group_id, bool initial_conf_is_null) {
+  auto& instance = Instance();
+  if (this != &instance) {
+    return instance.Init(group_id, initial_conf_is_null);
+  }
   if (node_ && server_) {
     return {0, "OK"};
   }
@@ -92,8 +358,9 @@ butil::Status PRaft::Init(std::string& group_id, bool initial_conf_is_null) {
   server_ = std::make_unique<brpc::Server>();
   auto port = g_config.port + pikiwidb::g_config.raft_port_offset;
   // Add your service into RPC server
-  DummyServiceImpl service(&PRAFT);
-  if (server_->AddService(&service, brpc::SERVER_DOESNT_OWN_SERVICE) != 0) {
+  auto service = new DummyServiceImpl(&PRAFT);
+  if (server_->AddService(service, brpc::SERVER_OWNS_SERVICE) != 0) {
+    delete service;
     server_.reset();
     return ERROR_LOG_AND_STATUS("Failed to add service");
   }
@@ -115,12 +382,15 @@ butil::Status PRaft::Init(std::string& group_id, bool initial_conf_is_null) {
     server_.reset();
     return ERROR_LOG_AND_STATUS("Failed to start server");
   }
+  // the leader serves ReadIndex from its lease, without a read barrier log
+  google::SetCommandLineOption("raft_enable_leader_lease", "true");
+  // a snapshot file is copied one chunk at a time, in RPCs of this size
+  google::SetCommandLineOption("raft_max_byte_count_per_rpc",
+                               std::to_string(g_config.raft_snapshot_chunk_bytes.load()).c_str());
   // It's ok to start PRaft;
   assert(group_id.size() == RAFT_GROUPID_LEN);
-  this->group_id_ = group_id;
 
   // FIXME: g_config.ip is default to 127.0.0.0, which may not work in cluster.
-  raw_addr_ = g_config.ip.ToString() + ":" + std::to_string(port);
   butil::ip_t ip;
   auto ret = butil::str2ip(g_config.ip.ToString().c_str(), &ip);
   if (ret != 0) {
@@ -128,6 +398,30 @@ butil::Status PRaft::Init(std::string& group_id, bool initial_conf_is_null) {
     return ERROR_LOG_AND_STATUS("Failed to convert str_ip to butil::ip_t");
   }
   butil::EndPoint addr(ip, port);
+  // the snapshots of all the groups share the cap of the node
+  if (auto bytes_per_second = g_config.raft_snapshot_max_bytes_per_second.load(); bytes_per_second > 0) {
+    snapshot_throttle_ = new braft::ThroughputSnapshotThrottle(static_cast<int64_t>(bytes_per_second), 10);
+  }
+
+  for (size_t i = 0; i < GroupNum(); i++) {
+    if (auto s = Group(i).InitNode(group_id, addr, initial_conf_is_null); !s.ok()) {
+      for (size_t j = 0; j < i; j++) {
+        Group(j).node_->shutdown(nullptr);
+        Group(j).node_->join();
+        Group(j).node_.reset();
+      }
+      server_.reset();
+      return s;
+    }
+  }
+
+  return {0, "OK"};
+}
+
+butil::Status PRaft::InitNode(const std::string& group_id, const butil::EndPoint& addr, bool initial_conf_is_null) {
+  read_index_pool_ = std::make_unique<pstd::ThreadPool>();
+  this->group_id_ = group_id;
+  raw_addr_ = butil::endpoint2str(addr).c_str();
 
   // Default init in one node.
   // initial_conf takes effect only when the replication group is started from an empty node.
@@ -142,7 +436,6 @@ butil::Status PRaft::Init(std::string& group_id, bool initial_conf_is_null) {
     initial_conf = raw_addr_ + ":0,";
   }
   if (node_options_.initial_conf.parse_from(initial_conf) != 0) {
-    server_.reset();
     return ERROR_LOG_AND_STATUS("Failed to parse configuration");
   }
 
@@ -151,16 +444,23 @@ butil::Status PRaft::Init(std::string& group_id, bool initial_conf_is_null) {
   node_options_.node_owns_fsm = false;
   node_options_.snapshot_interval_s = 0;
   std::string prefix = "local://" + g_config.db_path.ToString() + "_praft";
+  if (GroupNum() > 1) {
+    prefix += "/" + std::to_string(index_);
+  }
   node_options_.log_uri = prefix + "/log";
   node_options_.raft_meta_uri = prefix + "/raft_meta";
   node_options_.snapshot_uri = prefix + "/snapshot";
   // node_options_.disable_cli = FLAGS_disable_cli;
-  snapshot_adaptor_ = new PPosixFileSystemAdaptor();
+  snapshot_adaptor_ = new PPosixFileSystemAdaptor(SnapshotInstance());
   node_options_.snapshot_file_system_adaptor = &snapshot_adaptor_;
+  // a follower keeps the files of the snapshot it has already, by checksum
+  node_options_.filter_before_copy_remote = true;
+  if (Instance().snapshot_throttle_) {
+    node_options_.snapshot_throttle = &Instance().snapshot_throttle_;
+  }
 
-  node_ = std::make_unique<braft::Node>("pikiwidb", braft::PeerId(addr));  // group_id
+  node_ = std::make_unique<braft::Node>(GroupName(), braft::PeerId(addr));  // group_id
   if (node_->init(node_options_) != 0) {
-    server_.reset();
     node_.reset();
     return ERROR_LOG_AND_STATUS("Failed to init raft node");
   }
@@ -168,6 +468,8 @@ butil::Status PRaft::Init(std::string& group_id, bool initial_conf_is_null) {
   return {0, "OK"};
 }
 
+std::string PRaft::GroupName() const { return GroupNum() == 1 ? "pikiwidb" : "pikiwidb_" + std::to_string(index_); }
+
 bool PRaft::IsLeader() const {
   if (!node_) {
     ERROR("Node is not initialized");
@@ -316,6 +618,8 @@ int PRaft::ProcessClusterCmdResponse(PClient* client, const char* start, int len
 void PRaft::CheckRocksDBConfiguration(PClient* client, PClient* join_client, const std::string& reply) {
   int databases_num = 0;
   int rocksdb_num = 0;
+  // the nodes of an older version have one raft group
+  int raft_groups_num = 1;
   std::string rockdb_version;
   std::string line;
   std::istringstream iss(reply);
@@ -340,6 +644,8 @@ void PRaft::CheckRocksDBConfiguration(PClient* client, PClient* join_client, con
         cluster_cmd_ctx_.Clear();
       } else if (key == ROCKSDB_VERSION) {
         rockdb_version = pstd::StringTrimRight(value, "\r");
+      } else if (key == RAFT_GROUPS_NUM) {
+        pstd::String2int(pstd::StringTrimRight(value, "\r"), &raft_groups_num);
       }
     }
   }
@@ -348,8 +654,9 @@ void PRaft::CheckRocksDBConfiguration(PClient* client, PClient* join_client, con
   int current_rocksdb_num = pikiwidb::g_config.db_instance_num;
   std::string current_rocksdb_version = ROCKSDB_NAMESPACE::GetRocksVersionAsString();
   if (current_databases_num != databases_num || current_rocksdb_num != rocksdb_num ||
-      current_rocksdb_version != rockdb_version) {
-    join_client->SetRes(CmdRes::kErrOther, "Config of databases_num, rocksdb_num or rocksdb_version mismatch");
+      current_rocksdb_version != rockdb_version || static_cast<int>(GroupNum()) != raft_groups_num) {
+    join_client->SetRes(CmdRes::kErrOther,
+                        "Config of databases_num, rocksdb_num, rocksdb_version or raft_groups_num mismatch");
     join_client->SendPacket(join_client->Message());
     join_client->Clear();
     // If the join fails, clear clusterContext and set it again by using the join command
@@ -483,35 +790,77 @@ int PRaft::ProcessClusterRemoveCmdResponse(PClient* client, const char* start, i
 }
 
 butil::Status PRaft::AddPeer(const std::string& peer) {
-  if (!node_) {
-    ERROR_LOG_AND_STATUS("Node is not initialized");
+  for (size_t i = 0; i < GroupNum(); i++) {
+    if (auto s = Group(i).ChangePeer(peer, true); !s.ok()) {
+      return s;
+    }
   }
+  return {0, "OK"};
+}
 
-  braft::SynchronizedClosure done;
-  node_->add_peer(peer, &done);
-  done.wait();
-
-  if (!done.status().ok()) {
-    WARN("Failed to add peer {} to node {}, status: {}", peer, node_->node_id().to_string(), done.status().error_str());
-    return done.status();
+butil::Status PRaft::RemovePeer(const std::string& peer) {
+  for (size_t i = 0; i < GroupNum(); i++) {
+    if (auto s = Group(i).ChangePeer(peer, false); !s.ok()) {
+      return s;
+    }
   }
+  return {0, "OK"};
+}
 
+butil::Status PRaft::TransferLeader(const std::string& peer) {
+  braft::PeerId peer_id;
+  if (peer_id.parse(peer) != 0) {
+    return butil::Status(EINVAL, "Invalid peer %s", peer.c_str());
+  }
+  for (size_t i = 0; i < GroupNum(); i++) {
+    auto& node = Group(i).node_;
+    if (!node || !node->is_leader()) {
+      continue;
+    }
+    INFO("Raft group {} transfers its leader to {}", i, peer);
+    if (int ret = node->transfer_leadership_to(peer_id); ret != 0) {
+      return butil::Status(ret, "Failed to transfer the leader of raft group %zu", i);
+    }
+  }
   return {0, "OK"};
 }
 
-butil::Status PRaft::RemovePeer(const std::string& peer) {
+butil::Status PRaft::ChangePeer(const std::string& peer, bool add) {
   if (!node_) {
     return ERROR_LOG_AND_STATUS("Node is not initialized");
   }
 
-  braft::SynchronizedClosure done;
-  node_->remove_peer(peer, &done);
-  done.wait();
+  butil::Status status;
+  if (node_->is_leader()) {
+    braft::SynchronizedClosure done;
+    if (add) {
+      node_->add_peer(peer, &done);
+    } else {
+      node_->remove_peer(peer, &done);
+    }
+    done.wait();
+    status = done.status();
+  } else {
+    // the cluster commands go to the leader of group 0, another node may lead
+    // the other groups
+    auto leader = node_->leader_id();
+    if (leader.is_empty()) {
+      return butil::Status(EAGAIN, "No leader of raft group %zu", index_);
+    }
+    braft::Configuration conf;
+    conf.add_peer(leader);
+    braft::PeerId peer_id;
+    if (peer_id.parse(peer) != 0) {
+      return butil::Status(EINVAL, "Invalid peer %s", peer.c_str());
+    }
+    status = add ? braft::cli::add_peer(GroupName(), conf, peer_id, braft::cli::CliOptions())
+                 : braft::cli::remove_peer(GroupName(), conf, peer_id, braft::cli::CliOptions());
+  }
 
-  if (!done.status().ok()) {
-    WARN("Failed to remove peer {} from node {}, status: {}", peer, node_->node_id().to_string(),
-         done.status().error_str());
-    return done.status();
+  if (!status.ok()) {
+    WARN("Failed to {} peer {} in raft group {} of node {}, status: {}", add ? "add" : "remove", peer, index_,
+         node_->node_id().to_string(), status.error_str());
+    return status;
   }
 
   return {0, "OK"};
@@ -521,9 +870,17 @@ butil::Status PRaft::DoSnapshot(int64_t self_snapshot_index, bool is_sync) {
   if (!node_) {
     return ERROR_LOG_AND_STATUS("Node is not initialized");
   }
+  // the index of the snapshots of the storage is flushed to the SST files,
+  // braft saves one snapshot at a time too
+  std::unique_lock lock(snapshot_mutex_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    return {EBUSY, "Is saving another snapshot"};
+  }
+  snapshot_index_flushed_ = self_snapshot_index > 0;
   braft::SynchronizedClosure done;
   node_->snapshot(&done, self_snapshot_index);
   done.wait();
+  snapshot_index_flushed_ = false;
   return done.status();
 }
 
@@ -542,88 +899,580 @@ void PRaft::OnClusterCmdConnectionFailed([[maybe_unused]] EventLoop* loop, const
 
 // Shut this node and server down.
 void PRaft::ShutDown() {
-  if (node_) {
-    node_->shutdown(nullptr);
+  for (size_t i = 0; i < GroupNum(); i++) {
+    if (auto& node = Group(i).node_) {
+      node->shutdown(nullptr);
+    }
   }
 
-  if (server_) {
-    server_->Stop(0);
+  if (auto& server = Instance().server_) {
+    server->Stop(0);
   }
 }
 
 // Blocking this thread until the node is eventually down.
 void PRaft::Join() {
-  if (node_) {
-    node_->join();
+  for (size_t i = 0; i < GroupNum(); i++) {
+    if (auto& node = Group(i).node_) {
+      node->join();
+    }
   }
 
-  if (server_) {
-    server_->Join();
+  if (auto& server = Instance().server_) {
+    server->Join();
   }
 }
 
-void PRaft::AppendLog(const Binlog& log, std::promise<rocksdb::Status>&& promise) {
+void PRaft::AppendLog(storage::BinlogWriter&& log, std::promise<rocksdb::Status>&& promise) {
   assert(node_);
   assert(node_->is_leader());
+  PRaftWriteDoneClosure* done = nullptr;
+  if (const auto& reply = PRaftPendingReply::Current()) {
+    // the command is replied once the log is applied, the keys it locked stay
+    // locked until then and the batch does not wait
+    auto keys = std::make_shared<pstd::lock::DeferredUnlock>();
+    pstd::lock::DeferredUnlock::SetCurrent(keys);
+    reply->AddLog();
+    done = new PRaftWriteDoneClosure(reply, std::move(keys));
+    promise.set_value(rocksdb::Status::OK());
+  } else {
+    done = new PRaftWriteDoneClosure(std::move(promise));
+  }
+
+  // the binlogs in the window are committed as one raft log by ApplyGroup
+  auto window_us = g_config.raft_group_commit_window_us.load();
+  if (window_us > 0) {
+    std::lock_guard lock(group_mutex_);
+    if (!group_) {
+      group_ = new PRaftGroupDoneClosure;
+    }
+    DEBUG("append binlog of slot {} to group: {} bytes", log.SlotIdx(), log.Size());
+    group_->Add(std::move(log), done);
+    if (group_->ByteSize() >= g_config.raft_group_commit_max_bytes.load()) {
+      ApplyGroup();
+    } else if (!group_timer_added_) {
+      group_timer_added_ = bthread_timer_add(&group_timer_, butil::microseconds_from_now(window_us),
+                                             &PRaft::OnGroupCommitTimer, this) == 0;
+      if (!group_timer_added_) {
+        ApplyGroup();
+      }
+    }
+    return;
+  }
+
+  // the raft log takes the buffer of the binlog without a copy
   butil::IOBuf data;
-  butil::IOBufAsZeroCopyOutputStream wrapper(&data);
-  auto done = new PRaftWriteDoneClosure(std::move(promise));
-  if (!log.SerializeToZeroCopyStream(&wrapper)) {
+  size_t size = log.Size();
+  char* buf = log.Release();
+  if (data.append_user_data(buf, size, free) != 0) {
+    free(buf);
     done->SetStatus(rocksdb::Status::Incomplete("Failed to serialize binlog"));
     done->Run();
     return;
   }
-  DEBUG("append binlog: {}", log.ShortDebugString());
+  DEBUG("append binlog: {} bytes", size);
+  CompressBinlog(&data);
   braft::Task task;
   task.data = &data;
   task.done = done;
+  std::lock_guard lock(group_mutex_);
+  // a group left from before the window was turned off goes first
+  ApplyGroup();
+  AckAccepted(done);
+  node_->apply(task);
+}
+
+void PRaft::ApplyGroup() {
+  auto group = group_;
+  group_ = nullptr;
+  if (!group) {
+    return;
+  }
+  if (!node_) {
+    group->SetStatus(rocksdb::Status::Aborted("Raft node is shut down"));
+    group->Run();
+    return;
+  }
+  butil::IOBuf data;
+  if (!group->Serialize(&data)) {
+    group->SetStatus(rocksdb::Status::Incomplete("Failed to serialize binlog"));
+    group->Run();
+    return;
+  }
+  CompressBinlog(&data);
+  braft::Task task;
+  task.data = &data;
+  task.done = group;
+  AckAccepted(group);
+  // under group_mutex_, so the groups are applied in the order of their binlogs
   node_->apply(task);
 }
 
+void PRaft::AckAccepted(braft::Closure* done) {
+  // A log is handed to raft right after, which may run done any time after.
+  // The node is not the leader while it transfers the leader either, so a log
+  // braft rejects at once is not acked, only one rejected by a step down
+  // between here and the apply queue of braft is.
+  if (!node_->is_leader()) {
+    return;
+  }
+  if (auto group = dynamic_cast<PRaftGroupDoneClosure*>(done)) {
+    group->Ack(RaftWriteAck::kAccepted);
+  } else if (auto write = dynamic_cast<PRaftWriteDoneClosure*>(done)) {
+    write->Ack(RaftWriteAck::kAccepted);
+  }
+}
+
+void PRaft::OnGroupCommitTimer(void* arg) {
+  auto raft = static_cast<PRaft*>(arg);
+  std::lock_guard lock(raft->group_mutex_);
+  raft->group_timer_added_ = false;
+  raft->ApplyGroup();
+}
+
+void PRaft::CompressBinlog(butil::IOBuf* data) {
+  if (!g_config.raft_binlog_compression.load() || !peers_read_lzf_.load() ||
+      data->size() < g_config.raft_binlog_compression_threshold.load() || data->size() > UINT32_MAX) {
+    return;
+  }
+  std::string flattened;
+  const char* raw = nullptr;
+  if (data->backing_block_num() == 1) {
+    raw = data->backing_block(0).data();
+  } else {
+    flattened = data->to_string();
+    raw = flattened.data();
+  }
+  auto raw_size = static_cast<unsigned int>(data->size());
+  // the compressed log is kept if it saves an eighth of the log at least
+  unsigned int max_size = raw_size - raw_size / 8;
+  auto buf = static_cast<char*>(malloc(max_size));
+  unsigned int size = buf ? lzf_compress(raw, raw_size, buf, max_size) : 0;
+  butil::IOBuf compressed;
+  if (size == 0 || compressed.append(storage::BinlogWriter::CompressedHeader(kLZF, raw_size, size)) != 0 ||
+      compressed.append_user_data(buf, size, free) != 0) {
+    free(buf);
+    return;
+  }
+  compressed_logs_++;
+  compressed_raw_bytes_ += raw_size;
+  compressed_bytes_ += compressed.size();
+  data->swap(compressed);
+}
+
+void PRaft::CheckPeerFeatures() {
+  peers_read_lzf_ = false;
+  auto arg = new std::pair<PRaft*, uint64_t>(this, ++peer_check_generation_);
+  bthread_t tid;
+  if (bthread_start_background(&tid, nullptr, &PRaft::RunPeerFeaturesCheck, arg) != 0) {
+    WARN("Failed to start the check of the peer features, the raft logs are not compressed");
+    delete arg;
+  }
+}
+
+void* PRaft::RunPeerFeaturesCheck(void* arg) {
+  auto [raft, generation] = *static_cast<std::pair<PRaft*, uint64_t>*>(arg);
+  delete static_cast<std::pair<PRaft*, uint64_t>*>(arg);
+  // a peer that is down or of an older version is asked again later, until
+  // the peers or the leader change
+  while (generation == raft->peer_check_generation_.load()) {
+    std::vector<braft::PeerId> peers;
+    if (!raft->node_ || !raft->node_->list_peers(&peers).ok()) {
+      return nullptr;
+    }
+    bool read_lzf = true;
+    for (const auto& peer : peers) {
+      if (peer == raft->node_->node_id().peer_id) {
+        continue;
+      }
+      brpc::Channel channel;
+      brpc::ChannelOptions options;
+      options.timeout_ms = 1000;
+      if (channel.Init(peer.addr, &options) != 0) {
+        read_lzf = false;
+        break;
+      }
+      DummyService_Stub stub(&channel);
+      brpc::Controller cntl;
+      FeaturesRequest request;
+      FeaturesResponse response;
+      stub.GetFeatures(&cntl, &request, &response, nullptr);
+      if (cntl.Failed() || (response.binlog_compressions() & (1 << kLZF)) == 0) {
+        read_lzf = false;
+        break;
+      }
+    }
+    if (read_lzf) {
+      if (generation == raft->peer_check_generation_.load()) {
+        raft->peers_read_lzf_ = true;
+      }
+      return nullptr;
+    }
+    bthread_usleep(10 * 1000 * 1000);
+  }
+  return nullptr;
+}
+
+void PRaft::BalanceLeader() {
+  if (GroupNum() == 1) {
+    return;
+  }
+  auto arg = new std::pair<PRaft*, uint64_t>(this, ++balance_generation_);
+  bthread_t tid;
+  if (bthread_start_background(&tid, nullptr, &PRaft::RunLeaderBalance, arg) != 0) {
+    WARN("Failed to start the balance of the leader of raft group {}", index_);
+    delete arg;
+  }
+}
+
+void* PRaft::RunLeaderBalance(void* arg) {
+  auto [raft, generation] = *static_cast<std::pair<PRaft*, uint64_t>*>(arg);
+  delete static_cast<std::pair<PRaft*, uint64_t>*>(arg);
+  // A transfer puts the leader in TRANSFERRING, where it rejects the writes
+  // until the target leads or the election timeout passes, so the leader is
+  // only handed to a peer whose replicator is caught up. The balance waits
+  // longer after each round the peer is down or behind, and gives up after
+  // kBalanceRounds until the leader or the peers change.
+  int64_t wait_s = kBalanceWaitS;
+  for (int round = 0; round < kBalanceRounds && generation == raft->balance_generation_.load(); round++) {
+    bthread_usleep(wait_s * 1000 * 1000);
+    wait_s = std::min(wait_s * 2, kBalanceMaxWaitS);
+    std::vector<braft::PeerId> peers;
+    if (generation != raft->balance_generation_.load() || !raft->node_ || !raft->node_->is_leader() ||
+        !raft->node_->list_peers(&peers).ok() || peers.empty()) {
+      return nullptr;
+    }
+    // every node sorts the peers the same way
+    std::sort(peers.begin(), peers.end());
+    const auto& preferred = peers[raft->index_ % peers.size()];
+    if (preferred == raft->node_->node_id().peer_id) {
+      return nullptr;
+    }
+    braft::NodeStatus status;
+    raft->node_->get_status(&status);
+    auto follower = status.stable_followers.find(preferred);
+    if (follower == status.stable_followers.end() || !follower->second.valid ||
+        follower->second.installing_snapshot || follower->second.consecutive_error_times > 0 ||
+        follower->second.next_index + kBalanceMaxLagLogs <= status.last_index) {
+      INFO("Raft group {} waits for {} to catch up to transfer its leader", raft->index_, preferred.to_string());
+      continue;
+    }
+    INFO("Raft group {} transfers its leader to {}", raft->index_, preferred.to_string());
+    if (raft->node_->transfer_leadership_to(preferred) != 0) {
+      WARN("Raft group {} failed to transfer its leader to {}", raft->index_, preferred.to_string());
+    }
+  }
+  if (generation == raft->balance_generation_.load()) {
+    WARN("Raft group {} gives up transferring its leader until the leader or the peers change", raft->index_);
+  }
+  return nullptr;
+}
+
+butil::Status PRaft::ReadBarrier() {
+  int64_t index = 0;
+  auto status = ReadIndex(&index);
+  if (!status.ok()) {
+    return status;
+  }
+  std::unique_lock lock(applied_mutex_);
+  if (!applied_cv_.wait_for(lock, std::chrono::seconds(g_config.raft_timeout_s.load()),
+                            [&] { return applied_index_ >= index; })) {
+    return butil::Status(ETIMEDOUT, "Wait for the read index timeout");
+  }
+  return butil::Status::OK();
+}
+
+butil::Status PRaft::ReadIndex(int64_t* index) {
+  std::unique_lock lock(read_mutex_);
+  // a round started before the call may have got an index older than the
+  // call, the call waits for the next one
+  auto round = read_rounds_started_ + 1;
+  while (read_rounds_finished_ < round) {
+    if (read_rounds_started_ != read_rounds_finished_) {
+      read_cv_.wait(lock);
+      continue;
+    }
+    auto started = ++read_rounds_started_;
+    lock.unlock();
+    int64_t fetched = 0;
+    auto status = FetchReadIndex(&fetched);
+    lock.lock();
+    read_rounds_finished_ = started;
+    read_status_ = status;
+    read_index_ = fetched;
+    read_cv_.notify_all();
+  }
+  *index = read_index_;
+  return read_status_;
+}
+
+butil::Status PRaft::FetchReadIndex(int64_t* index) {
+  if (!node_) {
+    return ERROR_LOG_AND_STATUS("Node is not initialized");
+  }
+  auto timeout_s = g_config.raft_timeout_s.load();
+  if (node_->is_leader()) {
+    if (node_->is_leader_lease_valid()) {
+      // no other node becomes the leader before the lease expires
+      braft::NodeStatus status;
+      node_->get_status(&status);
+      *index = status.committed_index;
+      return butil::Status::OK();
+    }
+    // without a lease the leader confirms it with a log, an empty binlog
+    storage::BinlogWriter barrier(0, 0, 0);
+    butil::IOBuf data;
+    data.append(barrier.Data(), barrier.Size());
+    auto done = new PRaftReadBarrierClosure;
+    auto future = done->GetFuture();
+    braft::Task task;
+    task.data = &data;
+    task.done = done;
+    node_->apply(task);
+    if (future.wait_for(std::chrono::seconds(timeout_s)) == std::future_status::timeout) {
+      return butil::Status(ETIMEDOUT, "Read barrier timeout");
+    }
+    auto [status, barrier_index] = future.get();
+    *index = barrier_index;
+    return status;
+  }
+
+  auto leader = node_->leader_id();
+  if (leader.is_empty()) {
+    return butil::Status(EAGAIN, "No leader");
+  }
+  brpc::Channel channel;
+  brpc::ChannelOptions options;
+  options.timeout_ms = static_cast<int32_t>(timeout_s * 1000);
+  if (channel.Init(leader.addr, &options) != 0) {
+    return ERROR_LOG_AND_STATUS("Failed to connect the leader");
+  }
+  DummyService_Stub stub(&channel);
+  brpc::Controller cntl;
+  ReadIndexRequest request;
+  request.set_group(static_cast<uint32_t>(index_));
+  ReadIndexResponse response;
+  stub.ReadIndex(&cntl, &request, &response, nullptr);
+  if (cntl.Failed()) {
+    return butil::Status(cntl.ErrorCode(), cntl.ErrorText());
+  }
+  if (!response.success()) {
+    return butil::Status(EINVAL, response.error());
+  }
+  *index = response.index();
+  return butil::Status::OK();
+}
+
+void PRaft::HandleReadIndex(ReadIndexResponse* response, google::protobuf::Closure* done) {
+  auto task = [this, response, done] {
+    brpc::ClosureGuard done_guard(done);
+    if (!IsLeader()) {
+      response->set_success(false);
+      response->set_error(NOT_LEADER);
+      return;
+    }
+    int64_t index = 0;
+    auto status = ReadIndex(&index);
+    response->set_success(status.ok());
+    response->set_index(index);
+    if (!status.ok()) {
+      response->set_error(status.error_str());
+    }
+  };
+  read_index_pool_->ExecuteTask(std::move(task));
+}
+
+PRaft::BinlogCompressionStats PRaft::GetBinlogCompressionStats() const {
+  BinlogCompressionStats stats;
+  stats.enabled = g_config.raft_binlog_compression.load() && peers_read_lzf_.load();
+  stats.compressed_logs = compressed_logs_.load();
+  stats.raw_bytes = compressed_raw_bytes_.load();
+  stats.compressed_bytes = compressed_bytes_.load();
+  stats.decompressed_logs = decompressed_logs_.load();
+  stats.decompress_failures = decompress_failures_.load();
+  return stats;
+}
+
 // @braft::StateMachine
 void PRaft::Clear() {
-  if (node_) {
-    node_.reset();
+  for (size_t i = 0; i < GroupNum(); i++) {
+    Group(i).node_.reset();
   }
 
-  if (server_) {
-    server_.reset();
+  Instance().server_.reset();
+}
+
+namespace {
+
+// the binlogs of one instance in a round of on_apply
+struct ApplyBatch {
+  std::vector<std::pair<const storage::BinlogView*, storage::LogIndex>> logs;
+  // the closure of each binlog in leader and its index in a group, -1 if the
+  // log is not a group
+  std::vector<std::pair<braft::Closure*, int>> dones;
+  std::vector<rocksdb::Status> statuses;
+};
+
+// the logs in on_apply are committed
+void AckCommitted(braft::Closure* done) {
+  if (auto group = dynamic_cast<PRaftGroupDoneClosure*>(done)) {
+    group->Ack(RaftWriteAck::kCommit);
+  } else if (auto write = dynamic_cast<PRaftWriteDoneClosure*>(done)) {
+    write->Ack(RaftWriteAck::kCommit);
+  }
+}
+
+void SetApplyStatus(braft::Closure* done, int group_index, rocksdb::Status status) {
+  if (auto group = dynamic_cast<PRaftGroupDoneClosure*>(done)) {
+    if (group_index < 0) {
+      group->SetStatus(status);
+    } else {
+      group->SetStatus(group_index, std::move(status));
+    }
+  } else if (done) {  // in leader
+    dynamic_cast<PRaftWriteDoneClosure*>(done)->SetStatus(std::move(status));
   }
 }
 
+}  // namespace
+
 void PRaft::on_apply(braft::Iterator& iter) {
-  // A batch of tasks are committed, which must be processed through
+  // The logs of a round are applied with one write batch per instance, the
+  // instances concurrently, then their closures run in the order of the logs.
+  // The binlogs are parsed in place, their keys and values refer to the
+  // blocks of the raft logs until the batches are written.
+  std::deque<butil::IOBuf> datas;
+  std::deque<std::string> flattened;
+  std::deque<storage::BinlogView> logs;
+  std::vector<braft::Closure*> dones;
+  std::map<std::pair<uint32_t, uint32_t>, ApplyBatch> batches;
+  auto add_binlog = [&](const storage::BinlogView& binlog, storage::LogIndex index, braft::Closure* done,
+                        int group_index) {
+    auto& batch = batches[{binlog.DbId(), binlog.SlotIdx()}];
+    batch.logs.emplace_back(&binlog, index);
+    batch.dones.emplace_back(done, group_index);
+  };
+
+  int64_t last_index = 0;
   for (; iter.valid(); iter.next()) {
     auto done = iter.done();
-    brpc::ClosureGuard done_guard(done);
-
-    Binlog log;
-    butil::IOBufAsZeroCopyInputStream wrapper(iter.data());
-    bool success = log.ParseFromZeroCopyStream(&wrapper);
-    DEBUG("apply binlog{}: {}", iter.index(), log.ShortDebugString());
+    dones.push_back(done);
+    last_index = iter.index();
+
+    // a log this node appended without a group commit is the one block of
+    // its binlog, the others are flattened once
+    auto& data = datas.emplace_back(iter.data());
+    storage::Slice bytes;
+    if (data.backing_block_num() == 1) {
+      auto block = data.backing_block(0);
+      bytes = storage::Slice(block.data(), block.size());
+    } else {
+      bytes = flattened.emplace_back(data.to_string());
+    }
+    auto& log = logs.emplace_back();
+    bool success = log.Parse(bytes);
+    if (success && log.Compression() != kNoCompression) {
+      const auto& compressed = log.Compressed();
+      auto& raw = flattened.emplace_back(log.RawSize(), '\0');
+      success = log.Compression() == kLZF &&
+                lzf_decompress(compressed.data(), compressed.size(), raw.data(), raw.size()) == raw.size() &&
+                log.Parse(raw);
+      if (success) {
+        decompressed_logs_++;
+      } else {
+        decompress_failures_++;
+      }
+    }
+    DEBUG("apply binlog{}: {} bytes", iter.index(), bytes.size());
 
     if (!success) {
-      static constexpr std::string_view kMsg = "Failed to parse from protobuf when on_apply";
+      static constexpr std::string_view kMsg = "Failed to parse binlog when on_apply";
       ERROR(kMsg);
-      if (done) {  // in leader
-        dynamic_cast<PRaftWriteDoneClosure*>(done)->SetStatus(rocksdb::Status::Incomplete(kMsg));
+      SetApplyStatus(done, -1, rocksdb::Status::Incomplete(kMsg));
+      break;
+    }
+
+    if (log.Entries().empty() && log.Group().empty()) {
+      // nothing to write, like the read barriers of ReadIndex
+      if (auto barrier = dynamic_cast<PRaftReadBarrierClosure*>(done)) {
+        barrier->SetIndex(iter.index());
+      } else {
+        SetApplyStatus(done, -1, rocksdb::Status::OK());
       }
-      braft::run_closure_in_bthread(done_guard.release());
-      return;
+    } else if (!log.Group().empty()) {
+      // a group commit, done is the group closure in leader
+      for (size_t i = 0; i < log.Group().size(); i++) {
+        auto& binlog = logs.emplace_back();
+        if (!binlog.Parse(log.Group()[i])) {
+          static constexpr std::string_view kMsg = "Failed to parse binlog of group when on_apply";
+          ERROR(kMsg);
+          SetApplyStatus(done, static_cast<int>(i), rocksdb::Status::Incomplete(kMsg));
+          continue;
+        }
+        add_binlog(binlog, iter.index(), done, static_cast<int>(i));
+      }
+    } else {
+      add_binlog(log, iter.index(), done, -1);
+    }
+  }
+
+  // the writes replied on commit do not wait for the batches
+  for (auto done : dones) {
+    if (done) {
+      AckCommitted(done);
+    }
+  }
+
+  auto apply = [](ApplyBatch* batch) {
+    auto db_id = batch->logs.front().first->DbId();
+    PSTORE.GetBackend(db_id)->GetStorage()->OnBinlogWrite(batch->logs, &batch->statuses);
+  };
+  std::vector<std::future<void>> futures;
+  for (auto it = batches.begin(); it != batches.end(); ++it) {
+    if (std::next(it) == batches.end()) {
+      apply(&it->second);
+      break;
     }
+    if (!apply_pool_) {
+      apply_pool_ = std::make_unique<pstd::ThreadPool>();
+    }
+    futures.push_back(apply_pool_->ExecuteTask(apply, &it->second));
+  }
+  for (auto& future : futures) {
+    future.wait();
+  }
 
-    auto s = PSTORE.GetBackend(log.db_id())->GetStorage()->OnBinlogWrite(log, iter.index());
-    if (done) {  // in leader
-      dynamic_cast<PRaftWriteDoneClosure*>(done)->SetStatus(s);
+  for (auto& [_, batch] : batches) {
+    for (size_t i = 0; i < batch.dones.size(); i++) {
+      SetApplyStatus(batch.dones[i].first, batch.dones[i].second, std::move(batch.statuses[i]));
+    }
+  }
+  if (last_index > 0) {
+    std::lock_guard lock(applied_mutex_);
+    applied_index_ = last_index;
+    applied_cv_.notify_all();
+  }
+  for (auto done : dones) {
+    if (done) {
+      braft::run_closure_in_bthread(done);
     }
-    //  _applied_index = iter.index(); // consider to maintain a member applied_idx
-    braft::run_closure_in_bthread(done_guard.release());
   }
 }
 
 void PRaft::on_snapshot_save(braft::SnapshotWriter* writer, braft::Closure* done) {
   assert(writer);
   brpc::ClosureGuard done_guard(done);
+  // Links the SST files of the DB in the snapshot, the memtables are only
+  // flushed when the logs up to the snapshot index may still be in them.
+  auto log_size_for_flush = snapshot_index_flushed_ ? storage::kNoFlush : storage::kFlush;
+  auto s = CreateSnapshotFiles(writer->get_path(), db_id_, SnapshotInstance(), log_size_for_flush,
+                               [writer](const std::string& filename, const braft::LocalFileMeta& meta) {
+                                 return writer->add_file(filename, &meta);
+                               });
+  if (!s.ok()) {
+    ERROR("Fail to save snapshot in path {}: {}", writer->get_path(), s.ToString());
+    done->status().set_error(EIO, "Fail to create checkpoint: %s", s.ToString().c_str());
+  }
 }
 
 int PRaft::on_snapshot_load(braft::SnapshotReader* reader) {
@@ -631,20 +1480,42 @@ int PRaft::on_snapshot_load(braft::SnapshotReader* reader) {
   assert(reader);
   auto reader_path = reader->get_path();                             // xx/snapshot_0000001
   auto path = g_config.db_path.ToString() + std::to_string(db_id_);  // db/db_id
-  TasksVector tasks(1, {TaskType::kLoadDBFromCheckpoint, db_id_, {{TaskArg::kCheckpointPath, reader_path}}, true});
+  std::map<TaskArg, std::string> args{{TaskArg::kCheckpointPath, reader_path}};
+  if (auto instance = SnapshotInstance(); instance != -1) {
+    args[TaskArg::kInstanceIndex] = std::to_string(instance);
+  }
+  TasksVector tasks(1, {TaskType::kLoadDBFromCheckpoint, db_id_, args, true});
   PSTORE.HandleTaskSpecificDB(tasks);
+  braft::SnapshotMeta meta;
+  if (reader->load_meta(&meta) == 0) {
+    std::lock_guard lock(applied_mutex_);
+    applied_index_ = meta.last_included_index();
+    applied_cv_.notify_all();
+  }
   return 0;
 }
 
 void PRaft::on_leader_start(int64_t term) {
   WARN("Node {} start to be leader, term={}", node_->node_id().to_string(), term);
+  CheckPeerFeatures();
+  BalanceLeader();
 }
 
-void PRaft::on_leader_stop(const butil::Status& status) {}
+void PRaft::on_leader_stop(const butil::Status& status) {
+  peers_read_lzf_ = false;
+  peer_check_generation_++;
+  balance_generation_++;
+}
 
 void PRaft::on_shutdown() {}
 void PRaft::on_error(const ::braft::Error& e) {}
-void PRaft::on_configuration_committed(const ::braft::Configuration& conf) {}
+void PRaft::on_configuration_committed(const ::braft::Configuration& conf) {
+  // a new peer may not read compressed logs, and may be the one to lead
+  if (IsLeader()) {
+    CheckPeerFeatures();
+    BalanceLeader();
+  }
+}
 void PRaft::on_stop_following(const ::braft::LeaderChangeContext& ctx) {}
 void PRaft::on_start_following(const ::braft::LeaderChangeContext& ctx) {}
 
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <filesystem>
 #include <future>
 #include <mutex>
@@ -16,9 +18,15 @@
 
 #include "braft/file_system_adaptor.h"
 #include "braft/raft.h"
+#include "braft/snapshot_throttle.h"
 #include "brpc/server.h"
+#include "bthread/unstable.h"
 #include "rocksdb/status.h"
 
+#include "pstd/scope_record_lock.h"
+#include "pstd/thread_pool.h"
+#include "storage/binlog.h"
+
 #include "client.h"
 
 namespace pikiwidb {
@@ -29,6 +37,7 @@ namespace pikiwidb {
 #define DATABASES_NUM "databases_num"
 #define ROCKSDB_NUM "rocksdb_num"
 #define ROCKSDB_VERSION "rocksdb_version"
+#define RAFT_GROUPS_NUM "raft_groups_num"
 #define WRONG_LEADER "-ERR wrong leader"
 #define RAFT_GROUP_ID "raft_group_id:"
 #define NOT_LEADER "Not leader"
@@ -36,7 +45,8 @@ namespace pikiwidb {
 #define PRAFT PRaft::Instance()
 
 class EventLoop;
-class Binlog;
+class PRaftGroupDoneClosure;
+class ReadIndexResponse;
 
 enum ClusterCmdType {
   kNone,
@@ -76,27 +86,98 @@ class ClusterCmdContext {
   std::string peer_id_;
 };
 
+// the name of a RaftWriteAck but kDefault, and the other way around
+const char* RaftWriteAckName(RaftWriteAck ack);
+bool ParseRaftWriteAck(const std::string& name, RaftWriteAck* ack);
+
+/*
+ * The reply of a write command in raft mode. The worker that ran the command
+ * goes on with the next one, the reply is pushed once the command returned
+ * and the raft logs it appended reached the RaftWriteAck of the client, with
+ * the error of the first log that failed before, or with a timeout error once
+ * raft-timeout-s passed. A log that fails after the reply is only counted.
+ */
+class PRaftPendingReply : public std::enable_shared_from_this<PRaftPendingReply> {
+ public:
+  explicit PRaftPendingReply(std::shared_ptr<PClient> client);
+
+  RaftWriteAck Ack() const { return ack_; }
+
+  // the reply of the command running on this thread, nullptr if the worker
+  // replies when the command returns
+  static const std::shared_ptr<PRaftPendingReply>& Current();
+  static void SetCurrent(std::shared_ptr<PRaftPendingReply> reply);
+
+  // the command appended a raft log
+  void AddLog();
+  // the log is applied, or failed with status
+  void LogDone(const rocksdb::Status& status);
+  // the command returned
+  void CommandDone();
+  // a log failed once the write was replied
+  static void LogFailedAfterAck();
+
+  struct WriteAckStats {
+    uint64_t replies[3] = {0, 0, 0};  // by RaftWriteAck
+    uint64_t failed_after_ack = 0;
+  };
+  static WriteAckStats GetWriteAckStats();
+
+ private:
+  static void OnTimeout(void* arg);
+  // must hold mutex_
+  void MaybeReply();
+
+  std::shared_ptr<PClient> client_;
+  RaftWriteAck ack_ = RaftWriteAck::kApply;
+  std::mutex mutex_;
+  int pending_logs_ = 0;
+  bool command_done_ = false;
+  bool timed_out_ = false;
+  bool replied_ = false;
+  rocksdb::Status status_;
+  bthread_timer_t timer_ = 0;
+  std::weak_ptr<PRaftPendingReply>* timer_arg_ = nullptr;
+};
+
 class PRaftWriteDoneClosure : public braft::Closure {
  public:
   explicit PRaftWriteDoneClosure(std::promise<rocksdb::Status>&& promise) : promise_(std::move(promise)) {}
+  // a log of the command of reply, keys are unlocked once it is applied
+  PRaftWriteDoneClosure(std::shared_ptr<PRaftPendingReply> reply, std::shared_ptr<pstd::lock::DeferredUnlock> keys)
+      : reply_(std::move(reply)), keys_(std::move(keys)) {}
 
-  void Run() override {
-    promise_.set_value(result_);
-    delete this;
-  }
+  void Run() override;
   void SetStatus(rocksdb::Status status) { result_ = std::move(status); }
+  // the log reached ack, the reply of a command with that RaftWriteAck goes
+  // on without waiting for the log to be applied
+  void Ack(RaftWriteAck ack);
 
  private:
   std::promise<rocksdb::Status> promise_;
+  std::shared_ptr<PRaftPendingReply> reply_;
+  std::shared_ptr<pstd::lock::DeferredUnlock> keys_;
+  bool acked_ = false;
   rocksdb::Status result_{rocksdb::Status::Aborted("Unknown error")};
 };
 
+/*
+ * The raft group of the node, or with raft-group-per-instance one of the
+ * groups of the storage instances, Group(i) for the instance i. Each group has
+ * its own log, apply thread and snapshot, of its instance only. They share
+ * the brpc server and the cluster commands of Instance(), the group of the
+ * instance 0, and Init, ShutDown, Join, Clear, AddPeer, RemovePeer and
+ * TransferLeader of any group act on all of them.
+ */
 class PRaft : public braft::StateMachine {
  public:
-  PRaft() = default;
+  explicit PRaft(size_t index = 0) : index_(index) {}
   ~PRaft() override = default;
 
   static PRaft& Instance();
+  // Instance() unless raft-group-per-instance
+  static PRaft& Group(size_t index);
+  static size_t GroupNum();
 
   //===--------------------------------------------------------------------===//
   // Braft API
@@ -104,11 +185,13 @@ class PRaft : public braft::StateMachine {
   butil::Status Init(std::string& group_id, bool initial_conf_is_null);
   butil::Status AddPeer(const std::string& peer);
   butil::Status RemovePeer(const std::string& peer);
+  // of the groups this node leads
+  butil::Status TransferLeader(const std::string& peer);
   butil::Status DoSnapshot(int64_t self_snapshot_index = 0, bool is_sync = true);
 
   void ShutDown();
   void Join();
-  void AppendLog(const Binlog& log, std::promise<rocksdb::Status>&& promise);
+  void AppendLog(storage::BinlogWriter&& log, std::promise<rocksdb::Status>&& promise);
   void Clear();
 
   //===--------------------------------------------------------------------===//
@@ -138,7 +221,26 @@ class PRaft : public braft::StateMachine {
   braft::NodeStatus GetNodeStatus() const;
   butil::Status GetListPeers(std::vector<braft::PeerId>* peers);
 
-  bool IsInitialized() const { return node_ != nullptr && server_ != nullptr; }
+  bool IsInitialized() const { return node_ != nullptr && Instance().server_ != nullptr; }
+
+  // Blocks until this node applied the logs the leader committed before the
+  // call, so a read served after it is linearizable on any node.
+  butil::Status ReadBarrier();
+  // The commit index of the leader once it confirmed it is still the leader,
+  // asked to the leader by a follower. The concurrent calls share one round.
+  butil::Status ReadIndex(int64_t* index);
+  // ReadIndex for the RPC of a follower, response is sent once it returns
+  void HandleReadIndex(ReadIndexResponse* response, google::protobuf::Closure* done);
+
+  struct BinlogCompressionStats {
+    bool enabled = false;  // raft-binlog-compression and all the peers read LZF
+    uint64_t compressed_logs = 0;
+    uint64_t raw_bytes = 0;  // of the compressed logs before the compression
+    uint64_t compressed_bytes = 0;
+    uint64_t decompressed_logs = 0;
+    uint64_t decompress_failures = 0;  // of the compressed logs that failed to decompress
+  };
+  BinlogCompressionStats GetBinlogCompressionStats() const;
 
  private:
   void on_apply(braft::Iterator& iter) override;
@@ -154,16 +256,96 @@ class PRaft : public braft::StateMachine {
   void on_stop_following(const ::braft::LeaderChangeContext& ctx) override;
   void on_start_following(const ::braft::LeaderChangeContext& ctx) override;
 
+  // must hold group_mutex_
+  void ApplyGroup();
+  // acks RaftWriteAck::kAccepted to the writes of done, before it is applied
+  void AckAccepted(braft::Closure* done);
+  static void OnGroupCommitTimer(void* arg);
+
+  // replaces data by the compressed raft log when it is large enough
+  void CompressBinlog(butil::IOBuf* data);
+  // asks the peers whether they read compressed logs, in a bthread
+  void CheckPeerFeatures();
+  static void* RunPeerFeaturesCheck(void* arg);
+
+  // one round of ReadIndex
+  butil::Status FetchReadIndex(int64_t* index);
+
+  // the raft node of this group once the server runs
+  butil::Status InitNode(const std::string& group_id, const butil::EndPoint& addr, bool initial_conf_is_null);
+  // the name of the group in braft, the same on all the nodes
+  std::string GroupName() const;
+  // the storage instance in the snapshots of the group, -1 for all of them
+  int SnapshotInstance() const { return GroupNum() == 1 ? -1 : static_cast<int>(index_); }
+  // adds or removes the peer in this group, through the leader of the group
+  // when it is another node
+  butil::Status ChangePeer(const std::string& peer, bool add);
+
+  // The leader of the group i hands it over to the peer i of the sorted
+  // peers, so the leaders of the groups spread over the nodes. It waits for
+  // the peer to catch up first, in a bthread, for kBalanceRounds at most,
+  // until the leader or the peers change.
+  void BalanceLeader();
+  static void* RunLeaderBalance(void* arg);
+  static constexpr int kBalanceRounds = 6;
+  // the wait before the first round, doubled after each round
+  static constexpr int64_t kBalanceWaitS = 10;
+  static constexpr int64_t kBalanceMaxWaitS = 300;
+  // the logs the peer may be behind the last one to take the leader
+  static constexpr int64_t kBalanceMaxLagLogs = 100;
+
  private:
+  size_t index_ = 0;                               // the storage instance of the group
   std::unique_ptr<brpc::Server> server_{nullptr};  // brpc
   std::unique_ptr<braft::Node> node_{nullptr};
   braft::NodeOptions node_options_;  // options for raft node
   std::string raw_addr_;             // ip:port of this node
 
   scoped_refptr<braft::FileSystemAdaptor> snapshot_adaptor_ = nullptr;
+  scoped_refptr<braft::SnapshotThrottle> snapshot_throttle_ = nullptr;
+  // DoSnapshot at an index the storage flushed, see on_snapshot_save
+  std::mutex snapshot_mutex_;
+  std::atomic<bool> snapshot_index_flushed_ = false;
   ClusterCmdContext cluster_cmd_ctx_;  // context for cluster join/remove command
   std::string group_id_;               // group id
   int db_id_ = 0;                      // db_id
+
+  // the binlogs appended in the group commit window, applied as one raft log
+  std::mutex group_mutex_;
+  PRaftGroupDoneClosure* group_ = nullptr;
+  bthread_timer_t group_timer_ = 0;
+  bool group_timer_added_ = false;
+
+  // applies the logs of the instances concurrently, see on_apply
+  std::unique_ptr<pstd::ThreadPool> apply_pool_;
+
+  // the leader compresses its logs once all the peers read them, each check
+  // of the peers has a generation and only the latest one sets it
+  std::atomic<bool> peers_read_lzf_ = false;
+  std::atomic<uint64_t> peer_check_generation_ = 0;
+  std::atomic<uint64_t> compressed_logs_ = 0;
+  std::atomic<uint64_t> compressed_raw_bytes_ = 0;
+  std::atomic<uint64_t> compressed_bytes_ = 0;
+  std::atomic<uint64_t> decompressed_logs_ = 0;
+  std::atomic<uint64_t> decompress_failures_ = 0;
+
+  // each balance of the leader has a generation like the checks of the peers
+  std::atomic<uint64_t> balance_generation_ = 0;
+
+  // the rounds of ReadIndex, a call waits for the first round started after it
+  std::mutex read_mutex_;
+  std::condition_variable read_cv_;
+  uint64_t read_rounds_started_ = 0;
+  uint64_t read_rounds_finished_ = 0;
+  butil::Status read_status_;
+  int64_t read_index_ = 0;
+  // runs the ReadIndex of the followers, not to block the RPC threads
+  std::unique_ptr<pstd::ThreadPool> read_index_pool_;
+
+  // the index of the last log applied, see ReadBarrier
+  std::mutex applied_mutex_;
+  std::condition_variable applied_cv_;
+  int64_t applied_index_ = 0;
 };
 
 }  // namespace pikiwidb
@@ -7,17 +7,30 @@
 
 #pragma once
 
+#include "brpc/closure_guard.h"
+
+#include "binlog.pb.h"
+#include "praft.h"
 #include "praft.pb.h"
 
 namespace pikiwidb {
 
-class PRaft;
-
 class DummyServiceImpl : public DummyService {
  public:
   explicit DummyServiceImpl(PRaft* praft) : praft_(praft) {}
   void DummyMethod(::google::protobuf::RpcController* controller, const ::pikiwidb::DummyRequest* request,
                    ::pikiwidb::DummyResponse* response, ::google::protobuf::Closure* done) override {}
+  void GetFeatures(::google::protobuf::RpcController* controller, const ::pikiwidb::FeaturesRequest* request,
+                   ::pikiwidb::FeaturesResponse* response, ::google::protobuf::Closure* done) override {
+    brpc::ClosureGuard done_guard(done);
+    response->set_binlog_compressions(1 << Compression::kLZF);
+  }
+  void ReadIndex(::google::protobuf::RpcController* controller, const ::pikiwidb::ReadIndexRequest* request,
+                 ::pikiwidb::ReadIndexResponse* response, ::google::protobuf::Closure* done) override {
+    // the nodes with one raft group ask for group 0
+    auto praft = request->group() == 0 ? praft_ : &PRaft::Group(request->group());
+    praft->HandleReadIndex(response, done);
+  }
 
  private:
   PRaft* praft_ = nullptr;
@@ -10,10 +10,12 @@
 
 #include "psnapshot.h"
 
-#include "braft/local_file_meta.pb.h"
+#include <unordered_map>
+
 #include "butil/files/file_path.h"
 
 #include "pstd/log.h"
+#include "pstd/pstd_string.h"
 
 #include "config.h"
 #include "store.h"
@@ -22,6 +24,61 @@ namespace pikiwidb {
 
 extern PConfig g_config;
 
+namespace {
+
+void AddAllFiles(const std::filesystem::path& dir, const std::string& path,
+                 const std::unordered_map<std::string, std::string>& checksums,
+                 const AddSnapshotFileFunction& add_file) {
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    if (entry.is_directory()) {
+      if (entry.path() != "." && entry.path() != "..") {
+        INFO("dir_path = {}", entry.path().string());
+        AddAllFiles(entry.path(), path, checksums, add_file);
+      }
+    } else {
+      auto filename = std::filesystem::relative(entry.path(), path).string();
+      INFO("file_path = {}", filename);
+      braft::LocalFileMeta meta;
+      if (auto it = checksums.find(filename); it != checksums.end()) {
+        meta.set_checksum(it->second);
+      }
+      if (add_file(filename, meta) != 0) {
+        WARN("Failed to add file");
+      }
+    }
+  }
+}
+
+}  // namespace
+
+rocksdb::Status CreateSnapshotFiles(const std::string& path, int db_id, int instance, uint64_t log_size_for_flush,
+                                    const AddSnapshotFileFunction& add_file) {
+  auto& db = PSTORE.GetBackend(db_id);
+  auto checkpoint_path = path;
+  pstd::TrimSlash(checkpoint_path);
+  if (auto s = db->CreateCheckpoint(checkpoint_path, true, log_size_for_flush, instance); !s.ok()) {
+    return s;
+  }
+
+  // by the path of a file in the snapshot, db_id/instance/file, the SST files
+  // compacted since the checkpoint have none and are always copied
+  std::unordered_map<std::string, std::string> checksums;
+  for (size_t i = 0; i < g_config.db_instance_num.load(); i++) {
+    if (instance != -1 && i != static_cast<size_t>(instance)) {
+      continue;
+    }
+    std::unordered_map<std::string, std::string> ids;
+    if (auto s = db->GetStorage()->GetTableUniqueIds(static_cast<int>(i), &ids); !s.ok()) {
+      WARN("Failed to get the unique ids of the SST files of RocksDB {}: {}", i, s.ToString());
+    }
+    for (auto& [name, id] : ids) {
+      checksums[std::to_string(db_id) + "/" + std::to_string(i) + "/" + name] = std::move(id);
+    }
+  }
+  AddAllFiles(path, path, checksums, add_file);
+  return rocksdb::Status::OK();
+}
+
 braft::FileAdaptor* PPosixFileSystemAdaptor::open(const std::string& path, int oflag,
                                                   const ::google::protobuf::Message* file_meta, butil::File::Error* e) {
   if ((oflag & IS_RDONLY) == 0) {  // This is a read operation
@@ -53,7 +110,7 @@ braft::FileAdaptor* PPosixFileSystemAdaptor::open(const std::string& path, int o
       }
     }
 
-    // Snapshot generation
+    // Snapshot generation, for the snapshots saved without their files
     if (!snapshots_exists) {
       braft::LocalSnapshotMetaTable snapshot_meta_memtable;
       std::string meta_path = snapshot_path + "/" PRAFT_SNAPSHOT_META_FILE;
@@ -62,9 +119,14 @@ braft::FileAdaptor* PPosixFileSystemAdaptor::open(const std::string& path, int o
       assert(fs);
       snapshot_meta_memtable.load_from_file(fs, meta_path);
 
-      TasksVector tasks(1, {TaskType::kCheckpoint, 0, {{TaskArg::kCheckpointPath, snapshot_path}}, true});
-      PSTORE.HandleTaskSpecificDB(tasks);
-      AddAllFiles(snapshot_path, &snapshot_meta_memtable, snapshot_path);
+      auto s = CreateSnapshotFiles(snapshot_path, 0, instance_, storage::kFlush,
+                                   [&snapshot_meta_memtable](const std::string& filename,
+                                                             const braft::LocalFileMeta& meta) {
+                                     return snapshot_meta_memtable.add_file(filename, meta);
+                                   });
+      if (!s.ok()) {
+        ERROR("Fail to generate snapshot in path {}: {}", snapshot_path, s.ToString());
+      }
 
       auto rc = snapshot_meta_memtable.save_to_file(fs, meta_path);
       if (rc == 0) {
@@ -79,24 +141,11 @@ braft::FileAdaptor* PPosixFileSystemAdaptor::open(const std::string& path, int o
   return braft::PosixFileSystemAdaptor::open(path, oflag, file_meta, e);
 }
 
-void PPosixFileSystemAdaptor::AddAllFiles(const std::filesystem::path& dir,
-                                          braft::LocalSnapshotMetaTable* snapshot_meta_memtable,
-                                          const std::string& path) {
-  assert(snapshot_meta_memtable);
-  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
-    if (entry.is_directory()) {
-      if (entry.path() != "." && entry.path() != "..") {
-        INFO("dir_path = {}", entry.path().string());
-        AddAllFiles(entry.path(), snapshot_meta_memtable, path);
-      }
-    } else {
-      INFO("file_path = {}", std::filesystem::relative(entry.path(), path).string());
-      braft::LocalFileMeta meta;
-      if (snapshot_meta_memtable->add_file(std::filesystem::relative(entry.path(), path), meta) != 0) {
-        WARN("Failed to add file");
-      }
-    }
+bool PPosixFileSystemAdaptor::link(const std::string& old_path, const std::string& new_path) {
+  if (!create_directory(butil::FilePath(new_path).DirName().value(), nullptr, true)) {
+    return false;
   }
+  return braft::PosixFileSystemAdaptor::link(old_path, new_path);
 }
 
 }  // namespace pikiwidb
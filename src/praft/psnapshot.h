@@ -8,29 +8,47 @@
 #pragma once
 
 #include <filesystem>
+#include <functional>
+#include <string>
 
 #include "braft/file_system_adaptor.h"
+#include "braft/local_file_meta.pb.h"
 #include "braft/macros.h"
 #include "braft/snapshot.h"
 
+#include "rocksdb/status.h"
+
 #define PRAFT_SNAPSHOT_META_FILE "__raft_snapshot_meta"
 #define PRAFT_SNAPSHOT_PATH "snapshot/snapshot_"
 #define IS_RDONLY 0x01
 
 namespace pikiwidb {
 
+using AddSnapshotFileFunction = std::function<int(const std::string&, const braft::LocalFileMeta&)>;
+
+// Creates the checkpoint of db_id in the snapshot of path and adds its files
+// with add_file. The checksum of an SST file is its RocksDB unique id, so a
+// follower keeps the files it has in its last snapshot or from an interrupted
+// install, see NodeOptions::filter_before_copy_remote. Only the storage
+// instance of the raft group is in its snapshot, unless instance is -1.
+rocksdb::Status CreateSnapshotFiles(const std::string& path, int db_id, int instance, uint64_t log_size_for_flush,
+                                    const AddSnapshotFileFunction& add_file);
+
 class PPosixFileSystemAdaptor : public braft::PosixFileSystemAdaptor {
  public:
-  PPosixFileSystemAdaptor() {}
+  explicit PPosixFileSystemAdaptor(int instance = -1) : instance_(instance) {}
   ~PPosixFileSystemAdaptor() {}
 
   braft::FileAdaptor* open(const std::string& path, int oflag, const ::google::protobuf::Message* file_meta,
                            butil::File::Error* e) override;
-  void AddAllFiles(const std::filesystem::path& dir, braft::LocalSnapshotMetaTable* snapshot_meta_memtable,
-                   const std::string& path);
+  // a file of the last snapshot is linked into a directory of the new one
+  // which may not exist yet
+  bool link(const std::string& old_path, const std::string& new_path) override;
 
  private:
   braft::raft_mutex_t mutex_;
+  // the storage instance of the raft group, see CreateSnapshotFiles
+  int instance_ = -1;
 };
 
 }  // namespace pikiwidb
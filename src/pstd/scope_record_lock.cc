@@ -5,24 +5,96 @@
  * of patent rights can be found in the PATENTS file in the same directory.
  */
 
+#include <algorithm>
 #include <utility>
 
 #include "scope_record_lock.h"
 
 namespace pstd::lock {
 
+namespace {
+
+thread_local std::shared_ptr<DeferredUnlock> current_deferred_unlock;
+
+}  // namespace
+
+void DeferredUnlock::Add(const std::shared_ptr<LockMgr>& lock_mgr, const std::string& key) {
+  {
+    std::lock_guard lock(mutex_);
+    if (!released_) {
+      keys_.emplace_back(lock_mgr, key);
+      return;
+    }
+  }
+  lock_mgr->UnLock(key);
+}
+
+bool DeferredUnlock::Take(const std::shared_ptr<LockMgr>& lock_mgr, const std::string& key) {
+  std::lock_guard lock(mutex_);
+  auto it = std::find_if(keys_.begin(), keys_.end(),
+                         [&](const auto& held) { return held.first == lock_mgr && held.second == key; });
+  if (it == keys_.end()) {
+    return false;
+  }
+  keys_.erase(it);
+  return true;
+}
+
+void DeferredUnlock::Release() {
+  decltype(keys_) keys;
+  std::shared_ptr<DeferredUnlock> previous;
+  {
+    std::lock_guard lock(mutex_);
+    released_ = true;
+    keys.swap(keys_);
+    previous.swap(previous_);
+  }
+  for (const auto& [lock_mgr, key] : keys) {
+    lock_mgr->UnLock(key);
+  }
+}
+
+void DeferredUnlock::SetCurrent(std::shared_ptr<DeferredUnlock> deferred) {
+  if (deferred && deferred != current_deferred_unlock) {
+    std::lock_guard lock(deferred->mutex_);
+    if (!deferred->released_) {
+      deferred->previous_ = std::move(current_deferred_unlock);
+    }
+  }
+  current_deferred_unlock = std::move(deferred);
+}
+
+void DeferredUnlock::Lock(const std::shared_ptr<LockMgr>& lock_mgr, const std::string& key) {
+  for (auto deferred = current_deferred_unlock; deferred;) {
+    if (deferred->Take(lock_mgr, key)) {
+      return;
+    }
+    std::lock_guard lock(deferred->mutex_);
+    deferred = deferred->previous_;
+  }
+  lock_mgr->TryLock(key);
+}
+
+void DeferredUnlock::UnLock(const std::shared_ptr<LockMgr>& lock_mgr, const std::string& key) {
+  if (current_deferred_unlock) {
+    current_deferred_unlock->Add(lock_mgr, key);
+  } else {
+    lock_mgr->UnLock(key);
+  }
+}
+
 MultiScopeRecordLock::MultiScopeRecordLock(const std::shared_ptr<LockMgr>& lock_mgr,
                                            const std::vector<std::string>& keys)
     : lock_mgr_(lock_mgr), keys_(keys) {
   std::string pre_key;
   std::sort(keys_.begin(), keys_.end());
   if (!keys_.empty() && keys_[0].empty()) {
-    lock_mgr_->TryLock(pre_key);
+    DeferredUnlock::Lock(lock_mgr_, pre_key);
   }
 
   for (const auto& key : keys_) {
     if (pre_key != key) {
-      lock_mgr_->TryLock(key);
+      DeferredUnlock::Lock(lock_mgr_, key);
       pre_key = key;
     }
   }
@@ -30,12 +102,12 @@ MultiScopeRecordLock::MultiScopeRecordLock(const std::shared_ptr<LockMgr>& lock_
 MultiScopeRecordLock::~MultiScopeRecordLock() {
   std::string pre_key;
   if (!keys_.empty() && keys_[0].empty()) {
-    lock_mgr_->UnLock(pre_key);
+    DeferredUnlock::UnLock(lock_mgr_, pre_key);
   }
 
   for (const auto& key : keys_) {
     if (pre_key != key) {
-      lock_mgr_->UnLock(key);
+      DeferredUnlock::UnLock(lock_mgr_, key);
       pre_key = key;
     }
   }
@@ -48,13 +120,13 @@ void MultiRecordLock::Lock(const std::vector<std::string>& keys) {
   std::string pre_key;
   // consider internal_keys "" "" "a"
   if (!internal_keys.empty()) {
-    lock_mgr_->TryLock(internal_keys.front());
+    DeferredUnlock::Lock(lock_mgr_, internal_keys.front());
     pre_key = internal_keys.front();
   }
 
   for (const auto& key : internal_keys) {
     if (pre_key != key) {
-      lock_mgr_->TryLock(key);
+      DeferredUnlock::Lock(lock_mgr_, key);
       pre_key = key;
     }
   }
@@ -65,13 +137,13 @@ void MultiRecordLock::Unlock(const std::vector<std::string>& keys) {
   std::sort(internal_keys.begin(), internal_keys.end());
   std::string pre_key;
   if (!internal_keys.empty()) {
-    lock_mgr_->UnLock(internal_keys.front());
+    DeferredUnlock::UnLock(lock_mgr_, internal_keys.front());
     pre_key = internal_keys.front();
   }
 
   for (const auto& key : internal_keys) {
     if (pre_key != key) {
-      lock_mgr_->UnLock(key);
+      DeferredUnlock::UnLock(lock_mgr_, key);
       pre_key = key;
     }
   }
@@ -8,6 +8,8 @@
 #pragma once
 
 #include <algorithm>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -20,12 +22,50 @@ namespace pstd::lock {
 
 using Slice = rocksdb::Slice;
 
+/*
+ * The keys of a write that is applied after the command that made it
+ * returned. While a thread has one set with SetCurrent, the record locks
+ * released on it leave their keys locked and hand them over, the keys are
+ * unlocked by Release once the write is applied, so a later write of the same
+ * keys reads what this one wrote.
+ *
+ * A record lock taken again on a key a DeferredUnlock of the same command
+ * still keeps locked takes it back instead of waiting for the apply, so a
+ * command that commits the same key twice does not wait for its own writes.
+ */
+class DeferredUnlock final : public pstd::noncopyable {
+ public:
+  DeferredUnlock() = default;
+  ~DeferredUnlock() { Release(); }
+
+  // keeps key locked until Release, unlocks it at once if already released
+  void Add(const std::shared_ptr<LockMgr>& lock_mgr, const std::string& key);
+  void Release();
+
+  // the DeferredUnlocks set since the last nullptr are the ones of one command
+  static void SetCurrent(std::shared_ptr<DeferredUnlock> deferred);
+  // locks key, or takes it back from a DeferredUnlock of the command of this thread
+  static void Lock(const std::shared_ptr<LockMgr>& lock_mgr, const std::string& key);
+  // unlocks key, or hands it over to the DeferredUnlock of this thread
+  static void UnLock(const std::shared_ptr<LockMgr>& lock_mgr, const std::string& key);
+
+ private:
+  // removes key if still kept locked, the caller owns the lock then
+  bool Take(const std::shared_ptr<LockMgr>& lock_mgr, const std::string& key);
+
+  std::mutex mutex_;
+  bool released_ = false;
+  std::vector<std::pair<std::shared_ptr<LockMgr>, std::string>> keys_;
+  // the one set before this one in the same command
+  std::shared_ptr<DeferredUnlock> previous_;
+};
+
 class ScopeRecordLock final : public pstd::noncopyable {
  public:
   ScopeRecordLock(const std::shared_ptr<LockMgr>& lock_mgr, const Slice& key) : lock_mgr_(lock_mgr), key_(key) {
-    lock_mgr_->TryLock(key_.ToString());
+    DeferredUnlock::Lock(lock_mgr_, key_.ToString());
   }
-  ~ScopeRecordLock() { lock_mgr_->UnLock(key_.ToString()); }
+  ~ScopeRecordLock() { DeferredUnlock::UnLock(lock_mgr_, key_.ToString()); }
 
  private:
   std::shared_ptr<LockMgr> const lock_mgr_;
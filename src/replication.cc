@@ -5,19 +5,69 @@
  * of patent rights can be found in the PATENTS file in the same directory.
  */
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
 #include <iostream>  // the child process use stdout for log
+#include <limits>
+#include <thread>
+
+#include "fmt/core.h"
 
 #include "client.h"
+#include "cmd_table_manager.h"
 #include "config.h"
 #include "event_loop.h"
 #include "log.h"
 #include "net/util.h"
 #include "pikiwidb.h"
+#include "pstd/env.h"
 #include "pstd/pstd_string.h"
 #include "replication.h"
+#include "store.h"
 
 namespace pikiwidb {
 
+namespace {
+
+// the live WAL files are copied into the checkpoint instead of flushing the
+// memtables, so the writes wait for the checkpoint as short as possible
+const uint64_t kCheckpointLogSizeForFlush = std::numeric_limits<uint64_t>::max();
+
+// the checkpoints the master sends
+std::string CheckpointPath() { return g_config.db_path.ToString() + "_sync_checkpoint"; }
+// the checkpoint the slave receives
+std::string ReceivedCheckpointPath() { return g_config.db_path.ToString() + "_sync_received"; }
+
+bool WriteAll(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    auto n = ::write(fd, data, size);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+}  // namespace
+
+// The checkpoint of a full sync, removed once the slaves it is sent to got it
+// or are gone.
+struct PSyncCheckpoint {
+  ~PSyncCheckpoint() { pstd::DeleteDirIfExist(path); }
+
+  std::string path;
+  // by the path in the checkpoint, db/instance/name
+  std::vector<std::pair<std::string, size_t>> files;
+};
+
 PReplication& PReplication::Instance() {
   static PReplication rep;
   return rep;
@@ -25,10 +75,15 @@ PReplication& PReplication::Instance() {
 
 PReplication::PReplication() {}
 
+PReplication::~PReplication() = default;
+
 bool PReplication::IsBgsaving() const { return bgsaving_; }
 
 void PReplication::AddSlave(pikiwidb::PClient* cli) {
-  slaves_.push_back(std::static_pointer_cast<PClient>(cli->shared_from_this()));
+  {
+    std::lock_guard lock(mutex_);
+    slaves_.push_back(std::static_pointer_cast<PClient>(cli->shared_from_this()));
+  }
 
   // transfer to slave
   cli->TransferToSlaveThreads();
@@ -45,112 +100,194 @@ bool PReplication::HasAnyWaitingBgsave() const {
   return false;
 }
 
-void PReplication::OnRdbSaveDone() {
-  bgsaving_ = false;
+// the increment and the loads are ordered against the store of bgsaving_ and
+// the load of unbarriered_writes_ in Bgsave, one of the two sees the other
+PReplication::WriteGuard::WriteGuard(PReplication& repl) : repl_(repl) {
+  repl_.unbarriered_writes_.fetch_add(1);
+  if (repl_.has_slaves_.load() || repl_.bgsaving_.load()) {
+    repl_.unbarriered_writes_.fetch_sub(1);
+    barrier_ = std::shared_lock(repl_.write_barrier_);
+  }
+}
 
-  pstd::InputMemoryFile rdb;
+PReplication::WriteGuard::~WriteGuard() {
+  if (!barrier_.owns_lock()) {
+    repl_.unbarriered_writes_.fetch_sub(1);
+  }
+}
 
-  // send rdb to slaves that wait rdb end, set state
-  for (auto& wptr : slaves_) {
-    auto cli = wptr.lock();
-    if (!cli) {
-      continue;
+void PReplication::Sync(PClient* cli) {
+  {
+    std::lock_guard lock(mutex_);
+    auto slave = cli->GetSlaveInfo();
+    if (slave->state == kPSlaveStateWaitBgsaveEnd || slave->state == kPSlaveStateOnline) {
+      WARN("{} state is {}, ignore this sync request", cli->GetName(), int(slave->state));
+      return;
     }
+    slave->state = kPSlaveStateWaitBgsaveStart;
+  }
 
-    if (cli->GetSlaveInfo()->state == kPSlaveStateWaitBgsaveEnd) {
-      cli->GetSlaveInfo()->state = kPSlaveStateOnline;
+  TryBgsave();
+}
 
-      if (!rdb.IsOpen()) {
-        ERROR("can not open rdb when replication\n");
-        return;  // fatal error;
+void PReplication::TryBgsave() {
+  if (bgsaving_.exchange(true)) {
+    return;  // the running one checks for the waiting slaves once done
+  }
+
+  std::thread([this]() {
+    while (true) {
+      Bgsave();
+      std::lock_guard lock(mutex_);
+      if (!HasAnyWaitingBgsave()) {
+        bgsaving_ = false;
+        return;
       }
+    }
+  }).detach();
+}
 
-      std::size_t size = std::size_t(-1);
-      const char* data = rdb.Read(size);
+void PReplication::Bgsave() {
+  if (checkpoints_ == 0) {
+    pstd::DeleteDirIfExist(CheckpointPath());
+  }
+  auto checkpoint = std::make_shared<PSyncCheckpoint>();
+  checkpoint->path = CheckpointPath() + "/" + std::to_string(++checkpoints_);
 
-      // $file_len + filedata
-      char tmp[32];
-      int n = snprintf(tmp, sizeof tmp - 1, "$%ld\r\n", (long)size);
-      evbuffer_iovec iovecs[] = {
-          {tmp, (size_t)(n)}, {const_cast<char*>(data), size}, {buffer_.ReadAddr(), buffer_.ReadableSize()}};
-      cli->SendPacket(iovecs, sizeof(iovecs) / sizeof(iovecs[0]));
+  // the writes that took no barrier before bgsaving_ was set finish first,
+  // the later ones take it
+  while (unbarriered_writes_.load() > 0) {
+    std::this_thread::yield();
+  }
+  std::vector<std::weak_ptr<PClient>> slaves;
+  {
+    std::unique_lock barrier(write_barrier_);
+    rocksdb::Status s;
+    for (int i = 0; i < g_config.databases.load() && s.ok(); i++) {
+      s = PSTORE.GetBackend(i)->CreateCheckpoint(checkpoint->path, true, kCheckpointLogSizeForFlush);
+    }
 
-      INFO("Send to slave rdb {}, buffer {}", size, buffer_.ReadableSize());
+    std::lock_guard lock(mutex_);
+    for (const auto& wptr : slaves_) {
+      auto cli = wptr.lock();
+      if (!cli || cli->GetSlaveInfo()->state != kPSlaveStateWaitBgsaveStart) {
+        continue;
+      }
+      if (!s.ok()) {
+        cli->Close();  // release slave
+        continue;
+      }
+      auto slave = cli->GetSlaveInfo();
+      slave->state = kPSlaveStateWaitBgsaveEnd;
+      slave->db = -1;
+      slave->pending.Clear();
+      slaves.push_back(wptr);
+    }
+    if (!s.ok()) {
+      ERROR("PReplication create checkpoint {} failed: {}", checkpoint->path, s.ToString());
+      return;
     }
+    has_slaves_ = true;
   }
 
-  buffer_.Clear();
+  std::vector<std::string> paths;
+  pstd::GetDescendant(checkpoint->path, paths);
+  size_t bytes = 0;
+  for (const auto& path : paths) {
+    if (pstd::IsDir(path) != 1) {
+      continue;
+    }
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    if (ec) {
+      ERROR("PReplication can not stat {}: {}", path, ec.message());
+      continue;
+    }
+    checkpoint->files.emplace_back(path.substr(checkpoint->path.size() + 1), size);
+    bytes += size;
+  }
+  INFO("PReplication send checkpoint {} of {} files, {} bytes, to {} slaves", checkpoint->path,
+       checkpoint->files.size(), bytes, slaves.size());
+
+  auto header = fmt::format("+FULLSYNC {} {} {}\r\n", checkpoint->files.size(), g_config.databases.load(),
+                            g_config.db_instance_num.load());
+  for (const auto& slave : slaves) {
+    if (auto cli = slave.lock()) {
+      cli->SendPacket(header);
+      SendCheckpointFile(slave, checkpoint, 0);
+    }
+  }
 }
 
-void PReplication::TryBgsave() {
-  return;
-  if (IsBgsaving()) {
+// The files go one after another, the next once the last one is written to
+// the socket, so a slave holds one file open and the bytes are not read
+// into memory.
+void PReplication::SendCheckpointFile(const std::weak_ptr<PClient>& slave,
+                                      const std::shared_ptr<PSyncCheckpoint>& checkpoint, size_t index) {
+  auto cli = slave.lock();
+  if (!cli) {
     return;
   }
-
-  if (!HasAnyWaitingBgsave()) {
-    return;
+  if (index == checkpoint->files.size()) {
+    return OnCheckpointSent(cli.get());
   }
 
-  //  int ret = fork();
-  //  if (ret == 0) {
-  //    {
-  //      PDBSaver qdb;
-  //      qdb.Save(g_config.rdbfullname.c_str());
-  //      DEBUG("PReplication save rdb done, exiting child");
-  //    }
-  //    _exit(0);
-  //  } else if (ret == -1) {
-  //    ERROR("PReplication save rdb FATAL ERROR");
-  //    onStartBgsave(false);
-  //  } else {
-  //    INFO("PReplication save rdb START");
-  //    g_qdbPid = ret;
-  //    onStartBgsave(true);
-  //  }
-}
-
-void PReplication::onStartBgsave(bool succ) {
-  buffer_.Clear();
-  bgsaving_ = succ;
-
-  for (auto& c : slaves_) {
-    auto cli = c.lock();
-
-    if (!cli) {
-      continue;
-    }
+  const auto& [name, size] = checkpoint->files[index];
+  auto path = checkpoint->path + "/" + name;
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    ERROR("PReplication can not open {} for {}: {}", path, cli->GetName(), strerror(errno));
+    return cli->Close();
+  }
 
-    if (cli->GetSlaveInfo()->state == kPSlaveStateWaitBgsaveStart) {
-      if (succ) {
-        INFO("onStartBgsave set cli wait bgsave end {}", cli->GetName());
-        cli->GetSlaveInfo()->state = kPSlaveStateWaitBgsaveEnd;
-      } else {
-        cli->Close();  // release slave
-      }
-    }
+  cli->SendPacket(fmt::format("+FILE {} {}\r\n", size, name));
+  if (size == 0) {
+    ::close(fd);
+    return SendCheckpointFile(slave, checkpoint, index + 1);
+  }
+  auto on_sent = [slave, checkpoint, index]() { PREPL.SendCheckpointFile(slave, checkpoint, index + 1); };
+  if (!cli->SendFile(fd, size, std::move(on_sent))) {
+    cli->Close();
   }
 }
 
-void PReplication::SendToSlaves(const std::vector<PString>& params) {
-  if (IsBgsaving()) {  // During the execution of RDB, there are cache changes.
-    SaveCommand(params, buffer_);
+void PReplication::OnCheckpointSent(PClient* cli) {
+  std::lock_guard lock(mutex_);
+  auto slave = cli->GetSlaveInfo();
+  if (!slave || slave->state != kPSlaveStateWaitBgsaveEnd) {
     return;
   }
 
+  // the writes since the checkpoint, the later ones are sent after them
+  INFO("PReplication checkpoint sent to {}, then {} bytes of writes", cli->GetName(), slave->pending.ReadableSize());
+  cli->SendPacket(slave->pending);
+  slave->pending.Clear();
+  slave->state = kPSlaveStateOnline;
+}
+
+void PReplication::SendToSlaves(int db, const std::vector<PString>& params) {
+  std::lock_guard lock(mutex_);
   UnboundedBuffer ub;
 
   for (const auto& wptr : slaves_) {
     auto cli = wptr.lock();
-    if (!cli || cli->GetSlaveInfo()->state != kPSlaveStateOnline) {
+    auto slave = cli ? cli->GetSlaveInfo() : nullptr;
+    if (!slave || (slave->state != kPSlaveStateWaitBgsaveEnd && slave->state != kPSlaveStateOnline)) {
       continue;
     }
 
-    if (ub.IsEmpty()) {
-      SaveCommand(params, ub);
+    // a slave receiving the checkpoint gets the writes once it is sent
+    auto& dst = slave->state == kPSlaveStateOnline ? ub : slave->pending;
+    if (slave->db != db) {
+      SaveCommand({kCmdNameSelect, std::to_string(db)}, dst);
+      slave->db = db;
     }
+    SaveCommand(params, dst);
 
-    cli->SendPacket(ub);
+    if (&dst == &ub) {
+      cli->SendPacket(ub);
+      ub.Clear();
+    }
   }
 }
 
@@ -158,6 +295,7 @@ void PReplication::Cron() {
   static unsigned pingCron = 0;
 
   if (pingCron++ % 50 == 0) {
+    std::lock_guard lock(mutex_);
     for (auto it = slaves_.begin(); it != slaves_.end();) {
       auto cli = it->lock();
       if (!cli) {
@@ -170,6 +308,13 @@ void PReplication::Cron() {
         }
       }
     }
+
+    // changes under the barrier only, see HasSlaves
+    if (slaves_.empty() && has_slaves_) {
+      if (std::unique_lock barrier(write_barrier_, std::try_to_lock); barrier.owns_lock()) {
+        has_slaves_ = false;
+      }
+    }
   }
 
   if (masterInfo_.addr.IsValid()) {
@@ -213,8 +358,26 @@ void PReplication::Cron() {
         masterInfo_.state = kPReplStateConnecting;
       } break;
 
-      case kPReplStateConnected:
-        break;
+      case kPReplStateConnected: {
+        // in raft mode the connection is the one of RAFT.CLUSTER JOIN or REMOVE
+        if (g_config.use_raft.load()) {
+          break;
+        }
+
+        auto master = master_.lock();
+        if (!master) {
+          masterInfo_.state = kPReplStateNone;
+          masterInfo_.downSince = ::time(nullptr);
+          WARN("Master is down from connected to none");
+        } else {
+          if (!g_config.master_auth.empty()) {
+            UnboundedBuffer req;
+            SaveCommand({kCmdNameAuth, g_config.master_auth.ToString()}, req);
+            master->SendPacket(req);
+          }
+          masterInfo_.state = kPReplStateWaitAuth;
+        }
+      } break;
 
       case kPReplStateWaitAuth: {
         auto master = master_.lock();
@@ -242,18 +405,31 @@ void PReplication::Cron() {
           masterInfo_.downSince = ::time(nullptr);
           WARN("Master is down from wait_replconf to none");
         } else {
-          // request sync rdb file
+          // request the checkpoint files
+          if (checkpoint_fd_ != -1) {
+            ::close(checkpoint_fd_);
+            checkpoint_fd_ = -1;
+          }
+          pstd::DeleteDirIfExist(ReceivedCheckpointPath());
+          masterInfo_.filesLeft = std::size_t(-1);
+          masterInfo_.fileBytesLeft = std::size_t(-1);
+          masterInfo_.state = kPReplStateWaitCheckpoint;
+
           master->SendPacket("SYNC\r\n", 6);
           INFO("Request SYNC");
-
-          rdb_.Open(slaveRdbFile, false);
-          masterInfo_.rdbRecved = 0;
-          masterInfo_.rdbSize = std::size_t(-1);
-          masterInfo_.state = kPReplStateWaitRdb;
         }
       } break;
 
-      case kPReplStateWaitRdb:
+      case kPReplStateWaitCheckpoint:
+        if (!master_.lock()) {
+          if (checkpoint_fd_ != -1) {
+            ::close(checkpoint_fd_);
+            checkpoint_fd_ = -1;
+          }
+          masterInfo_.state = kPReplStateNone;
+          masterInfo_.downSince = ::time(nullptr);
+          WARN("Master is down from wait_checkpoint to none");
+        }
         break;
 
       case kPReplStateOnline:
@@ -282,25 +458,121 @@ void PReplication::Cron() {
   }
 }
 
-void PReplication::SaveTmpRdb(const char* data, std::size_t& len) {
-  //  if (masterInfo_.rdbRecved + len > masterInfo_.rdbSize) {
-  //    len = masterInfo_.rdbSize - masterInfo_.rdbRecved;
-  //  }
-  //
-  //  rdb_.Write(data, len);
-  //  masterInfo_.rdbRecved += len;
-  //
-  //  if (masterInfo_.rdbRecved == masterInfo_.rdbSize) {
-  //    INFO("Rdb recv complete, bytes {}", masterInfo_.rdbSize);
-  //
-  //    //PSTORE.ResetDB();
-  //
-  //    PDBLoader loader;
-  //    loader.Load(slaveRdbFile);
-  //    masterInfo_.state = kPReplStateOnline;
-  //    masterInfo_.downSince = 0;
-  //  }
-  return;
+int PReplication::OnCheckpointData(const char* start, const char* end) {
+  // the bytes of a file
+  if (masterInfo_.fileBytesLeft != std::size_t(-1)) {
+    auto len = std::min(static_cast<std::size_t>(end - start), masterInfo_.fileBytesLeft);
+    if (!WriteAll(checkpoint_fd_, start, len)) {
+      FailFullSync(fmt::format("write the checkpoint failed: {}", strerror(errno)));
+      return static_cast<int>(end - start);
+    }
+    masterInfo_.fileBytesLeft -= len;
+    if (masterInfo_.fileBytesLeft == 0) {
+      ::close(checkpoint_fd_);
+      checkpoint_fd_ = -1;
+      masterInfo_.fileBytesLeft = std::size_t(-1);
+      if (--masterInfo_.filesLeft == 0) {
+        LoadCheckpoint();
+      }
+    }
+    return static_cast<int>(len);
+  }
+
+  // a header line
+  const char* crlf = std::search(start, end, "\r\n", "\r\n" + 2);
+  if (crlf == end) {
+    return 0;
+  }
+  auto consumed = static_cast<int>(crlf + 2 - start);
+  std::string line(start, crlf);
+  auto fields = SplitString(line, ' ');
+
+  if (masterInfo_.filesLeft == std::size_t(-1)) {
+    if (!line.empty() && line[0] == '-') {
+      FailFullSync("master replied " + line);
+    } else if (fields.size() == 4 && fields[0] == "+FULLSYNC") {
+      long files = 0;
+      long databases = 0;
+      long instances = 0;
+      if (!pstd::String2int(fields[1], &files) || !pstd::String2int(fields[2], &databases) ||
+          !pstd::String2int(fields[3], &instances)) {
+        FailFullSync("bad header " + line);
+      } else if (databases != g_config.databases.load() || instances != g_config.db_instance_num.load()) {
+        // the slots of the keys are in other instances
+        FailFullSync(fmt::format("master has {} databases of {} instances, this node {} of {}", databases, instances,
+                                 g_config.databases.load(), g_config.db_instance_num.load()));
+      } else {
+        INFO("Recv checkpoint of {} files", files);
+        masterInfo_.filesLeft = files;
+        if (files == 0) {
+          LoadCheckpoint();
+        }
+      }
+    }
+    // the +OK of replconf may come late
+    return consumed;
+  }
+
+  long size = 0;
+  if (fields.size() != 3 || fields[0] != "+FILE" || !pstd::String2int(fields[1], &size) || size < 0 ||
+      fields[2].find("..") != std::string::npos) {
+    FailFullSync("bad file header " + line);
+    return static_cast<int>(end - start);
+  }
+  auto path = ReceivedCheckpointPath() + "/" + fields[2];
+  if (pstd::CreatePath(std::filesystem::path(path).parent_path().string()) != 0) {
+    FailFullSync("create the directory of " + path + " failed");
+    return static_cast<int>(end - start);
+  }
+  checkpoint_fd_ = ::open(path.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0644);
+  if (checkpoint_fd_ < 0) {
+    FailFullSync(fmt::format("open {} failed: {}", path, strerror(errno)));
+    return static_cast<int>(end - start);
+  }
+  masterInfo_.fileBytesLeft = size;
+  if (size == 0) {
+    ::close(checkpoint_fd_);
+    checkpoint_fd_ = -1;
+    masterInfo_.fileBytesLeft = std::size_t(-1);
+    if (--masterInfo_.filesLeft == 0) {
+      LoadCheckpoint();
+    }
+  }
+  return consumed;
+}
+
+void PReplication::LoadCheckpoint() {
+  auto path = ReceivedCheckpointPath();
+  for (int i = 0; i < g_config.databases.load(); i++) {
+    PSTORE.GetBackend(i)->LoadDBFromCheckpoint(path);
+  }
+  pstd::DeleteDirIfExist(path);
+
+  INFO("Full sync from master {} done", AddrToString(&masterInfo_.addr.GetAddr()));
+  masterInfo_.filesLeft = std::size_t(-1);
+  masterInfo_.state = kPReplStateOnline;
+  masterInfo_.downSince = 0;
+}
+
+void PReplication::FailFullSync(const std::string& reason) {
+  ERROR("Full sync from master {} failed, {}", AddrToString(&masterInfo_.addr.GetAddr()), reason);
+  if (checkpoint_fd_ != -1) {
+    ::close(checkpoint_fd_);
+    checkpoint_fd_ = -1;
+  }
+  if (auto master = master_.lock()) {
+    master->Close();
+  }
+  masterInfo_.state = kPReplStateNone;
+  masterInfo_.downSince = ::time(nullptr);
+}
+
+BaseCmd* PReplication::GetMasterCommand(const std::string& name, PClient* cli) {
+  if (!master_cmds_) {
+    master_cmds_ = std::make_unique<CmdTableManager>();
+    master_cmds_->InitCmdTable();
+  }
+  return master_cmds_->GetCommand(name, cli).first;
 }
 
 void PReplication::SetMaster(const std::shared_ptr<PClient>& cli) { master_ = cli; }
@@ -319,53 +591,17 @@ void PReplication::SetMasterAddr(const char* ip, uint16_t port) {
   }
 }
 
-void PReplication::SetRdbSize(std::size_t s) { masterInfo_.rdbSize = s; }
-
-std::size_t PReplication::GetRdbSize() const { return masterInfo_.rdbSize; }
-
-PError replconf(const std::vector<PString>& params, UnboundedBuffer* reply) {
-  if (params.size() % 2 == 0) {
-    ReplyError(kPErrorSyntax, reply);
-    return kPErrorSyntax;
-  }
-
-  for (size_t i = 1; i < params.size(); i += 2) {
-    if (strncasecmp(params[i].c_str(), "listening-port", 14) == 0) {
-      long port;
-      if (!pstd::String2int(params[i + 1].c_str(), params[i + 1].size(), &port)) {
-        ReplyError(kPErrorParam, reply);
-        return kPErrorParam;
-      }
-
-      auto client = PClient::Current();
-      auto info = client->GetSlaveInfo();
-      if (!info) {
-        client->SetSlaveInfo();
-        info = client->GetSlaveInfo();
-        PREPL.AddSlave(client);
-      }
-      info->listenPort = static_cast<uint16_t>(port);
-    } else {
-      break;
-    }
-  }
-
-  FormatOK(reply);
-  return kPErrorOK;
-}
-
 void PReplication::OnInfoCommand(UnboundedBuffer& res) {
   const char* slaveState[] = {
       "none",
       "wait_bgsave",
-      "wait_bgsave",
-      //"send_bulk", // pikiwidb does not have send bulk state
+      "send_checkpoint",
       "online",
-
   };
 
   std::ostringstream oss;
   int index = 0;
+  std::unique_lock lock(mutex_);
   for (const auto& c : slaves_) {
     auto cli = c.lock();
     if (cli) {
@@ -380,6 +616,7 @@ void PReplication::OnInfoCommand(UnboundedBuffer& res) {
     }
   }
 
+  lock.unlock();
   PString slaveInfo(oss.str());
 
   char buf[1024] = {};
@@ -396,14 +633,16 @@ void PReplication::OnInfoCommand(UnboundedBuffer& res) {
                << "\r\nmaster_link_status:";
 
     auto master = master_.lock();
-    masterInfo << (master ? "up\r\n" : "down\r\n");
-    if (!master) {
-      if (!masterInfo_.downSince) {
-        assert(0);
-      }
-
+    masterInfo << (master && masterInfo_.state == kPReplStateOnline ? "up\r\n" : "down\r\n");
+    if (!master && masterInfo_.downSince) {
       masterInfo << "master_link_down_since_seconds:" << (::time(nullptr) - masterInfo_.downSince) << "\r\n";
     }
+
+    bool syncing = masterInfo_.state == kPReplStateWaitCheckpoint;
+    masterInfo << "master_sync_in_progress:" << (syncing ? 1 : 0) << "\r\n";
+    if (syncing && masterInfo_.filesLeft != std::size_t(-1)) {
+      masterInfo << "master_sync_left_files:" << masterInfo_.filesLeft << "\r\n";
+    }
   }
 
   if (!res.IsEmpty()) {
@@ -418,45 +657,4 @@ void PReplication::OnInfoCommand(UnboundedBuffer& res) {
   }
 }
 
-PError slaveof(const std::vector<PString>& params, UnboundedBuffer* reply) {
-  if (strncasecmp(params[1].data(), "no", 2) == 0 && strncasecmp(params[2].data(), "one", 3) == 0) {
-    PREPL.SetMasterAddr(nullptr, 0);
-  } else {
-    long tmpPort = 0;
-    pstd::String2int(params[2].c_str(), params[2].size(), &tmpPort);
-    uint16_t port = static_cast<uint16_t>(tmpPort);
-
-    SocketAddr reqMaster(params[1].c_str(), port);
-
-    if (port > 0 && PREPL.GetMasterAddr() != reqMaster) {
-      PREPL.SetMasterAddr(params[1].c_str(), port);
-      PREPL.SetMasterState(kPReplStateNone);
-    }
-  }
-
-  FormatOK(reply);
-  return kPErrorOK;
-}
-
-PError sync(const std::vector<PString>& params, UnboundedBuffer* reply) {
-  PClient* cli = PClient::Current();
-  auto slave = cli->GetSlaveInfo();
-  if (!slave) {
-    cli->SetSlaveInfo();
-    slave = cli->GetSlaveInfo();
-    PREPL.AddSlave(cli);
-  }
-
-  if (slave->state == kPSlaveStateWaitBgsaveEnd || slave->state == kPSlaveStateOnline) {
-    WARN("{} state is {}, ignore this sync request", cli->GetName(), int(slave->state));
-
-    return kPErrorOK;
-  }
-
-  slave->state = kPSlaveStateWaitBgsaveStart;
-  PREPL.TryBgsave();
-
-  return kPErrorOK;
-}
-
 }  // namespace pikiwidb
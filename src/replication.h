@@ -7,15 +7,17 @@
 
 #pragma once
 
+#include <atomic>
 #include <list>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <vector>
 
 #include "common.h"
 #include "net/tcp_connection.h"
 #include "net/unbounded_buffer.h"
 #include "net/util.h"
-#include "pstd/memory_file.h"
 
 namespace pikiwidb {
 
@@ -58,18 +60,31 @@ inline void SaveCommand(const std::vector<PString>& params, DEST& dst) {
   }
 }
 
+/*
+ * A full sync streams a checkpoint of all the dbs to the slave, then the
+ * writes the master ran since, then the writes as they run:
+ *
+ *   +FULLSYNC <files> <databases> <db-instance-num>\r\n
+ *   +FILE <size> <db>/<instance>/<name>\r\n<size bytes>   (for each file)
+ *   *<argc>\r\n$<len>\r\n<arg>\r\n...                     (the writes)
+ *
+ * The slave loads the files with DB::LoadDBFromCheckpoint, so the sync is
+ * bounded by the disk and the network instead of replaying every key.
+ */
+
 // master side
 enum PSlaveState {
   kPSlaveStateNone,
-  kPSlaveStateWaitBgsaveStart,  // 有非sync的bgsave进行 要等待
-  kPSlaveStateWaitBgsaveEnd,    // sync bgsave正在进行
-  // PSlaveState_send_rdb, // 这个slave在接受rdb文件
+  kPSlaveStateWaitBgsaveStart,  // waits for the next checkpoint
+  kPSlaveStateWaitBgsaveEnd,    // receives the checkpoint, its writes are kept in pending
   kPSlaveStateOnline,
 };
 
 struct PSlaveInfo {
   PSlaveState state;
   uint16_t listenPort;  // slave listening port
+  int db = -1;          // the db the writes sent to the slave are for
+  UnboundedBuffer pending;
 
   PSlaveInfo() : state(kPSlaveStateNone), listenPort(0) {}
 };
@@ -81,7 +96,7 @@ enum PReplState {
   kPReplStateConnected,
   kPReplStateWaitAuth,      // wait auth to be confirmed
   kPReplStateWaitReplconf,  // wait replconf to be confirmed
-  kPReplStateWaitRdb,       // wait to recv rdb file
+  kPReplStateWaitCheckpoint,  // wait to recv the checkpoint files
   kPReplStateOnline,
 };
 
@@ -90,22 +105,22 @@ struct PMasterInfo {
   PReplState state;
   time_t downSince;
 
-  // For recv rdb
-  std::size_t rdbSize;
-  std::size_t rdbRecved;
+  // For recv the checkpoint, -1 before +FULLSYNC and between the files
+  std::size_t filesLeft;
+  std::size_t fileBytesLeft;
 
   PMasterInfo() {
     state = kPReplStateNone;
     downSince = 0;
-    rdbSize = static_cast<std::size_t>(-1);
-    rdbRecved = 0;
+    filesLeft = static_cast<std::size_t>(-1);
+    fileBytesLeft = static_cast<std::size_t>(-1);
   }
 };
 
-// tmp filename
-const char* const slaveRdbFile = "slave.rdb";
-
+class BaseCmd;
+class CmdTableManager;
 class PClient;
+struct PSyncCheckpoint;
 
 class PReplication {
  public:
@@ -118,42 +133,81 @@ class PReplication {
 
   // master side
   bool IsBgsaving() const;
-  bool HasAnyWaitingBgsave() const;
   void AddSlave(PClient* cli);
-  void TryBgsave();
-  bool StartBgsave();
-  void OnStartBgsave();
-  void OnRdbSaveDone();
-  void SendToSlaves(const std::vector<PString>& params);
+  // the slave waits for the next checkpoint
+  void Sync(PClient* cli);
+  // A write holds one while it runs and is sent to the slaves. The
+  // checkpoints of a full sync are created under write_barrier_ exclusive,
+  // which the write holds shared, so a write is either in them or sent after
+  // them. With no slaves and no bgsave pending the write only counts itself
+  // in unbarriered_writes_, Bgsave waits for those to finish.
+  class WriteGuard {
+   public:
+    explicit WriteGuard(PReplication& repl);
+    ~WriteGuard();
+    WriteGuard(const WriteGuard&) = delete;
+    WriteGuard& operator=(const WriteGuard&) = delete;
+
+    // false if the write has no slave to be sent to
+    bool Barriered() const { return barrier_.owns_lock(); }
+
+   private:
+    PReplication& repl_;
+    std::shared_lock<std::shared_mutex> barrier_;
+  };
+  // stable under a barriered WriteGuard
+  bool HasSlaves() const { return has_slaves_.load(std::memory_order_relaxed); }
+  void SendToSlaves(int db, const std::vector<PString>& params);
 
   // slave side
   void SetFailCallback(TcpConnectionFailCallback cb) { on_fail_ = std::move(cb); }
-  void SaveTmpRdb(const char* data, std::size_t& len);
+  // the bytes of the stream consumed, 0 until a header line is complete
+  int OnCheckpointData(const char* start, const char* end);
+  // the commands of the master run in its connection, see PClient, nullptr
+  // for an unknown one
+  BaseCmd* GetMasterCommand(const std::string& name, PClient* cli);
   void SetMaster(const std::shared_ptr<PClient>& cli);
   void SetMasterState(PReplState s);
   void SetMasterAddr(const char* ip, uint16_t port);
-  void SetRdbSize(std::size_t s);
   PReplState GetMasterState() const;
   PClient* GetMaster() const { return master_.lock().get(); }
   SocketAddr GetMasterAddr() const;
-  std::size_t GetRdbSize() const;
 
   // info command
   void OnInfoCommand(UnboundedBuffer& res);
 
  private:
   PReplication();
-  void onStartBgsave(bool succ);
+  ~PReplication();
 
   // master side
-  bool bgsaving_;
-  UnboundedBuffer buffer_;
+  bool HasAnyWaitingBgsave() const;
+  void TryBgsave();
+  void Bgsave();
+  void SendCheckpointFile(const std::weak_ptr<PClient>& slave, const std::shared_ptr<PSyncCheckpoint>& checkpoint,
+                          size_t index);
+  void OnCheckpointSent(PClient* cli);
+
+  // slave side
+  void LoadCheckpoint();
+  void FailFullSync(const std::string& reason);
+
+  // master side
+  std::atomic<bool> bgsaving_{false};
+  std::atomic<bool> has_slaves_{false};
+  std::shared_mutex write_barrier_;
+  std::atomic<int64_t> unbarriered_writes_{0};
+  // slaves_ and their PSlaveInfo
+  mutable std::mutex mutex_;
   std::list<std::weak_ptr<PClient> > slaves_;
 
+  uint64_t checkpoints_ = 0;
+
   // slave side
   PMasterInfo masterInfo_;
   std::weak_ptr<PClient> master_;
-  pstd::OutputMemoryFile rdb_;
+  int checkpoint_fd_ = -1;
+  std::unique_ptr<CmdTableManager> master_cmds_;
 
   // Callback function that failed to connect to the master node
   TcpConnectionFailCallback on_fail_ = nullptr;
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rocksdb/db.h"
+
+namespace storage::bench {
+
+// the microseconds func takes
+template <typename Func>
+int64_t TimeUs(Func&& func) {
+  auto start = std::chrono::steady_clock::now();
+  std::forward<Func>(func)();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+struct KeyOrderResult {
+  int64_t put_us = 0;
+  int64_t range_us = 0;
+  size_t ranged = 0;
+};
+
+// puts the keys into a DB ordered by comparator, then reads range_len keys
+// from each of the seek keys
+inline KeyOrderResult RunKeyOrder(const std::string& path, const rocksdb::Comparator* comparator,
+                                  const std::vector<std::string>& keys, const std::vector<std::string>& seeks,
+                                  int range_len) {
+  std::filesystem::remove_all(path);
+  std::filesystem::create_directories(path);
+  rocksdb::Options options;
+  options.create_if_missing = true;
+  options.comparator = comparator;
+  rocksdb::DB* db = nullptr;
+  KeyOrderResult result;
+  if (!rocksdb::DB::Open(options, path, &db).ok()) {
+    return result;
+  }
+  result.put_us = TimeUs([&]() {
+    for (const auto& key : keys) {
+      db->Put(rocksdb::WriteOptions(), key, "");
+    }
+  });
+  // ranged from the SSTs, like in a loaded DB
+  db->Flush(rocksdb::FlushOptions());
+  db->CompactRange(rocksdb::CompactRangeOptions(), nullptr, nullptr);
+  result.range_us = TimeUs([&]() {
+    std::unique_ptr<rocksdb::Iterator> iter(db->NewIterator(rocksdb::ReadOptions()));
+    for (const auto& seek : seeks) {
+      iter->Seek(seek);
+      for (int i = 0; i < range_len && iter->Valid(); i++, iter->Next()) {
+        result.ranged++;
+      }
+    }
+  });
+  delete db;
+  std::filesystem::remove_all(path);
+  return result;
+}
+
+}  // namespace storage::bench
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <algorithm>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "benchmark/bench_util.h"
+#include "binlog.pb.h"
+#include "storage/storage.h"
+#include "tests/sync_raft_storage.h"
+
+using namespace storage;  // NOLINT
+using storage::bench::TimeUs;
+
+namespace {
+
+const int kLogs = 100000;
+// the logs of an on_apply round, and the binlogs of a group commit
+const int kRound = 32;
+const int kInstances = 4;
+
+// the binlog of a SET
+BinlogWriter MakeBinlog(int i) {
+  BinlogWriter log(0, 0, kCurrentKeyFormat);
+  std::string key = fmt::format("key_{:08d}", i);
+  std::string value(64, 'v');
+  Slice value_slice(value);
+  log.AddEntry(kStringsCF, pikiwidb::OperateType::kPut, key, &value_slice);
+  return log;
+}
+
+// a log per binlog, applied one at a time, like on_apply before the batches
+void ApplyOneByOne(Storage& db, const std::vector<BinlogWriter>& binlogs) {
+  for (size_t i = 0; i < binlogs.size(); i++) {
+    BinlogView view;
+    view.Parse({binlogs[i].Data(), binlogs[i].Size()});
+    db.OnBinlogWrite(view, static_cast<LogIndex>(i + 1));
+  }
+}
+
+// a log per binlog, the logs of a round applied with one write batch
+void ApplyInRounds(Storage& db, const std::vector<BinlogWriter>& binlogs) {
+  std::vector<Status> statuses;
+  for (size_t start = 0; start < binlogs.size(); start += kRound) {
+    size_t end = std::min(binlogs.size(), start + kRound);
+    std::vector<BinlogView> views(end - start);
+    std::vector<std::pair<const BinlogView*, LogIndex>> logs;
+    for (size_t i = start; i < end; i++) {
+      views[i - start].Parse({binlogs[i].Data(), binlogs[i].Size()});
+      logs.emplace_back(&views[i - start], static_cast<LogIndex>(i + 1));
+    }
+    db.OnBinlogWrite(logs, &statuses);
+  }
+}
+
+// the binlogs of kRound writes group committed into one log
+std::vector<std::string> GroupCommit(const std::vector<BinlogWriter>& binlogs) {
+  std::vector<std::string> logs;
+  for (size_t start = 0; start < binlogs.size(); start += kRound) {
+    size_t end = std::min(binlogs.size(), start + kRound);
+    size_t size = 0;
+    for (size_t i = start; i < end; i++) {
+      size += binlogs[i].Size();
+    }
+    auto& log = logs.emplace_back(BinlogWriter::GroupHeader(size));
+    for (size_t i = start; i < end; i++) {
+      log.append(binlogs[i].Data(), binlogs[i].Size());
+    }
+  }
+  return logs;
+}
+
+// a log per group, its binlogs parse as one binlog of one write batch
+void ApplyGroups(Storage& db, const std::vector<std::string>& logs) {
+  for (size_t i = 0; i < logs.size(); i++) {
+    BinlogView log;
+    BinlogView binlog;
+    log.Parse(logs[i]);
+    binlog.Parse(log.Group().front());
+    db.OnBinlogWrite(binlog, static_cast<LogIndex>(i + 1));
+  }
+}
+
+// apply on a storage of its own, the storages are opened before the timing
+template <typename Apply>
+int64_t Run(const std::string& name, int storages, bool concurrently, Apply&& apply) {
+  std::vector<std::unique_ptr<SyncRaftStorage>> dbs;
+  for (int i = 0; i < storages; i++) {
+    dbs.push_back(std::make_unique<SyncRaftStorage>(fmt::format("./bench_db/binlog_apply_{}_{}", name, i)));
+    if (!dbs.back()->Open().ok()) {
+      return -1;
+    }
+  }
+  return TimeUs([&]() {
+    std::vector<std::future<void>> futures;
+    for (auto& db : dbs) {
+      if (concurrently) {
+        futures.push_back(std::async(std::launch::async, [&apply, &db]() { apply(db->db()); }));
+      } else {
+        apply(db->db());
+      }
+    }
+    for (auto& future : futures) {
+      future.wait();
+    }
+  });
+}
+
+}  // namespace
+
+// The apply of raft logs of one write each, one at a time, against the
+// logs of an on_apply round in one write batch per instance, the instances
+// applied concurrently, and against the logs of group commits. The raft
+// side of a group commit, a log and an append per group instead of per
+// write, needs a raft group and is not timed here, the log counts show it.
+int main() {
+  std::vector<BinlogWriter> binlogs;
+  size_t binlog_bytes = 0;
+  for (int i = 0; i < kLogs; i++) {
+    binlogs.push_back(MakeBinlog(i));
+    binlog_bytes += binlogs.back().Size();
+  }
+  auto groups = GroupCommit(binlogs);
+  size_t group_bytes = 0;
+  for (const auto& group : groups) {
+    group_bytes += group.size();
+  }
+
+  auto one_by_one_us = Run("one_by_one", 1, false, [&](Storage& db) { ApplyOneByOne(db, binlogs); });
+  auto rounds_us = Run("rounds", 1, false, [&](Storage& db) { ApplyInRounds(db, binlogs); });
+  auto groups_us = Run("groups", 1, false, [&](Storage& db) { ApplyGroups(db, groups); });
+  if (one_by_one_us < 0 || rounds_us < 0 || groups_us < 0) {
+    fmt::print(stderr, "the storage failed to open\n");
+    return 1;
+  }
+  fmt::print("{} logs of a SET applied one by one: {}us, in rounds of {}: {}us\n", kLogs, one_by_one_us, kRound,
+             rounds_us);
+  fmt::print("{} group commits of {} SETs: {}us, {} log bytes ({} logs of {} bytes)\n", groups.size(), kRound,
+             groups_us, group_bytes, kLogs, binlog_bytes);
+
+  auto serial_us = Run("serial", kInstances, false, [&](Storage& db) { ApplyInRounds(db, binlogs); });
+  auto concurrent_us = Run("concurrent", kInstances, true, [&](Storage& db) { ApplyInRounds(db, binlogs); });
+  fmt::print("rounds of {} instances applied concurrently: {}us (one after another {}us)\n", kInstances,
+             concurrent_us, serial_us);
+  return 0;
+}
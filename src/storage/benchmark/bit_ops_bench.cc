@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "benchmark/bench_util.h"
+#include "src/bit_ops.h"
+#include "tests/bit_ops_reference.h"
+
+using namespace storage;             // NOLINT
+using namespace storage::reference;  // NOLINT
+using storage::bench::TimeUs;
+
+// BITCOUNT, BITOP and BITPOS of 8MB bitmaps, against the byte loops
+int main() {
+  std::mt19937 gen(374);
+  const size_t kBitmapSize = 8 << 20;
+  std::vector<std::string> src_values;
+  for (int i = 0; i < 4; i++) {
+    src_values.push_back(RandomBytes(&gen, kBitmapSize));
+  }
+
+  int64_t count = 0;
+  int64_t reference_count = 0;
+  auto count_us = TimeUs([&]() { count = GetBitCount(Bytes(src_values[0]), kBitmapSize); });
+  auto reference_count_us = TimeUs([&]() { reference_count = ReferenceBitCount(Bytes(src_values[0]), kBitmapSize); });
+
+  std::string dest;
+  std::string reference_dest;
+  auto bitop_us = TimeUs([&]() { dest = BitOpOperate(kBitOpXor, src_values, kBitmapSize); });
+  auto reference_bitop_us = TimeUs([&]() { reference_dest = ReferenceBitOp(kBitOpXor, src_values, kBitmapSize); });
+
+  std::string zeros(kBitmapSize, '\0');
+  zeros.back() = 1;
+  int64_t pos = 0;
+  int64_t reference_pos = 0;
+  auto bitpos_us = TimeUs([&]() { pos = GetBitPos(Bytes(zeros), kBitmapSize, 1); });
+  auto reference_bitpos_us = TimeUs([&]() { reference_pos = ReferenceBitPos(Bytes(zeros), kBitmapSize, 1); });
+
+  if (count != reference_count || dest != reference_dest || pos != reference_pos) {
+    fmt::print(stderr, "the results differ from the byte loops\n");
+    return 1;
+  }
+  fmt::print("8MB BITCOUNT {}us (byte loop {}us)\n", count_us, reference_count_us);
+  fmt::print("8MB BITOP XOR of 4 {}us (byte loop {}us)\n", bitop_us, reference_bitop_us);
+  fmt::print("8MB BITPOS {}us (bit loop {}us)\n", bitpos_us, reference_bitpos_us);
+  return 0;
+}
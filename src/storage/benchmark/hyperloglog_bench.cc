@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "benchmark/bench_util.h"
+#include "src/redis_hyperloglog.h"
+#include "tests/hyperloglog_reference.h"
+
+using namespace storage;             // NOLINT
+using namespace storage::reference;  // NOLINT
+using storage::bench::TimeUs;
+
+// PFADD of one value at a time and PFCOUNT of several dense keys, against
+// the one byte per register implementation
+int main() {
+  const int kAdds = 1000;
+  const int kKeys = 8;
+  const int kValuesPerKey = 50000;
+
+  // decoded and encoded like the storage does
+  std::string value;
+  auto add_us = TimeUs([&]() {
+    for (int i = 0; i < kAdds; i++) {
+      HyperLogLog hll(kPrecision);
+      hll.Decode(value);
+      std::string element = std::to_string(i);
+      hll.Add(element.data(), element.size());
+      value = hll.Encode();
+    }
+  });
+  // which also estimated the cardinality before and after the add
+  std::string registers;
+  int updates = 0;
+  auto reference_add_us = TimeUs([&]() {
+    for (int i = 0; i < kAdds; i++) {
+      ReferenceHyperLogLog hll(registers);
+      auto previous = static_cast<int32_t>(hll.Estimate());
+      registers = hll.Add(std::to_string(i));
+      auto now = static_cast<int32_t>(ReferenceHyperLogLog(registers).Estimate());
+      updates += previous != now ? 1 : 0;
+    }
+  });
+  HyperLogLog added(kPrecision);
+  added.Decode(value);
+  if (added.Estimate() != ReferenceHyperLogLog(registers).Estimate()) {
+    fmt::print(stderr, "the PFADD estimates differ\n");
+    return 1;
+  }
+
+  std::vector<std::string> values;
+  std::vector<std::string> reference_values;
+  for (int key = 0; key < kKeys; key++) {
+    HyperLogLog dense(kPrecision);
+    ReferenceHyperLogLog reference("");
+    for (int i = 0; i < kValuesPerKey; i++) {
+      std::string element = std::to_string(key) + "_" + std::to_string(i);
+      dense.Add(element.data(), element.size());
+      reference.Add(element);
+    }
+    values.push_back(dense.Encode());
+    reference_values.push_back(reference.Registers());
+  }
+  double estimate = 0;
+  auto count_us = TimeUs([&]() {
+    HyperLogLog merged(kPrecision);
+    merged.Decode(values[0]);
+    for (int key = 1; key < kKeys; key++) {
+      HyperLogLog dense(kPrecision);
+      dense.Decode(values[key]);
+      merged.Merge(dense);
+    }
+    estimate = merged.Estimate();
+  });
+  double reference_estimate = 0;
+  auto reference_count_us = TimeUs([&]() {
+    ReferenceHyperLogLog merged(reference_values[0]);
+    for (int key = 1; key < kKeys; key++) {
+      merged.Merge(ReferenceHyperLogLog(reference_values[key]));
+    }
+    reference_estimate = merged.Estimate();
+  });
+  if (estimate != reference_estimate) {
+    fmt::print(stderr, "the PFCOUNT estimates differ\n");
+    return 1;
+  }
+
+  fmt::print("{} PFADD {}us (one byte per register {}us, {} estimates changed)\n", kAdds, add_us, reference_add_us,
+             updates);
+  fmt::print("PFCOUNT of {} dense keys {}us (one byte per register {}us)\n", kKeys, count_us, reference_count_us);
+  return 0;
+}
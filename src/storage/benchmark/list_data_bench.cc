@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "benchmark/bench_util.h"
+#include "src/coding.h"
+#include "src/custom_comparator.h"
+#include "src/data_key_prefix_transform.h"
+#include "src/lists_data_key_format.h"
+#include "src/lists_meta_value_format.h"
+#include "storage/storage.h"
+#include "storage/util.h"
+
+using namespace storage;  // NOLINT
+using storage::bench::RunKeyOrder;
+using storage::bench::TimeUs;
+
+namespace {
+
+const std::string kKey = "list";
+const uint64_t kVersion = 1;
+
+// a list data key, with the index little-endian when legacy
+std::string ListNodeKey(uint64_t index, bool legacy) {
+  std::string key = ListsDataKey(kKey, kVersion, index).Encode().ToString();
+  if (legacy) {
+    EncodeFixed64(key.data() + DataKeyPrefixTransform().Transform(key).size(), index);
+  }
+  return key;
+}
+
+}  // namespace
+
+// The node keys of LPUSH and RPUSH and the seeks and scans of LRANGE, in a CF
+// sorted by the legacy comparator, which scanned the user key and decoded the
+// version and index on every compare, against the bytewise CF that replaced
+// it. Then the commands on the storage, which also update the meta key.
+int main() {
+  const int kPushes = 200000;
+  const int kRanges = 20000;
+  const int kRangeLen = 10;
+
+  // half of the nodes pushed on each side, alternately
+  std::vector<uint64_t> indexes;
+  for (int i = 0; i < kPushes / 2; i++) {
+    indexes.push_back(InitalLeftIndex - i);
+    indexes.push_back(InitalRightIndex + i);
+  }
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<uint64_t> index_dist(InitalLeftIndex - kPushes / 2, InitalRightIndex + kPushes / 2);
+  std::vector<uint64_t> seek_indexes;
+  for (int i = 0; i < kRanges; i++) {
+    seek_indexes.push_back(index_dist(rng));
+  }
+
+  std::vector<std::string> keys[2];
+  std::vector<std::string> seeks[2];
+  for (int legacy = 0; legacy < 2; legacy++) {
+    for (uint64_t index : indexes) {
+      keys[legacy].push_back(ListNodeKey(index, legacy != 0));
+    }
+    for (uint64_t index : seek_indexes) {
+      seeks[legacy].push_back(ListNodeKey(index, legacy != 0));
+    }
+  }
+  ListsDataKeyComparatorImpl legacy_comparator;
+  auto legacy = RunKeyOrder("./bench_db/legacy_list", &legacy_comparator, keys[1], seeks[1], kRangeLen);
+  auto bytewise =
+      RunKeyOrder("./bench_db/bytewise_list", rocksdb::BytewiseComparator(), keys[0], seeks[0], kRangeLen);
+  if (legacy.ranged != bytewise.ranged || bytewise.ranged == 0) {
+    fmt::print(stderr, "the ranged list nodes differ\n");
+    return 1;
+  }
+  fmt::print("{} list node puts: {}us (legacy comparator {}us)\n", kPushes, bytewise.put_us, legacy.put_us);
+  fmt::print("{} seeks and scans of {} list nodes: {}us (legacy comparator {}us)\n", kRanges, kRangeLen,
+             bytewise.range_us, legacy.range_us);
+
+  const std::string kPath = "./bench_db/list_commands";
+  std::filesystem::remove_all(kPath);
+  {
+    StorageOptions options;
+    options.options.create_if_missing = true;
+    options.db_instance_num = 1;
+    Storage db;
+    if (!db.Open(options, kPath).ok()) {
+      fmt::print(stderr, "the storage failed to open\n");
+      return 1;
+    }
+    uint64_t len = 0;
+    auto push_us = TimeUs([&]() {
+      for (int i = 0; i < kPushes / 2; i++) {
+        db.LPush(kKey, {fmt::format("left_{}", i)}, &len);
+        db.RPush(kKey, {fmt::format("right_{}", i)}, &len);
+      }
+    });
+    std::uniform_int_distribution<int64_t> start_dist(0, kPushes - kRangeLen);
+    std::vector<std::string> elements;
+    auto lrange_us = TimeUs([&]() {
+      for (int i = 0; i < kRanges; i++) {
+        int64_t start = start_dist(rng);
+        db.LRange(kKey, start, start + kRangeLen - 1, &elements);
+      }
+    });
+    fmt::print("{} LPUSHs and RPUSHs: {}us, {} LRANGEs of {}: {}us\n", kPushes, push_us, kRanges, kRangeLen, lrange_us);
+    db.Close();
+  }
+  DeleteFiles(kPath.c_str());
+  return 0;
+}
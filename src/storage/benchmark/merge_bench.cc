@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <string>
+
+#include <fmt/core.h>
+
+#include "benchmark/bench_util.h"
+#include "storage/storage.h"
+#include "tests/sync_raft_storage.h"
+
+using namespace storage;  // NOLINT
+using storage::bench::TimeUs;
+
+namespace {
+
+struct Result {
+  int64_t write_us = 0;
+  size_t log_bytes = 0;
+  int64_t get_us = 0;
+};
+
+// write is run times, then the key is read once
+template <typename Write>
+Result Run(const std::string& path, int runs, Write&& write) {
+  SyncRaftStorage storage(path);
+  Result result;
+  if (!storage.Open().ok()) {
+    return result;
+  }
+  result.write_us = TimeUs([&]() {
+    for (int i = 0; i < runs; i++) {
+      write(storage.db());
+    }
+  });
+  result.log_bytes = storage.log_bytes();
+  std::string value;
+  result.get_us = TimeUs([&]() { storage.db().Get("key", &value); });
+  return result;
+}
+
+void Print(const char* name, const Result& merge, const Result& rewrite) {
+  fmt::print("{}: {}us, {} log bytes, GET after {}us (rewrite {}us, {} log bytes, GET after {}us)\n", name,
+             merge.write_us, merge.log_bytes, merge.get_us, rewrite.write_us, rewrite.log_bytes, rewrite.get_us);
+}
+
+}  // namespace
+
+// APPEND, which merges, against a GET and a SET of the whole value, which it
+// replaced. It still reads the value for the reply, so the merge saves only
+// the bytes written.
+int main() {
+  const int kAppends = 900;
+  const std::string kSuffix(64, 's');
+  auto append = Run("./bench_db/merge_append", kAppends, [&](Storage& db) {
+    int32_t len = 0;
+    db.Append("key", kSuffix, &len);
+  });
+  auto rewrite_append = Run("./bench_db/rewrite_append", kAppends, [&](Storage& db) {
+    std::string value;
+    db.Get("key", &value);
+    db.Set("key", value + kSuffix);
+  });
+  Print("900 APPENDs of 64 bytes", append, rewrite_append);
+  return 0;
+}
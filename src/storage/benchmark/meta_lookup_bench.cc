@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+#include "rocksdb/db.h"
+
+#include "benchmark/bench_util.h"
+#include "src/base_filter.h"
+#include "src/base_key_format.h"
+#include "storage/storage.h"
+#include "storage/util.h"
+
+using namespace storage;  // NOLINT
+using storage::bench::TimeUs;
+
+namespace {
+
+std::string MetaKey(int i) { return BaseMetaKey(fmt::format("key_{:08d}", i)).Encode().ToString(); }
+
+}  // namespace
+
+// The meta lookups of the data CF compaction filters, in key order, with
+// MetaValueLookup against the Get per user key it replaced. Then the time a
+// compaction of the hash CFs takes, with half of the hashes deleted.
+int main() {
+  const int kKeys = 500000;
+  const int kHashes = 50000;
+  const int kFields = 20;
+
+  const std::string kLookupPath = "./bench_db/meta_lookup";
+  std::filesystem::remove_all(kLookupPath);
+  std::filesystem::create_directories(kLookupPath);
+  rocksdb::Options options;
+  options.create_if_missing = true;
+  rocksdb::DB* db = nullptr;
+  if (!rocksdb::DB::Open(options, kLookupPath, &db).ok()) {
+    fmt::print(stderr, "the DB failed to open\n");
+    return 1;
+  }
+  // only the even keys have a meta value, like the data keys of deleted keys
+  for (int i = 0; i < kKeys; i += 2) {
+    db->Put(rocksdb::WriteOptions(), MetaKey(i), fmt::format("meta_{}", i));
+  }
+  db->Flush(rocksdb::FlushOptions());
+  db->CompactRange(rocksdb::CompactRangeOptions(), nullptr, nullptr);
+
+  std::string meta_value;
+  int lookup_found = 0;
+  auto lookup_us = TimeUs([&]() {
+    MetaValueLookup lookup;
+    for (int i = 0; i < kKeys; i++) {
+      lookup_found += lookup.Lookup(db, db->DefaultColumnFamily(), MetaKey(i), &meta_value).ok() ? 1 : 0;
+    }
+  });
+  int get_found = 0;
+  auto get_us = TimeUs([&]() {
+    rocksdb::ReadOptions read_options;
+    read_options.fill_cache = false;
+    for (int i = 0; i < kKeys; i++) {
+      get_found += db->Get(read_options, MetaKey(i), &meta_value).ok() ? 1 : 0;
+    }
+  });
+  delete db;
+  std::filesystem::remove_all(kLookupPath);
+  if (lookup_found != get_found || lookup_found != kKeys / 2) {
+    fmt::print(stderr, "the lookups found {} meta keys, the Gets {}\n", lookup_found, get_found);
+    return 1;
+  }
+  fmt::print("{} meta lookups in key order: {}us (Get per key {}us)\n", kKeys, lookup_us, get_us);
+
+  const std::string kPath = "./bench_db/hash_compaction";
+  std::filesystem::remove_all(kPath);
+  {
+    StorageOptions storage_options;
+    storage_options.options.create_if_missing = true;
+    storage_options.db_instance_num = 1;
+    Storage storage;
+    if (!storage.Open(storage_options, kPath).ok()) {
+      fmt::print(stderr, "the storage failed to open\n");
+      return 1;
+    }
+    std::vector<std::string> deleted;
+    for (int i = 0; i < kHashes; i++) {
+      std::vector<FieldValue> fvs;
+      for (int j = 0; j < kFields; j++) {
+        fvs.push_back({fmt::format("field_{}", j), fmt::format("value_{}", j)});
+      }
+      std::string key = fmt::format("hash_{:08d}", i);
+      storage.HMSet(key, fvs);
+      if (i % 2 == 1) {
+        deleted.push_back(key);
+      }
+    }
+    storage.Del(deleted);
+    auto compact_us = TimeUs([&]() { storage.Compact(DataType::kHashes, true); });
+    int64_t entries = static_cast<int64_t>(kHashes) * (kFields + 1);
+    fmt::print("compaction of {} hash entries, half of them deleted: {}us, {} entries/s\n", entries, compact_us,
+               compact_us > 0 ? entries * 1000000 / compact_us : 0);
+    storage.Close();
+  }
+  DeleteFiles(kPath.c_str());
+  return 0;
+}
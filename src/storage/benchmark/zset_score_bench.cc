@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "benchmark/bench_util.h"
+#include "src/coding.h"
+#include "src/custom_comparator.h"
+#include "src/data_key_prefix_transform.h"
+#include "src/zsets_data_key_format.h"
+#include "storage/storage.h"
+#include "storage/util.h"
+
+using namespace storage;  // NOLINT
+using storage::bench::RunKeyOrder;
+using storage::bench::TimeUs;
+
+namespace {
+
+const std::string kKey = "zset";
+const uint64_t kVersion = 1;
+
+// a score key, with the score in the legacy little-endian bits when legacy
+std::string ScoreKey(double score, const std::string& member, bool legacy) {
+  std::string key = ZSetsScoreKey(kKey, kVersion, score, member).Encode().ToString();
+  if (legacy) {
+    uint64_t bits;
+    memcpy(&bits, &score, sizeof(bits));
+    EncodeFixed64(key.data() + DataKeyPrefixTransform().Transform(key).size(), bits);
+  }
+  return key;
+}
+
+}  // namespace
+
+// The score keys of ZADD and the seeks and scans of ZRANGEBYSCORE, in a CF
+// sorted by the legacy comparator, which decoded the user key, version and
+// double on every compare, against the bytewise CF that replaced it. Then
+// the commands on the storage, which also write the member and meta keys.
+int main() {
+  const int kMembers = 200000;
+  const int kRanges = 20000;
+  const int kRangeLen = 10;
+  const double kMaxScore = 1e6;
+
+  std::mt19937_64 rng(42);
+  std::uniform_real_distribution<double> score_dist(-kMaxScore, kMaxScore);
+  std::vector<double> scores;
+  std::vector<double> seek_scores;
+  for (int i = 0; i < kMembers; i++) {
+    scores.push_back(score_dist(rng));
+  }
+  for (int i = 0; i < kRanges; i++) {
+    seek_scores.push_back(score_dist(rng));
+  }
+
+  std::vector<std::string> keys[2];
+  std::vector<std::string> seeks[2];
+  for (int legacy = 0; legacy < 2; legacy++) {
+    for (int i = 0; i < kMembers; i++) {
+      keys[legacy].push_back(ScoreKey(scores[i], fmt::format("member_{}", i), legacy != 0));
+    }
+    for (double score : seek_scores) {
+      seeks[legacy].push_back(ScoreKey(score, "", legacy != 0));
+    }
+  }
+  ZSetsScoreKeyComparatorImpl legacy_comparator;
+  auto legacy = RunKeyOrder("./bench_db/legacy_score", &legacy_comparator, keys[1], seeks[1], kRangeLen);
+  auto bytewise =
+      RunKeyOrder("./bench_db/bytewise_score", rocksdb::BytewiseComparator(), keys[0], seeks[0], kRangeLen);
+  if (legacy.ranged != bytewise.ranged || bytewise.ranged == 0) {
+    fmt::print(stderr, "the ranged score keys differ\n");
+    return 1;
+  }
+  fmt::print("{} score key puts: {}us (legacy comparator {}us)\n", kMembers, bytewise.put_us, legacy.put_us);
+  fmt::print("{} seeks and scans of {} score keys: {}us (legacy comparator {}us)\n", kRanges, kRangeLen,
+             bytewise.range_us, legacy.range_us);
+
+  const std::string kPath = "./bench_db/zset_commands";
+  std::filesystem::remove_all(kPath);
+  {
+    StorageOptions options;
+    options.options.create_if_missing = true;
+    options.db_instance_num = 1;
+    Storage db;
+    if (!db.Open(options, kPath).ok()) {
+      fmt::print(stderr, "the storage failed to open\n");
+      return 1;
+    }
+    int32_t added = 0;
+    auto zadd_us = TimeUs([&]() {
+      for (int i = 0; i < kMembers; i++) {
+        db.ZAdd(kKey, {{scores[i], fmt::format("member_{}", i)}}, &added);
+      }
+    });
+    std::vector<ScoreMember> score_members;
+    auto zrangebyscore_us = TimeUs([&]() {
+      for (double score : seek_scores) {
+        db.ZRangebyscore(kKey, score, kMaxScore, true, true, kRangeLen, 0, &score_members);
+      }
+    });
+    fmt::print("{} ZADDs: {}us, {} ZRANGEBYSCOREs with a LIMIT of {}: {}us\n", kMembers, zadd_us, kRanges, kRangeLen,
+               zrangebyscore_us);
+    db.Close();
+  }
+  DeleteFiles(kPath.c_str());
+  return 0;
+}
@@ -0,0 +1,110 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef INCLUDE_STORAGE_BINLOG_H_
+#define INCLUDE_STORAGE_BINLOG_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rocksdb/slice.h"
+
+namespace storage {
+
+using Slice = rocksdb::Slice;
+
+/*
+ * Writes a binlog in the protobuf wire format of pikiwidb::Binlog, see
+ * binlog.proto, so a binlog parses with the generated class too. Each key
+ * and value is copied once, into a buffer the raft log takes without another
+ * copy, instead of into the strings of a BinlogEntry that are serialized
+ * again before the append.
+ */
+class BinlogWriter {
+ public:
+  BinlogWriter(uint32_t db_id, uint32_t slot_idx, uint32_t key_format);
+  BinlogWriter(BinlogWriter&& other) noexcept;
+  BinlogWriter& operator=(BinlogWriter&& other) noexcept;
+  BinlogWriter(const BinlogWriter&) = delete;
+  BinlogWriter& operator=(const BinlogWriter&) = delete;
+  ~BinlogWriter();
+
+  // op_type is a pikiwidb::OperateType, value is nullptr for the ops without one
+  void AddEntry(uint32_t cf_idx, uint32_t op_type, const Slice& key, const Slice* value);
+
+  const char* Data() const { return data_; }
+  size_t Size() const { return size_; }
+  uint32_t DbId() const { return db_id_; }
+  uint32_t SlotIdx() const { return slot_idx_; }
+  uint32_t KeyFormat() const { return key_format_; }
+
+  // Hands the buffer over to the caller, who frees it with std::free. The
+  // writer is empty afterwards.
+  char* Release();
+
+  // The bytes before a member of the group of a binlog, size bytes of
+  // binlogs of the same db, slot and key format one after another, which
+  // parse as one binlog with the entries of all of them.
+  static std::string GroupHeader(size_t size);
+  // The bytes before the compressed_size bytes of a compressed binlog, which
+  // was raw_size bytes, compression is a pikiwidb::Compression.
+  static std::string CompressedHeader(uint32_t compression, size_t raw_size, size_t compressed_size);
+
+ private:
+  void Reserve(size_t n);
+  void PutVarint(uint64_t v);
+  void PutTag(uint32_t field, uint32_t wire_type) { PutVarint((field << 3) | wire_type); }
+
+  char* data_ = nullptr;
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+  uint32_t db_id_ = 0;
+  uint32_t slot_idx_ = 0;
+  uint32_t key_format_ = 0;
+};
+
+struct BinlogEntryView {
+  uint32_t cf_idx = 0;
+  uint32_t op_type = 0;
+  Slice key;
+  Slice value;
+  bool has_value = false;
+};
+
+// A binlog parsed in place, the keys and values of its entries and its group
+// refer to the parsed bytes, which must outlive the view.
+class BinlogView {
+ public:
+  // false if data is not a binlog in the protobuf wire format. Unknown fields
+  // are skipped, the fields set twice keep the last value like protobuf.
+  bool Parse(const Slice& data);
+
+  uint32_t DbId() const { return db_id_; }
+  uint32_t SlotIdx() const { return slot_idx_; }
+  uint32_t KeyFormat() const { return key_format_; }
+  const std::vector<BinlogEntryView>& Entries() const { return entries_; }
+  // the serialized binlogs of a group commit
+  const std::vector<Slice>& Group() const { return group_; }
+  // a compressed binlog has none of the fields above, only these
+  uint32_t Compression() const { return compression_; }
+  uint32_t RawSize() const { return raw_size_; }
+  const Slice& Compressed() const { return compressed_; }
+
+ private:
+  uint32_t db_id_ = 0;
+  uint32_t slot_idx_ = 0;
+  uint32_t key_format_ = 0;
+  uint32_t compression_ = 0;
+  uint32_t raw_size_ = 0;
+  Slice compressed_;
+  std::vector<BinlogEntryView> entries_;
+  std::vector<Slice> group_;
+};
+
+}  // namespace storage
+
+#endif  //  INCLUDE_STORAGE_BINLOG_H_
@@ -14,6 +14,7 @@
 #include <map>
 #include <queue>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -27,12 +28,9 @@
 
 #include "pstd/env.h"
 #include "pstd/pstd_mutex.h"
+#include "storage/binlog.h"
 #include "storage/slot_indexer.h"
 
-namespace pikiwidb {
-class Binlog;
-}
-
 namespace storage {
 
 inline constexpr double ZSET_SCORE_MAX = std::numeric_limits<double>::max();
@@ -44,6 +42,7 @@ inline const std::string PROPERTY_TYPE_ROCKSDB_BACKGROUND_ERRORS = "rocksdb.back
 
 inline constexpr size_t BATCH_DELETE_LIMIT = 100;
 inline constexpr size_t COMPACT_THRESHOLD_COUNT = 2000;
+inline constexpr size_t DENSITY_COMPACTION_INTERVAL = 60;  // seconds
 
 inline constexpr uint64_t kNoFlush = std::numeric_limits<uint64_t>::max();
 inline constexpr uint64_t kFlush = 0;
@@ -61,8 +60,11 @@ enum class OptionType;
 template <typename T1, typename T2>
 class LRUCache;
 
-using AppendLogFunction = std::function<void(const pikiwidb::Binlog&, std::promise<Status>&&)>;
-using DoSnapshotFunction = std::function<void(LogIndex, bool)>;
+using AppendLogFunction = std::function<void(BinlogWriter&&, std::promise<Status>&&)>;
+// the index of the instance is the raft group of its logs when there is a
+// group per instance, see raft-group-per-instance
+using DoSnapshotFunction = std::function<void(int32_t, LogIndex, bool)>;
+using IsLeaderFunction = std::function<bool(int32_t)>;
 
 struct StorageOptions {
   mutable rocksdb::Options options;
@@ -76,9 +78,26 @@ struct StorageOptions {
   int db_id = 0;
   AppendLogFunction append_log_function = nullptr;
   DoSnapshotFunction do_snapshot_function = nullptr;
+  // in raft mode only the leader reaps expired keys, followers apply its deletes
+  IsLeaderFunction is_leader_function = nullptr;
+  // upper bound of keys deleted by the expire reaper per second, 0 disables it
+  size_t expire_reap_keys_per_second = 1000;
+  // SST files and key ranges with at least this percent of deletes and expired
+  // entries are compacted in the background, 0 disables it
+  size_t density_compaction_percent = 50;
+  // upper bound of the ranges compacted by one density compaction round
+  size_t density_compaction_max_ranges = 8;
 
   uint32_t raft_timeout_s = std::numeric_limits<uint32_t>::max();
+  // A restart replays the raft logs from the oldest one whose data is still in
+  // a memtable. The column families holding it are flushed once there are
+  // max_gap such logs, or max_gap_bytes bytes of their keys and values, 0 is
+  // no limit of bytes.
   int64_t max_gap = 1000;
+  uint64_t max_gap_bytes = 0;
+  // the writes start such flushes at most once in this many milliseconds, 0
+  // leaves them to the flushes RocksDB does on its own
+  uint32_t gap_flush_interval_ms = 1000;
   uint64_t mem_manager_size = 100000000;
   Status ResetOptions(const OptionType& option_type, const std::unordered_map<std::string, std::string>& options_map);
 };
@@ -110,6 +129,19 @@ struct KeyInfo {
   }
 };
 
+struct SpaceUsage {
+  int inst_index = 0;
+  uint64_t sst_files_size = 0;
+  uint64_t live_data_size = 0;
+  // entries of all SST files, and the deletes and expired entries among them
+  uint64_t entries = 0;
+  uint64_t dead_entries = 0;
+
+  double SpaceAmplification() const {
+    return live_data_size == 0 ? 0 : static_cast<double>(sst_files_size) / static_cast<double>(live_data_size);
+  }
+};
+
 struct ValueStatus {
   std::string value;
   Status status;
@@ -166,7 +198,8 @@ enum Operation {
   kCleanZSets,
   kCleanSets,
   kCleanLists,
-  kCompactRange
+  kCompactRange,
+  kCompactDensestRanges
 };
 
 struct BGTask {
@@ -188,14 +221,26 @@ class Storage {
 
   Status Close();
 
-  std::vector<std::future<Status>> CreateCheckpoint(const std::string& checkpoint_path);
+  // log_size_for_flush is kNoFlush for the checkpoint of a raft snapshot, the
+  // logs up to the snapshot index are in the SST files already. Only the
+  // instance index is checkpointed unless it is -1.
+  std::vector<std::future<Status>> CreateCheckpoint(const std::string& checkpoint_path,
+                                                    uint64_t log_size_for_flush = kFlush, int index = -1);
 
-  Status CreateCheckpointInternal(const std::string& checkpoint_path, int db_index);
+  Status CreateCheckpointInternal(const std::string& checkpoint_path, int db_index, uint64_t log_size_for_flush);
+
+  // The unique ids of the SST files of the RocksDB index by file name, which
+  // stay the same when a file is copied to another node
+  Status GetTableUniqueIds(int index, std::unordered_map<std::string, std::string>* ids);
 
   std::vector<std::future<Status>> LoadCheckpoint(const std::string& checkpoint_path, const std::string& db_path);
 
   Status LoadCheckpointInternal(const std::string& dump_path, const std::string& db_path, int index);
 
+  // Loads the checkpoint of the instance index and opens it again, the other
+  // instances stay open, for the snapshot of the raft group of one instance.
+  Status LoadInstanceCheckpoint(const std::string& checkpoint_path, const std::string& db_path, int index);
+
   Status LoadCursorStartKey(const DataType& dtype, int64_t cursor, char* type, std::string* start_key);
 
   Status StoreCursorStartKey(const DataType& dtype, int64_t cursor, char type, const std::string& next_key);
@@ -204,6 +249,9 @@ class Storage {
 
   std::unique_ptr<Redis>& GetDBInstance(const std::string& key);
 
+  // the index of the instance of the key
+  size_t GetInstanceIndex(const std::string& key);
+
   // Strings Commands
 
   // Set key to hold the string value. if key
@@ -1011,6 +1059,10 @@ class Storage {
   // the pattern
   Status PKPatternMatchDel(const DataType& data_type, const std::string& pattern, int32_t* ret);
 
+  // Removes every key of every data type, the space is reclaimed later by a
+  // background compaction
+  Status FlushDB();
+
   // Iterate over a collection of elements
   // return next_key that the user need to use as the start_key argument
   // in the next call
@@ -1099,11 +1151,14 @@ class Storage {
   Status StartBGThread();
   Status RunBGTask();
   Status AddBGTask(const BGTask& bg_task);
+  Status StartExpireReaper();
+  void RunExpireReaper();
 
   Status Compact(const DataType& type, bool sync = false);
   Status CompactRange(const DataType& type, const std::string& start, const std::string& end, bool sync = false);
   Status DoCompactRange(const DataType& type, const std::string& start, const std::string& end);
   Status DoCompactSpecificKey(const DataType& type, const std::string& key);
+  Status DoCompactDensestRanges();
 
   Status SetMaxCacheStatisticKeys(uint32_t max_cache_statistic_keys);
   Status SetSmallCompactionThreshold(uint32_t small_compaction_threshold);
@@ -1113,6 +1168,7 @@ class Storage {
   Status GetUsage(const std::string& property, uint64_t* result);
   Status GetUsage(const std::string& property, std::map<int, uint64_t>* type_result);
   uint64_t GetProperty(const std::string& property);
+  Status GetSpaceUsage(std::vector<SpaceUsage>* usages);
 
   Status GetKeyNum(std::vector<KeyInfo>* key_infos);
   Status StopScanKeyNum();
@@ -1121,7 +1177,13 @@ class Storage {
 
   Status SetOptions(const OptionType& option_type, const std::unordered_map<std::string, std::string>& options);
   void GetRocksDBInfo(std::string& info);
-  Status OnBinlogWrite(const pikiwidb::Binlog& log, LogIndex log_idx);
+  Status OnBinlogWrite(const BinlogView& log, LogIndex log_idx);
+  // Applies the binlogs of one instance of several raft logs, in the order
+  // of their log indexes, with one write batch. The binlogs of different
+  // instances may be applied concurrently. (*statuses)[i] is the status of
+  // logs[i], a binlog that fails is left out of the batch.
+  void OnBinlogWrite(const std::vector<std::pair<const BinlogView*, LogIndex>>& logs,
+                     std::vector<Status>* statuses);
 
  private:
   std::vector<std::unique_ptr<Redis>> insts_;
@@ -1139,10 +1201,22 @@ class Storage {
   std::atomic<int> current_task_type_ = kNone;
   std::atomic<bool> bg_tasks_should_exit_ = false;
 
+  // Storage start the expire reaper thread to delete due keys of the expire index
+  pthread_t expire_reaper_thread_id_ = 0;
+  pstd::Mutex expire_reaper_mutex_;
+  pstd::CondVar expire_reaper_cond_var_;
+  std::atomic<bool> expire_reaper_should_exit_ = false;
+  size_t expire_reap_keys_per_second_ = 0;
+  double density_compaction_ratio_ = 0;
+  size_t density_compaction_max_ranges_ = 0;
+  IsLeaderFunction is_leader_function_ = nullptr;
+
   // For scan keys in data base
   std::atomic<bool> scan_keynum_exit_ = false;
   size_t db_instance_num_ = 3;
   int db_id_ = 0;
+  // to open an instance again after its checkpoint is loaded
+  StorageOptions storage_options_;
 };
 
 }  //  namespace storage
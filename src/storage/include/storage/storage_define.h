@@ -7,7 +7,9 @@
 #define STORAGE_DEFINE_H_
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <string>
 #include "stdint.h"
 
 #include "rocksdb/slice.h"
@@ -42,7 +44,18 @@ enum ColumnFamilyIndex {
   kZsetsMetaCF = 7,
   kZsetsDataCF = 8,
   kZsetsScoreCF = 9,
-  kColumnFamilyNum = 10,
+  kExpireIndexCF = 10,
+  kStringsDataCF = 11,
+  kColumnFamilyNum = 12,
+};
+
+// Version of the key encodings in the binlogs, the keys of the binlogs of an
+// older version are converted when they are applied
+enum BinlogKeyFormat : uint32_t {
+  kLegacyKeyFormat = 0,             // zset scores and list indexes are little-endian
+  kBytewiseScoreKeyFormat = 1,      // zset scores are order preserving, see EncodeScore
+  kBytewiseListIndexKeyFormat = 2,  // list indexes are big-endian
+  kCurrentKeyFormat = kBytewiseListIndexKeyFormat,
 };
 
 const static char kNeedTransformCharacter = '\u0000';
@@ -50,6 +63,29 @@ const static char* kEncodedTransformCharacter = "\u0000\u0001";
 const static char* kEncodedKeyDelim = "\u0000\u0000";
 const static int kEncodedKeyDelimSize = 2;
 
+/*
+ * The scans of the encoded user keys below jump from one \u0000 to the next
+ * with memchr, which libc vectorizes and dispatches on the CPU features at
+ * runtime, and copy the bytes between them at once. Keys without \u0000, the
+ * common case, are one memchr and one memcpy.
+ */
+
+// number of \u0000 in user_key, the nzero of EncodeUserKey
+inline size_t CountNeedTransformCharacters(const Slice& user_key) {
+  size_t nzero = 0;
+  const char* ptr = user_key.data();
+  const char* end = ptr + user_key.size();
+  while (ptr != end) {
+    auto zero = static_cast<const char*>(memchr(ptr, kNeedTransformCharacter, end - ptr));
+    if (zero == nullptr) {
+      break;
+    }
+    nzero++;
+    ptr = zero + 1;
+  }
+  return nzero;
+}
+
 inline char* EncodeUserKey(const Slice& user_key, char* dst_ptr, size_t nzero) {
   // no \u0000 exists in user_key, memcopy user_key directly.
   if (nzero == 0) {
@@ -60,71 +96,75 @@ inline char* EncodeUserKey(const Slice& user_key, char* dst_ptr, size_t nzero) {
     return dst_ptr;
   }
 
-  // \u0000 exists in user_key, iterate and replace.
-  size_t pos = 0;
-  const char* user_data = user_key.data();
-  for (size_t i = 0; i < user_key.size(); i++) {
-    if (user_data[i] == kNeedTransformCharacter) {
-      size_t sub_len = i - pos;
-      if (sub_len != 0) {
-        memcpy(dst_ptr, user_data + pos, sub_len);
-        dst_ptr += sub_len;
-      }
-      memcpy(dst_ptr, kEncodedTransformCharacter, 2);
-      dst_ptr += 2;
-      pos = i + 1;
+  // \u0000 exists in user_key, copy the runs between them and escape them.
+  const char* ptr = user_key.data();
+  const char* end = ptr + user_key.size();
+  for (size_t i = 0; i < nzero; i++) {
+    auto zero = static_cast<const char*>(memchr(ptr, kNeedTransformCharacter, end - ptr));
+    if (zero == nullptr) {
+      break;
     }
+    memcpy(dst_ptr, ptr, zero - ptr);
+    dst_ptr += zero - ptr;
+    memcpy(dst_ptr, kEncodedTransformCharacter, 2);
+    dst_ptr += 2;
+    ptr = zero + 1;
   }
-  if (pos != user_key.size()) {
-    memcpy(dst_ptr, user_data + pos, user_key.size() - pos);
-  }
+  memcpy(dst_ptr, ptr, end - ptr);
+  dst_ptr += end - ptr;
 
   memcpy(dst_ptr, kEncodedKeyDelim, 2);
   dst_ptr += 2;
   return dst_ptr;
 }
 
+// Unescapes the encoded user key at ptr into user_key and returns the end of
+// its delimiter, or ptr if there is no delimiter in length bytes
 inline const char* DecodeUserKey(const char* ptr, int length, std::string* user_key) {
-  const char* ret_ptr = ptr;
-  user_key->resize(length - kEncodedKeyDelimSize);
-  bool zero_ahead = false;
-  bool delim_found = false;
-  int output_idx = 0;
-
-  for (int idx = 0; idx < length; idx++) {
-    switch (ptr[idx]) {
-      case '\u0000': {
-        delim_found = zero_ahead ? true : false;
-        zero_ahead = true;
-        break;
-      }
-      case '\u0001': {
-        (*user_key)[output_idx++] = zero_ahead ? '\u0000' : ptr[idx];
-        zero_ahead = false;
-        break;
-      }
-      default: {
-        (*user_key)[output_idx++] = ptr[idx];
-        zero_ahead = false;
-        break;
-      }
-    }
-    if (delim_found) {
-      user_key->resize(output_idx);
-      ret_ptr = ptr + idx + 1;
+  user_key->clear();
+  if (length < kEncodedKeyDelimSize) {
+    return ptr;
+  }
+  user_key->reserve(length - kEncodedKeyDelimSize);
+  const char* cur = ptr;
+  const char* end = ptr + length;
+  while (cur != end) {
+    auto zero = static_cast<const char*>(memchr(cur, kNeedTransformCharacter, end - cur));
+    if (zero == nullptr || zero + 1 == end) {
       break;
     }
+    user_key->append(cur, zero - cur);
+    if (zero[1] == kNeedTransformCharacter) {
+      return zero + 2;
+    }
+    if (zero[1] == '\u0001') {
+      user_key->push_back(kNeedTransformCharacter);
+      cur = zero + 2;
+    } else {
+      // not a valid escape, the \u0000 is dropped
+      cur = zero + 1;
+    }
   }
-  return ret_ptr;
+  return ptr;
 }
 
+// Returns the end of the delimiter of the encoded user key at ptr, or ptr if
+// there is no delimiter in length bytes
 inline const char* SeekUserkeyDelim(const char* ptr, int length) {
-  bool zero_ahead = false;
-  for (int i = 0; i < length; i++) {
-    if ((ptr[i] == kNeedTransformCharacter) && zero_ahead) {
-      return ptr + i + 1;
+  if (length <= 0) {
+    return ptr;
+  }
+  const char* cur = ptr;
+  const char* end = ptr + length;
+  while (cur != end) {
+    auto zero = static_cast<const char*>(memchr(cur, kNeedTransformCharacter, end - cur));
+    if (zero == nullptr || zero + 1 == end) {
+      break;
+    }
+    if (zero[1] == kNeedTransformCharacter) {
+      return zero + 2;
     }
-    zero_ahead = ptr[i] == kNeedTransformCharacter;
+    cur = zero + 1;
   }
   // TODO: handle invalid format
   return ptr;
@@ -31,7 +31,7 @@ class BaseDataKey {
   Slice EncodeSeekKey() {
     size_t meta_size = sizeof(reserve1_) + sizeof(version_);
     size_t usize = key_.size() + data_.size() + kEncodedKeyDelimSize;
-    size_t nzero = std::count(key_.data(), key_.data() + key_.size(), kNeedTransformCharacter);
+    size_t nzero = CountNeedTransformCharacters(key_);
     usize += nzero;
     size_t needed = meta_size + usize;
     char* dst;
@@ -64,7 +64,7 @@ class BaseDataKey {
   Slice Encode() {
     size_t meta_size = sizeof(reserve1_) + sizeof(version_) + sizeof(reserve2_);
     size_t usize = key_.size() + data_.size() + kEncodedKeyDelimSize;
-    size_t nzero = std::count(key_.data(), key_.data() + key_.size(), kNeedTransformCharacter);
+    size_t nzero = CountNeedTransformCharacters(key_);
     usize += nzero;
     size_t needed = meta_size + usize;
     char* dst;
@@ -18,14 +18,71 @@
 
 namespace storage {
 
+/*
+ * Looks up the meta values of the user keys met by a data CF compaction
+ * filter. The data keys of a compaction arrive in key order, so instead of a
+ * Get per user key one iterator over the meta CF is moved forward with Next,
+ * it only falls back to Seek when the target is behind the iterator or too
+ * far ahead of it. The iterator pins the memtables and SST files it was
+ * created on, so it is re-created every kLookupsBeforeRefresh lookups rather
+ * than kept for the whole compaction.
+ */
+class MetaValueLookup {
+ public:
+  // number of Next tried before the iterator is repositioned with Seek
+  static constexpr int kMaxNextBeforeSeek = 8;
+  // number of lookups served by one iterator, its first one is a Seek
+  static constexpr int kLookupsBeforeRefresh = 10000;
+
+  // Returns OK and fills meta_value if meta_key exists, NotFound if it
+  // doesn't, or the error of the underlying iterator.
+  Status Lookup(rocksdb::DB* db, rocksdb::ColumnFamilyHandle* handle, const Slice& meta_key,
+                std::string* meta_value) {
+    if (iter_ != nullptr && lookups_ >= kLookupsBeforeRefresh) {
+      iter_.reset();
+    }
+    if (iter_ == nullptr) {
+      rocksdb::ReadOptions read_options;
+      // compaction lookups should not evict the blocks of foreground reads
+      read_options.fill_cache = false;
+      iter_.reset(db->NewIterator(read_options, handle));
+      lookups_ = 0;
+    }
+    lookups_++;
+
+    bool positioned = false;
+    if (iter_->Valid() && iter_->key().compare(meta_key) <= 0) {
+      for (int i = 0; i < kMaxNextBeforeSeek && iter_->Valid() && iter_->key().compare(meta_key) < 0; i++) {
+        iter_->Next();
+      }
+      positioned = !iter_->Valid() || iter_->key().compare(meta_key) >= 0;
+    }
+    if (!positioned || !iter_->status().ok()) {
+      iter_->Seek(meta_key);
+    }
+
+    if (!iter_->status().ok()) {
+      return iter_->status();
+    }
+    if (!iter_->Valid() || iter_->key() != meta_key) {
+      return Status::NotFound();
+    }
+    meta_value->assign(iter_->value().data(), iter_->value().size());
+    return Status::OK();
+  }
+
+ private:
+  std::unique_ptr<rocksdb::Iterator> iter_;
+  int lookups_ = 0;
+};
+
 class BaseMetaFilter : public rocksdb::CompactionFilter {
  public:
-  BaseMetaFilter() = default;
+  // the current time is taken once per compaction, not once per entry
+  BaseMetaFilter() { rocksdb::Env::Default()->GetCurrentTime(&unix_time_); }
   bool Filter(int level, const rocksdb::Slice& key, const rocksdb::Slice& value, std::string* new_value,
               bool* value_changed) const override {
-    int64_t unix_time;
-    rocksdb::Env::Default()->GetCurrentTime(&unix_time);
-    auto cur_time = static_cast<int32_t>(unix_time);
+    auto cur_time = static_cast<int32_t>(unix_time_);
     ParsedBaseMetaValue parsed_base_meta_value(value);
     TRACE("==========================START==========================");
     TRACE("[MetaFilter], key: %s, count = %d, timestamp: %llu, cur_time: %d, version: %llu", key.ToString().c_str(),
@@ -45,6 +102,9 @@ class BaseMetaFilter : public rocksdb::CompactionFilter {
   }
 
   const char* Name() const override { return "BaseMetaFilter"; }
+
+ private:
+  int64_t unix_time_ = 0;
 };
 
 class BaseMetaFilterFactory : public rocksdb::CompactionFilterFactory {
@@ -60,7 +120,9 @@ class BaseMetaFilterFactory : public rocksdb::CompactionFilterFactory {
 class BaseDataFilter : public rocksdb::CompactionFilter {
  public:
   BaseDataFilter(rocksdb::DB* db, std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr, int meta_cf_index)
-      : db_(db), cf_handles_ptr_(cf_handles_ptr), meta_cf_index_(meta_cf_index) {}
+      : db_(db), cf_handles_ptr_(cf_handles_ptr), meta_cf_index_(meta_cf_index) {
+    rocksdb::Env::Default()->GetCurrentTime(&unix_time_);
+  }
 
   bool Filter(int level, const Slice& key, const rocksdb::Slice& value, std::string* new_value,
               bool* value_changed) const override {
@@ -86,7 +148,7 @@ class BaseDataFilter : public rocksdb::CompactionFilter {
       if (cf_handles_ptr_->empty()) {
         return false;
       }
-      Status s = db_->Get(default_read_options_, (*cf_handles_ptr_)[meta_cf_index_], cur_key_, &meta_value);
+      Status s = meta_lookup_.Lookup(db_, (*cf_handles_ptr_)[meta_cf_index_], cur_key_, &meta_value);
       if (s.ok()) {
         meta_not_found_ = false;
         ParsedBaseMetaValue parsed_base_meta_value(&meta_value);
@@ -106,9 +168,7 @@ class BaseDataFilter : public rocksdb::CompactionFilter {
       return true;
     }
 
-    int64_t unix_time;
-    rocksdb::Env::Default()->GetCurrentTime(&unix_time);
-    if (cur_meta_etime_ != 0 && cur_meta_etime_ < static_cast<uint64_t>(unix_time)) {
+    if (cur_meta_etime_ != 0 && cur_meta_etime_ < static_cast<uint64_t>(unix_time_)) {
       TRACE("Drop[Timeout]");
       return true;
     }
@@ -127,7 +187,8 @@ class BaseDataFilter : public rocksdb::CompactionFilter {
  private:
   rocksdb::DB* db_ = nullptr;
   std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr_ = nullptr;
-  rocksdb::ReadOptions default_read_options_;
+  mutable MetaValueLookup meta_lookup_;
+  int64_t unix_time_ = 0;
   mutable std::string cur_key_;
   mutable bool meta_not_found_ = false;
   mutable uint64_t cur_meta_version_ = 0;
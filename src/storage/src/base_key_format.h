@@ -30,7 +30,7 @@ class BaseKey {
 
   Slice Encode() {
     size_t meta_size = sizeof(reserve1_) + sizeof(reserve2_);
-    size_t nzero = std::count(key_.data(), key_.data() + key_.size(), kNeedTransformCharacter);
+    size_t nzero = CountNeedTransformCharacters(key_);
     size_t usize = nzero + kEncodedKeyDelimSize + key_.size();
     size_t needed = meta_size + usize;
     char* dst;
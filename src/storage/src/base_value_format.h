@@ -29,6 +29,7 @@ class InternalValue {
     }
   }
   void SetEtime(uint64_t etime = 0) { etime_ = etime; }
+  uint64_t Etime() const { return etime_; }
   void setCtime(uint64_t ctime) { ctime_ = ctime; }
   Status SetRelativeTimestamp(uint64_t ttl) {
     int64_t unix_time;
@@ -134,7 +135,7 @@ class ParsedInternalValue {
   uint64_t version_ = 0;
   uint64_t ctime_ = 0;
   uint64_t etime_ = 0;
-  char reserve_[16] = {0};  // unused
+  char reserve_[16] = {0};
 };
 
 }  //  namespace storage
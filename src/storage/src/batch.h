@@ -16,6 +16,7 @@
 
 #include "binlog.pb.h"
 #include "src/redis.h"
+#include "storage/binlog.h"
 #include "storage/storage.h"
 #include "storage/storage_define.h"
 
@@ -27,6 +28,9 @@ class Batch {
 
   virtual void Put(ColumnFamilyIndex cf_idx, const Slice& key, const Slice& val) = 0;
   virtual void Delete(ColumnFamilyIndex cf_idx, const Slice& key) = 0;
+  virtual void Merge(ColumnFamilyIndex cf_idx, const Slice& key, const Slice& operand) = 0;
+  // Deletes the keys in [begin_key, end_key) with a single range tombstone
+  virtual void DeleteRange(ColumnFamilyIndex cf_idx, const Slice& begin_key, const Slice& end_key) = 0;
   virtual Status Commit() = 0;
   int32_t Count() const { return cnt_; }
 
@@ -50,6 +54,14 @@ class RocksBatch : public Batch {
     batch_.Delete(handles_[cf_idx], key);
     cnt_++;
   }
+  void Merge(ColumnFamilyIndex cf_idx, const Slice& key, const Slice& operand) override {
+    batch_.Merge(handles_[cf_idx], key, operand);
+    cnt_++;
+  }
+  void DeleteRange(ColumnFamilyIndex cf_idx, const Slice& begin_key, const Slice& end_key) override {
+    batch_.DeleteRange(handles_[cf_idx], begin_key, end_key);
+    cnt_++;
+  }
   Status Commit() override { return db_->Write(options_, &batch_); }
 
  private:
@@ -62,25 +74,25 @@ class RocksBatch : public Batch {
 class BinlogBatch : public Batch {
  public:
   BinlogBatch(AppendLogFunction func, int32_t index, uint32_t seconds = 10)
-      : func_(std::move(func)), seconds_(seconds) {
-    binlog_.set_db_id(0);
-    binlog_.set_slot_idx(index);
-  }
+      : func_(std::move(func)), binlog_(0, index, kCurrentKeyFormat), seconds_(seconds) {}
 
   void Put(ColumnFamilyIndex cf_idx, const Slice& key, const Slice& value) override {
-    auto entry = binlog_.add_entries();
-    entry->set_cf_idx(cf_idx);
-    entry->set_op_type(pikiwidb::OperateType::kPut);
-    entry->set_key(key.ToString());
-    entry->set_value(value.ToString());
+    binlog_.AddEntry(cf_idx, pikiwidb::OperateType::kPut, key, &value);
     cnt_++;
   }
 
   void Delete(ColumnFamilyIndex cf_idx, const Slice& key) override {
-    auto entry = binlog_.add_entries();
-    entry->set_cf_idx(cf_idx);
-    entry->set_op_type(pikiwidb::OperateType::kDelete);
-    entry->set_key(key.ToString());
+    binlog_.AddEntry(cf_idx, pikiwidb::OperateType::kDelete, key, nullptr);
+    cnt_++;
+  }
+
+  void Merge(ColumnFamilyIndex cf_idx, const Slice& key, const Slice& operand) override {
+    binlog_.AddEntry(cf_idx, pikiwidb::OperateType::kMerge, key, &operand);
+    cnt_++;
+  }
+
+  void DeleteRange(ColumnFamilyIndex cf_idx, const Slice& begin_key, const Slice& end_key) override {
+    binlog_.AddEntry(cf_idx, pikiwidb::OperateType::kDeleteRange, begin_key, &end_key);
     cnt_++;
   }
 
@@ -88,7 +100,8 @@ class BinlogBatch : public Batch {
     // FIXME(longfar): We should make sure that in non-RAFT mode, the code doesn't run here
     std::promise<Status> promise;
     auto future = promise.get_future();
-    func_(binlog_, std::move(promise));
+    // the raft log takes the buffer of the binlog
+    func_(std::move(binlog_), std::move(promise));
     auto status = future.wait_for(std::chrono::seconds(seconds_));
     if (status == std::future_status::timeout) {
       return Status::Incomplete("Wait for write timeout");
@@ -98,7 +111,7 @@ class BinlogBatch : public Batch {
 
  private:
   AppendLogFunction func_;
-  pikiwidb::Binlog binlog_;
+  BinlogWriter binlog_;
   uint32_t seconds_ = 10;
 };
 
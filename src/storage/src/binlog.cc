@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "storage/binlog.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include "pstd/pstd_coding.h"
+
+namespace storage {
+
+namespace {
+
+// the protobuf wire types
+const uint32_t kWireVarint = 0;
+const uint32_t kWireFixed64 = 1;
+const uint32_t kWireLengthDelimited = 2;
+const uint32_t kWireFixed32 = 5;
+
+// the field numbers of Binlog and BinlogEntry in binlog.proto
+const uint32_t kBinlogDbId = 1;
+const uint32_t kBinlogSlotIdx = 2;
+const uint32_t kBinlogEntries = 3;
+const uint32_t kBinlogKeyFormat = 4;
+const uint32_t kBinlogGroup = 5;
+const uint32_t kBinlogCompression = 6;
+const uint32_t kBinlogRawSize = 7;
+const uint32_t kBinlogCompressed = 8;
+const uint32_t kEntryCfIdx = 1;
+const uint32_t kEntryOpType = 2;
+const uint32_t kEntryKey = 3;
+const uint32_t kEntryValue = 4;
+
+const size_t kMaxVarintLength = 10;
+
+// Reads the next field of [*p, limit), *value is the varint of a varint
+// field and data the bytes of a length-delimited one. nullptr if the bytes
+// are not a field.
+const char* GetField(const char* p, const char* limit, uint32_t* field, uint32_t* wire_type, uint64_t* value,
+                     Slice* data) {
+  uint64_t tag = 0;
+  p = pstd::GetVarint64Ptr(p, limit, &tag);
+  if (!p || (tag >> 3) == 0) {
+    return nullptr;
+  }
+  *field = static_cast<uint32_t>(tag >> 3);
+  *wire_type = static_cast<uint32_t>(tag & 0x7);
+  switch (*wire_type) {
+    case kWireVarint:
+      return pstd::GetVarint64Ptr(p, limit, value);
+    case kWireFixed64:
+      return limit - p < 8 ? nullptr : p + 8;
+    case kWireFixed32:
+      return limit - p < 4 ? nullptr : p + 4;
+    case kWireLengthDelimited:
+      p = pstd::GetVarint64Ptr(p, limit, value);
+      if (!p || *value > static_cast<uint64_t>(limit - p)) {
+        return nullptr;
+      }
+      *data = Slice(p, *value);
+      return p + *value;
+    default:
+      return nullptr;
+  }
+}
+
+bool ParseEntry(const Slice& bytes, BinlogEntryView* entry) {
+  const char* p = bytes.data();
+  const char* limit = p + bytes.size();
+  while (p < limit) {
+    uint32_t field = 0;
+    uint32_t wire_type = 0;
+    uint64_t value = 0;
+    Slice data;
+    p = GetField(p, limit, &field, &wire_type, &value, &data);
+    if (!p) {
+      return false;
+    }
+    if (field == kEntryCfIdx && wire_type == kWireVarint) {
+      entry->cf_idx = static_cast<uint32_t>(value);
+    } else if (field == kEntryOpType && wire_type == kWireVarint) {
+      entry->op_type = static_cast<uint32_t>(value);
+    } else if (field == kEntryKey && wire_type == kWireLengthDelimited) {
+      entry->key = data;
+    } else if (field == kEntryValue && wire_type == kWireLengthDelimited) {
+      entry->value = data;
+      entry->has_value = true;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+BinlogWriter::BinlogWriter(uint32_t db_id, uint32_t slot_idx, uint32_t key_format)
+    : db_id_(db_id), slot_idx_(slot_idx), key_format_(key_format) {
+  PutTag(kBinlogDbId, kWireVarint);
+  PutVarint(db_id);
+  PutTag(kBinlogSlotIdx, kWireVarint);
+  PutVarint(slot_idx);
+  PutTag(kBinlogKeyFormat, kWireVarint);
+  PutVarint(key_format);
+}
+
+BinlogWriter::BinlogWriter(BinlogWriter&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      capacity_(std::exchange(other.capacity_, 0)),
+      db_id_(other.db_id_),
+      slot_idx_(other.slot_idx_),
+      key_format_(other.key_format_) {}
+
+BinlogWriter& BinlogWriter::operator=(BinlogWriter&& other) noexcept {
+  if (this != &other) {
+    std::free(data_);
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    capacity_ = std::exchange(other.capacity_, 0);
+    db_id_ = other.db_id_;
+    slot_idx_ = other.slot_idx_;
+    key_format_ = other.key_format_;
+  }
+  return *this;
+}
+
+BinlogWriter::~BinlogWriter() { std::free(data_); }
+
+void BinlogWriter::AddEntry(uint32_t cf_idx, uint32_t op_type, const Slice& key, const Slice* value) {
+  // one byte for each tag
+  size_t entry_size = 1 + pstd::VarintLength(cf_idx) + 1 + pstd::VarintLength(op_type);
+  entry_size += 1 + pstd::VarintLength(key.size()) + key.size();
+  if (value) {
+    entry_size += 1 + pstd::VarintLength(value->size()) + value->size();
+  }
+  Reserve(1 + kMaxVarintLength + entry_size);
+  PutTag(kBinlogEntries, kWireLengthDelimited);
+  PutVarint(entry_size);
+  PutTag(kEntryCfIdx, kWireVarint);
+  PutVarint(cf_idx);
+  PutTag(kEntryOpType, kWireVarint);
+  PutVarint(op_type);
+  PutTag(kEntryKey, kWireLengthDelimited);
+  PutVarint(key.size());
+  memcpy(data_ + size_, key.data(), key.size());
+  size_ += key.size();
+  if (value) {
+    PutTag(kEntryValue, kWireLengthDelimited);
+    PutVarint(value->size());
+    memcpy(data_ + size_, value->data(), value->size());
+    size_ += value->size();
+  }
+}
+
+char* BinlogWriter::Release() {
+  capacity_ = 0;
+  size_ = 0;
+  return std::exchange(data_, nullptr);
+}
+
+std::string BinlogWriter::GroupHeader(size_t size) {
+  char header[1 + kMaxVarintLength];
+  header[0] = static_cast<char>((kBinlogGroup << 3) | kWireLengthDelimited);
+  return {header, static_cast<size_t>(pstd::EncodeVarint64(header + 1, size) - header)};
+}
+
+std::string BinlogWriter::CompressedHeader(uint32_t compression, size_t raw_size, size_t compressed_size) {
+  char header[3 + 3 * kMaxVarintLength];
+  char* p = header;
+  *p++ = static_cast<char>((kBinlogCompression << 3) | kWireVarint);
+  p = pstd::EncodeVarint64(p, compression);
+  *p++ = static_cast<char>((kBinlogRawSize << 3) | kWireVarint);
+  p = pstd::EncodeVarint64(p, raw_size);
+  *p++ = static_cast<char>((kBinlogCompressed << 3) | kWireLengthDelimited);
+  p = pstd::EncodeVarint64(p, compressed_size);
+  return {header, static_cast<size_t>(p - header)};
+}
+
+void BinlogWriter::Reserve(size_t n) {
+  if (size_ + n <= capacity_) {
+    return;
+  }
+  size_t capacity = std::max({size_ + n, capacity_ * 2, static_cast<size_t>(256)});
+  auto data = static_cast<char*>(std::realloc(data_, capacity));
+  if (!data) {
+    throw std::bad_alloc();
+  }
+  data_ = data;
+  capacity_ = capacity;
+}
+
+void BinlogWriter::PutVarint(uint64_t v) {
+  Reserve(kMaxVarintLength);
+  size_ = pstd::EncodeVarint64(data_ + size_, v) - data_;
+}
+
+bool BinlogView::Parse(const Slice& data) {
+  db_id_ = 0;
+  slot_idx_ = 0;
+  key_format_ = 0;
+  compression_ = 0;
+  raw_size_ = 0;
+  compressed_ = Slice();
+  entries_.clear();
+  group_.clear();
+  const char* p = data.data();
+  const char* limit = p + data.size();
+  while (p < limit) {
+    uint32_t field = 0;
+    uint32_t wire_type = 0;
+    uint64_t value = 0;
+    Slice bytes;
+    p = GetField(p, limit, &field, &wire_type, &value, &bytes);
+    if (!p) {
+      return false;
+    }
+    if (field == kBinlogDbId && wire_type == kWireVarint) {
+      db_id_ = static_cast<uint32_t>(value);
+    } else if (field == kBinlogSlotIdx && wire_type == kWireVarint) {
+      slot_idx_ = static_cast<uint32_t>(value);
+    } else if (field == kBinlogKeyFormat && wire_type == kWireVarint) {
+      key_format_ = static_cast<uint32_t>(value);
+    } else if (field == kBinlogEntries && wire_type == kWireLengthDelimited) {
+      if (!ParseEntry(bytes, &entries_.emplace_back())) {
+        return false;
+      }
+    } else if (field == kBinlogGroup && wire_type == kWireLengthDelimited) {
+      group_.push_back(bytes);
+    } else if (field == kBinlogCompression && wire_type == kWireVarint) {
+      compression_ = static_cast<uint32_t>(value);
+    } else if (field == kBinlogRawSize && wire_type == kWireVarint) {
+      raw_size_ = static_cast<uint32_t>(value);
+    } else if (field == kBinlogCompressed && wire_type == kWireLengthDelimited) {
+      compressed_ = bytes;
+    }
+  }
+  return true;
+}
+
+}  // namespace storage
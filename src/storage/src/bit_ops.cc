@@ -0,0 +1,218 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "src/bit_ops.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#  include <immintrin.h>
+#  define STORAGE_BIT_OPS_AVX2
+#endif
+
+namespace storage {
+
+namespace {
+
+inline uint64_t LoadWord(const unsigned char* ptr) {
+  uint64_t word;
+  memcpy(&word, ptr, sizeof(word));
+  return word;
+}
+
+inline void StoreWord(unsigned char* ptr, uint64_t word) { memcpy(ptr, &word, sizeof(word)); }
+
+int64_t BitCountWords(const unsigned char* value, int64_t bytes) {
+  int64_t count = 0;
+  int64_t i = 0;
+  // four independent words per step keep several popcnt in flight
+  for (; i + 32 <= bytes; i += 32) {
+    count += __builtin_popcountll(LoadWord(value + i)) + __builtin_popcountll(LoadWord(value + i + 8)) +
+             __builtin_popcountll(LoadWord(value + i + 16)) + __builtin_popcountll(LoadWord(value + i + 24));
+  }
+  for (; i + 8 <= bytes; i += 8) {
+    count += __builtin_popcountll(LoadWord(value + i));
+  }
+  for (; i < bytes; i++) {
+    count += __builtin_popcount(value[i]);
+  }
+  return count;
+}
+
+// dst = dst op src over bytes, op is one of AND, OR and XOR
+template <BitOpType op>
+void BitOpWords(unsigned char* dst, const unsigned char* src, int64_t bytes) {
+  int64_t i = 0;
+  for (; i + 8 <= bytes; i += 8) {
+    uint64_t word = LoadWord(dst + i);
+    uint64_t src_word = LoadWord(src + i);
+    StoreWord(dst + i, op == kBitOpAnd ? word & src_word : op == kBitOpOr ? word | src_word : word ^ src_word);
+  }
+  for (; i < bytes; i++) {
+    dst[i] = op == kBitOpAnd ? dst[i] & src[i] : op == kBitOpOr ? dst[i] | src[i] : dst[i] ^ src[i];
+  }
+}
+
+void BitNotWords(unsigned char* dst, int64_t bytes) {
+  int64_t i = 0;
+  for (; i + 8 <= bytes; i += 8) {
+    StoreWord(dst + i, ~LoadWord(dst + i));
+  }
+  for (; i < bytes; i++) {
+    dst[i] = static_cast<unsigned char>(~dst[i]);
+  }
+}
+
+// offset of the first byte that is not skip, bytes if there is none
+int64_t FindByteNotWords(const unsigned char* value, int64_t bytes, unsigned char skip) {
+  const uint64_t skip_word = skip == 0 ? 0 : ~uint64_t{0};
+  int64_t i = 0;
+  while (i + 8 <= bytes && LoadWord(value + i) == skip_word) {
+    i += 8;
+  }
+  while (i < bytes && value[i] == skip) {
+    i++;
+  }
+  return i;
+}
+
+#ifdef STORAGE_BIT_OPS_AVX2
+
+// Counts the bits of each nibble with a shuffle lookup, W. Mula's method,
+// and sums the byte counts into 64-bit lanes every 31 vectors, before a
+// byte count could pass 255.
+__attribute__((target("avx2"))) int64_t BitCountAvx2(const unsigned char* value, int64_t bytes) {
+  const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2,
+                                          2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  __m256i total = _mm256_setzero_si256();
+  int64_t i = 0;
+  while (i + 32 <= bytes) {
+    __m256i byte_counts = _mm256_setzero_si256();
+    for (int n = 0; n < 31 && i + 32 <= bytes; n++, i += 32) {
+      __m256i vec = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(value + i));
+      __m256i low = _mm256_shuffle_epi8(lookup, _mm256_and_si256(vec, low_mask));
+      __m256i high = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(vec, 4), low_mask));
+      byte_counts = _mm256_add_epi8(byte_counts, _mm256_add_epi8(low, high));
+    }
+    total = _mm256_add_epi64(total, _mm256_sad_epu8(byte_counts, _mm256_setzero_si256()));
+  }
+  uint64_t lanes[4];
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), total);
+  return static_cast<int64_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3]) + BitCountWords(value + i, bytes - i);
+}
+
+template <BitOpType op>
+__attribute__((target("avx2"))) void BitOpAvx2(unsigned char* dst, const unsigned char* src, int64_t bytes) {
+  int64_t i = 0;
+  for (; i + 32 <= bytes; i += 32) {
+    __m256i vec = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+    __m256i src_vec = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    vec = op == kBitOpAnd  ? _mm256_and_si256(vec, src_vec)
+          : op == kBitOpOr ? _mm256_or_si256(vec, src_vec)
+                           : _mm256_xor_si256(vec, src_vec);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), vec);
+  }
+  BitOpWords<op>(dst + i, src + i, bytes - i);
+}
+
+__attribute__((target("avx2"))) void BitNotAvx2(unsigned char* dst, int64_t bytes) {
+  const __m256i ones = _mm256_set1_epi8(static_cast<char>(0xff));
+  int64_t i = 0;
+  for (; i + 32 <= bytes; i += 32) {
+    __m256i vec = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(vec, ones));
+  }
+  BitNotWords(dst + i, bytes - i);
+}
+
+__attribute__((target("avx2"))) int64_t FindByteNotAvx2(const unsigned char* value, int64_t bytes,
+                                                         unsigned char skip) {
+  const __m256i skip_vec = _mm256_set1_epi8(static_cast<char>(skip));
+  int64_t i = 0;
+  for (; i + 32 <= bytes; i += 32) {
+    __m256i vec = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(value + i));
+    auto equal = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(vec, skip_vec)));
+    if (equal != 0xffffffff) {
+      return i + __builtin_ctz(~equal);
+    }
+  }
+  return i + FindByteNotWords(value + i, bytes - i, skip);
+}
+
+#endif  // STORAGE_BIT_OPS_AVX2
+
+struct BitKernels {
+  int64_t (*count)(const unsigned char*, int64_t);
+  void (*bit_and)(unsigned char*, const unsigned char*, int64_t);
+  void (*bit_or)(unsigned char*, const unsigned char*, int64_t);
+  void (*bit_xor)(unsigned char*, const unsigned char*, int64_t);
+  void (*bit_not)(unsigned char*, int64_t);
+  int64_t (*find_byte_not)(const unsigned char*, int64_t, unsigned char);
+};
+
+const BitKernels& Kernels() {
+  static const BitKernels kernels = []() {
+#ifdef STORAGE_BIT_OPS_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      return BitKernels{BitCountAvx2,           BitOpAvx2<kBitOpAnd>, BitOpAvx2<kBitOpOr>,
+                        BitOpAvx2<kBitOpXor>,   BitNotAvx2,           FindByteNotAvx2};
+    }
+#endif
+    return BitKernels{BitCountWords,         BitOpWords<kBitOpAnd>, BitOpWords<kBitOpOr>,
+                      BitOpWords<kBitOpXor>, BitNotWords,           FindByteNotWords};
+  }();
+  return kernels;
+}
+
+}  // namespace
+
+int64_t GetBitCount(const unsigned char* value, int64_t bytes) { return Kernels().count(value, bytes); }
+
+std::string BitOpOperate(BitOpType op, const std::vector<std::string>& src_values, int64_t max_len) {
+  const BitKernels& kernels = Kernels();
+  std::string dest_value(max_len, '\0');
+  auto dest = reinterpret_cast<unsigned char*>(dest_value.data());
+  memcpy(dest, src_values[0].data(), std::min(static_cast<int64_t>(src_values[0].size()), max_len));
+  if (op == kBitOpNot) {
+    kernels.bit_not(dest, max_len);
+    return dest_value;
+  }
+  for (size_t i = 1; i < src_values.size(); i++) {
+    auto src = reinterpret_cast<const unsigned char*>(src_values[i].data());
+    int64_t bytes = std::min(static_cast<int64_t>(src_values[i].size()), max_len);
+    switch (op) {
+      case kBitOpAnd:
+        kernels.bit_and(dest, src, bytes);
+        // and with the zero padding of the shorter source
+        memset(dest + bytes, 0, max_len - bytes);
+        break;
+      case kBitOpOr:
+        kernels.bit_or(dest, src, bytes);
+        break;
+      case kBitOpXor:
+        kernels.bit_xor(dest, src, bytes);
+        break;
+      default:
+        break;
+    }
+  }
+  return dest_value;
+}
+
+int64_t GetBitPos(const unsigned char* s, int64_t bytes, int bit) {
+  const unsigned char skip = bit == 1 ? 0 : 0xff;
+  int64_t offset = Kernels().find_byte_not(s, bytes, skip);
+  if (offset == bytes) {
+    return bit == 1 ? -1 : 8 * bytes;
+  }
+  unsigned int byte = bit == 1 ? s[offset] : static_cast<unsigned char>(~s[offset]);
+  // the byte is not zero, count its leading zeros within 8 bits
+  return 8 * offset + __builtin_clz(byte) - 24;
+}
+
+}  // namespace storage
@@ -0,0 +1,34 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef SRC_BIT_OPS_H_
+#define SRC_BIT_OPS_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "storage/storage.h"
+
+namespace storage {
+
+/*
+ * The bitmap kernels of BITCOUNT, BITOP and BITPOS. They work on 64-bit words,
+ * and on x86 CPUs with AVX2, detected once at runtime, on 256-bit vectors.
+ */
+
+// number of set bits in the bytes at value
+int64_t GetBitCount(const unsigned char* value, int64_t bytes);
+
+// the result of op over src_values, each zero padded to max_len
+std::string BitOpOperate(BitOpType op, const std::vector<std::string>& src_values, int64_t max_len);
+
+// Position of the first bit equal to bit in the bytes at s, counted from the
+// most significant bit of the first byte. If there is none, -1 for bit 1 and
+// 8 * bytes, the first bit of the zero padding, for bit 0.
+int64_t GetBitPos(const unsigned char* s, int64_t bytes, int bit);
+
+}  // namespace storage
+#endif  // SRC_BIT_OPS_H_
@@ -79,5 +79,26 @@ inline uint64_t DecodeFixed64(const char* ptr) {
   }
 }
 
+// Big-endian variants, used where the encoded integer is part of a key
+// and the keys must sort by that integer under the bytewise comparator.
+inline void EncodeFixed64BigEndian(char* buf, uint64_t value) {
+  buf[0] = (value >> 56) & 0xff;
+  buf[1] = (value >> 48) & 0xff;
+  buf[2] = (value >> 40) & 0xff;
+  buf[3] = (value >> 32) & 0xff;
+  buf[4] = (value >> 24) & 0xff;
+  buf[5] = (value >> 16) & 0xff;
+  buf[6] = (value >> 8) & 0xff;
+  buf[7] = value & 0xff;
+}
+
+inline uint64_t DecodeFixed64BigEndian(const char* ptr) {
+  uint64_t result = 0;
+  for (int i = 0; i < 8; i++) {
+    result = (result << 8) | static_cast<uint64_t>(static_cast<unsigned char>(ptr[i]));
+  }
+  return result;
+}
+
 }  // namespace storage
 #endif  // SRC_CODING_H_
@@ -13,9 +13,12 @@
 #include "storage/storage_define.h"
 
 namespace storage {
-/* list data key pattern
+/* legacy list data key pattern, the index is little-endian
  * | reserve1 | key | version | index | reserve2 |
  * |    8B    |     |    8B   |  8B   |   16B    |
+ *
+ * Only orders the list data CF of the DBs written before the indexes were
+ * stored big-endian, while Redis::Open moves its keys to the bytewise CF.
  */
 class ListsDataKeyComparatorImpl : public rocksdb::Comparator {
  public:
@@ -83,9 +86,12 @@ class ListsDataKeyComparatorImpl : public rocksdb::Comparator {
   void FindShortSuccessor(std::string* key) const override {}
 };
 
-/* zset score key pattern
+/* legacy zset score key pattern, the score is a little-endian double
  *  | <Reserve 1> |      <Key>      |  <Version>  |  <Score>  | <Member> | <Reserve2> |
  *  |   8 Bytes   |  Key Size Bytes |   8 Bytes   |  8 Bytes  |          |     16B    |
+ *
+ * Only orders the score CF of the DBs written before the scores were stored
+ * order preserving, while Redis::Open moves its keys to the bytewise CF.
  */
 class ZSetsScoreKeyComparatorImpl : public rocksdb::Comparator {
  public:
@@ -112,6 +118,13 @@ class ZSetsScoreKeyComparatorImpl : public rocksdb::Comparator {
     if (ret != 0) {
       return ret;
     }
+    // a bare key and version prefix, as cut by the prefix extractor, sorts
+    // before the score keys of the version
+    bool a_prefix_only = std::distance(a.data(), p_a) >= a_size;
+    bool b_prefix_only = std::distance(b.data(), p_b) >= b_size;
+    if (a_prefix_only || b_prefix_only) {
+      return a_prefix_only == b_prefix_only ? 0 : (a_prefix_only ? -1 : 1);
+    }
 
     ptr_a = p_a;
     ptr_b = p_b;
@@ -0,0 +1,57 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef SRC_DATA_KEY_PREFIX_TRANSFORM_H_
+#define SRC_DATA_KEY_PREFIX_TRANSFORM_H_
+
+#include "rocksdb/slice_transform.h"
+
+#include "storage/storage_define.h"
+
+namespace storage {
+
+/*
+ * Prefix extractor of the data and score column families, the data keys of
+ * one version of a user key share the prefix
+ * | reserve1 | key | version |
+ * |    8B    |     |    8B   |
+ *
+ * The prefix bloom filters are checked with the prefix of the seek target and
+ * the iterators are not defined past it, so every iterator over these column
+ * families has to seek inside the prefix of one key and stay in it, which
+ * the IterateBounds of the key do. SeekToFirst and SeekToLast are not
+ * filtered.
+ *
+ * The SST files written before the extractor was set, or with an extractor of
+ * another name, record no or another extractor in their table properties and
+ * RocksDB skips their prefix filters, they are read as before until they are
+ * compacted. Keep the name unless the prefix changes.
+ */
+class DataKeyPrefixTransform : public rocksdb::SliceTransform {
+ public:
+  const char* Name() const override { return "pikiwidb.DataKeyPrefixTransform"; }
+
+  Slice Transform(const Slice& key) const override { return Slice(key.data(), PrefixLength(key)); }
+
+  bool InDomain(const Slice& key) const override { return PrefixLength(key) != 0; }
+
+ private:
+  // length of the key and version prefix, 0 if key is too short to have one
+  static size_t PrefixLength(const Slice& key) {
+    if (key.size() <= static_cast<size_t>(kPrefixReserveLength)) {
+      return 0;
+    }
+    const char* encoded_key = key.data() + kPrefixReserveLength;
+    const char* version = SeekUserkeyDelim(encoded_key, static_cast<int>(key.size() - kPrefixReserveLength));
+    if (version == encoded_key) {
+      return 0;
+    }
+    size_t length = version - key.data() + kVersionLength;
+    return length <= key.size() ? length : 0;
+  }
+};
+
+}  // namespace storage
+#endif  // SRC_DATA_KEY_PREFIX_TRANSFORM_H_
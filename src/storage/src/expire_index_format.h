@@ -0,0 +1,76 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef SRC_EXPIRE_INDEX_FORMAT_H_
+#define SRC_EXPIRE_INDEX_FORMAT_H_
+
+#include <string>
+
+#include "src/coding.h"
+#include "storage/storage_define.h"
+
+namespace storage {
+/*
+ * used for the expire index column family. format:
+ * | etime | type | key |
+ * |  8B   |  1B  |     |
+ *
+ * etime is encoded in big-endian so that index keys are ordered by expire
+ * time under the default bytewise comparator, type is the DataTypeTag of the
+ * indexed key. The value is empty.
+ *
+ * An index key is only a hint: EXPIRE to a later time or PERSIST leaves the
+ * old index key in place, the reaper compares it against the etime stored in
+ * the meta value and drops it when they don't match.
+ */
+const int kExpireIndexPrefixLength = kTimestampLength + 1;
+
+class ExpireIndexKey {
+ public:
+  ExpireIndexKey(uint64_t etime, char type, const Slice& key) : etime_(etime), type_(type), key_(key) {}
+
+  std::string Encode() const {
+    std::string dst(kExpireIndexPrefixLength + key_.size(), '\0');
+    EncodeFixed64BigEndian(dst.data(), etime_);
+    dst[kTimestampLength] = type_;
+    memcpy(dst.data() + kExpireIndexPrefixLength, key_.data(), key_.size());
+    return dst;
+  }
+
+  // the smallest index key whose etime is not less than the given one
+  static std::string EncodeSeekKey(uint64_t etime) {
+    std::string dst(kTimestampLength, '\0');
+    EncodeFixed64BigEndian(dst.data(), etime);
+    return dst;
+  }
+
+ private:
+  uint64_t etime_ = 0;
+  char type_ = 0;
+  Slice key_;
+};
+
+class ParsedExpireIndexKey {
+ public:
+  explicit ParsedExpireIndexKey(const Slice& key) {
+    if (key.size() >= static_cast<size_t>(kExpireIndexPrefixLength)) {
+      etime_ = DecodeFixed64BigEndian(key.data());
+      type_ = key[kTimestampLength];
+      key_ = Slice(key.data() + kExpireIndexPrefixLength, key.size() - kExpireIndexPrefixLength);
+    }
+  }
+
+  uint64_t Etime() const { return etime_; }
+  char Type() const { return type_; }
+  Slice Key() const { return key_; }
+
+ private:
+  uint64_t etime_ = 0;
+  char type_ = 0;
+  Slice key_;
+};
+
+}  //  namespace storage
+#endif  // SRC_EXPIRE_INDEX_FORMAT_H_
@@ -0,0 +1,96 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef SRC_ITERATE_BOUNDS_H_
+#define SRC_ITERATE_BOUNDS_H_
+
+#include <string>
+#include <utility>
+
+#include "pstd/noncopyable.h"
+#include "rocksdb/options.h"
+
+#include "src/base_data_key_format.h"
+#include "storage/storage_define.h"
+
+namespace storage {
+
+// The smallest string greater than every string starting with prefix, empty
+// when there is none, i.e. the prefix is empty or all 0xff
+inline std::string PrefixSuccessor(const Slice& prefix) {
+  std::string successor = prefix.ToString();
+  while (!successor.empty() && static_cast<unsigned char>(successor.back()) == 0xff) {
+    successor.pop_back();
+  }
+  if (!successor.empty()) {
+    successor.back() = static_cast<char>(static_cast<unsigned char>(successor.back()) + 1);
+  }
+  return successor;
+}
+
+/*
+ * Bounds of an iteration over the data keys of one key, or over the meta keys
+ * starting with a user key prefix. With them RocksDB skips the SST files out
+ * of the range and stops at the bound, instead of stepping over the
+ * tombstones of the neighbouring keys until the prefix check fails.
+ *
+ * ReadOptions only keeps pointers to the bounds, so the IterateBounds must
+ * outlive the iterators created with the options from Bound().
+ */
+class IterateBounds : public pstd::noncopyable {
+ public:
+  // [lower, upper), an empty upper means no upper bound
+  IterateBounds(std::string lower, std::string upper)
+      : lower_(std::move(lower)), upper_(std::move(upper)), lower_bound_(lower_), upper_bound_(upper_) {}
+
+  // the keys starting with prefix, in a column family ordered bytewise
+  static IterateBounds Prefix(const Slice& prefix) { return {prefix.ToString(), PrefixSuccessor(prefix)}; }
+
+  // the meta keys whose user key starts with prefix
+  static IterateBounds MetaKeyPrefix(const Slice& prefix) {
+    std::string lower(kPrefixReserveLength, kNeedTransformCharacter);
+    size_t nzero = CountNeedTransformCharacters(prefix);
+    std::string encoded(prefix.size() + nzero + kEncodedKeyDelimSize, '\0');
+    EncodeUserKey(prefix, encoded.data(), nzero);
+    // without the delimiter, longer keys share the prefix
+    lower.append(encoded.data(), encoded.size() - kEncodedKeyDelimSize);
+    std::string upper = PrefixSuccessor(lower);
+    return {std::move(lower), std::move(upper)};
+  }
+
+  // the list nodes of one version of key
+  static IterateBounds ListsData(const Slice& key, uint64_t version) {
+    BaseDataKey prefix(key, version, Slice());
+    return Prefix(prefix.EncodeSeekKey());
+  }
+
+  // the score keys of one version of key
+  static IterateBounds ZSetsScore(const Slice& key, uint64_t version) {
+    BaseDataKey prefix(key, version, Slice());
+    return Prefix(prefix.EncodeSeekKey());
+  }
+
+  const Slice& Lower() const { return lower_bound_; }
+  const Slice& Upper() const { return upper_bound_; }
+  const Slice* LowerBound() const { return &lower_bound_; }
+  const Slice* UpperBound() const { return upper_.empty() ? nullptr : &upper_bound_; }
+
+  // a copy of options whose iterators stay in the bounds
+  rocksdb::ReadOptions Bound(const rocksdb::ReadOptions& options) const {
+    rocksdb::ReadOptions bounded(options);
+    bounded.iterate_lower_bound = LowerBound();
+    bounded.iterate_upper_bound = UpperBound();
+    return bounded;
+  }
+
+ private:
+  std::string lower_;
+  std::string upper_;
+  Slice lower_bound_;
+  Slice upper_bound_;
+};
+
+}  // namespace storage
+#endif  // SRC_ITERATE_BOUNDS_H_
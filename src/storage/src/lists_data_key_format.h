@@ -6,14 +6,37 @@
 #ifndef SRC_LISTS_DATA_KEY_FORMAT_H_
 #define SRC_LISTS_DATA_KEY_FORMAT_H_
 
+#include <string>
+
 #include "pstd/pstd_coding.h"
+#include "src/coding.h"
 #include "storage/storage_define.h"
 
 namespace storage {
+
+// Converts a list data key of the legacy encoding, where the index was stored
+// little-endian and sorted by a custom comparator
+inline std::string LegacyListsDataKeyToBytewise(const Slice& legacy_key) {
+  std::string key = legacy_key.ToString();
+  if (key.size() <= static_cast<size_t>(kPrefixReserveLength)) {
+    return key;
+  }
+  const char* encoded_key = key.data() + kPrefixReserveLength;
+  const char* version = SeekUserkeyDelim(encoded_key, static_cast<int>(key.size() - kPrefixReserveLength));
+  size_t index_offset = version - key.data() + kVersionLength;
+  if (version == encoded_key || index_offset + sizeof(uint64_t) > key.size()) {
+    return key;
+  }
+  EncodeFixed64BigEndian(key.data() + index_offset, DecodeFixed64(key.data() + index_offset));
+  return key;
+}
+
 /*
  * used for List data key. format:
  * | reserve1 | key | version | index | reserve2 |
  * |    8B    |     |    8B   |   8B  |   16B    |
+ *
+ * The index is stored big-endian, so the nodes of a list sort bytewise.
  */
 class ListsDataKey {
  public:
@@ -28,7 +51,7 @@ class ListsDataKey {
   Slice Encode() {
     size_t meta_size = sizeof(reserve1_) + sizeof(version_) + sizeof(reserve2_);
     size_t usize = key_.size() + sizeof(index_) + kEncodedKeyDelimSize;
-    size_t nzero = std::count(key_.data(), key_.data() + key_.size(), kNeedTransformCharacter);
+    size_t nzero = CountNeedTransformCharacters(key_);
     usize += nzero;
     size_t needed = meta_size + usize;
     char* dst;
@@ -51,7 +74,7 @@ class ListsDataKey {
     EncodeFixed64(dst, version_);
     dst += sizeof(version_);
     // index
-    EncodeFixed64(dst, index_);
+    EncodeFixed64BigEndian(dst, index_);
     dst += sizeof(index_);
     // TODO(wangshaoyi): too much for reserve
     // reserve2: 16 byte
@@ -93,7 +116,7 @@ class ParsedListsDataKey {
     ptr = DecodeUserKey(ptr, std::distance(ptr, end_ptr), &key_str_);
     version_ = pstd::DecodeFixed64(ptr);
     ptr += sizeof(version_);
-    index_ = pstd::DecodeFixed64(ptr);
+    index_ = DecodeFixed64BigEndian(ptr);
   }
 
   virtual ~ParsedListsDataKey() = default;
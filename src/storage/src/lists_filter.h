@@ -12,6 +12,7 @@
 
 #include "rocksdb/compaction_filter.h"
 #include "rocksdb/db.h"
+#include "src/base_filter.h"
 #include "src/debug.h"
 #include "src/lists_data_key_format.h"
 #include "src/lists_meta_value_format.h"
@@ -20,12 +21,10 @@ namespace storage {
 
 class ListsMetaFilter : public rocksdb::CompactionFilter {
  public:
-  ListsMetaFilter() = default;
+  ListsMetaFilter() { rocksdb::Env::Default()->GetCurrentTime(&unix_time_); }
   bool Filter(int level, const rocksdb::Slice& key, const rocksdb::Slice& value, std::string* new_value,
               bool* value_changed) const override {
-    int64_t unix_time;
-    rocksdb::Env::Default()->GetCurrentTime(&unix_time);
-    auto cur_time = static_cast<int32_t>(unix_time);
+    auto cur_time = static_cast<int32_t>(unix_time_);
     ParsedListsMetaValue parsed_lists_meta_value(value);
     TRACE("==========================START==========================");
     TRACE("[ListMetaFilter], key: %s, count = %llu, timestamp: %llu, cur_time: %d, version: %llu",
@@ -46,6 +45,9 @@ class ListsMetaFilter : public rocksdb::CompactionFilter {
   }
 
   const char* Name() const override { return "ListsMetaFilter"; }
+
+ private:
+  int64_t unix_time_ = 0;
 };
 
 class ListsMetaFilterFactory : public rocksdb::CompactionFilterFactory {
@@ -61,7 +63,9 @@ class ListsMetaFilterFactory : public rocksdb::CompactionFilterFactory {
 class ListsDataFilter : public rocksdb::CompactionFilter {
  public:
   ListsDataFilter(rocksdb::DB* db, std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr, int meta_cf_index)
-      : db_(db), cf_handles_ptr_(cf_handles_ptr), meta_cf_index_(meta_cf_index) {}
+      : db_(db), cf_handles_ptr_(cf_handles_ptr), meta_cf_index_(meta_cf_index) {
+    rocksdb::Env::Default()->GetCurrentTime(&unix_time_);
+  }
 
   bool Filter(int level, const rocksdb::Slice& key, const rocksdb::Slice& value, std::string* new_value,
               bool* value_changed) const override {
@@ -88,7 +92,7 @@ class ListsDataFilter : public rocksdb::CompactionFilter {
       if (cf_handles_ptr_->empty()) {
         return false;
       }
-      rocksdb::Status s = db_->Get(default_read_options_, (*cf_handles_ptr_)[meta_cf_index_], cur_key_, &meta_value);
+      rocksdb::Status s = meta_lookup_.Lookup(db_, (*cf_handles_ptr_)[meta_cf_index_], cur_key_, &meta_value);
       if (s.ok()) {
         meta_not_found_ = false;
         ParsedListsMetaValue parsed_lists_meta_value(&meta_value);
@@ -108,9 +112,7 @@ class ListsDataFilter : public rocksdb::CompactionFilter {
       return true;
     }
 
-    int64_t unix_time;
-    rocksdb::Env::Default()->GetCurrentTime(&unix_time);
-    if (cur_meta_etime_ != 0 && cur_meta_etime_ < static_cast<uint64_t>(unix_time)) {
+    if (cur_meta_etime_ != 0 && cur_meta_etime_ < static_cast<uint64_t>(unix_time_)) {
       TRACE("Drop[Timeout]");
       return true;
     }
@@ -129,7 +131,8 @@ class ListsDataFilter : public rocksdb::CompactionFilter {
  private:
   rocksdb::DB* db_ = nullptr;
   std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr_ = nullptr;
-  rocksdb::ReadOptions default_read_options_;
+  mutable MetaValueLookup meta_lookup_;
+  int64_t unix_time_ = 0;
   mutable std::string cur_key_;
   mutable bool meta_not_found_ = false;
   mutable uint64_t cur_meta_version_ = 0;
@@ -8,6 +8,7 @@
 #include "log_index.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cinttypes>
 #include <set>
 
@@ -71,6 +72,7 @@ size_t LogIndexOfColumnFamilies::GetPendingFlushGap() const {
 };
 
 std::atomic_int64_t LogIndexAndSequenceCollector::max_gap_ = 1000;
+std::atomic_uint64_t LogIndexAndSequenceCollector::max_gap_bytes_ = 0;
 
 std::optional<LogIndexAndSequencePair> storage::LogIndexTablePropertiesCollector::ReadStatsFromTableProps(
     const std::shared_ptr<const rocksdb::TableProperties> &table_props) {
@@ -110,13 +112,44 @@ LogIndex LogIndexAndSequenceCollector::FindAppliedLogIndex(SequenceNumber seqno)
   return it->GetAppliedLogIndex();
 }
 
-void LogIndexAndSequenceCollector::Update(LogIndex smallest_applied_log_index, SequenceNumber smallest_flush_seqno) {
+void LogIndexAndSequenceCollector::Update(LogIndex smallest_applied_log_index, SequenceNumber smallest_flush_seqno,
+                                          uint64_t log_bytes) {
+  auto applied_bytes = applied_bytes_.fetch_add(log_bytes) + log_bytes;
+  if (smallest_applied_log_index > last_applied_log_index_.load()) {
+    last_applied_log_index_.store(smallest_applied_log_index);
+  }
+  std::lock_guard gd(mutex_);
   // If step length > 1, log index is sampled and sacrifice precision to save memory usage.
   // It means that extra applied log may be applied again on start stage.
   if ((smallest_applied_log_index & step_length_mask_) == 0) {
-    std::lock_guard gd(mutex_);
     list_.emplace_back(smallest_applied_log_index, smallest_flush_seqno);
   }
+  if (applied_bytes_samples_.empty() ||
+      smallest_applied_log_index - applied_bytes_samples_.back().first >= kAppliedBytesStep) {
+    applied_bytes_samples_.emplace_back(smallest_applied_log_index, applied_bytes);
+  }
+}
+
+uint64_t LogIndexAndSequenceCollector::GetAppliedBytesSince(LogIndex log_index) const {
+  std::shared_lock gd(mutex_);
+  if (applied_bytes_samples_.empty()) {
+    return 0;
+  }
+  // the last sample at or before log_index, or the first one for the logs
+  // applied before the samples, like the ones before a restart
+  auto it = std::upper_bound(applied_bytes_samples_.begin(), applied_bytes_samples_.end(), log_index,
+                             [](LogIndex idx, const std::pair<LogIndex, uint64_t> &p) { return idx < p.first; });
+  if (it != applied_bytes_samples_.begin()) {
+    --it;
+  }
+  return applied_bytes_.load() - it->second;
+}
+
+void LogIndexAndSequenceCollector::PurgeAppliedBytes(LogIndex log_index) {
+  std::lock_guard gd(mutex_);
+  while (applied_bytes_samples_.size() >= 2 && applied_bytes_samples_[1].first <= log_index) {
+    applied_bytes_samples_.pop_front();
+  }
 }
 
 // TODO(longfar): find the iterator which should be deleted and erase from begin to the iterator
@@ -154,33 +187,84 @@ auto LogIndexTablePropertiesCollector::GetLargestLogIndexFromTableCollection(
 
 void LogIndexAndSequenceCollectorPurger::OnFlushCompleted(rocksdb::DB *db,
                                                           const rocksdb::FlushJobInfo &flush_job_info) {
-  cf_->SetFlushedLogIndex(flush_job_info.cf_id, collector_->FindAppliedLogIndex(flush_job_info.largest_seqno),
+  // the RocksDB id of a column family created after the others, like the
+  // bytewise zset score CF of an upgraded DB, is not its index in the handles
+  size_t cf_idx = 0;
+  while (cf_idx < column_families_->size() && (*column_families_)[cf_idx]->GetID() != flush_job_info.cf_id) {
+    cf_idx++;
+  }
+  if (cf_idx == column_families_->size()) {
+    return;
+  }
+  cf_->SetFlushedLogIndex(cf_idx, collector_->FindAppliedLogIndex(flush_job_info.largest_seqno),
                           flush_job_info.largest_seqno);
 
   auto [smallest_applied_log_index_cf, smallest_applied_log_index, smallest_flushed_log_index_cf,
-        smallest_flushed_log_index, smallest_flushed_seqno] = cf_->GetSmallestLogIndex(flush_job_info.cf_id);
+        smallest_flushed_log_index, smallest_flushed_seqno] = cf_->GetSmallestLogIndex(cf_idx);
   collector_->Purge(smallest_applied_log_index);
 
   if (smallest_flushed_log_index_cf != -1) {
     cf_->SetFlushedLogIndexGlobal(smallest_flushed_log_index, smallest_flushed_seqno);
   }
   auto count = count_.fetch_add(1);
+  bool gap_flushed = cf_idx == manul_flushing_cf_.load();
+  if (gap_flushed) {
+    manul_flushing_cf_.store(-1);
+  }
 
-  if (count % 10 == 0) {
+  // the logs before the oldest unflushed one are not replayed any more
+  auto res = cf_->GetSmallestLogIndex(-1);
+  collector_->PurgeAppliedBytes(res.smallest_flushed_log_index_cf == -1 ? collector_->GetLastAppliedLogIndex()
+                                                                        : res.smallest_flushed_log_index);
+
+  // a restart replays the logs after the last snapshot, so one is taken once
+  // the flushes of a pending flush bring the logs to replay under the limits
+  bool gap_flush_pending = IsGapFlushPending();
+  if (count % 10 == 0 || (gap_flushed && !gap_flush_pending)) {
     callback_(smallest_flushed_log_index, false);
   }
 
-  if (flush_job_info.cf_id == manul_flushing_cf_.load()) {
-    manul_flushing_cf_.store(-1);
+  if (gap_flush_pending || collector_->IsFlushPending()) {
+    FlushOldestCF(db);
   }
+}
 
-  auto flushing_cf = manul_flushing_cf_.load();
-  if (flushing_cf != -1 || !collector_->IsFlushPending()) {
+bool LogIndexAndSequenceCollectorPurger::IsGapFlushPending() const {
+  auto res = cf_->GetSmallestLogIndex(-1);
+  if (res.smallest_flushed_log_index_cf == -1) {
+    return false;
+  }
+  auto max_gap_bytes = LogIndexAndSequenceCollector::max_gap_bytes_.load();
+  return collector_->GetLastAppliedLogIndex() - res.smallest_flushed_log_index >=
+             LogIndexAndSequenceCollector::max_gap_.load() ||
+         (max_gap_bytes > 0 && collector_->GetAppliedBytesSince(res.smallest_flushed_log_index) >= max_gap_bytes);
+}
+
+void LogIndexAndSequenceCollectorPurger::FlushOldestCFIfPending(rocksdb::DB *db) {
+  if (gap_flush_interval_ms_ == 0 || manul_flushing_cf_.load() != -1) {
+    return;
+  }
+  auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+                 .count();
+  auto last = last_gap_flush_ms_.load();
+  if (now - last < gap_flush_interval_ms_ || !IsGapFlushPending() ||
+      !last_gap_flush_ms_.compare_exchange_strong(last, now)) {
     return;
   }
+  FlushOldestCF(db);
+}
 
-  assert(flushing_cf == -1);
+void LogIndexAndSequenceCollectorPurger::FlushOldestCF(rocksdb::DB *db) {
+  auto flushing_cf = manul_flushing_cf_.load();
+  if (flushing_cf != -1) {
+    return;
+  }
 
+  // the column families without unflushed data have nothing to flush
+  auto smallest_flushed_log_index_cf = cf_->GetSmallestLogIndex(-1).smallest_flushed_log_index_cf;
+  if (smallest_flushed_log_index_cf == -1) {
+    return;
+  }
   if (!manul_flushing_cf_.compare_exchange_strong(flushing_cf, smallest_flushed_log_index_cf)) {
     return;
   }
@@ -188,7 +272,9 @@ void LogIndexAndSequenceCollectorPurger::OnFlushCompleted(rocksdb::DB *db,
   assert(manul_flushing_cf_.load() == smallest_flushed_log_index_cf);
   rocksdb::FlushOptions flush_option;
   flush_option.wait = false;
-  db->Flush(flush_option, column_families_->at(smallest_flushed_log_index_cf));
+  if (!db->Flush(flush_option, column_families_->at(smallest_flushed_log_index_cf)).ok()) {
+    manul_flushing_cf_.store(-1);
+  }
 }
 
 }  // namespace storage
\ No newline at end of file
@@ -150,8 +150,9 @@ class LogIndexAndSequenceCollector {
   // find the index of log which contain seqno or before it
   LogIndex FindAppliedLogIndex(SequenceNumber seqno) const;
 
-  // if there's a new pair, add it to list; otherwise, do nothing
-  void Update(LogIndex smallest_applied_log_index, SequenceNumber smallest_flush_seqno);
+  // if there's a new pair, add it to list; otherwise, do nothing. log_bytes
+  // is the size of the keys and values of the log
+  void Update(LogIndex smallest_applied_log_index, SequenceNumber smallest_flush_seqno, uint64_t log_bytes = 0);
 
   // purge out dated log index after memtable flushed.
   void Purge(LogIndex smallest_applied_log_index);
@@ -159,6 +160,15 @@ class LogIndexAndSequenceCollector {
   // Is manual flushing required?
   bool IsFlushPending() const { return GetSize() >= max_gap_; }
 
+  LogIndex GetLastAppliedLogIndex() const { return last_applied_log_index_.load(); }
+
+  // The bytes of the logs applied after log_index, counted from the sample at
+  // or before it, so up to kAppliedBytesStep logs more.
+  uint64_t GetAppliedBytesSince(LogIndex log_index) const;
+
+  // drops the samples of the applied bytes before log_index
+  void PurgeAppliedBytes(LogIndex log_index);
+
   // for gtest
   uint64_t GetSize() const {
     std::shared_lock<std::shared_mutex> share_lock;
@@ -172,11 +182,17 @@ class LogIndexAndSequenceCollector {
 
  public:
   static std::atomic_int64_t max_gap_;
+  static std::atomic_uint64_t max_gap_bytes_;
+  static constexpr LogIndex kAppliedBytesStep = 64;
 
  private:
   uint64_t step_length_mask_ = 0;
   mutable std::shared_mutex mutex_;
   std::deque<LogIndexAndSequencePair> list_;
+  std::atomic<LogIndex> last_applied_log_index_ = 0;
+  std::atomic<uint64_t> applied_bytes_ = 0;
+  // (log index, bytes applied up to it) every kAppliedBytesStep logs
+  std::deque<std::pair<LogIndex, uint64_t>> applied_bytes_samples_;
 };
 
 class LogIndexTablePropertiesCollector : public rocksdb::TablePropertiesCollector {
@@ -239,18 +255,40 @@ class LogIndexAndSequenceCollectorPurger : public rocksdb::EventListener {
  public:
   explicit LogIndexAndSequenceCollectorPurger(std::vector<rocksdb::ColumnFamilyHandle *> *column_families,
                                               LogIndexAndSequenceCollector *collector, LogIndexOfColumnFamilies *cf,
-                                              std::function<void(int64_t, bool)> callback)
-      : column_families_(column_families), collector_(collector), cf_(cf), callback_(callback) {}
+                                              std::function<void(int64_t, bool)> callback,
+                                              uint32_t gap_flush_interval_ms = 0)
+      : column_families_(column_families),
+        collector_(collector),
+        cf_(cf),
+        callback_(callback),
+        gap_flush_interval_ms_(gap_flush_interval_ms) {}
 
   void OnFlushCompleted(rocksdb::DB *db, const rocksdb::FlushJobInfo &flush_job_info) override;
 
+  // A restart replays the logs after the oldest one whose data is still in a
+  // memtable, the smallest flushed log index of the column families with
+  // unflushed data. Flushing is pending once they reach max_gap_ logs or
+  // max_gap_bytes_ bytes.
+  bool IsGapFlushPending() const;
+
+  // Called after the writes, starts flushing the column family of the oldest
+  // unflushed log if the flush is pending and none of it is running, at most
+  // once in gap_flush_interval_ms. Each flush completed starts the next one
+  // until the logs to replay are under the limits again.
+  void FlushOldestCFIfPending(rocksdb::DB *db);
+
  private:
+  // flushes the column family of the oldest unflushed log, one at a time
+  void FlushOldestCF(rocksdb::DB *db);
+
   std::vector<rocksdb::ColumnFamilyHandle *> *column_families_ = nullptr;
   LogIndexAndSequenceCollector *collector_ = nullptr;
   LogIndexOfColumnFamilies *cf_ = nullptr;
   std::atomic_uint64_t count_ = 0;
   std::atomic<size_t> manul_flushing_cf_ = -1;
   std::function<void(int64_t, bool)> callback_;
+  uint32_t gap_flush_interval_ms_ = 0;
+  std::atomic<int64_t> last_gap_flush_ms_ = 0;
 };
 
 }  // namespace storage
\ No newline at end of file
@@ -0,0 +1,107 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef SRC_MERGE_OPERATOR_H_
+#define SRC_MERGE_OPERATOR_H_
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "rocksdb/merge_operator.h"
+#include "rocksdb/slice.h"
+
+#include "src/coding.h"
+#include "src/strings_value_format.h"
+#include "storage/storage_define.h"
+
+namespace storage {
+
+/*
+ * merge operand format:
+ * | type | etime | payload |
+ * |  1B  |  8B   |         |
+ *
+ * etime is the expire time of the key when the operand was written. If the
+ * base value has already been dropped by the compaction filter when the
+ * operand is merged, the result inherits this etime, so an expired key is
+ * never resurrected by a late APPEND.
+ *
+ * Only APPEND writes operands: it writes the appended bytes instead of the
+ * whole value. The writes that rewrite a value about as long as an operand,
+ * like INCRBY, put the new value.
+ */
+enum MergeOperandType : char {
+  kMergeAppend = 'a',  // payload: raw bytes to append
+};
+
+const int kMergeOperandHeaderLength = 1 + kTimestampLength;
+
+inline std::string EncodeMergeOperand(MergeOperandType type, uint64_t etime, const Slice& payload) {
+  std::string operand(kMergeOperandHeaderLength + payload.size(), '\0');
+  char* dst = operand.data();
+  dst[0] = type;
+  EncodeFixed64(dst + 1, etime);
+  memcpy(dst + kMergeOperandHeaderLength, payload.data(), payload.size());
+  return operand;
+}
+
+// Applies one operand to the user value in place, false if the operand is
+// not one this operator wrote
+inline bool ApplyMergeOperand(const Slice& operand, std::string* user_value) {
+  if (operand.size() < static_cast<size_t>(kMergeOperandHeaderLength)) {
+    return false;
+  }
+  Slice payload(operand.data() + kMergeOperandHeaderLength, operand.size() - kMergeOperandHeaderLength);
+  switch (operand[0]) {
+    case kMergeAppend:
+      user_value->append(payload.data(), payload.size());
+      return true;
+    default:
+      return false;
+  }
+}
+
+/*
+ * Merge operator of the strings column family, the suffix
+ * (reserve | cdate | timestamp) of the base value is kept as is. A bad
+ * operand fails the merge, so the read or the compaction of the key reports
+ * the corruption instead of dropping the operand.
+ */
+class StringsMergeOperator : public rocksdb::MergeOperator {
+ public:
+  bool FullMergeV2(const MergeOperationInput& merge_in, MergeOperationOutput* merge_out) const override {
+    static const size_t kSuffixLength = kSuffixReserveLength + 2 * kTimestampLength;
+    std::string user_value;
+    std::string suffix;
+    if (merge_in.existing_value != nullptr) {
+      const Slice& existing = *merge_in.existing_value;
+      if (existing.size() < kSuffixLength) {
+        return false;
+      }
+      user_value.assign(existing.data(), existing.size() - kSuffixLength);
+      suffix.assign(existing.data() + user_value.size(), kSuffixLength);
+    }
+    for (const auto& operand : merge_in.operand_list) {
+      if (!ApplyMergeOperand(operand, &user_value)) {
+        return false;
+      }
+      if (suffix.empty()) {
+        StringsValue strings_value{Slice()};
+        strings_value.SetEtime(DecodeFixed64(operand.data() + 1));
+        Slice encoded = strings_value.Encode();
+        suffix.assign(encoded.data(), encoded.size());
+      }
+    }
+    merge_out->new_value = std::move(user_value);
+    merge_out->new_value.append(suffix);
+    return true;
+  }
+
+  const char* Name() const override { return "StringsMergeOperator"; }
+};
+
+}  //  namespace storage
+#endif  // SRC_MERGE_OPERATOR_H_
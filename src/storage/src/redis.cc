@@ -3,16 +3,31 @@
 //  LICENSE file in the root directory of this source tree. An additional grant
 //  of patent rights can be found in the PATENTS file in the same directory.
 
+#include <algorithm>
+#include <chrono>
+#include <set>
 #include <sstream>
 
 #include "pstd/log.h"
 #include "rocksdb/env.h"
 
 #include "src/base_filter.h"
+#include "src/base_key_format.h"
+#include "src/batch.h"
+#include "src/data_key_prefix_transform.h"
+#include "src/expire_index_format.h"
+#include "src/iterate_bounds.h"
+#include "src/lists_data_key_format.h"
 #include "src/lists_filter.h"
+#include "src/lists_meta_value_format.h"
+#include "src/merge_operator.h"
 #include "src/mutex.h"
 #include "src/redis.h"
+#include "src/scope_record_lock.h"
+#include "src/scope_snapshot.h"
 #include "src/strings_filter.h"
+#include "src/tombstone_density_collector.h"
+#include "src/zsets_data_key_format.h"
 #include "src/zsets_filter.h"
 
 #define ADD_TABLE_PROPERTY_COLLECTOR_FACTORY(type)              \
@@ -20,6 +35,19 @@
       std::make_shared<LogIndexTablePropertiesCollectorFactory>(log_index_collector_));
 
 namespace storage {
+// share of the write buffer of a data CF taken by its memtable prefix bloom
+const double kMemtablePrefixBloomSizeRatio = 0.1;
+// the list data and zset score CFs in the bytewise encodings, and the ones
+// before them
+const char* kListsDataCFName = "list_data_bytewise_cf";
+const char* kLegacyListsDataCFName = "list_data_cf";
+const char* kZSetsScoreCFName = "zset_score_bytewise_cf";
+const char* kLegacyZSetsScoreCFName = "zset_score_cf";
+// keys moved out of a legacy CF per write, and between the progress logs
+const int kMigrationBatchSize = 10000;
+const uint64_t kMigrationProgressKeys = 1000000;
+
+// only open the legacy CFs for the migration
 const rocksdb::Comparator* ListsDataKeyComparator() {
   static ListsDataKeyComparatorImpl ldkc;
   return &ldkc;
@@ -39,9 +67,11 @@ Redis::Redis(Storage* const s, int32_t index)
   statistics_store_ = std::make_unique<LRUCache<std::string, KeyStatistics>>();
   scan_cursors_store_ = std::make_unique<LRUCache<std::string, std::string>>();
   spop_counts_store_ = std::make_unique<LRUCache<std::string, size_t>>();
+  zset_pop_hints_ = std::make_unique<LRUCache<std::string, std::string>>();
   default_compact_range_options_.exclusive_manual_compaction = false;
   default_compact_range_options_.change_level = true;
   spop_counts_store_->SetCapacity(1000);
+  zset_pop_hints_->SetCapacity(10000);
   scan_cursors_store_->SetCapacity(5000);
   handles_.clear();
 }
@@ -77,12 +107,22 @@ Status Redis::Open(const StorageOptions& storage_options, const std::string& db_
   // string column-family options
   rocksdb::ColumnFamilyOptions string_cf_ops(storage_options.options);
   string_cf_ops.compaction_filter_factory = std::make_shared<StringsFilterFactory>();
+  string_cf_ops.merge_operator = std::make_shared<StringsMergeOperator>();
   rocksdb::BlockBasedTableOptions string_table_ops(table_ops);
   if (!storage_options.share_block_cache && (storage_options.block_cache_size > 0)) {
     string_table_ops.block_cache = rocksdb::NewLRUCache(storage_options.block_cache_size);
   }
   string_cf_ops.table_factory.reset(rocksdb::NewBlockBasedTableFactory(string_table_ops));
 
+  // the chunks of the chunked string values
+  rocksdb::ColumnFamilyOptions string_data_cf_ops(storage_options.options);
+  string_data_cf_ops.compaction_filter_factory = std::make_shared<StringsDataFilterFactory>(&db_, &handles_);
+  rocksdb::BlockBasedTableOptions string_data_cf_table_ops(table_ops);
+  if (!storage_options.share_block_cache && (storage_options.block_cache_size > 0)) {
+    string_data_cf_table_ops.block_cache = rocksdb::NewLRUCache(storage_options.block_cache_size);
+  }
+  string_data_cf_ops.table_factory.reset(rocksdb::NewBlockBasedTableFactory(string_data_cf_table_ops));
+
   // hash column-family options
   rocksdb::ColumnFamilyOptions hash_meta_cf_ops(storage_options.options);
   rocksdb::ColumnFamilyOptions hash_data_cf_ops(storage_options.options);
@@ -103,7 +143,6 @@ Status Redis::Open(const StorageOptions& storage_options, const std::string& db_
   rocksdb::ColumnFamilyOptions list_data_cf_ops(storage_options.options);
   list_meta_cf_ops.compaction_filter_factory = std::make_shared<ListsMetaFilterFactory>();
   list_data_cf_ops.compaction_filter_factory = std::make_shared<ListsDataFilterFactory>(&db_, &handles_, kListsMetaCF);
-  list_data_cf_ops.comparator = ListsDataKeyComparator();
   rocksdb::BlockBasedTableOptions list_meta_cf_table_ops(table_ops);
   rocksdb::BlockBasedTableOptions list_data_cf_table_ops(table_ops);
   if (!storage_options.share_block_cache && (storage_options.block_cache_size > 0)) {
@@ -135,7 +174,6 @@ Status Redis::Open(const StorageOptions& storage_options, const std::string& db_
   zset_data_cf_ops.compaction_filter_factory = std::make_shared<ZSetsDataFilterFactory>(&db_, &handles_, kZsetsMetaCF);
   zset_score_cf_ops.compaction_filter_factory =
       std::make_shared<ZSetsScoreFilterFactory>(&db_, &handles_, kZsetsMetaCF);
-  zset_score_cf_ops.comparator = ZSetsScoreKeyComparator();
 
   rocksdb::BlockBasedTableOptions zset_meta_cf_table_ops(table_ops);
   rocksdb::BlockBasedTableOptions zset_data_cf_table_ops(table_ops);
@@ -149,6 +187,45 @@ Status Redis::Open(const StorageOptions& storage_options, const std::string& db_
   zset_data_cf_ops.table_factory.reset(rocksdb::NewBlockBasedTableFactory(zset_data_cf_table_ops));
   zset_score_cf_ops.table_factory.reset(rocksdb::NewBlockBasedTableFactory(zset_score_cf_table_ops));
 
+  // expire index column-family options, index keys are tiny and only read by
+  // the reaper in expire time order, no filter and no dedicated block cache
+  rocksdb::ColumnFamilyOptions expire_index_cf_ops(storage_options.options);
+  rocksdb::BlockBasedTableOptions expire_index_cf_table_ops(storage_options.table_options);
+  expire_index_cf_ops.table_factory.reset(rocksdb::NewBlockBasedTableFactory(expire_index_cf_table_ops));
+
+  // record the deletes and expired entries of every SST file for the density
+  // compactions and the space usage report
+  double dead_ratio = static_cast<double>(storage_options.density_compaction_percent) / 100;
+  auto add_density_collector = [dead_ratio](rocksdb::ColumnFamilyOptions& cf_ops, DensityValueType value_type) {
+    cf_ops.table_properties_collector_factories.push_back(
+        std::make_shared<TombstoneDensityCollectorFactory>(value_type, dead_ratio));
+  };
+  add_density_collector(string_cf_ops, DensityValueType::kStrings);
+  add_density_collector(hash_meta_cf_ops, DensityValueType::kBaseMeta);
+  add_density_collector(hash_data_cf_ops, DensityValueType::kNone);
+  add_density_collector(list_meta_cf_ops, DensityValueType::kListsMeta);
+  add_density_collector(list_data_cf_ops, DensityValueType::kNone);
+  add_density_collector(set_meta_cf_ops, DensityValueType::kBaseMeta);
+  add_density_collector(set_data_cf_ops, DensityValueType::kNone);
+  add_density_collector(zset_meta_cf_ops, DensityValueType::kBaseMeta);
+  add_density_collector(zset_data_cf_ops, DensityValueType::kNone);
+  add_density_collector(zset_score_cf_ops, DensityValueType::kNone);
+  add_density_collector(string_data_cf_ops, DensityValueType::kNone);
+
+  // Prefix bloom filters and memtable prefix blooms on the key and version
+  // prefix of the data keys, so a seek into a missing or deleted collection
+  // stops at the filters. The filters still keep the whole keys for the
+  // point lookups of fields and members.
+  auto data_key_prefix = std::make_shared<DataKeyPrefixTransform>();
+  for (auto* cf_ops : {&hash_data_cf_ops, &set_data_cf_ops, &list_data_cf_ops, &zset_data_cf_ops, &zset_score_cf_ops,
+                       &string_data_cf_ops}) {
+    cf_ops->prefix_extractor = data_key_prefix;
+    if (cf_ops->memtable_prefix_bloom_size_ratio == 0) {
+      cf_ops->memtable_prefix_bloom_size_ratio = kMemtablePrefixBloomSizeRatio;
+    }
+    cf_ops->memtable_whole_key_filtering = true;
+  }
+
   if (append_log_function_) {
     // Add log index table property collector factory to each column family
     ADD_TABLE_PROPERTY_COLLECTOR_FACTORY(string);
@@ -161,10 +238,16 @@ Status Redis::Open(const StorageOptions& storage_options, const std::string& db_
     ADD_TABLE_PROPERTY_COLLECTOR_FACTORY(zset_meta);
     ADD_TABLE_PROPERTY_COLLECTOR_FACTORY(zset_data);
     ADD_TABLE_PROPERTY_COLLECTOR_FACTORY(zset_score);
+    ADD_TABLE_PROPERTY_COLLECTOR_FACTORY(expire_index);
+    ADD_TABLE_PROPERTY_COLLECTOR_FACTORY(string_data);
 
     // Add a listener on flush to purge log index collector
-    db_ops.listeners.push_back(std::make_shared<LogIndexAndSequenceCollectorPurger>(
-        &handles_, &log_index_collector_, &log_index_of_all_cfs_, storage_options.do_snapshot_function));
+    auto do_snapshot = [index = index_, func = storage_options.do_snapshot_function](int64_t log_index, bool sync) {
+      func(index, log_index, sync);
+    };
+    log_index_purger_ = std::make_shared<LogIndexAndSequenceCollectorPurger>(
+        &handles_, &log_index_collector_, &log_index_of_all_cfs_, do_snapshot, storage_options.gap_flush_interval_ms);
+    db_ops.listeners.push_back(log_index_purger_);
   }
 
   std::vector<rocksdb::ColumnFamilyDescriptor> column_families;
@@ -177,20 +260,114 @@ Status Redis::Open(const StorageOptions& storage_options, const std::string& db_
   column_families.emplace_back("set_data_cf", set_data_cf_ops);
   // list CF
   column_families.emplace_back("list_meta_cf", list_meta_cf_ops);
-  column_families.emplace_back("list_data_cf", list_data_cf_ops);
+  column_families.emplace_back(kListsDataCFName, list_data_cf_ops);
   // zset CF
   column_families.emplace_back("zset_meta_cf", zset_meta_cf_ops);
   column_families.emplace_back("zset_data_cf", zset_data_cf_ops);
-  column_families.emplace_back("zset_score_cf", zset_score_cf_ops);
+  column_families.emplace_back(kZSetsScoreCFName, zset_score_cf_ops);
+  // expire index CF
+  column_families.emplace_back("expire_index_cf", expire_index_cf_ops);
+  // string chunk CF
+  column_families.emplace_back("string_data_cf", string_data_cf_ops);
+
+  // the list data and score CFs of an older DB, sorted by the legacy
+  // comparators, are opened last and moved into the bytewise ones below
+  struct LegacyColumnFamily {
+    const char* name;
+    const rocksdb::Comparator* comparator;
+    ColumnFamilyIndex cf_idx;
+    std::string (*to_bytewise)(const Slice&);
+  };
+  const LegacyColumnFamily known_legacy_cfs[] = {
+      {kLegacyListsDataCFName, ListsDataKeyComparator(), kListsDataCF, LegacyListsDataKeyToBytewise},
+      {kLegacyZSetsScoreCFName, ZSetsScoreKeyComparator(), kZsetsScoreCF, LegacyScoreKeyToBytewise},
+  };
+  std::vector<LegacyColumnFamily> legacy_cfs;
+  std::vector<std::string> existing_cfs;
+  if (rocksdb::DB::ListColumnFamilies(db_ops, db_path, &existing_cfs).ok()) {
+    for (const auto& legacy_cf : known_legacy_cfs) {
+      if (std::find(existing_cfs.begin(), existing_cfs.end(), legacy_cf.name) == existing_cfs.end()) {
+        continue;
+      }
+      rocksdb::ColumnFamilyOptions legacy_cf_ops(storage_options.options);
+      legacy_cf_ops.comparator = legacy_cf.comparator;
+      legacy_cf_ops.disable_auto_compactions = true;
+      column_families.emplace_back(legacy_cf.name, legacy_cf_ops);
+      legacy_cfs.push_back(legacy_cf);
+    }
+  }
 
   auto s = rocksdb::DB::Open(db_ops, db_path, column_families, &handles_, &db_);
   if (!s.ok()) {
     return s;
   }
   assert(!handles_.empty());
+  std::vector<rocksdb::ColumnFamilyHandle*> legacy_handles(handles_.end() - legacy_cfs.size(), handles_.end());
+  handles_.resize(handles_.size() - legacy_cfs.size());
+  for (size_t i = 0; i < legacy_cfs.size(); i++) {
+    s = MigrateLegacyColumnFamily(legacy_handles[i], legacy_cfs[i].cf_idx, legacy_cfs[i].to_bytewise);
+    if (!s.ok()) {
+      for (size_t j = i + 1; j < legacy_cfs.size(); j++) {
+        db_->DestroyColumnFamilyHandle(legacy_handles[j]);
+      }
+      return s;
+    }
+  }
   return log_index_of_all_cfs_.Init(this);
 }
 
+Status Redis::MigrateLegacyColumnFamily(rocksdb::ColumnFamilyHandle* legacy_handle, ColumnFamilyIndex cf_idx,
+                                        std::string (*to_bytewise)(const Slice&)) {
+  const std::string& legacy_name = legacy_handle->GetName();
+  // it runs before the DB serves, the logs tell a long open from a stuck one
+  INFO("Migrating the keys of {} in {} to the bytewise encoding", legacy_name, db_->GetName());
+  auto start = std::chrono::steady_clock::now();
+  auto elapsed_s = [&start]() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - start).count();
+  };
+  rocksdb::ReadOptions iterator_options;
+  iterator_options.fill_cache = false;
+  std::unique_ptr<rocksdb::Iterator> iter(db_->NewIterator(iterator_options, legacy_handle));
+  rocksdb::WriteBatch batch;
+  uint64_t migrated = 0;
+  Status s;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    s = batch.Put(handles_[cf_idx], to_bytewise(iter->key()), iter->value());
+    if (s.ok() && batch.Count() >= kMigrationBatchSize) {
+      s = db_->Write(default_write_options_, &batch);
+      batch.Clear();
+    }
+    if (!s.ok()) {
+      break;
+    }
+    if (++migrated % kMigrationProgressKeys == 0) {
+      INFO("Migrated {} keys of {} in {} so far, {}s", migrated, legacy_name, db_->GetName(), elapsed_s());
+    }
+  }
+  if (s.ok()) {
+    s = iter->status();
+  }
+  if (s.ok() && batch.Count() != 0) {
+    s = db_->Write(default_write_options_, &batch);
+  }
+  iter.reset();
+  // the keys must be durable before the legacy CF is dropped, a crash before
+  // the drop migrates them again, which puts the same keys
+  if (s.ok()) {
+    s = db_->Flush(rocksdb::FlushOptions(), handles_[cf_idx]);
+  }
+  if (s.ok()) {
+    s = db_->DropColumnFamily(legacy_handle);
+  }
+  if (!s.ok()) {
+    ERROR("Migrating the keys of {} in {} failed: {}", legacy_name, db_->GetName(), s.ToString());
+  } else {
+    INFO("Migrated {} keys of {} in {}, {}s", migrated, legacy_name, db_->GetName(), elapsed_s());
+  }
+  db_->DestroyColumnFamilyHandle(legacy_handle);
+  return s;
+}
+
 Status Redis::GetScanStartPoint(const DataType& type, const Slice& key, const Slice& pattern, int64_t cursor,
                                 std::string* start_point) {
   std::string index_key;
@@ -228,6 +405,9 @@ Status Redis::CompactRange(const DataType& dtype, const rocksdb::Slice* begin, c
   switch (dtype) {
     case DataType::kStrings:
       s = db_->CompactRange(default_compact_range_options_, begin, end);
+      if (s.ok() && (type == kData || type == kMetaAndData)) {
+        s = db_->CompactRange(default_compact_range_options_, handles_[kStringsDataCF], begin, end);
+      }
       break;
     case DataType::kHashes:
       if (type == kMeta || type == kMetaAndData) {
@@ -319,6 +499,314 @@ Status Redis::AddCompactKeyTaskIfNeeded(const DataType& dtype, const std::string
   return Status::OK();
 }
 
+void Redis::AddExpireIndex(Batch* batch, const DataType& type, const Slice& key, uint64_t etime) {
+  if (etime == 0) {
+    return;
+  }
+  ExpireIndexKey expire_index_key(etime, DataTypeTag[type], key);
+  batch->Put(kExpireIndexCF, expire_index_key.Encode(), Slice());
+}
+
+Status Redis::UpdateMetaWithExpireIndex(const DataType& type, const Slice& key, const Slice& meta_key,
+                                        const Slice& meta_value, uint64_t etime) {
+  ColumnFamilyIndex cf_idx;
+  switch (type) {
+    case DataType::kHashes:
+      cf_idx = kHashesMetaCF;
+      break;
+    case DataType::kSets:
+      cf_idx = kSetsMetaCF;
+      break;
+    case DataType::kLists:
+      cf_idx = kListsMetaCF;
+      break;
+    case DataType::kZSets:
+      cf_idx = kZsetsMetaCF;
+      break;
+    default:
+      cf_idx = kStringsCF;
+  }
+  auto batch = Batch::CreateBatch(this);
+  batch->Put(cf_idx, meta_key, meta_value);
+  AddExpireIndex(batch.get(), type, key, etime);
+  return batch->Commit();
+}
+
+Status Redis::ReapExpiredKeys(size_t limit, std::map<DataType, std::pair<std::string, std::string>>* reaped_ranges,
+                              size_t* reaped) {
+  *reaped = 0;
+  int64_t unix_time;
+  rocksdb::Env::Default()->GetCurrentTime(&unix_time);
+
+  // Collect the due index keys first, the record locks must not be taken
+  // while an iterator pins the expire index.
+  std::vector<std::string> index_keys;
+  {
+    std::string upper_bound_key = ExpireIndexKey::EncodeSeekKey(static_cast<uint64_t>(unix_time));
+    Slice upper_bound(upper_bound_key);
+    rocksdb::ReadOptions iterator_options;
+    iterator_options.fill_cache = false;
+    iterator_options.iterate_upper_bound = &upper_bound;
+    std::unique_ptr<rocksdb::Iterator> iter(db_->NewIterator(iterator_options, handles_[kExpireIndexCF]));
+    for (iter->SeekToFirst(); iter->Valid() && index_keys.size() < limit; iter->Next()) {
+      index_keys.push_back(iter->key().ToString());
+    }
+    if (!iter->status().ok()) {
+      return iter->status();
+    }
+  }
+
+  // The index keys of a pass are reaped in a few batches, each committed once
+  // under the record locks of its keys, so in raft mode a batch is one raft
+  // round trip rather than one per key.
+  for (size_t begin = 0; begin < index_keys.size(); begin += kReapBatchKeys) {
+    size_t end = std::min(index_keys.size(), begin + kReapBatchKeys);
+    std::vector<std::string> keys;
+    for (size_t i = begin; i < end; i++) {
+      keys.push_back(ParsedExpireIndexKey(index_keys[i]).Key().ToString());
+    }
+    MultiScopeRecordLock l(lock_mgr_, keys);
+    auto batch = Batch::CreateBatch(this);
+    // the meta keys deleted by this batch, a key may have several index keys
+    std::set<std::pair<DataType, std::string>> stale_keys;
+    for (size_t i = begin; i < end; i++) {
+      const auto& key = keys[i - begin];
+      DataType type;
+      ColumnFamilyIndex cf_idx;
+      switch (ParsedExpireIndexKey(index_keys[i]).Type()) {
+        case 'k':
+          type = DataType::kStrings;
+          cf_idx = kStringsCF;
+          break;
+        case 'h':
+          type = DataType::kHashes;
+          cf_idx = kHashesMetaCF;
+          break;
+        case 's':
+          type = DataType::kSets;
+          cf_idx = kSetsMetaCF;
+          break;
+        case 'l':
+          type = DataType::kLists;
+          cf_idx = kListsMetaCF;
+          break;
+        case 'z':
+          type = DataType::kZSets;
+          cf_idx = kZsetsMetaCF;
+          break;
+        default:
+          type = DataType::kAll;
+          cf_idx = kExpireIndexCF;
+      }
+      batch->Delete(kExpireIndexCF, index_keys[i]);
+
+      bool stale = false;
+      BaseKey base_key(key);
+      std::string value;
+      Status s;
+      if (type != DataType::kAll) {
+        s = db_->Get(default_read_options_, handles_[cf_idx], base_key.Encode(), &value);
+      }
+      if (s.ok() && !value.empty()) {
+        // The index key only tells when the key was due at the time it was
+        // written, the etime in the meta value is the one that counts.
+        if (type == DataType::kStrings) {
+          stale = ParsedStringsValue(&value).IsStale();
+        } else if (type == DataType::kLists) {
+          stale = ParsedListsMetaValue(&value).IsStale();
+        } else {
+          stale = ParsedBaseMetaValue(&value).IsStale();
+        }
+      } else if (!s.ok() && !s.IsNotFound()) {
+        return s;
+      }
+
+      if (stale && stale_keys.emplace(type, key).second) {
+        // data keys of the deleted meta key are dropped by the data filters
+        batch->Delete(cf_idx, base_key.Encode());
+      }
+    }
+    auto s = batch->Commit();
+    if (!s.ok()) {
+      return s;
+    }
+
+    *reaped += stale_keys.size();
+    for (const auto& [type, key] : stale_keys) {
+      auto iter = reaped_ranges->find(type);
+      if (iter == reaped_ranges->end()) {
+        reaped_ranges->emplace(type, std::make_pair(key, key));
+      } else if (key < iter->second.first) {
+        iter->second.first = key;
+      } else if (key > iter->second.second) {
+        iter->second.second = key;
+      }
+    }
+  }
+  return Status::OK();
+}
+
+Status Redis::CompactExpireIndex() {
+  int64_t unix_time;
+  rocksdb::Env::Default()->GetCurrentTime(&unix_time);
+  std::string end_key = ExpireIndexKey::EncodeSeekKey(static_cast<uint64_t>(unix_time));
+  Slice end(end_key);
+  return db_->CompactRange(default_compact_range_options_, handles_[kExpireIndexCF], nullptr, &end);
+}
+
+Status Redis::PKPrefixRangeDel(const DataType& type, const std::string& prefix, int32_t* ret) {
+  *ret = 0;
+  ColumnFamilyIndex meta_cf;
+  std::vector<ColumnFamilyIndex> data_cfs;
+  switch (type) {
+    case DataType::kStrings:
+      meta_cf = kStringsCF;
+      data_cfs = {kStringsDataCF};
+      break;
+    case DataType::kHashes:
+      meta_cf = kHashesMetaCF;
+      data_cfs = {kHashesDataCF};
+      break;
+    case DataType::kSets:
+      meta_cf = kSetsMetaCF;
+      data_cfs = {kSetsDataCF};
+      break;
+    case DataType::kZSets:
+      meta_cf = kZsetsMetaCF;
+      data_cfs = {kZsetsDataCF, kZsetsScoreCF};
+      break;
+    case DataType::kLists:
+      meta_cf = kListsMetaCF;
+      data_cfs = {kListsDataCF};
+      break;
+    default:
+      return Status::InvalidArgument("Unsupported data types");
+  }
+
+  // the upper bound is never empty since reserve1 is all zero
+  auto bounds = IterateBounds::MetaKeyPrefix(prefix);
+
+  int64_t unix_time;
+  rocksdb::Env::Default()->GetCurrentTime(&unix_time);
+
+  // The writes of a key read its meta value and write it back, so the keys in
+  // the range are deleted under their record locks, otherwise a write that
+  // read a meta value before the range tombstone puts it back after it. The
+  // keys are found by a scan under the locks of the keys the previous scan
+  // found, until no key in the range is left unlocked.
+  //
+  // Count the live keys for the reply. A meta key whose version is not older
+  // than the current second is put back as an empty meta value with a bumped
+  // version, otherwise a key recreated in the same second could get the same
+  // version and see the data keys that are not dropped yet.
+  std::set<std::string> keys;
+  int32_t total_delete = 0;
+  while (true) {
+    MultiScopeRecordLock l(lock_mgr_, std::vector<std::string>(keys.begin(), keys.end()));
+    bool all_locked = true;
+    total_delete = 0;
+    std::vector<std::pair<std::string, std::string>> kept_meta;
+    {
+      rocksdb::ReadOptions iterator_options;
+      const rocksdb::Snapshot* snapshot;
+      ScopeSnapshot ss(db_, &snapshot);
+      iterator_options.snapshot = snapshot;
+      iterator_options.fill_cache = false;
+      std::unique_ptr<rocksdb::Iterator> iter(db_->NewIterator(bounds.Bound(iterator_options), handles_[meta_cf]));
+      for (iter->Seek(bounds.Lower()); iter->Valid(); iter->Next()) {
+        if (keys.insert(ParsedBaseMetaKey(iter->key()).Key().ToString()).second) {
+          all_locked = false;
+        }
+        if (!all_locked) {
+          continue;
+        }
+        std::string value = iter->value().ToString();
+        if (type == DataType::kStrings) {
+          if (!ParsedStringsValue(&value).IsStale()) {
+            total_delete++;
+          }
+        } else if (type == DataType::kLists) {
+          ParsedListsMetaValue parsed_lists_meta_value(&value);
+          if (!parsed_lists_meta_value.IsStale() && parsed_lists_meta_value.Count() != 0) {
+            total_delete++;
+          }
+          if (parsed_lists_meta_value.Version() >= static_cast<uint64_t>(unix_time)) {
+            parsed_lists_meta_value.InitialMetaValue();
+            kept_meta.emplace_back(iter->key().ToString(), std::move(value));
+          }
+        } else {
+          ParsedBaseMetaValue parsed_base_meta_value(&value);
+          if (!parsed_base_meta_value.IsStale() && parsed_base_meta_value.Count() != 0) {
+            total_delete++;
+          }
+          if (parsed_base_meta_value.Version() >= static_cast<uint64_t>(unix_time)) {
+            parsed_base_meta_value.InitialMetaValue();
+            kept_meta.emplace_back(iter->key().ToString(), std::move(value));
+          }
+        }
+      }
+      if (!iter->status().ok()) {
+        return iter->status();
+      }
+    }
+    if (!all_locked) {
+      continue;
+    }
+
+    auto batch = Batch::CreateBatch(this);
+    batch->DeleteRange(meta_cf, bounds.Lower(), bounds.Upper());
+    for (auto data_cf : data_cfs) {
+      batch->DeleteRange(data_cf, bounds.Lower(), bounds.Upper());
+    }
+    for (const auto& [meta_key, meta_value] : kept_meta) {
+      batch->Put(meta_cf, meta_key, meta_value);
+    }
+    Status s = batch->Commit();
+    if (!s.ok()) {
+      return s;
+    }
+    break;
+  }
+  *ret = total_delete;
+
+  // compact the deleted range later in the bg thread
+  storage_->AddBGTask({type, kCompactRange, {prefix, PrefixSuccessor(prefix)}});
+  return Status::OK();
+}
+
+Status Redis::FlushDB() {
+  rocksdb::ReadOptions iterator_options;
+  iterator_options.fill_cache = false;
+  auto batch = Batch::CreateBatch(this);
+  for (size_t idx = 0; idx < handles_.size(); idx++) {
+    // The first and last keys are real keys of the column family, so the
+    // range is valid for the custom comparators too.
+    std::unique_ptr<rocksdb::Iterator> iter(db_->NewIterator(iterator_options, handles_[idx]));
+    iter->SeekToFirst();
+    if (!iter->Valid()) {
+      if (!iter->status().ok()) {
+        return iter->status();
+      }
+      continue;
+    }
+    std::string first_key = iter->key().ToString();
+    iter->SeekToLast();
+    if (!iter->Valid()) {
+      return iter->status();
+    }
+    std::string last_key = iter->key().ToString();
+    auto cf_idx = static_cast<ColumnFamilyIndex>(idx);
+    if (first_key != last_key) {
+      batch->DeleteRange(cf_idx, first_key, last_key);
+    }
+    batch->Delete(cf_idx, last_key);
+  }
+  if (batch->Count() == 0) {
+    return Status::OK();
+  }
+  return batch->Commit();
+}
+
 Status Redis::SetOptions(const OptionType& option_type, const std::unordered_map<std::string, std::string>& options) {
   if (option_type == OptionType::kDB) {
     return db_->SetDBOptions(options);
@@ -423,6 +911,67 @@ Status Redis::GetProperty(const std::string& property, uint64_t* out) {
   return Status::OK();
 }
 
+Status Redis::GetSpaceUsage(SpaceUsage* usage) {
+  usage->inst_index = index_;
+  db_->GetAggregatedIntProperty(rocksdb::DB::Properties::kTotalSstFilesSize, &usage->sst_files_size);
+  db_->GetAggregatedIntProperty(rocksdb::DB::Properties::kEstimateLiveDataSize, &usage->live_data_size);
+  usage->entries = 0;
+  usage->dead_entries = 0;
+  for (auto handle : handles_) {
+    rocksdb::TablePropertiesCollection collection;
+    auto s = db_->GetPropertiesOfAllTables(handle, &collection);
+    if (!s.ok()) {
+      return s;
+    }
+    for (const auto& [file, props] : collection) {
+      auto density = TombstoneDensityCollector::ReadFromTableProps(*props);
+      if (density.has_value()) {
+        usage->entries += density->entries;
+        usage->dead_entries += density->Dead();
+      }
+    }
+  }
+  return Status::OK();
+}
+
+Status Redis::GetDensityCompactionRanges(double dead_ratio, std::vector<DensityCompactionRange>* ranges) {
+  for (size_t idx = 0; idx < handles_.size(); idx++) {
+    // the expire index is compacted by the expire reaper
+    if (idx == kExpireIndexCF) {
+      continue;
+    }
+    rocksdb::TablePropertiesCollection collection;
+    auto s = db_->GetPropertiesOfAllTables(handles_[idx], &collection);
+    if (!s.ok()) {
+      return s;
+    }
+    auto cf_idx = static_cast<ColumnFamilyIndex>(idx);
+    for (const auto& [file, props] : collection) {
+      auto density = TombstoneDensityCollector::ReadFromTableProps(*props);
+      if (!density.has_value() || density->entries < TombstoneDensityCollector::kWindowEntries ||
+          density->first_key.empty()) {
+        continue;
+      }
+      if (static_cast<double>(density->Dead()) >= static_cast<double>(density->entries) * dead_ratio) {
+        ranges->push_back({cf_idx, density->first_key, density->last_key, density->Dead()});
+      } else if (static_cast<double>(density->window_dead) >=
+                 static_cast<double>(TombstoneDensityCollector::kWindowEntries) * dead_ratio) {
+        ranges->push_back({cf_idx, density->window_start, density->window_end, density->window_dead});
+      }
+    }
+  }
+  return Status::OK();
+}
+
+Status Redis::CompactColumnFamilyRange(const DensityCompactionRange& range) {
+  // the range is a part of one level, don't move the output to another level
+  rocksdb::CompactRangeOptions compact_range_options;
+  compact_range_options.exclusive_manual_compaction = false;
+  Slice begin(range.start_key);
+  Slice end(range.end_key);
+  return db_->CompactRange(compact_range_options, handles_[range.cf_idx], &begin, &end);
+}
+
 Status Redis::ScanKeyNum(std::vector<KeyInfo>* key_infos) {
   key_infos->resize(5);
   rocksdb::Status s;
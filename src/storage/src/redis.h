@@ -33,6 +33,18 @@ namespace storage {
 using Status = rocksdb::Status;
 using Slice = rocksdb::Slice;
 
+class Batch;
+class HyperLogLog;
+class StringsChunkMeta;
+
+// a key range of one column family picked for a density compaction
+struct DensityCompactionRange {
+  ColumnFamilyIndex cf_idx;
+  std::string start_key;
+  std::string end_key;
+  uint64_t dead_entries = 0;
+};
+
 class Redis {
  public:
   Redis(Storage* storage, int32_t index);
@@ -106,6 +118,14 @@ class Redis {
                               const ColumnFamilyType& type = kMetaAndData);
 
   virtual Status GetProperty(const std::string& property, uint64_t* out);
+  Status GetSpaceUsage(SpaceUsage* usage);
+  // Collects the SST files, or the densest windows of them, whose share of
+  // deletes and expired entries is at least dead_ratio
+  Status GetDensityCompactionRanges(double dead_ratio, std::vector<DensityCompactionRange>* ranges);
+  Status CompactColumnFamilyRange(const DensityCompactionRange& range);
+  // Drops the ZPopMin/ZPopMax hints of key, called by every write that may
+  // add a score key to it
+  void InvalidateZSetPopHints(const Slice& key);
   bool IsApplied(size_t cf_idx, LogIndex logidx) const { return log_index_of_all_cfs_.IsApplied(cf_idx, logidx); }
   void UpdateAppliedLogIndexOfColumnFamily(size_t cf_idx, LogIndex logidx, SequenceNumber seqno) {
     log_index_of_all_cfs_.Update(cf_idx, logidx, seqno);
@@ -125,6 +145,11 @@ class Redis {
   virtual Status HashesPKPatternMatchDel(const std::string& pattern, int32_t* ret);
   virtual Status ZsetsPKPatternMatchDel(const std::string& pattern, int32_t* ret);
   virtual Status SetsPKPatternMatchDel(const std::string& pattern, int32_t* ret);
+  // Deletes the keys of `type` starting with `prefix` with range tombstones,
+  // used by the *PKPatternMatchDel when the pattern is a prefix followed by '*'
+  Status PKPrefixRangeDel(const DataType& type, const std::string& prefix, int32_t* ret);
+  // Deletes every key of this instance with one range tombstone per column family
+  Status FlushDB();
 
   // Keys Commands
   virtual Status StringsExpire(const Slice& key, uint64_t ttl);
@@ -201,6 +226,11 @@ class Redis {
   Status BitPos(const Slice& key, int32_t bit, int64_t start_offset, int64_t end_offset, int64_t* ret);
   Status PKSetexAt(const Slice& key, const Slice& value, uint64_t timestamp);
 
+  // HyperLogLog Commands, a HyperLogLog is a string value and keeps its etime
+  Status PfAdd(const Slice& key, const std::vector<std::string>& values, bool* update);
+  // merges sources into the HyperLogLog of key, value gets the merged one
+  Status PfMerge(const Slice& key, const HyperLogLog& sources, std::string* value);
+
   // Hash Commands
   Status HDel(const Slice& key, const std::vector<std::string>& fields, int32_t* ret);
   Status HExists(const Slice& key, const Slice& field);
@@ -313,6 +343,20 @@ class Redis {
   Status ZPopMax(const Slice& key, int64_t count, std::vector<ScoreMember>* score_members);
   Status ZPopMin(const Slice& key, int64_t count, std::vector<ScoreMember>* score_members);
 
+  // Expire index
+  void AddExpireIndex(Batch* batch, const DataType& type, const Slice& key, uint64_t etime);
+  Status UpdateMetaWithExpireIndex(const DataType& type, const Slice& key, const Slice& meta_key,
+                                   const Slice& meta_value, uint64_t etime);
+  // Deletes at most `limit` keys that are due according to the expire index,
+  // committed in batches of kReapBatchKeys index keys.
+  // The user key range of the deleted keys is merged into `reaped_ranges`
+  // per data type, so that the caller can compact it.
+  Status ReapExpiredKeys(size_t limit, std::map<DataType, std::pair<std::string, std::string>>* reaped_ranges,
+                         size_t* reaped);
+  static constexpr size_t kReapBatchKeys = 256;
+  // Compacts away the tombstones the reaper left at the head of the expire index
+  Status CompactExpireIndex();
+
   void ScanDatabase();
   void ScanStrings();
   void ScanHashes();
@@ -320,8 +364,15 @@ class Redis {
   void ScanZsets();
   void ScanSets();
 
-  void UpdateLogIndex(LogIndex applied_log_index, SequenceNumber seqno) {
-    log_index_collector_.Update(applied_log_index, seqno);
+  void UpdateLogIndex(LogIndex applied_log_index, SequenceNumber seqno, uint64_t log_bytes) {
+    log_index_collector_.Update(applied_log_index, seqno, log_bytes);
+  }
+  // keeps the raft logs a restart replays under the limits, see
+  // LogIndexAndSequenceCollectorPurger::FlushOldestCFIfPending
+  void FlushOldestCFIfPending() {
+    if (log_index_purger_) {
+      log_index_purger_->FlushOldestCFIfPending(db_);
+    }
   }
 
   TypeIterator* CreateIterator(const DataType& type, const std::string& pattern, const Slice* lower_bound,
@@ -337,7 +388,7 @@ class Redis {
     options.iterate_upper_bound = upper_bound;
     switch (type) {
       case 'k':
-        return new StringsIterator(options, db_, handles_[kStringsCF], pattern);
+        return new StringsIterator(options, db_, handles_[kStringsCF], handles_[kStringsDataCF], pattern);
         break;
       case 'h':
         return new HashesIterator(options, db_, handles_[kHashesMetaCF], pattern);
@@ -377,6 +428,11 @@ class Redis {
   // For Scan
   std::unique_ptr<LRUCache<std::string, std::string>> scan_cursors_store_;
   std::unique_ptr<LRUCache<std::string, size_t>> spop_counts_store_;
+  // For ZPopMin/ZPopMax, the score key of the first live member after the
+  // last pop from that end, so that the next pop seeks past the tombstones
+  std::unique_ptr<LRUCache<std::string, std::string>> zset_pop_hints_;
+  void SeekKeyFromPopHint(const std::string& hint_key, const Slice& key, uint64_t version, std::string* seek_key);
+  void UpdateZSetPopHint(const Status& s, const std::string& hint_key, const std::string& next_hint);
 
   Status GetScanStartPoint(const DataType& type, const Slice& key, const Slice& pattern, int64_t cursor,
                            std::string* start_point);
@@ -393,8 +449,37 @@ class Redis {
   AppendLogFunction append_log_function_;
   LogIndexAndSequenceCollector log_index_collector_;
   LogIndexOfColumnFamilies log_index_of_all_cfs_;
+  std::shared_ptr<LogIndexAndSequenceCollectorPurger> log_index_purger_;
   bool is_starting_{true};
 
+  // moves the keys of a CF of a legacy encoding into the bytewise CF cf_idx
+  // and drops the legacy CF, legacy_handle is destroyed
+  Status MigrateLegacyColumnFamily(rocksdb::ColumnFamilyHandle* legacy_handle, ColumnFamilyIndex cf_idx,
+                                   std::string (*to_bytewise)(const Slice&));
+
+  // Replaces the value of key read from the strings CF with its user value,
+  // the one of a chunked value is read from its chunks
+  Status StringsUserValue(const Slice& key, std::string* value);
+  // Reads the HyperLogLog of key into log and its etime into etime, the
+  // caller holds the record lock of key
+  Status GetHyperLogLog(const Slice& key, HyperLogLog* log, uint64_t* etime);
+  // Puts data at offset of the chunked value of key, the chunks that already
+  // hold bytes of the value are read and rewritten, chunk_meta gets the new length
+  Status PutStringsChunks(Batch* batch, const Slice& key, StringsChunkMeta* chunk_meta, uint64_t offset,
+                          const Slice& data);
+  // Writes data at offset of the string value of key, meta_value is its value
+  // in the strings CF, empty if there is none. A value that is not chunked
+  // yet is split into chunks, under a version past replaced_version, the one
+  // of the chunks of a stale value meta_value replaces. length gets the new
+  // length of the value.
+  Status SetStringsChunkRange(Batch* batch, const Slice& key, std::string* meta_value, uint64_t replaced_version,
+                              uint64_t offset, const Slice& data, uint64_t* length);
+  // Copies the chunks of the chunked value of key to newkey of new_inst under
+  // a new version in batch, past the one of the chunks newkey has. value is
+  // the value of key in the strings CF and becomes the one of newkey
+  Status CopyStringsChunks(const Slice& key, Redis* new_inst, const Slice& newkey, std::string* value,
+                           rocksdb::WriteBatch* batch);
+
   Status UpdateSpecificKeyStatistics(const DataType& dtype, const std::string& key, uint64_t count);
   Status UpdateSpecificKeyDuration(const DataType& dtype, const std::string& key, uint64_t duration);
   Status AddCompactKeyTaskIfNeeded(const DataType& dtype, const std::string& key, uint64_t count, uint64_t duration);
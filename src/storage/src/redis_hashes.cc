@@ -17,6 +17,7 @@
 #include "src/base_data_key_format.h"
 #include "src/base_data_value_format.h"
 #include "src/base_filter.h"
+#include "src/iterate_bounds.h"
 #include "src/scope_record_lock.h"
 #include "src/scope_snapshot.h"
 #include "storage/storage_define.h"
@@ -61,6 +62,10 @@ Status Redis::ScanHashesKeyNum(KeyInfo* key_info) {
 }
 
 Status Redis::HashesPKPatternMatchDel(const std::string& pattern, int32_t* ret) {
+  if (pattern == "*" || isTailWildcard(pattern)) {
+    return PKPrefixRangeDel(DataType::kHashes, pattern.substr(0, pattern.size() - 1), ret);
+  }
+
   rocksdb::ReadOptions iterator_options;
   const rocksdb::Snapshot* snapshot;
   ScopeSnapshot ss(db_, &snapshot);
@@ -77,9 +82,11 @@ Status Redis::HashesPKPatternMatchDel(const std::string& pattern, int32_t* ret)
   while (iter->Valid()) {
     key = iter->key().ToString();
     meta_value = iter->value().ToString();
+    ParsedBaseMetaKey parsed_meta_key(&key);
     ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
     if (!parsed_hashes_meta_value.IsStale() && (parsed_hashes_meta_value.Count() != 0) &&
-        (StringMatch(pattern.data(), pattern.size(), key.data(), key.size(), 0) != 0)) {
+        (StringMatch(pattern.data(), pattern.size(), parsed_meta_key.Key().data(), parsed_meta_key.Key().size(), 0) !=
+         0)) {
       parsed_hashes_meta_value.InitialMetaValue();
       batch.Put(handles_[kHashesMetaCF], key, meta_value);
     }
@@ -227,7 +234,8 @@ Status Redis::HGetall(const Slice& key, std::vector<FieldValue>* fvs) {
       HashesDataKey hashes_data_key(key, version, "");
       Slice prefix = hashes_data_key.EncodeSeekKey();
       KeyStatisticsDurationGuard guard(this, DataType::kHashes, key.ToString());
-      auto iter = db_->NewIterator(read_options, handles_[kHashesDataCF]);
+      auto bounds = IterateBounds::Prefix(prefix);
+      auto iter = db_->NewIterator(bounds.Bound(read_options), handles_[kHashesDataCF]);
       for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
         ParsedHashesDataKey parsed_hashes_data_key(iter->key());
         ParsedBaseDataValue parsed_internal_value(iter->value());
@@ -270,7 +278,8 @@ Status Redis::HGetallWithTTL(const Slice& key, std::vector<FieldValue>* fvs, uin
       HashesDataKey hashes_data_key(key, version, "");
       Slice prefix = hashes_data_key.EncodeSeekKey();
       KeyStatisticsDurationGuard guard(this, DataType::kHashes, key.ToString());
-      auto iter = db_->NewIterator(read_options, handles_[kHashesDataCF]);
+      auto bounds = IterateBounds::Prefix(prefix);
+      auto iter = db_->NewIterator(bounds.Bound(read_options), handles_[kHashesDataCF]);
       for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
         ParsedHashesDataKey parsed_hashes_data_key(iter->key());
         ParsedBaseDataValue parsed_internal_value(iter->value());
@@ -305,7 +314,8 @@ Status Redis::HIncrby(const Slice& key, const Slice& field, int64_t value, int64
       batch.Put(handles_[kHashesMetaCF], base_meta_key.Encode(), meta_value);
       HashesDataKey hashes_data_key(key, version, field);
       Int64ToStr(value_buf, 32, value);
-      batch.Put(handles_[kHashesDataCF], hashes_data_key.Encode(), value_buf);
+      BaseDataValue internal_value(value_buf);
+      batch.Put(handles_[kHashesDataCF], hashes_data_key.Encode(), internal_value.Encode());
       *ret = value;
     } else {
       version = parsed_hashes_meta_value.Version();
@@ -462,7 +472,8 @@ Status Redis::HKeys(const Slice& key, std::vector<std::string>* fields) {
       HashesDataKey hashes_data_key(key, version, "");
       Slice prefix = hashes_data_key.EncodeSeekKey();
       KeyStatisticsDurationGuard guard(this, DataType::kHashes, key.ToString());
-      auto iter = db_->NewIterator(read_options, handles_[kHashesDataCF]);
+      auto bounds = IterateBounds::Prefix(prefix);
+      auto iter = db_->NewIterator(bounds.Bound(read_options), handles_[kHashesDataCF]);
       for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
         ParsedHashesDataKey parsed_hashes_data_key(iter->key());
         fields->push_back(parsed_hashes_data_key.field().ToString());
@@ -756,7 +767,8 @@ Status Redis::HVals(const Slice& key, std::vector<std::string>* values) {
       HashesDataKey hashes_data_key(key, version, "");
       Slice prefix = hashes_data_key.EncodeSeekKey();
       KeyStatisticsDurationGuard guard(this, DataType::kHashes, key.ToString());
-      auto iter = db_->NewIterator(read_options, handles_[kHashesDataCF]);
+      auto bounds = IterateBounds::Prefix(prefix);
+      auto iter = db_->NewIterator(bounds.Bound(read_options), handles_[kHashesDataCF]);
       for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
         ParsedBaseDataValue parsed_internal_value(iter->value());
         values->push_back(parsed_internal_value.UserValue().ToString());
@@ -822,7 +834,8 @@ Status Redis::HScan(const Slice& key, int64_t cursor, const std::string& pattern
       HashesDataKey hashes_start_data_key(key, version, start_point);
       std::string prefix = hashes_data_prefix.EncodeSeekKey().ToString();
       KeyStatisticsDurationGuard guard(this, DataType::kHashes, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kHashesDataCF]);
+      auto bounds = IterateBounds::Prefix(prefix);
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kHashesDataCF]);
       for (iter->Seek(hashes_start_data_key.Encode()); iter->Valid() && rest > 0 && iter->key().starts_with(prefix);
            iter->Next()) {
         ParsedHashesDataKey parsed_hashes_data_key(iter->key());
@@ -876,7 +889,8 @@ Status Redis::HScanx(const Slice& key, const std::string& start_field, const std
       HashesDataKey hashes_start_data_key(key, version, start_field);
       std::string prefix = hashes_data_prefix.EncodeSeekKey().ToString();
       KeyStatisticsDurationGuard guard(this, DataType::kHashes, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kHashesDataCF]);
+      auto bounds = IterateBounds::Prefix(prefix);
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kHashesDataCF]);
       for (iter->Seek(hashes_start_data_key.Encode()); iter->Valid() && rest > 0 && iter->key().starts_with(prefix);
            iter->Next()) {
         ParsedHashesDataKey parsed_hashes_data_key(iter->key());
@@ -952,8 +966,9 @@ Status Redis::HRandField(const Slice& key, int64_t count, bool with_values, std:
   }
 
   HashesDataKey hashes_data_key(key, parsed_hashes_meta_value.Version(), "");
+  auto bounds = IterateBounds::Prefix(hashes_data_key.EncodeSeekKey());
   Slice prefix = hashes_data_key.Encode();
-  auto tmp_iter = db_->NewIterator(default_read_options_, handles_[kHashesDataCF]);
+  auto tmp_iter = db_->NewIterator(bounds.Bound(default_read_options_), handles_[kHashesDataCF]);
   std::unique_ptr<rocksdb::Iterator> iter{tmp_iter};
   iter->Seek(prefix);
   uint32_t save_idx{};
@@ -1008,7 +1023,8 @@ Status Redis::PKHScanRange(const Slice& key, const Slice& field_start, const std
       HashesDataKey hashes_start_data_key(key, version, field_start);
       std::string prefix = hashes_data_prefix.EncodeSeekKey().ToString();
       KeyStatisticsDurationGuard guard(this, DataType::kHashes, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kHashesDataCF]);
+      auto bounds = IterateBounds::Prefix(prefix);
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kHashesDataCF]);
       for (iter->Seek(start_no_limit ? prefix : hashes_start_data_key.Encode());
            iter->Valid() && remain > 0 && iter->key().starts_with(prefix); iter->Next()) {
         ParsedHashesDataKey parsed_hashes_data_key(iter->key());
@@ -1065,15 +1081,20 @@ Status Redis::PKHRScanRange(const Slice& key, const Slice& field_start, const st
       return Status::NotFound();
     } else {
       uint64_t version = parsed_hashes_meta_value.Version();
-      int32_t start_key_version = start_no_limit ? version + 1 : version;
-      std::string start_key_field = start_no_limit ? "" : field_start.ToString();
       HashesDataKey hashes_data_prefix(key, version, Slice());
-      HashesDataKey hashes_start_data_key(key, start_key_version, start_key_field);
+      HashesDataKey hashes_start_data_key(key, version, field_start);
       std::string prefix = hashes_data_prefix.EncodeSeekKey().ToString();
       KeyStatisticsDurationGuard guard(this, DataType::kHashes, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kHashesDataCF]);
-      for (iter->SeekForPrev(hashes_start_data_key.Encode().ToString());
-           iter->Valid() && remain > 0 && iter->key().starts_with(prefix); iter->Prev()) {
+      auto bounds = IterateBounds::Prefix(prefix);
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kHashesDataCF]);
+      // stay in the prefix of the key, the prefix bloom filters are checked
+      // with the prefix of the seek target
+      if (start_no_limit) {
+        iter->SeekToLast();
+      } else {
+        iter->SeekForPrev(hashes_start_data_key.Encode());
+      }
+      for (; iter->Valid() && remain > 0 && iter->key().starts_with(prefix); iter->Prev()) {
         ParsedHashesDataKey parsed_hashes_data_key(iter->key());
         std::string field = parsed_hashes_data_key.field().ToString();
         if (!end_no_limit && field.compare(field_end) < 0) {
@@ -1116,10 +1137,12 @@ Status Redis::HashesExpire(const Slice& key, uint64_t ttl) {
 
     if (ttl > 0) {
       parsed_hashes_meta_value.SetRelativeTimestamp(ttl);
-      s = db_->Put(default_write_options_, handles_[kHashesMetaCF], base_meta_key.Encode(), meta_value);
+      s = UpdateMetaWithExpireIndex(DataType::kHashes, key, base_meta_key.Encode(), meta_value,
+                                    parsed_hashes_meta_value.Etime());
     } else {
       parsed_hashes_meta_value.InitialMetaValue();
-      s = db_->Put(default_write_options_, handles_[kHashesMetaCF], base_meta_key.Encode(), meta_value);
+      s = UpdateMetaWithExpireIndex(DataType::kHashes, key, base_meta_key.Encode(), meta_value,
+                                    parsed_hashes_meta_value.Etime());
     }
   }
   return s;
@@ -1165,7 +1188,8 @@ Status Redis::HashesExpireat(const Slice& key, uint64_t timestamp) {
       } else {
         parsed_hashes_meta_value.InitialMetaValue();
       }
-      s = db_->Put(default_write_options_, handles_[kHashesMetaCF], base_meta_key.Encode(), meta_value);
+      s = UpdateMetaWithExpireIndex(DataType::kHashes, key, base_meta_key.Encode(), meta_value,
+                                    parsed_hashes_meta_value.Etime());
     }
   }
   return s;
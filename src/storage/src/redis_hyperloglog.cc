@@ -6,49 +6,305 @@
 #include "src/redis_hyperloglog.h"
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <string>
 #include "src/storage_murmur3.h"
 
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#  include <arm_neon.h>
+#endif
+
 namespace storage {
 
 const int32_t HLL_HASH_SEED = 313;
+const char kHyperLogLogMagic[] = "HYLL";
+
+namespace {
+
+// dst[i] = max(dst[i], src[i]), 16 registers at a time where the CPU can
+void MaxRegisters(uint8_t* dst, const uint8_t* src, size_t n) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 16 <= n; i += 16) {
+    __m128i vec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+    __m128i src_vec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_max_epu8(vec, src_vec));
+  }
+#elif defined(__ARM_NEON)
+  for (; i + 16 <= n; i += 16) {
+    vst1q_u8(dst + i, vmaxq_u8(vld1q_u8(dst + i), vld1q_u8(src + i)));
+  }
+#endif
+  for (; i < n; i++) {
+    dst[i] = std::max(dst[i], src[i]);
+  }
+}
+
+// appends the sparse opcodes of a run of zero registers
+void AppendZeroRun(uint32_t len, std::string* dst) {
+  while (len > 64) {
+    uint32_t run = std::min<uint32_t>(len, 16384);
+    dst->push_back(static_cast<char>(0x40 | ((run - 1) >> 8)));
+    dst->push_back(static_cast<char>((run - 1) & 0xff));
+    len -= run;
+  }
+  if (len > 0) {
+    dst->push_back(static_cast<char>(len - 1));
+  }
+}
 
-HyperLogLog::HyperLogLog(uint8_t precision, std::string origin_register) {
+}  // namespace
+
+HyperLogLog::HyperLogLog(uint8_t precision) {
   b_ = precision;
   m_ = 1 << precision;
   alpha_ = Alpha();
-  register_ = std::make_unique<char[]>(m_);
-  for (uint32_t i = 0; i < m_; ++i) {
-    register_[i] = 0;
+}
+
+bool HyperLogLog::Decode(const std::string& value) {
+  sparse_ = true;
+  sparse_registers_.clear();
+  registers_.clear();
+  if (value.empty()) {
+    return true;
   }
-  if (!origin_register.empty()) {
-    for (uint32_t i = 0; i < m_; ++i) {
-      register_[i] = origin_register[i];
+  if (value.size() >= kHeaderLength && memcmp(value.data(), kHyperLogLogMagic, 4) == 0) {
+    if (static_cast<uint8_t>(value[5]) != b_) {
+      return false;
     }
+    const char* ptr = value.data() + kHeaderLength;
+    size_t len = value.size() - kHeaderLength;
+    switch (value[4]) {
+      case kSparse:
+        return DecodeSparse(ptr, len);
+      case kDense:
+        return DecodeDense(ptr, len);
+      default:
+        return false;
+    }
+  }
+  // one byte per register
+  if (value.size() != m_) {
+    return false;
   }
+  sparse_ = false;
+  registers_.assign(value.begin(), value.end());
+  return std::all_of(registers_.begin(), registers_.end(), [this](uint8_t reg) { return reg <= 32 - b_ + 1; });
 }
 
-HyperLogLog::~HyperLogLog() = default;
+bool HyperLogLog::DecodeSparse(const char* ptr, size_t len) {
+  uint32_t index = 0;
+  for (size_t i = 0; i < len; i++) {
+    auto op = static_cast<uint8_t>(ptr[i]);
+    if ((op & 0xc0) == 0) {
+      index += (op & 0x3f) + 1;
+    } else if ((op & 0xc0) == 0x40) {
+      if (++i == len) {
+        return false;
+      }
+      index += (((op & 0x3f) << 8) | static_cast<uint8_t>(ptr[i])) + 1;
+    } else {
+      auto reg = static_cast<uint8_t>(((op >> 2) & 0x1f) + 1);
+      uint32_t run = (op & 0x3) + 1;
+      if (index + run > m_) {
+        return false;
+      }
+      for (uint32_t j = 0; j < run; j++) {
+        sparse_registers_.emplace_back(index + j, reg);
+      }
+      index += run;
+    }
+    if (index > m_) {
+      return false;
+    }
+  }
+  if (index != m_) {
+    return false;
+  }
+  if (sparse_registers_.size() > kSparseMaxBytes) {
+    ToDense();
+  }
+  return true;
+}
+
+bool HyperLogLog::DecodeDense(const char* ptr, size_t len) {
+  if (len != m_ / 4 * 3) {
+    return false;
+  }
+  sparse_ = false;
+  registers_.resize(m_);
+  auto src = reinterpret_cast<const uint8_t*>(ptr);
+  // 4 registers in every 3 bytes
+  for (uint32_t i = 0; i < m_; i += 4, src += 3) {
+    uint32_t word = src[0] | (src[1] << 8) | (src[2] << 16);
+    registers_[i] = word & 0x3f;
+    registers_[i + 1] = (word >> 6) & 0x3f;
+    registers_[i + 2] = (word >> 12) & 0x3f;
+    registers_[i + 3] = (word >> 18) & 0x3f;
+  }
+  return true;
+}
+
+std::string HyperLogLog::Encode() const {
+  std::string result(kHyperLogLogMagic, 4);
+  result.push_back(kSparse);
+  result.push_back(static_cast<char>(b_));
+  result.append(2, '\0');
+  if (sparse_) {
+    uint32_t next = 0;
+    for (size_t i = 0; i < sparse_registers_.size();) {
+      auto [index, reg] = sparse_registers_[i];
+      AppendZeroRun(index - next, &result);
+      // up to 4 registers of the same value in a row
+      size_t run = 1;
+      while (run < 4 && i + run < sparse_registers_.size() && sparse_registers_[i + run].first == index + run &&
+             sparse_registers_[i + run].second == reg) {
+        run++;
+      }
+      result.push_back(static_cast<char>(0x80 | ((reg - 1) << 2) | (run - 1)));
+      next = index + run;
+      i += run;
+    }
+    AppendZeroRun(m_ - next, &result);
+    if (result.size() <= kHeaderLength + kSparseMaxBytes) {
+      return result;
+    }
+    HyperLogLog dense(*this);
+    dense.ToDense();
+    return dense.Encode();
+  }
+
+  result[4] = kDense;
+  result.resize(kHeaderLength + m_ / 4 * 3);
+  auto dst = reinterpret_cast<uint8_t*>(result.data() + kHeaderLength);
+  for (uint32_t i = 0; i < m_; i += 4, dst += 3) {
+    uint32_t word = registers_[i] | (registers_[i + 1] << 6) | (registers_[i + 2] << 12) | (registers_[i + 3] << 18);
+    dst[0] = word & 0xff;
+    dst[1] = (word >> 8) & 0xff;
+    dst[2] = (word >> 16) & 0xff;
+  }
+  return result;
+}
 
-std::string HyperLogLog::Add(const char* value, uint32_t len) {
+std::pair<uint32_t, uint8_t> HyperLogLog::Register(const char* value, uint32_t len) const {
   uint32_t hash_value;
   MurmurHash3_x86_32(value, static_cast<int32_t>(len), HLL_HASH_SEED, static_cast<void*>(&hash_value));
   uint32_t index = hash_value & ((1 << b_) - 1);
-  uint8_t rank = Nctz((hash_value >> b_), static_cast<int32_t>(32 - b_));
-  if (rank > register_[index]) {
-    register_[index] = static_cast<char>(rank);
+  // the number of trailing zeros of the rest of the hash, plus one
+  uint32_t rest = hash_value >> b_;
+  auto rank = static_cast<uint8_t>(std::min<uint32_t>(32 - b_, rest == 0 ? 32 : __builtin_ctz(rest)) + 1);
+  return {index, rank};
+}
+
+bool HyperLogLog::Add(const char* value, uint32_t len) {
+  auto [index, rank] = Register(value, len);
+  if (!sparse_) {
+    if (rank <= registers_[index]) {
+      return false;
+    }
+    registers_[index] = rank;
+    return true;
   }
-  std::string result(m_, 0);
-  for (uint32_t i = 0; i < m_; ++i) {
-    result[i] = register_[i];
+  auto it = std::lower_bound(sparse_registers_.begin(), sparse_registers_.end(), std::make_pair(index, uint8_t{0}));
+  if (it != sparse_registers_.end() && it->first == index) {
+    if (rank <= it->second) {
+      return false;
+    }
+    it->second = rank;
+    return true;
+  }
+  sparse_registers_.insert(it, std::make_pair(index, rank));
+  if (sparse_registers_.size() > kSparseMaxBytes) {
+    ToDense();
+  }
+  return true;
+}
+
+void HyperLogLog::Merge(const HyperLogLog& hll) {
+  if (m_ != hll.m_) {
+    return;
+  }
+  if (!hll.sparse_) {
+    ToDense();
+    MaxRegisters(registers_.data(), hll.registers_.data(), m_);
+    return;
+  }
+  if (!sparse_) {
+    for (auto [index, reg] : hll.sparse_registers_) {
+      registers_[index] = std::max(registers_[index], reg);
+    }
+    return;
+  }
+  std::vector<std::pair<uint32_t, uint8_t>> merged;
+  merged.reserve(sparse_registers_.size() + hll.sparse_registers_.size());
+  auto it = sparse_registers_.begin();
+  auto other = hll.sparse_registers_.begin();
+  while (it != sparse_registers_.end() || other != hll.sparse_registers_.end()) {
+    if (other == hll.sparse_registers_.end() || (it != sparse_registers_.end() && it->first < other->first)) {
+      merged.push_back(*it++);
+    } else if (it == sparse_registers_.end() || other->first < it->first) {
+      merged.push_back(*other++);
+    } else {
+      merged.emplace_back(it->first, std::max(it->second, other->second));
+      ++it;
+      ++other;
+    }
+  }
+  sparse_registers_ = std::move(merged);
+  if (sparse_registers_.size() > kSparseMaxBytes) {
+    ToDense();
   }
-  return result;
+}
+
+void HyperLogLog::ToDense() {
+  if (!sparse_) {
+    return;
+  }
+  sparse_ = false;
+  registers_.assign(m_, 0);
+  for (auto [index, reg] : sparse_registers_) {
+    registers_[index] = reg;
+  }
+  sparse_registers_.clear();
+  sparse_registers_.shrink_to_fit();
 }
 
 double HyperLogLog::Estimate() const {
-  double estimate = FirstEstimate();
+  // the registers of each value, summed once per value instead of once per
+  // register
+  uint32_t histogram[64] = {0};
+  if (sparse_) {
+    histogram[0] = m_ - static_cast<uint32_t>(sparse_registers_.size());
+    for (auto [index, reg] : sparse_registers_) {
+      histogram[reg]++;
+    }
+  } else {
+    // four histograms break the dependency between neighbouring registers
+    uint32_t partial[4][64] = {{0}};
+    uint32_t i = 0;
+    for (; i + 4 <= m_; i += 4) {
+      partial[0][registers_[i]]++;
+      partial[1][registers_[i + 1]]++;
+      partial[2][registers_[i + 2]]++;
+      partial[3][registers_[i + 3]]++;
+    }
+    for (; i < m_; i++) {
+      partial[0][registers_[i]]++;
+    }
+    for (int reg = 0; reg < 64; reg++) {
+      histogram[reg] = partial[0][reg] + partial[1][reg] + partial[2][reg] + partial[3][reg];
+    }
+  }
+
+  double sum = 0.0;
+  for (int reg = 63; reg >= 0; reg--) {
+    sum += ldexp(histogram[reg], -reg);
+  }
+  double estimate = alpha_ * m_ * m_ / sum;
   if (estimate <= 2.5 * m_) {
-    uint32_t zeros = CountZero();
+    uint32_t zeros = histogram[0];
     if (zeros != 0) {
       estimate = m_ * log(static_cast<double>(m_) / zeros);
     }
@@ -58,17 +314,6 @@ double HyperLogLog::Estimate() const {
   return estimate;
 }
 
-double HyperLogLog::FirstEstimate() const {
-  double estimate;
-  double sum = 0.0;
-  for (uint32_t i = 0; i < m_; i++) {
-    sum += 1.0 / (1 << register_[i]);
-  }
-
-  estimate = alpha_ * m_ * m_ / sum;
-  return estimate;
-}
-
 double HyperLogLog::Alpha() const {
   switch (m_) {
     case 16:
@@ -82,34 +327,4 @@ double HyperLogLog::Alpha() const {
   }
 }
 
-uint32_t HyperLogLog::CountZero() const {
-  uint32_t count = 0;
-  for (uint32_t i = 0; i < m_; i++) {
-    if (register_[i] == 0) {
-      count++;
-    }
-  }
-  return count;
-}
-
-std::string HyperLogLog::Merge(const HyperLogLog& hll) {
-  if (m_ != hll.m_) {
-    // TODO(shq) the number of registers doesn't match
-  }
-  for (uint32_t r = 0; r < m_; r++) {
-    if (register_[r] < hll.register_[r]) {
-      register_[r] = static_cast<char>(register_[r] | hll.register_[r]);
-    }
-  }
-
-  std::string result(m_, 0);
-  for (uint32_t i = 0; i < m_; ++i) {
-    result[i] = register_[i];
-  }
-  return result;
-}
-
-// ::__builtin_ctz(x): 返回右起第一个‘1’之后的0的个数
-uint8_t HyperLogLog::Nctz(uint32_t x, int b) { return static_cast<uint8_t>(std::min(b, ::__builtin_ctz(x))) + 1; }
-
 }  // namespace storage
@@ -7,31 +7,66 @@
 #define SRC_REDIS_HYPERLOGLOG_H_
 
 #include <cstdint>
-#include <iostream>
-#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace storage {
 
+/*
+ * A HyperLogLog of 2^precision registers. Its string value is a header
+ * | magic "HYLL" | encoding | precision | reserve |
+ * |      4B      |    1B    |     1B    |   2B    |
+ * followed by the registers in one of two encodings:
+ *  - sparse, while the cardinality is small: the runs of the registers with
+ *    the opcodes of Redis, 00xxxxxx is a run of xxxxxx + 1 zero registers,
+ *    01xxxxxx yyyyyyyy one of xxxxxxyyyyyyyy + 1 zero registers and 1vvvvvxx
+ *    one of xx + 1 registers of value vvvvv + 1.
+ *  - dense: 6 bits per register, register i in the bits [6i, 6i + 6) with
+ *    the least significant bit first.
+ * A value of 2^precision bytes without the header is the one byte per
+ * register layout of the older versions, it is still read.
+ */
 class HyperLogLog {
  public:
-  HyperLogLog(uint8_t precision, std::string origin_register);
-  ~HyperLogLog();
+  enum Encoding : uint8_t {
+    kSparse = 0,
+    kDense = 1,
+  };
+  static const size_t kHeaderLength = 8;
+  // a sparse value longer than this is written dense
+  static const size_t kSparseMaxBytes = 3000;
 
+  explicit HyperLogLog(uint8_t precision);
+
+  // false if value is not a HyperLogLog of this precision, an empty value is
+  // an empty HyperLogLog
+  bool Decode(const std::string& value);
+  std::string Encode() const;
+
+  // the index of the register of value and the rank it puts there
+  std::pair<uint32_t, uint8_t> Register(const char* value, uint32_t len) const;
+  // true if a register changed
+  bool Add(const char* value, uint32_t len);
+  void Merge(const HyperLogLog& hll);
   double Estimate() const;
-  double FirstEstimate() const;
-  uint32_t CountZero() const;
-  double Alpha() const;
-  uint8_t Nctz(uint32_t x, int b);
 
-  std::string Add(const char* value, uint32_t len);
-  std::string Merge(const HyperLogLog& hll);
+  bool IsSparse() const { return sparse_; }
+
+ private:
+  double Alpha() const;
+  void ToDense();
+  bool DecodeSparse(const char* ptr, size_t len);
+  bool DecodeDense(const char* ptr, size_t len);
 
- protected:
-  uint32_t m_ = 0;  // register bit width
-  uint32_t b_ = 0;  // regieter size
+  uint32_t m_ = 0;  // register size
+  uint32_t b_ = 0;  // register bit width
   double alpha_ = 0;
-  std::unique_ptr<char[]> register_;
+  bool sparse_ = true;
+  // the nonzero registers of a sparse HyperLogLog, sorted by index
+  std::vector<std::pair<uint32_t, uint8_t>> sparse_registers_;
+  // all the registers of a dense one, one byte each
+  std::vector<uint8_t> registers_;
 };
 
 }  // namespace storage
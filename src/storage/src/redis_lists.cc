@@ -9,6 +9,7 @@
 #include "pstd/log.h"
 #include "src/base_data_value_format.h"
 #include "src/batch.h"
+#include "src/iterate_bounds.h"
 #include "src/lists_filter.h"
 #include "src/redis.h"
 #include "src/scope_record_lock.h"
@@ -54,6 +55,10 @@ Status Redis::ScanListsKeyNum(KeyInfo* key_info) {
 }
 
 Status Redis::ListsPKPatternMatchDel(const std::string& pattern, int32_t* ret) {
+  if (pattern == "*" || isTailWildcard(pattern)) {
+    return PKPrefixRangeDel(DataType::kLists, pattern.substr(0, pattern.size() - 1), ret);
+  }
+
   rocksdb::ReadOptions iterator_options;
   const rocksdb::Snapshot* snapshot;
   ScopeSnapshot ss(db_, &snapshot);
@@ -156,7 +161,8 @@ Status Redis::LInsert(const Slice& key, const BeforeOrAfter& before_or_after, co
       uint64_t pivot_index = 0;
       uint64_t version = parsed_lists_meta_value.Version();
       uint64_t current_index = parsed_lists_meta_value.LeftIndex() + 1;
-      rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
+      auto bounds = IterateBounds::ListsData(key, version);
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(default_read_options_), handles_[kListsDataCF]);
       ListsDataKey start_data_key(key, version, current_index);
       for (iter->Seek(start_data_key.Encode()); iter->Valid() && current_index < parsed_lists_meta_value.RightIndex();
            iter->Next(), current_index++) {
@@ -179,7 +185,8 @@ Status Redis::LInsert(const Slice& key, const BeforeOrAfter& before_or_after, co
         if (pivot_index <= mid_index) {
           target_index = (before_or_after == Before) ? pivot_index - 1 : pivot_index;
           current_index = parsed_lists_meta_value.LeftIndex() + 1;
-          rocksdb::Iterator* first_half_iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
+          rocksdb::Iterator* first_half_iter =
+              db_->NewIterator(bounds.Bound(default_read_options_), handles_[kListsDataCF]);
           ListsDataKey start_data_key(key, version, current_index);
           for (first_half_iter->Seek(start_data_key.Encode()); first_half_iter->Valid() && current_index <= pivot_index;
                first_half_iter->Next(), current_index++) {
@@ -204,7 +211,8 @@ Status Redis::LInsert(const Slice& key, const BeforeOrAfter& before_or_after, co
         } else {
           target_index = (before_or_after == Before) ? pivot_index : pivot_index + 1;
           current_index = pivot_index;
-          rocksdb::Iterator* after_half_iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
+          rocksdb::Iterator* after_half_iter =
+              db_->NewIterator(bounds.Bound(default_read_options_), handles_[kListsDataCF]);
           ListsDataKey start_data_key(key, version, current_index);
           for (after_half_iter->Seek(start_data_key.Encode());
                after_half_iter->Valid() && current_index < parsed_lists_meta_value.RightIndex();
@@ -283,9 +291,17 @@ Status Redis::LPop(const Slice& key, int64_t count, std::vector<std::string>* el
       int32_t start_index = 0;
       auto stop_index = static_cast<int32_t>(count <= size ? count - 1 : size - 1);
       int32_t cur_index = 0;
+      // Bound the iterator to the live elements, so that queue workloads don't
+      // step over the tombstones popped from either end
       ListsDataKey lists_data_key(key, version, parsed_lists_meta_value.LeftIndex() + 1);
-      rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
-      for (iter->Seek(lists_data_key.Encode()); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
+      ListsDataKey upper_key(key, version, parsed_lists_meta_value.RightIndex());
+      Slice lower_bound = lists_data_key.Encode();
+      Slice upper_bound = upper_key.Encode();
+      rocksdb::ReadOptions read_options(default_read_options_);
+      read_options.iterate_lower_bound = &lower_bound;
+      read_options.iterate_upper_bound = &upper_bound;
+      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kListsDataCF]);
+      for (iter->Seek(lower_bound); iter->Valid() && cur_index <= stop_index; ++cur_index) {
         statistic++;
         ParsedBaseDataValue parsed_base_data_value(iter->value());
         elements->push_back(parsed_base_data_value.UserValue().ToString());
@@ -293,6 +309,9 @@ Status Redis::LPop(const Slice& key, int64_t count, std::vector<std::string>* el
 
         parsed_lists_meta_value.ModifyCount(-1);
         parsed_lists_meta_value.ModifyLeftIndex(-1);
+        if (cur_index < stop_index) {
+          iter->Next();
+        }
       }
       batch->Put(kListsMetaCF, base_meta_key.Encode(), meta_value);
       delete iter;
@@ -419,7 +438,8 @@ Status Redis::LRange(const Slice& key, int64_t start, int64_t stop, std::vector<
         if (sublist_right_index > origin_right_index) {
           sublist_right_index = origin_right_index;
         }
-        rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kListsDataCF]);
+        auto bounds = IterateBounds::ListsData(key, version);
+        rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kListsDataCF]);
         uint64_t current_index = sublist_left_index;
         ListsDataKey start_data_key(key, version, current_index);
         for (iter->Seek(start_data_key.Encode()); iter->Valid() && current_index <= sublist_right_index;
@@ -480,7 +500,8 @@ Status Redis::LRangeWithTTL(const Slice& key, int64_t start, int64_t stop, std::
         if (sublist_right_index > origin_right_index) {
           sublist_right_index = origin_right_index;
         }
-        rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kListsDataCF]);
+        auto bounds = IterateBounds::ListsData(key, version);
+        rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kListsDataCF]);
         uint64_t current_index = sublist_left_index;
         ListsDataKey start_data_key(key, version, current_index);
         for (iter->Seek(start_data_key.Encode()); iter->Valid() && current_index <= sublist_right_index;
@@ -521,9 +542,10 @@ Status Redis::LRem(const Slice& key, int64_t count, const Slice& value, uint64_t
       uint64_t stop_index = parsed_lists_meta_value.RightIndex() - 1;
       ListsDataKey start_data_key(key, version, start_index);
       ListsDataKey stop_data_key(key, version, stop_index);
+      auto bounds = IterateBounds::ListsData(key, version);
       if (count >= 0) {
         current_index = start_index;
-        rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
+        rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(default_read_options_), handles_[kListsDataCF]);
         for (iter->Seek(start_data_key.Encode());
              iter->Valid() && current_index <= stop_index && ((count == 0) || rest != 0);
              iter->Next(), current_index++) {
@@ -538,7 +560,7 @@ Status Redis::LRem(const Slice& key, int64_t count, const Slice& value, uint64_t
         delete iter;
       } else {
         current_index = stop_index;
-        rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
+        rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(default_read_options_), handles_[kListsDataCF]);
         for (iter->Seek(stop_data_key.Encode());
              iter->Valid() && current_index >= start_index && ((count == 0) || rest != 0);
              iter->Prev(), current_index--) {
@@ -565,7 +587,7 @@ Status Redis::LRem(const Slice& key, int64_t count, const Slice& value, uint64_t
           uint64_t left = sublist_right_index;
           current_index = sublist_right_index;
           ListsDataKey sublist_right_key(key, version, sublist_right_index);
-          rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
+          rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(default_read_options_), handles_[kListsDataCF]);
           for (iter->Seek(sublist_right_key.Encode()); iter->Valid() && current_index >= start_index;
                iter->Prev(), current_index--) {
             ParsedBaseDataValue parsed_value(iter->value());
@@ -586,7 +608,7 @@ Status Redis::LRem(const Slice& key, int64_t count, const Slice& value, uint64_t
           uint64_t right = sublist_left_index;
           current_index = sublist_left_index;
           ListsDataKey sublist_left_key(key, version, sublist_left_index);
-          rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
+          rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(default_read_options_), handles_[kListsDataCF]);
           for (iter->Seek(sublist_left_key.Encode()); iter->Valid() && current_index <= stop_index;
                iter->Next(), current_index++) {
             ParsedBaseDataValue parsed_value(iter->value());
@@ -735,10 +757,18 @@ Status Redis::RPop(const Slice& key, int64_t count, std::vector<std::string>* el
       int32_t start_index = 0;
       auto stop_index = static_cast<int32_t>(count <= size ? count - 1 : size - 1);
       int32_t cur_index = 0;
+      // Bound the iterator to the live elements, so that queue workloads don't
+      // step over the tombstones popped from either end
       ListsDataKey lists_data_key(key, version, parsed_lists_meta_value.RightIndex() - 1);
-      rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kListsDataCF]);
-      for (iter->SeekForPrev(lists_data_key.Encode()); iter->Valid() && cur_index <= stop_index;
-           iter->Prev(), ++cur_index) {
+      ListsDataKey lower_key(key, version, parsed_lists_meta_value.LeftIndex() + 1);
+      ListsDataKey upper_key(key, version, parsed_lists_meta_value.RightIndex());
+      Slice lower_bound = lower_key.Encode();
+      Slice upper_bound = upper_key.Encode();
+      rocksdb::ReadOptions read_options(default_read_options_);
+      read_options.iterate_lower_bound = &lower_bound;
+      read_options.iterate_upper_bound = &upper_bound;
+      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kListsDataCF]);
+      for (iter->SeekForPrev(lists_data_key.Encode()); iter->Valid() && cur_index <= stop_index; ++cur_index) {
         statistic++;
         ParsedBaseDataValue parsed_value(iter->value());
         elements->push_back(parsed_value.UserValue().ToString());
@@ -746,6 +776,9 @@ Status Redis::RPop(const Slice& key, int64_t count, std::vector<std::string>* el
 
         parsed_lists_meta_value.ModifyCount(-1);
         parsed_lists_meta_value.ModifyRightIndex(-1);
+        if (cur_index < stop_index) {
+          iter->Prev();
+        }
       }
       batch->Put(kListsMetaCF, base_meta_key.Encode(), meta_value);
       delete iter;
@@ -974,10 +1007,12 @@ Status Redis::ListsExpire(const Slice& key, uint64_t ttl) {
 
     if (ttl > 0) {
       parsed_lists_meta_value.SetRelativeTimestamp(ttl);
-      s = db_->Put(default_write_options_, handles_[kListsMetaCF], base_meta_key.Encode(), meta_value);
+      s = UpdateMetaWithExpireIndex(DataType::kLists, key, base_meta_key.Encode(), meta_value,
+                                    parsed_lists_meta_value.Etime());
     } else {
       parsed_lists_meta_value.InitialMetaValue();
-      s = db_->Put(default_write_options_, handles_[kListsMetaCF], base_meta_key.Encode(), meta_value);
+      s = UpdateMetaWithExpireIndex(DataType::kLists, key, base_meta_key.Encode(), meta_value,
+                                    parsed_lists_meta_value.Etime());
     }
   }
   return s;
@@ -1023,7 +1058,8 @@ Status Redis::ListsExpireat(const Slice& key, uint64_t timestamp) {
       } else {
         parsed_lists_meta_value.InitialMetaValue();
       }
-      return db_->Put(default_write_options_, handles_[kListsMetaCF], base_meta_key.Encode(), meta_value);
+      return UpdateMetaWithExpireIndex(DataType::kLists, key, base_meta_key.Encode(), meta_value,
+                                       parsed_lists_meta_value.Etime());
     }
   }
   return s;
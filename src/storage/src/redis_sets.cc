@@ -18,6 +18,7 @@
 #include "pstd/log.h"
 #include "src/base_data_value_format.h"
 #include "src/base_filter.h"
+#include "src/iterate_bounds.h"
 #include "src/scope_record_lock.h"
 #include "src/scope_snapshot.h"
 #include "storage/util.h"
@@ -61,6 +62,10 @@ rocksdb::Status Redis::ScanSetsKeyNum(KeyInfo* key_info) {
 }
 
 rocksdb::Status Redis::SetsPKPatternMatchDel(const std::string& pattern, int32_t* ret) {
+  if (pattern == "*" || isTailWildcard(pattern)) {
+    return PKPrefixRangeDel(DataType::kSets, pattern.substr(0, pattern.size() - 1), ret);
+  }
+
   rocksdb::ReadOptions iterator_options;
   const rocksdb::Snapshot* snapshot;
   ScopeSnapshot ss(db_, &snapshot);
@@ -245,7 +250,8 @@ rocksdb::Status Redis::SDiff(const std::vector<std::string>& keys, std::vector<s
       SetsMemberKey sets_member_key(keys[0], version, Slice());
       prefix = sets_member_key.EncodeSeekKey();
       KeyStatisticsDurationGuard guard(this, DataType::kSets, keys[0]);
-      auto iter = db_->NewIterator(read_options, handles_[kSetsDataCF]);
+      auto bounds = IterateBounds::Prefix(prefix);
+      auto iter = db_->NewIterator(bounds.Bound(read_options), handles_[kSetsDataCF]);
       for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
         ParsedSetsMemberKey parsed_sets_member_key(iter->key());
         Slice member = parsed_sets_member_key.member();
@@ -317,7 +323,8 @@ rocksdb::Status Redis::SDiffstore(const Slice& destination, const std::vector<st
       SetsMemberKey sets_member_key(keys[0], version, Slice());
       Slice prefix = sets_member_key.EncodeSeekKey();
       KeyStatisticsDurationGuard guard(this, DataType::kSets, keys[0]);
-      auto iter = db_->NewIterator(read_options, handles_[kSetsDataCF]);
+      auto bounds = IterateBounds::Prefix(prefix);
+      auto iter = db_->NewIterator(bounds.Bound(read_options), handles_[kSetsDataCF]);
       for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
         ParsedSetsMemberKey parsed_sets_member_key(iter->key());
         Slice member = parsed_sets_member_key.member();
@@ -422,7 +429,8 @@ rocksdb::Status Redis::SInter(const std::vector<std::string>& keys, std::vector<
       SetsMemberKey sets_member_key(keys[0], version, Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kSets, keys[0]);
       Slice prefix = sets_member_key.EncodeSeekKey();
-      auto iter = db_->NewIterator(read_options, handles_[kSetsDataCF]);
+      auto bounds = IterateBounds::Prefix(prefix);
+      auto iter = db_->NewIterator(bounds.Bound(read_options), handles_[kSetsDataCF]);
       for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
         ParsedSetsMemberKey parsed_sets_member_key(iter->key());
         Slice member = parsed_sets_member_key.member();
@@ -508,7 +516,8 @@ rocksdb::Status Redis::SInterstore(const Slice& destination, const std::vector<s
         SetsMemberKey sets_member_key(keys[0], version, Slice());
         Slice prefix = sets_member_key.EncodeSeekKey();
         KeyStatisticsDurationGuard guard(this, DataType::kSets, keys[0]);
-        auto iter = db_->NewIterator(read_options, handles_[kSetsDataCF]);
+        auto bounds = IterateBounds::Prefix(prefix);
+        auto iter = db_->NewIterator(bounds.Bound(read_options), handles_[kSetsDataCF]);
         for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
           ParsedSetsMemberKey parsed_sets_member_key(iter->key());
           Slice member = parsed_sets_member_key.member();
@@ -625,7 +634,8 @@ rocksdb::Status Redis::SMembers(const Slice& key, std::vector<std::string>* memb
       SetsMemberKey sets_member_key(key, version, Slice());
       Slice prefix = sets_member_key.EncodeSeekKey();
       KeyStatisticsDurationGuard guard(this, DataType::kSets, key.ToString());
-      auto iter = db_->NewIterator(read_options, handles_[kSetsDataCF]);
+      auto bounds = IterateBounds::Prefix(prefix);
+      auto iter = db_->NewIterator(bounds.Bound(read_options), handles_[kSetsDataCF]);
       for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
         ParsedSetsMemberKey parsed_sets_member_key(iter->key());
         members->push_back(parsed_sets_member_key.member().ToString());
@@ -667,7 +677,8 @@ Status Redis::SMembersWithTTL(const Slice& key, std::vector<std::string>* member
       SetsMemberKey sets_member_key(key, version, Slice());
       Slice prefix = sets_member_key.EncodeSeekKey();
       KeyStatisticsDurationGuard guard(this, DataType::kSets, key.ToString());
-      auto iter = db_->NewIterator(read_options, handles_[kSetsDataCF]);
+      auto bounds = IterateBounds::Prefix(prefix);
+      auto iter = db_->NewIterator(bounds.Bound(read_options), handles_[kSetsDataCF]);
       for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
         ParsedSetsMemberKey parsed_sets_member_key(iter->key());
         members->push_back(parsed_sets_member_key.member().ToString());
@@ -799,7 +810,8 @@ rocksdb::Status Redis::SPop(const Slice& key, std::vector<std::string>* members,
         int32_t cur_index = 0;
         uint64_t version = parsed_sets_meta_value.Version();
         SetsMemberKey sets_member_key(key, version, Slice());
-        auto iter = db_->NewIterator(default_read_options_, handles_[kSetsDataCF]);
+        auto bounds = IterateBounds::Prefix(sets_member_key.EncodeSeekKey());
+        auto iter = db_->NewIterator(bounds.Bound(default_read_options_), handles_[kSetsDataCF]);
         for (iter->Seek(sets_member_key.EncodeSeekKey()); iter->Valid() && cur_index < size;
              iter->Next(), cur_index++) {
           batch->Delete(kSetsDataCF, iter->key());
@@ -831,7 +843,8 @@ rocksdb::Status Redis::SPop(const Slice& key, std::vector<std::string>* members,
         SetsMemberKey sets_member_key(key, version, Slice());
         int64_t del_count = 0;
         KeyStatisticsDurationGuard guard(this, DataType::kSets, key.ToString());
-        auto iter = db_->NewIterator(default_read_options_, handles_[kSetsDataCF]);
+        auto bounds = IterateBounds::Prefix(sets_member_key.EncodeSeekKey());
+        auto iter = db_->NewIterator(bounds.Bound(default_read_options_), handles_[kSetsDataCF]);
         for (iter->Seek(sets_member_key.EncodeSeekKey()); iter->Valid() && cur_index < size;
              iter->Next(), cur_index++) {
           if (del_count == cnt) {
@@ -920,7 +933,8 @@ rocksdb::Status Redis::SRandmember(const Slice& key, int32_t count, std::vector<
       int32_t idx = 0;
       SetsMemberKey sets_member_key(key, version, Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kSets, key.ToString());
-      auto iter = db_->NewIterator(default_read_options_, handles_[kSetsDataCF]);
+      auto bounds = IterateBounds::Prefix(sets_member_key.EncodeSeekKey());
+      auto iter = db_->NewIterator(bounds.Bound(default_read_options_), handles_[kSetsDataCF]);
       for (iter->Seek(sets_member_key.EncodeSeekKey()); iter->Valid() && cur_index < size; iter->Next(), cur_index++) {
         if (static_cast<size_t>(idx) >= targets.size()) {
           break;
@@ -1023,7 +1037,8 @@ rocksdb::Status Redis::SUnion(const std::vector<std::string>& keys, std::vector<
     SetsMemberKey sets_member_key(key_version.key, key_version.version, Slice());
     prefix = sets_member_key.EncodeSeekKey();
     KeyStatisticsDurationGuard guard(this, DataType::kSets, key_version.key);
-    auto iter = db_->NewIterator(read_options, handles_[kSetsDataCF]);
+    auto bounds = IterateBounds::Prefix(prefix);
+    auto iter = db_->NewIterator(bounds.Bound(read_options), handles_[kSetsDataCF]);
     for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
       ParsedSetsMemberKey parsed_sets_member_key(iter->key());
       std::string member = parsed_sets_member_key.member().ToString();
@@ -1075,7 +1090,8 @@ rocksdb::Status Redis::SUnionstore(const Slice& destination, const std::vector<s
     SetsMemberKey sets_member_key(key_version.key, key_version.version, Slice());
     prefix = sets_member_key.EncodeSeekKey();
     KeyStatisticsDurationGuard guard(this, DataType::kSets, key_version.key);
-    auto iter = db_->NewIterator(read_options, handles_[kSetsDataCF]);
+    auto bounds = IterateBounds::Prefix(prefix);
+    auto iter = db_->NewIterator(bounds.Bound(read_options), handles_[kSetsDataCF]);
     for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
       ParsedSetsMemberKey parsed_sets_member_key(iter->key());
       std::string member = parsed_sets_member_key.member().ToString();
@@ -1164,7 +1180,8 @@ rocksdb::Status Redis::SScan(const Slice& key, int64_t cursor, const std::string
       SetsMemberKey sets_member_key(key, version, start_point);
       std::string prefix = sets_member_prefix.EncodeSeekKey().ToString();
       KeyStatisticsDurationGuard guard(this, DataType::kSets, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kSetsDataCF]);
+      auto bounds = IterateBounds::Prefix(prefix);
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kSetsDataCF]);
       for (iter->Seek(sets_member_key.EncodeSeekKey()); iter->Valid() && rest > 0 && iter->key().starts_with(prefix);
            iter->Next()) {
         ParsedSetsMemberKey parsed_sets_member_key(iter->key());
@@ -1208,10 +1225,12 @@ rocksdb::Status Redis::SetsExpire(const Slice& key, uint64_t ttl) {
 
     if (ttl > 0) {
       parsed_sets_meta_value.SetRelativeTimestamp(ttl);
-      s = db_->Put(default_write_options_, handles_[kSetsMetaCF], base_meta_key.Encode(), meta_value);
+      s = UpdateMetaWithExpireIndex(DataType::kSets, key, base_meta_key.Encode(), meta_value,
+                                    parsed_sets_meta_value.Etime());
     } else {
       parsed_sets_meta_value.InitialMetaValue();
-      s = db_->Put(default_write_options_, handles_[kSetsMetaCF], base_meta_key.Encode(), meta_value);
+      s = UpdateMetaWithExpireIndex(DataType::kSets, key, base_meta_key.Encode(), meta_value,
+                                    parsed_sets_meta_value.Etime());
     }
   }
   return s;
@@ -1257,7 +1276,8 @@ rocksdb::Status Redis::SetsExpireat(const Slice& key, uint64_t timestamp) {
       } else {
         parsed_sets_meta_value.InitialMetaValue();
       }
-      return db_->Put(default_write_options_, handles_[kSetsMetaCF], base_meta_key.Encode(), meta_value);
+      return UpdateMetaWithExpireIndex(DataType::kSets, key, base_meta_key.Encode(), meta_value,
+                                       parsed_sets_meta_value.Etime());
     }
   }
   return s;
@@ -3,6 +3,7 @@
 //  LICENSE file in the root directory of this source tree. An additional grant
 //  of patent rights can be found in the PATENTS file in the same directory.
 
+#include <algorithm>
 #include <memory>
 
 #include <fmt/core.h>
@@ -10,9 +11,13 @@
 #include "pstd/log.h"
 #include "src/base_key_format.h"
 #include "src/batch.h"
+#include "src/bit_ops.h"
+#include "src/merge_operator.h"
 #include "src/redis.h"
+#include "src/redis_hyperloglog.h"
 #include "src/scope_record_lock.h"
 #include "src/scope_snapshot.h"
+#include "src/strings_chunk_format.h"
 #include "src/strings_filter.h"
 #include "storage/storage_define.h"
 #include "storage/util.h"
@@ -58,6 +63,10 @@ Status Redis::ScanStringsKeyNum(KeyInfo* key_info) {
 }
 
 Status Redis::StringsPKPatternMatchDel(const std::string& pattern, int32_t* ret) {
+  if (pattern == "*" || isTailWildcard(pattern)) {
+    return PKPrefixRangeDel(DataType::kStrings, pattern.substr(0, pattern.size() - 1), ret);
+  }
+
   rocksdb::ReadOptions iterator_options;
   const rocksdb::Snapshot* snapshot;
   ScopeSnapshot ss(db_, &snapshot);
@@ -74,9 +83,10 @@ Status Redis::StringsPKPatternMatchDel(const std::string& pattern, int32_t* ret)
   while (iter->Valid()) {
     key = iter->key().ToString();
     value = iter->value().ToString();
+    ParsedBaseKey parsed_base_key(&key);
     ParsedStringsValue parsed_strings_value(&value);
-    if (!parsed_strings_value.IsStale() &&
-        (StringMatch(pattern.data(), pattern.size(), key.data(), key.size(), 0) != 0)) {
+    if (!parsed_strings_value.IsStale() && (StringMatch(pattern.data(), pattern.size(), parsed_base_key.Key().data(),
+                                                        parsed_base_key.Key().size(), 0) != 0)) {
       batch.Delete(key);
     }
     // In order to be more efficient, we use batch deletion here
@@ -104,50 +114,193 @@ Status Redis::StringsPKPatternMatchDel(const std::string& pattern, int32_t* ret)
   return s;
 }
 
+Status Redis::StringsUserValue(const Slice& key, std::string* value) {
+  ParsedStringsValue parsed_strings_value(value);
+  if (!parsed_strings_value.IsChunked()) {
+    parsed_strings_value.StripSuffix();
+    return Status::OK();
+  }
+  StringsChunkMeta chunk_meta(parsed_strings_value.UserValue());
+  return GetStringsChunks(db_, handles_[kStringsDataCF], default_read_options_, key, chunk_meta, 0, chunk_meta.Length(),
+                          value);
+}
+
+Status Redis::GetHyperLogLog(const Slice& key, HyperLogLog* log, uint64_t* etime) {
+  std::string value;
+  BaseKey base_key(key);
+  Status s = db_->Get(default_read_options_, base_key.Encode(), &value);
+  if (!s.ok()) {
+    return s;
+  }
+  ParsedStringsValue parsed_strings_value(&value);
+  if (parsed_strings_value.IsStale()) {
+    return Status::NotFound("Stale");
+  }
+  *etime = parsed_strings_value.Etime();
+  s = StringsUserValue(key, &value);
+  if (!s.ok()) {
+    return s;
+  }
+  if (!log->Decode(value)) {
+    return Status::Corruption("Key is not a valid HyperLogLog string value");
+  }
+  return Status::OK();
+}
+
+// the version of the chunks of a strings value, stale or not, 0 if it is not
+// chunked
+static uint64_t StringsChunkVersion(const std::string& value) {
+  ParsedStringsValue parsed_strings_value(Slice(value));
+  return parsed_strings_value.IsChunked() ? StringsChunkMeta(parsed_strings_value.UserValue()).Version() : 0;
+}
+
+Status Redis::PutStringsChunks(Batch* batch, const Slice& key, StringsChunkMeta* chunk_meta, uint64_t offset,
+                               const Slice& data) {
+  uint64_t chunk_size = chunk_meta->ChunkSize();
+  uint64_t end = offset + data.size();
+  for (uint64_t index = offset / chunk_size; !data.empty() && index * chunk_size < end; index++) {
+    uint64_t chunk_offset = index * chunk_size;
+    StringsChunkKey chunk_key(key, chunk_meta->Version(), index);
+    std::string chunk;
+    // only a chunk before the end of the value can hold bytes of it
+    if (chunk_offset < chunk_meta->Length()) {
+      Status s = db_->Get(default_read_options_, handles_[kStringsDataCF], chunk_key.Encode(), &chunk);
+      if (s.ok()) {
+        ParsedBaseDataValue parsed_chunk(&chunk);
+        parsed_chunk.StripSuffix();
+      } else if (!s.IsNotFound()) {
+        return s;
+      }
+    }
+    uint64_t begin = std::max(offset, chunk_offset);
+    uint64_t chunk_end = std::min(end, chunk_offset + chunk_size);
+    if (chunk.size() < chunk_end - chunk_offset) {
+      chunk.resize(chunk_end - chunk_offset);
+    }
+    memcpy(chunk.data() + (begin - chunk_offset), data.data() + (begin - offset), chunk_end - begin);
+    BaseDataValue chunk_value(chunk);
+    batch->Put(kStringsDataCF, chunk_key.Encode(), chunk_value.Encode());
+  }
+  chunk_meta->SetLength(std::max(chunk_meta->Length(), end));
+  return Status::OK();
+}
+
+Status Redis::SetStringsChunkRange(Batch* batch, const Slice& key, std::string* meta_value, uint64_t replaced_version,
+                                   uint64_t offset, const Slice& data, uint64_t* length) {
+  ParsedStringsValue parsed_strings_value(meta_value);
+  Slice user_value = parsed_strings_value.UserValue();
+  Status s;
+  StringsChunkMeta chunk_meta = parsed_strings_value.IsChunked()
+                                    ? StringsChunkMeta(user_value)
+                                    : StringsChunkMeta(0, kStringsChunkSize, replaced_version);
+  if (parsed_strings_value.IsChunked()) {
+    s = PutStringsChunks(batch, key, &chunk_meta, offset, data);
+  } else {
+    // the value is split into chunks as it grows past the threshold, the
+    // write is merged into it when they share a chunk
+    uint64_t value_end = (user_value.size() + kStringsChunkSize - 1) / kStringsChunkSize * kStringsChunkSize;
+    if (offset < value_end) {
+      std::string new_value = user_value.ToString();
+      if (new_value.size() < offset + data.size()) {
+        new_value.resize(offset + data.size());
+      }
+      memcpy(new_value.data() + offset, data.data(), data.size());
+      s = PutStringsChunks(batch, key, &chunk_meta, 0, new_value);
+    } else {
+      s = PutStringsChunks(batch, key, &chunk_meta, 0, user_value);
+      if (s.ok()) {
+        s = PutStringsChunks(batch, key, &chunk_meta, offset, data);
+      }
+    }
+  }
+  if (!s.ok()) {
+    return s;
+  }
+  std::string chunk_meta_value = chunk_meta.Encode();
+  StringsValue strings_value(chunk_meta_value);
+  strings_value.SetChunked();
+  strings_value.SetEtime(parsed_strings_value.Etime());
+  BaseKey base_key(key);
+  batch->Put(kStringsCF, base_key.Encode(), strings_value.Encode());
+  *length = chunk_meta.Length();
+  return Status::OK();
+}
+
+Status Redis::CopyStringsChunks(const Slice& key, Redis* new_inst, const Slice& newkey, std::string* value,
+                                rocksdb::WriteBatch* batch) {
+  ParsedStringsValue parsed_strings_value(value);
+  StringsChunkMeta chunk_meta(parsed_strings_value.UserValue());
+  std::string new_value;
+  uint64_t replaced_version = 0;
+  Status s = new_inst->GetDB()->Get(default_read_options_, BaseKey(newkey).Encode(), &new_value);
+  if (s.ok()) {
+    replaced_version = StringsChunkVersion(new_value);
+  } else if (!s.IsNotFound()) {
+    return s;
+  }
+  StringsChunkMeta new_chunk_meta(chunk_meta.Length(), chunk_meta.ChunkSize(), replaced_version);
+  uint64_t chunk_num = (chunk_meta.Length() + chunk_meta.ChunkSize() - 1) / chunk_meta.ChunkSize();
+  StringsChunkKey first_key(key, chunk_meta.Version(), 0);
+  StringsChunkKey upper_key(key, chunk_meta.Version(), chunk_num);
+  std::string lower_bound = first_key.EncodeSeekKey().ToString();
+  std::string upper_bound = upper_key.EncodeSeekKey().ToString();
+  Slice upper_bound_slice(upper_bound);
+
+  rocksdb::ReadOptions iterator_options;
+  iterator_options.iterate_upper_bound = &upper_bound_slice;
+  std::unique_ptr<rocksdb::Iterator> iter(db_->NewIterator(iterator_options, handles_[kStringsDataCF]));
+  for (iter->Seek(lower_bound); iter->Valid(); iter->Next()) {
+    StringsChunkKey chunk_key(newkey, new_chunk_meta.Version(), StringsChunkIndex(iter->key()));
+    batch->Put(new_inst->GetColumnFamilyHandles()[kStringsDataCF], chunk_key.Encode(), iter->value());
+  }
+  if (!iter->status().ok()) {
+    return iter->status();
+  }
+  // the chunk meta has a fixed length, the new one is written in place
+  std::string encoded = new_chunk_meta.Encode();
+  memcpy(value->data(), encoded.data(), encoded.size());
+  return Status::OK();
+}
+
 Status Redis::Append(const Slice& key, const Slice& value, int32_t* ret) {
   std::string old_value;
   *ret = 0;
   ScopeRecordLock l(lock_mgr_, key);
 
   BaseKey base_key(key);
+  auto batch = Batch::CreateBatch(this);
   Status s = db_->Get(default_read_options_, base_key.Encode(), &old_value);
   if (s.ok()) {
     ParsedStringsValue parsed_strings_value(&old_value);
     if (parsed_strings_value.IsStale()) {
       *ret = static_cast<int32_t>(value.size());
       StringsValue strings_value(value);
-      return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+      batch->Put(kStringsCF, base_key.Encode(), strings_value.Encode());
+    } else if (parsed_strings_value.IsChunked() ||
+               parsed_strings_value.UserValue().size() + value.size() > kStringsChunkThreshold) {
+      uint64_t length = 0;
+      uint64_t offset = parsed_strings_value.IsChunked() ? StringsChunkMeta(parsed_strings_value.UserValue()).Length()
+                                                         : parsed_strings_value.UserValue().size();
+      s = SetStringsChunkRange(batch.get(), key, &old_value, 0, offset, value, &length);
+      if (!s.ok()) {
+        return s;
+      }
+      *ret = static_cast<int32_t>(length);
     } else {
-      uint64_t timestamp = parsed_strings_value.Etime();
-      std::string old_user_value = parsed_strings_value.UserValue().ToString();
-      std::string new_value = old_user_value + value.ToString();
-      StringsValue strings_value(new_value);
-      strings_value.SetEtime(timestamp);
-      *ret = static_cast<int32_t>(new_value.size());
-      return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+      // The value is still read above, for the length in the reply, but only
+      // the appended bytes are written, StringsMergeOperator rebuilds the value
+      *ret = static_cast<int32_t>(parsed_strings_value.UserValue().size() + value.size());
+      batch->Merge(kStringsCF, base_key.Encode(),
+                   EncodeMergeOperand(kMergeAppend, parsed_strings_value.Etime(), value));
     }
   } else if (s.IsNotFound()) {
     *ret = static_cast<int32_t>(value.size());
     StringsValue strings_value(value);
-    return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+    batch->Put(kStringsCF, base_key.Encode(), strings_value.Encode());
+  } else {
+    return s;
   }
-  return s;
-}
-
-int GetBitCount(const unsigned char* value, int64_t bytes) {
-  int bit_num = 0;
-  static const unsigned char bitsinbyte[256] = {
-      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, 1, 2, 2, 3, 2,
-      3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 1, 2, 2, 3, 2, 3, 3, 4, 2, 3,
-      3, 4, 3, 4, 4, 5, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5,
-      6, 3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7, 1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, 2, 3, 3, 4,
-      3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 3, 4, 4, 5, 4, 5, 5, 6, 4,
-      5, 5, 6, 5, 6, 6, 7, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6,
-      6, 7, 3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7, 4, 5, 5, 6, 5, 6, 6, 7, 5, 6, 6, 7, 6, 7, 7, 8};
-  for (int i = 0; i < bytes; i++) {
-    bit_num += bitsinbyte[static_cast<unsigned int>(value[i])];
-  }
-  return bit_num;
+  return batch->Commit();
 }
 
 Status Redis::BitCount(const Slice& key, int64_t start_offset, int64_t end_offset, int32_t* ret, bool have_range) {
@@ -161,9 +314,10 @@ Status Redis::BitCount(const Slice& key, int64_t start_offset, int64_t end_offse
     if (parsed_strings_value.IsStale()) {
       return Status::NotFound("Stale");
     } else {
+      bool chunked = parsed_strings_value.IsChunked();
+      StringsChunkMeta chunk_meta(chunked ? parsed_strings_value.UserValue() : Slice());
       parsed_strings_value.StripSuffix();
-      const auto bit_value = reinterpret_cast<const unsigned char*>(value.data());
-      auto value_length = static_cast<int64_t>(value.length());
+      auto value_length = static_cast<int64_t>(chunked ? chunk_meta.Length() : value.length());
       if (have_range) {
         if (start_offset < 0) {
           start_offset = start_offset + value_length;
@@ -188,7 +342,18 @@ Status Redis::BitCount(const Slice& key, int64_t start_offset, int64_t end_offse
         start_offset = 0;
         end_offset = std::max(value_length - 1, static_cast<int64_t>(0));
       }
-      *ret = GetBitCount(bit_value + start_offset, end_offset - start_offset + 1);
+      if (chunked) {
+        // only the chunks in the range are read
+        s = GetStringsChunks(db_, handles_[kStringsDataCF], default_read_options_, key, chunk_meta, start_offset,
+                             end_offset - start_offset + 1, &value);
+        if (!s.ok()) {
+          return s;
+        }
+        start_offset = 0;
+        end_offset = static_cast<int64_t>(value.size()) - 1;
+      }
+      const auto bit_value = reinterpret_cast<const unsigned char*>(value.data());
+      *ret = static_cast<int32_t>(GetBitCount(bit_value + start_offset, end_offset - start_offset + 1));
     }
   } else {
     return s;
@@ -196,47 +361,6 @@ Status Redis::BitCount(const Slice& key, int64_t start_offset, int64_t end_offse
   return Status::OK();
 }
 
-std::string BitOpOperate(BitOpType op, const std::vector<std::string>& src_values, int64_t max_len) {
-  char byte;
-  char output;
-  auto dest_value = std::make_unique<char[]>(max_len);
-  for (int64_t j = 0; j < max_len; j++) {
-    if (j < static_cast<int64_t>(src_values[0].size())) {
-      output = src_values[0][j];
-    } else {
-      output = 0;
-    }
-    if (op == kBitOpNot) {
-      output = static_cast<char>(~output);
-    }
-    for (size_t i = 1; i < src_values.size(); i++) {
-      if (static_cast<int64_t>(src_values[i].size()) - 1 >= j) {
-        byte = src_values[i][j];
-      } else {
-        byte = 0;
-      }
-      switch (op) {
-        case kBitOpNot:
-          break;
-        case kBitOpAnd:
-          output = static_cast<char>(output & byte);
-          break;
-        case kBitOpOr:
-          output = static_cast<char>(output | byte);
-          break;
-        case kBitOpXor:
-          output = static_cast<char>(output ^ byte);
-          break;
-        case kBitOpDefault:
-          break;
-      }
-    }
-    dest_value[j] = output;
-  }
-  std::string dest_str(dest_value.get(), max_len);
-  return dest_str;
-}
-
 Status Redis::BitOp(BitOpType op, const std::string& dest_key, const std::vector<std::string>& src_keys,
                     std::string& value_to_dest, int64_t* ret) {
   Status s;
@@ -259,7 +383,10 @@ Status Redis::BitOp(BitOpType op, const std::string& dest_key, const std::vector
         src_values.emplace_back("");
         value_len = 0;
       } else {
-        parsed_strings_value.StripSuffix();
+        s = StringsUserValue(src_key, &value);
+        if (!s.ok()) {
+          return s;
+        }
         src_values.push_back(value);
         value_len = static_cast<int64_t>(value.size());
       }
@@ -288,6 +415,7 @@ Status Redis::Decrby(const Slice& key, int64_t value, int64_t* ret) {
   ScopeRecordLock l(lock_mgr_, key);
 
   BaseKey base_key(key);
+  auto batch = Batch::CreateBatch(this);
   Status s = db_->Get(default_read_options_, base_key.Encode(), &old_value);
   if (s.ok()) {
     ParsedStringsValue parsed_strings_value(&old_value);
@@ -295,8 +423,11 @@ Status Redis::Decrby(const Slice& key, int64_t value, int64_t* ret) {
       *ret = -value;
       new_value = std::to_string(*ret);
       StringsValue strings_value(new_value);
-      return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+      batch->Put(kStringsCF, base_key.Encode(), strings_value.Encode());
     } else {
+      if (parsed_strings_value.IsChunked()) {
+        return Status::Corruption("Value is not a integer");
+      }
       uint64_t timestamp = parsed_strings_value.Etime();
       std::string old_user_value = parsed_strings_value.UserValue().ToString();
       char* end = nullptr;
@@ -312,16 +443,17 @@ Status Redis::Decrby(const Slice& key, int64_t value, int64_t* ret) {
       new_value = std::to_string(*ret);
       StringsValue strings_value(new_value);
       strings_value.SetEtime(timestamp);
-      return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+      batch->Put(kStringsCF, base_key.Encode(), strings_value.Encode());
     }
   } else if (s.IsNotFound()) {
     *ret = -value;
     new_value = std::to_string(*ret);
     StringsValue strings_value(new_value);
-    return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+    batch->Put(kStringsCF, base_key.Encode(), strings_value.Encode());
   } else {
     return s;
   }
+  return batch->Commit();
 }
 
 Status Redis::Get(const Slice& key, std::string* value) {
@@ -335,7 +467,7 @@ Status Redis::Get(const Slice& key, std::string* value) {
       value->clear();
       return Status::NotFound("Stale");
     } else {
-      parsed_strings_value.StripSuffix();
+      s = StringsUserValue(key, value);
     }
   }
   return s;
@@ -352,8 +484,11 @@ Status Redis::GetWithTTL(const Slice& key, std::string* value, uint64_t* ttl) {
       *ttl = -2;
       return Status::NotFound("Stale");
     } else {
-      parsed_strings_value.StripSuffix();
       *ttl = parsed_strings_value.Etime();
+      s = StringsUserValue(key, value);
+      if (!s.ok()) {
+        return s;
+      }
       if (*ttl == 0) {
         *ttl = -1;
       } else {
@@ -382,6 +517,19 @@ Status Redis::GetBit(const Slice& key, int64_t offset, int32_t* ret) {
       if (parsed_strings_value.IsStale()) {
         *ret = 0;
         return Status::OK();
+      } else if (parsed_strings_value.IsChunked()) {
+        // only the byte of the bit is read, from its chunk
+        StringsChunkMeta chunk_meta(parsed_strings_value.UserValue());
+        *ret = 0;
+        if (static_cast<uint64_t>(offset >> 3) < chunk_meta.Length()) {
+          s = GetStringsChunks(db_, handles_[kStringsDataCF], default_read_options_, key, chunk_meta, offset >> 3, 1,
+                               &data_value);
+          if (!s.ok()) {
+            return s;
+          }
+          *ret = (data_value[0] >> (7 - (offset & 0x7))) & 1;
+        }
+        return Status::OK();
       } else {
         data_value = parsed_strings_value.UserValue().ToString();
       }
@@ -410,8 +558,10 @@ Status Redis::Getrange(const Slice& key, int64_t start_offset, int64_t end_offse
     if (parsed_strings_value.IsStale()) {
       return Status::NotFound("Stale");
     } else {
+      bool chunked = parsed_strings_value.IsChunked();
+      StringsChunkMeta chunk_meta(chunked ? parsed_strings_value.UserValue() : Slice());
       parsed_strings_value.StripSuffix();
-      auto size = static_cast<int64_t>(value.size());
+      auto size = static_cast<int64_t>(chunked ? chunk_meta.Length() : value.size());
       int64_t start_t = start_offset >= 0 ? start_offset : size + start_offset;
       int64_t end_t = end_offset >= 0 ? end_offset : size + end_offset;
       if (start_t > size - 1 || (start_t != 0 && start_t > end_t) || (start_t != 0 && end_t < 0)) {
@@ -426,6 +576,11 @@ Status Redis::Getrange(const Slice& key, int64_t start_offset, int64_t end_offse
       if (start_t == 0 && end_t < 0) {
         end_t = 0;
       }
+      if (chunked) {
+        // only the chunks in the range are read
+        return GetStringsChunks(db_, handles_[kStringsDataCF], default_read_options_, key, chunk_meta, start_t,
+                                end_t - start_t + 1, ret);
+      }
       *ret = value.substr(start_t, end_t - start_t + 1);
       return Status::OK();
     }
@@ -437,7 +592,8 @@ Status Redis::Getrange(const Slice& key, int64_t start_offset, int64_t end_offse
 Status Redis::GetrangeWithValue(const Slice& key, int64_t start_offset, int64_t end_offset, std::string* ret,
                                 std::string* value, uint64_t* ttl) {
   *ret = "";
-  Status s = db_->Get(default_read_options_, key, value);
+  BaseKey base_key(key);
+  Status s = db_->Get(default_read_options_, base_key.Encode(), value);
   if (s.ok()) {
     ParsedStringsValue parsed_strings_value(value);
     if (parsed_strings_value.IsStale()) {
@@ -445,9 +601,12 @@ Status Redis::GetrangeWithValue(const Slice& key, int64_t start_offset, int64_t
       *ttl = -2;
       return Status::NotFound("Stale");
     } else {
-      parsed_strings_value.StripSuffix();
       // get ttl
       *ttl = parsed_strings_value.Etime();
+      s = StringsUserValue(key, value);
+      if (!s.ok()) {
+        return s;
+      }
       if (*ttl == 0) {
         *ttl = -1;
       } else {
@@ -491,7 +650,10 @@ Status Redis::GetSet(const Slice& key, const Slice& value, std::string* old_valu
     if (parsed_strings_value.IsStale()) {
       *old_value = "";
     } else {
-      parsed_strings_value.StripSuffix();
+      s = StringsUserValue(key, old_value);
+      if (!s.ok()) {
+        return s;
+      }
     }
   } else if (!s.IsNotFound()) {
     return s;
@@ -502,10 +664,10 @@ Status Redis::GetSet(const Slice& key, const Slice& value, std::string* old_valu
 
 Status Redis::Incrby(const Slice& key, int64_t value, int64_t* ret) {
   std::string old_value;
-  std::string new_value;
   ScopeRecordLock l(lock_mgr_, key);
 
   BaseKey base_key(key);
+  auto batch = Batch::CreateBatch(this);
   Status s = db_->Get(default_read_options_, base_key.Encode(), &old_value);
   char buf[32] = {0};
   if (s.ok()) {
@@ -514,8 +676,13 @@ Status Redis::Incrby(const Slice& key, int64_t value, int64_t* ret) {
       *ret = value;
       Int64ToStr(buf, 32, value);
       StringsValue strings_value(buf);
-      return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+      batch->Put(kStringsCF, base_key.Encode(), strings_value.Encode());
     } else {
+      // a chunked value is far longer than any integer, and its user value is
+      // the chunk meta, which must not be read as one
+      if (parsed_strings_value.IsChunked()) {
+        return Status::Corruption("Value is not a integer");
+      }
       uint64_t timestamp = parsed_strings_value.Etime();
       std::string old_user_value = parsed_strings_value.UserValue().ToString();
       char* end = nullptr;
@@ -527,19 +694,20 @@ Status Redis::Incrby(const Slice& key, int64_t value, int64_t* ret) {
         return Status::InvalidArgument("Overflow");
       }
       *ret = ival + value;
-      new_value = std::to_string(*ret);
-      StringsValue strings_value(new_value);
+      Int64ToStr(buf, 32, *ret);
+      StringsValue strings_value(buf);
       strings_value.SetEtime(timestamp);
-      return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+      batch->Put(kStringsCF, base_key.Encode(), strings_value.Encode());
     }
   } else if (s.IsNotFound()) {
     *ret = value;
     Int64ToStr(buf, 32, value);
     StringsValue strings_value(buf);
-    return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+    batch->Put(kStringsCF, base_key.Encode(), strings_value.Encode());
   } else {
     return s;
   }
+  return batch->Commit();
 }
 
 Status Redis::Incrbyfloat(const Slice& key, const Slice& value, std::string* ret) {
@@ -552,6 +720,7 @@ Status Redis::Incrbyfloat(const Slice& key, const Slice& value, std::string* ret
 
   BaseKey base_key(key);
   ScopeRecordLock l(lock_mgr_, key);
+  auto batch = Batch::CreateBatch(this);
   Status s = db_->Get(default_read_options_, base_key.Encode(), &old_value);
   if (s.ok()) {
     ParsedStringsValue parsed_strings_value(&old_value);
@@ -559,8 +728,11 @@ Status Redis::Incrbyfloat(const Slice& key, const Slice& value, std::string* ret
       LongDoubleToStr(long_double_by, &new_value);
       *ret = new_value;
       StringsValue strings_value(new_value);
-      return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+      batch->Put(kStringsCF, base_key.Encode(), strings_value.Encode());
     } else {
+      if (parsed_strings_value.IsChunked()) {
+        return Status::Corruption("Value is not a vaild float");
+      }
       uint64_t timestamp = parsed_strings_value.Etime();
       std::string old_user_value = parsed_strings_value.UserValue().ToString();
       long double total;
@@ -575,16 +747,17 @@ Status Redis::Incrbyfloat(const Slice& key, const Slice& value, std::string* ret
       *ret = new_value;
       StringsValue strings_value(new_value);
       strings_value.SetEtime(timestamp);
-      return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+      batch->Put(kStringsCF, base_key.Encode(), strings_value.Encode());
     }
   } else if (s.IsNotFound()) {
     LongDoubleToStr(long_double_by, &new_value);
     *ret = new_value;
     StringsValue strings_value(new_value);
-    return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+    batch->Put(kStringsCF, base_key.Encode(), strings_value.Encode());
   } else {
     return s;
   }
+  return batch->Commit();
 }
 
 Status Redis::MSet(const std::vector<KeyValue>& kvs) {
@@ -662,10 +835,13 @@ Status Redis::Setxx(const Slice& key, const Slice& value, int32_t* ret, const ui
     return s;
   } else {
     *ret = 1;
+    auto batch = Batch::CreateBatch(this);
     if (ttl > 0) {
       strings_value.SetRelativeTimestamp(ttl);
+      AddExpireIndex(batch.get(), DataType::kStrings, key, strings_value.Etime());
     }
-    return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+    batch->Put(kStringsCF, base_key.Encode(), strings_value.Encode());
+    return batch->Commit();
   }
 }
 
@@ -681,20 +857,41 @@ Status Redis::SetBit(const Slice& key, int64_t offset, int32_t on, int32_t* ret)
   if (s.ok() || s.IsNotFound()) {
     std::string data_value;
     int32_t timestamp = 0;
+    bool chunked = false;
+    StringsChunkMeta chunk_meta{Slice()};
+    uint64_t replaced_version = 0;
     if (s.ok()) {
       ParsedStringsValue parsed_strings_value(&meta_value);
       if (!parsed_strings_value.IsStale()) {
-        data_value = parsed_strings_value.UserValue().ToString();
+        chunked = parsed_strings_value.IsChunked();
+        if (chunked) {
+          chunk_meta = StringsChunkMeta(parsed_strings_value.UserValue());
+        } else {
+          data_value = parsed_strings_value.UserValue().ToString();
+        }
         timestamp = parsed_strings_value.Etime();
+      } else {
+        replaced_version = StringsChunkVersion(meta_value);
+        meta_value.clear();
       }
+    } else {
+      meta_value.clear();
     }
     size_t byte = offset >> 3;
     size_t bit = 7 - (offset & 0x7);
     char byte_val;
-    size_t value_lenth = data_value.length();
+    size_t value_lenth = chunked ? chunk_meta.Length() : data_value.length();
     if (byte + 1 > value_lenth) {
       *ret = 0;
       byte_val = 0;
+    } else if (chunked) {
+      s = GetStringsChunks(db_, handles_[kStringsDataCF], default_read_options_, key, chunk_meta, byte, 1,
+                           &data_value);
+      if (!s.ok()) {
+        return s;
+      }
+      *ret = ((data_value[0] & (1 << bit)) >> bit);
+      byte_val = data_value[0];
     } else {
       *ret = ((data_value[byte] & (1 << bit)) >> bit);
       byte_val = data_value[byte];
@@ -704,6 +901,16 @@ Status Redis::SetBit(const Slice& key, int64_t offset, int32_t on, int32_t* ret)
     }
     byte_val = static_cast<char>(byte_val & (~(1 << bit)));
     byte_val = static_cast<char>(byte_val | ((on & 0x1) << bit));
+    if (chunked || std::max(value_lenth, byte + 1) > kStringsChunkThreshold) {
+      // only the chunk of the byte is rewritten
+      uint64_t length = 0;
+      auto batch = Batch::CreateBatch(this);
+      s = SetStringsChunkRange(batch.get(), key, &meta_value, replaced_version, byte, Slice(&byte_val, 1), &length);
+      if (!s.ok()) {
+        return s;
+      }
+      return batch->Commit();
+    }
     if (byte + 1 <= value_lenth) {
       data_value.replace(byte, 1, &byte_val, 1);
     } else {
@@ -734,6 +941,7 @@ Status Redis::Setex(const Slice& key, const Slice& value, uint64_t ttl) {
   ScopeRecordLock l(lock_mgr_, key);
   auto batch = Batch::CreateBatch(this);
   batch->Put(kStringsCF, base_key.Encode(), strings_value.Encode());
+  AddExpireIndex(batch.get(), DataType::kStrings, key, strings_value.Etime());
   return batch->Commit();
 }
 
@@ -748,20 +956,26 @@ Status Redis::Setnx(const Slice& key, const Slice& value, int32_t* ret, const ui
     ParsedStringsValue parsed_strings_value(&old_value);
     if (parsed_strings_value.IsStale()) {
       StringsValue strings_value(value);
+      auto batch = Batch::CreateBatch(this);
       if (ttl > 0) {
         strings_value.SetRelativeTimestamp(ttl);
+        AddExpireIndex(batch.get(), DataType::kStrings, key, strings_value.Etime());
       }
-      s = db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+      batch->Put(kStringsCF, base_key.Encode(), strings_value.Encode());
+      s = batch->Commit();
       if (s.ok()) {
         *ret = 1;
       }
     }
   } else if (s.IsNotFound()) {
     StringsValue strings_value(value);
+    auto batch = Batch::CreateBatch(this);
     if (ttl > 0) {
       strings_value.SetRelativeTimestamp(ttl);
+      AddExpireIndex(batch.get(), DataType::kStrings, key, strings_value.Etime());
     }
-    s = db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+    batch->Put(kStringsCF, base_key.Encode(), strings_value.Encode());
+    s = batch->Commit();
     if (s.ok()) {
       *ret = 1;
     }
@@ -781,12 +995,19 @@ Status Redis::Setvx(const Slice& key, const Slice& value, const Slice& new_value
     if (parsed_strings_value.IsStale()) {
       *ret = 0;
     } else {
-      if (value.compare(parsed_strings_value.UserValue()) == 0) {
+      s = StringsUserValue(key, &old_value);
+      if (!s.ok()) {
+        return s;
+      }
+      if (value.compare(old_value) == 0) {
         StringsValue strings_value(new_value);
+        auto batch = Batch::CreateBatch(this);
         if (ttl > 0) {
           strings_value.SetRelativeTimestamp(ttl);
+          AddExpireIndex(batch.get(), DataType::kStrings, key, strings_value.Etime());
         }
-        s = db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+        batch->Put(kStringsCF, base_key.Encode(), strings_value.Encode());
+        s = batch->Commit();
         if (!s.ok()) {
           return s;
         }
@@ -816,7 +1037,11 @@ Status Redis::Delvx(const Slice& key, const Slice& value, int32_t* ret) {
       *ret = 0;
       return Status::NotFound("Stale");
     } else {
-      if (value.compare(parsed_strings_value.UserValue()) == 0) {
+      s = StringsUserValue(key, &old_value);
+      if (!s.ok()) {
+        return s;
+      }
+      if (value.compare(old_value) == 0) {
         *ret = 1;
         return db_->Delete(default_write_options_, base_key.Encode());
       } else {
@@ -840,97 +1065,76 @@ Status Redis::Setrange(const Slice& key, int64_t start_offset, const Slice& valu
 
   BaseKey base_key(key);
   Status s = db_->Get(default_read_options_, base_key.Encode(), &old_value);
+  if (!s.ok() && !s.IsNotFound()) {
+    return s;
+  }
+  // a missing or stale value is empty
+  uint64_t timestamp = 0;
+  uint64_t length = 0;
+  bool chunked = false;
+  uint64_t replaced_version = 0;
   if (s.ok()) {
-    int32_t timestamp = 0;
     ParsedStringsValue parsed_strings_value(&old_value);
-    parsed_strings_value.StripSuffix();
     if (parsed_strings_value.IsStale()) {
-      std::string tmp(start_offset, '\0');
-      new_value = tmp.append(value.data());
-      *ret = static_cast<int32_t>(new_value.length());
+      replaced_version = StringsChunkVersion(old_value);
+      old_value.clear();
     } else {
       timestamp = parsed_strings_value.Etime();
-      if (static_cast<size_t>(start_offset) > old_value.length()) {
-        old_value.resize(start_offset);
-        new_value = old_value.append(value.data());
-      } else {
-        std::string head = old_value.substr(0, start_offset);
-        std::string tail;
-        if ((start_offset + value.size()) < old_value.length()) {
-          tail = old_value.substr(start_offset + value.size());
-        }
-        new_value = head + value.data() + tail;
-      }
+      chunked = parsed_strings_value.IsChunked();
+      length = chunked ? StringsChunkMeta(parsed_strings_value.UserValue()).Length()
+                       : parsed_strings_value.UserValue().size();
     }
-    *ret = static_cast<int32_t>(new_value.length());
-    StringsValue strings_value(new_value);
-    strings_value.SetEtime(timestamp);
-    return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
-  } else if (s.IsNotFound()) {
-    std::string tmp(start_offset, '\0');
-    new_value = tmp.append(value.data());
-    *ret = static_cast<int32_t>(new_value.length());
-    StringsValue strings_value(new_value);
-    return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
   }
-  return s;
-}
 
-Status Redis::Strlen(const Slice& key, int32_t* len) {
-  std::string value;
-  Status s = Get(key, &value);
-  if (s.ok()) {
-    *len = static_cast<int32_t>(value.size());
-  } else {
-    *len = 0;
+  if (chunked || std::max(length, start_offset + value.size()) > kStringsChunkThreshold) {
+    // only the chunks in the range are rewritten
+    auto batch = Batch::CreateBatch(this);
+    s = SetStringsChunkRange(batch.get(), key, &old_value, replaced_version, start_offset, value, &length);
+    if (!s.ok()) {
+      return s;
+    }
+    *ret = static_cast<int32_t>(length);
+    return batch->Commit();
   }
-  return s;
-}
 
-int32_t GetBitPos(const unsigned char* s, unsigned int bytes, int bit) {
-  uint64_t word = 0;
-  uint64_t skip_val = 0;
-  auto value = const_cast<unsigned char*>(s);
-  auto l = reinterpret_cast<uint64_t*>(value);
-  int pos = 0;
-  if (bit == 0) {
-    skip_val = std::numeric_limits<uint64_t>::max();
-  } else {
-    skip_val = 0;
+  if (!old_value.empty()) {
+    ParsedStringsValue parsed_strings_value(&old_value);
+    parsed_strings_value.StripSuffix();
   }
-  // skip 8 bytes at one time, find the first int64 that should not be skipped
-  while (bytes >= sizeof(*l)) {
-    if (*l != skip_val) {
-      break;
-    }
-    l++;
-    bytes = bytes - sizeof(*l);
-    pos += static_cast<int32_t>(8 * sizeof(*l));
-  }
-  auto c = reinterpret_cast<unsigned char*>(l);
-  for (size_t j = 0; j < sizeof(*l); j++) {
-    word = word << 8;
-    if (bytes != 0U) {
-      word = word | *c;
-      c++;
-      bytes--;
+  if (static_cast<size_t>(start_offset) > old_value.length()) {
+    old_value.resize(start_offset);
+    new_value = old_value.append(value.data());
+  } else {
+    std::string head = old_value.substr(0, start_offset);
+    std::string tail;
+    if ((start_offset + value.size()) < old_value.length()) {
+      tail = old_value.substr(start_offset + value.size());
     }
+    new_value = head + value.data() + tail;
   }
-  if (bit == 1 && word == 0) {
-    return -1;
-  }
-  // set each bit of mask to 0 except msb
-  uint64_t mask = std::numeric_limits<uint64_t>::max();
-  mask = mask >> 1;
-  mask = ~(mask);
-  while (mask != 0U) {
-    if (static_cast<int>((word & mask) != 0) == bit) {
-      return pos;
+  *ret = static_cast<int32_t>(new_value.length());
+  StringsValue strings_value(new_value);
+  strings_value.SetEtime(timestamp);
+  return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+}
+
+Status Redis::Strlen(const Slice& key, int32_t* len) {
+  std::string value;
+  *len = 0;
+
+  BaseKey base_key(key);
+  Status s = db_->Get(default_read_options_, base_key.Encode(), &value);
+  if (s.ok()) {
+    ParsedStringsValue parsed_strings_value(&value);
+    if (parsed_strings_value.IsStale()) {
+      return Status::NotFound("Stale");
     }
-    pos++;
-    mask = mask >> 1;
+    // the length of a chunked value is in its chunk meta, no chunk is read
+    *len = static_cast<int32_t>(parsed_strings_value.IsChunked()
+                                    ? StringsChunkMeta(parsed_strings_value.UserValue()).Length()
+                                    : parsed_strings_value.UserValue().size());
   }
-  return pos;
+  return s;
 }
 
 Status Redis::BitPos(const Slice& key, int32_t bit, int64_t* ret) {
@@ -949,16 +1153,18 @@ Status Redis::BitPos(const Slice& key, int32_t bit, int64_t* ret) {
       }
       return Status::NotFound("Stale");
     } else {
-      parsed_strings_value.StripSuffix();
+      s = StringsUserValue(key, &value);
+      if (!s.ok()) {
+        return s;
+      }
       const auto bit_value = reinterpret_cast<const unsigned char*>(value.data());
       auto value_length = static_cast<int64_t>(value.length());
       int64_t start_offset = 0;
       int64_t end_offset = std::max(value_length - 1, static_cast<int64_t>(0));
       int64_t bytes = end_offset - start_offset + 1;
+      // without an end the value is followed by zero bits, so BITPOS 0 of a
+      // value of all ones is the first bit past it
       int64_t pos = GetBitPos(bit_value + start_offset, bytes, bit);
-      if (pos == (8 * bytes) && bit == 0) {
-        pos = -1;
-      }
       if (pos != -1) {
         pos = pos + 8 * start_offset;
       }
@@ -986,7 +1192,10 @@ Status Redis::BitPos(const Slice& key, int32_t bit, int64_t start_offset, int64_
       }
       return Status::NotFound("Stale");
     } else {
-      parsed_strings_value.StripSuffix();
+      s = StringsUserValue(key, &value);
+      if (!s.ok()) {
+        return s;
+      }
       const auto bit_value = reinterpret_cast<const unsigned char*>(value.data());
       auto value_length = static_cast<int64_t>(value.length());
       int64_t end_offset = std::max(value_length - 1, static_cast<int64_t>(0));
@@ -1005,10 +1214,8 @@ Status Redis::BitPos(const Slice& key, int32_t bit, int64_t start_offset, int64_
         return Status::OK();
       }
       int64_t bytes = end_offset - start_offset + 1;
+      // only an explicit end makes BITPOS 0 past the range -1
       int64_t pos = GetBitPos(bit_value + start_offset, bytes, bit);
-      if (pos == (8 * bytes) && bit == 0) {
-        pos = -1;
-      }
       if (pos != -1) {
         pos = pos + 8 * start_offset;
       }
@@ -1036,7 +1243,10 @@ Status Redis::BitPos(const Slice& key, int32_t bit, int64_t start_offset, int64_
       }
       return Status::NotFound("Stale");
     } else {
-      parsed_strings_value.StripSuffix();
+      s = StringsUserValue(key, &value);
+      if (!s.ok()) {
+        return s;
+      }
       const auto bit_value = reinterpret_cast<const unsigned char*>(value.data());
       auto value_length = static_cast<int64_t>(value.length());
       if (start_offset < 0) {
@@ -1086,7 +1296,10 @@ Status Redis::PKSetexAt(const Slice& key, const Slice& value, uint64_t timestamp
   BaseKey base_key(key);
   ScopeRecordLock l(lock_mgr_, key);
   strings_value.SetEtime(uint64_t(timestamp));
-  return db_->Put(default_write_options_, base_key.Encode(), strings_value.Encode());
+  auto batch = Batch::CreateBatch(this);
+  batch->Put(kStringsCF, base_key.Encode(), strings_value.Encode());
+  AddExpireIndex(batch.get(), DataType::kStrings, key, timestamp);
+  return batch->Commit();
 }
 
 Status Redis::StringsExpire(const Slice& key, uint64_t ttl) {
@@ -1102,7 +1315,10 @@ Status Redis::StringsExpire(const Slice& key, uint64_t ttl) {
     }
     if (ttl > 0) {
       parsed_strings_value.SetRelativeTimestamp(ttl);
-      return db_->Put(default_write_options_, base_key.Encode(), value);
+      auto batch = Batch::CreateBatch(this);
+      batch->Put(kStringsCF, base_key.Encode(), value);
+      AddExpireIndex(batch.get(), DataType::kStrings, key, parsed_strings_value.Etime());
+      return batch->Commit();
     } else {
       return db_->Delete(default_write_options_, base_key.Encode());
     }
@@ -1139,7 +1355,10 @@ Status Redis::StringsExpireat(const Slice& key, uint64_t timestamp) {
     } else {
       if (timestamp > 0) {
         parsed_strings_value.SetEtime(uint64_t(timestamp));
-        return db_->Put(default_write_options_, base_key.Encode(), value);
+        auto batch = Batch::CreateBatch(this);
+        batch->Put(kStringsCF, base_key.Encode(), value);
+        AddExpireIndex(batch.get(), DataType::kStrings, key, timestamp);
+        return batch->Commit();
       } else {
         return db_->Delete(default_write_options_, base_key.Encode());
       }
@@ -1212,8 +1431,17 @@ Status Redis::StringsRename(const Slice& key, Redis* new_inst, const Slice& newk
     if (parsed_strings_value.IsStale()) {
       return Status::NotFound("Stale");
     }
+    rocksdb::WriteBatch batch;
+    if (parsed_strings_value.IsChunked()) {
+      // the chunks are copied under newkey, the data filter drops the ones of key
+      s = CopyStringsChunks(key, new_inst, newkey, &value, &batch);
+      if (!s.ok()) {
+        return s;
+      }
+    }
     db_->Delete(default_write_options_, base_key.Encode());
-    s = new_inst->GetDB()->Put(default_write_options_, base_newkey.Encode(), value);
+    batch.Put(new_inst->GetColumnFamilyHandles()[kStringsCF], base_newkey.Encode(), value);
+    s = new_inst->GetDB()->Write(default_write_options_, &batch);
   }
   return s;
 }
@@ -1233,15 +1461,25 @@ Status Redis::StringsRenamenx(const Slice& key, Redis* new_inst, const Slice& ne
       return Status::NotFound("Stale");
     }
     // check if newkey exists.
-    s = new_inst->GetDB()->Get(default_read_options_, base_newkey.Encode(), &value);
+    std::string new_value;
+    s = new_inst->GetDB()->Get(default_read_options_, base_newkey.Encode(), &new_value);
     if (s.ok()) {
-      ParsedStringsValue parsed_strings_value(&value);
-      if (!parsed_strings_value.IsStale()) {
+      ParsedStringsValue parsed_new_value(&new_value);
+      if (!parsed_new_value.IsStale()) {
         return Status::Corruption();  // newkey already exists.
       }
     }
+    rocksdb::WriteBatch batch;
+    if (parsed_strings_value.IsChunked()) {
+      // the chunks are copied under newkey, the data filter drops the ones of key
+      s = CopyStringsChunks(key, new_inst, newkey, &value, &batch);
+      if (!s.ok()) {
+        return s;
+      }
+    }
     db_->Delete(default_write_options_, base_key.Encode());
-    s = new_inst->GetDB()->Put(default_write_options_, base_newkey.Encode(), value);
+    batch.Put(new_inst->GetColumnFamilyHandles()[kStringsCF], base_newkey.Encode(), value);
+    s = new_inst->GetDB()->Write(default_write_options_, &batch);
   }
   return s;
 }
@@ -1270,4 +1508,52 @@ void Redis::ScanStrings() {
   delete iter;
 }
 
+Status Redis::PfAdd(const Slice& key, const std::vector<std::string>& values, bool* update) {
+  *update = false;
+  ScopeRecordLock l(lock_mgr_, key);
+
+  HyperLogLog log(Storage::kPrecision);
+  uint64_t etime = 0;
+  Status s = GetHyperLogLog(key, &log, &etime);
+  if (!s.ok() && !s.IsNotFound()) {
+    return s;
+  }
+  // a new key is written even without values
+  bool changed = s.IsNotFound();
+  for (const auto& value : values) {
+    if (log.Add(value.data(), value.size())) {
+      changed = true;
+    }
+  }
+  if (!changed) {
+    return Status::OK();
+  }
+  *update = true;
+  BaseKey base_key(key);
+  StringsValue strings_value(log.Encode());
+  strings_value.SetEtime(etime);
+  auto batch = Batch::CreateBatch(this);
+  batch->Put(kStringsCF, base_key.Encode(), strings_value.Encode());
+  return batch->Commit();
+}
+
+Status Redis::PfMerge(const Slice& key, const HyperLogLog& sources, std::string* value) {
+  ScopeRecordLock l(lock_mgr_, key);
+
+  HyperLogLog log(Storage::kPrecision);
+  uint64_t etime = 0;
+  Status s = GetHyperLogLog(key, &log, &etime);
+  if (!s.ok() && !s.IsNotFound()) {
+    return s;
+  }
+  log.Merge(sources);
+  *value = log.Encode();
+  BaseKey base_key(key);
+  StringsValue strings_value(*value);
+  strings_value.SetEtime(etime);
+  auto batch = Batch::CreateBatch(this);
+  batch->Put(kStringsCF, base_key.Encode(), strings_value.Encode());
+  return batch->Commit();
+}
+
 }  //  namespace storage
@@ -15,6 +15,7 @@
 #include "src/base_data_value_format.h"
 #include "src/base_key_format.h"
 #include "src/batch.h"
+#include "src/iterate_bounds.h"
 #include "src/redis.h"
 #include "src/scope_record_lock.h"
 #include "src/scope_snapshot.h"
@@ -22,6 +23,15 @@
 #include "storage/util.h"
 
 namespace storage {
+static const char kZSetPopMinHint = '<';
+static const char kZSetPopMaxHint = '>';
+
+static std::string ZSetPopHintKey(char end, const Slice& key) {
+  std::string hint_key(1, end);
+  hint_key.append(key.data(), key.size());
+  return hint_key;
+}
+
 Status Redis::ScanZsetsKeyNum(KeyInfo* key_info) {
   uint64_t keys = 0;
   uint64_t expires = 0;
@@ -60,6 +70,10 @@ Status Redis::ScanZsetsKeyNum(KeyInfo* key_info) {
 }
 
 Status Redis::ZsetsPKPatternMatchDel(const std::string& pattern, int32_t* ret) {
+  if (pattern == "*" || isTailWildcard(pattern)) {
+    return PKPrefixRangeDel(DataType::kZSets, pattern.substr(0, pattern.size() - 1), ret);
+  }
+
   rocksdb::ReadOptions iterator_options;
   const rocksdb::Snapshot* snapshot;
   ScopeSnapshot ss(db_, &snapshot);
@@ -122,14 +136,18 @@ Status Redis::ZPopMax(const Slice& key, const int64_t count, std::vector<ScoreMe
     } else if (parsed_zsets_meta_value.Count() == 0) {
       return Status::NotFound();
     } else {
-      int64_t num = parsed_zsets_meta_value.Count();
-      num = num <= count ? num : count;
+      int64_t total = parsed_zsets_meta_value.Count();
+      int64_t num = total <= count ? total : count;
       uint64_t version = parsed_zsets_meta_value.Version();
       ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::max(), Slice());
+      std::string seek_key = zsets_score_key.Encode().ToString();
+      std::string hint_key = ZSetPopHintKey(kZSetPopMaxHint, key);
+      SeekKeyFromPopHint(hint_key, key, version, &seek_key);
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kZsetsScoreCF]);
+      auto bounds = IterateBounds::ZSetsScore(key, version);
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(default_read_options_), handles_[kZsetsScoreCF]);
       int32_t del_cnt = 0;
-      for (iter->SeekForPrev(zsets_score_key.Encode()); iter->Valid() && del_cnt < num; iter->Prev()) {
+      for (iter->SeekForPrev(seek_key); iter->Valid() && del_cnt < num;) {
         ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
         score_members->emplace_back(
             ScoreMember{parsed_zsets_score_key.score(), parsed_zsets_score_key.member().ToString()});
@@ -138,7 +156,12 @@ Status Redis::ZPopMax(const Slice& key, const int64_t count, std::vector<ScoreMe
         ++del_cnt;
         batch->Delete(kZsetsDataCF, zsets_member_key.Encode());
         batch->Delete(kZsetsScoreCF, iter->key());
+        // stop on the last member, the tombstones before it may run into other keys
+        if (del_cnt < total) {
+          iter->Prev();
+        }
       }
+      std::string next_hint = (del_cnt < total && iter->Valid()) ? iter->key().ToString() : std::string();
       delete iter;
       if (!parsed_zsets_meta_value.CheckModifyCount(-del_cnt)) {
         return Status::InvalidArgument("zset size overflow");
@@ -146,6 +169,7 @@ Status Redis::ZPopMax(const Slice& key, const int64_t count, std::vector<ScoreMe
       parsed_zsets_meta_value.ModifyCount(-del_cnt);
       batch->Put(kZsetsMetaCF, base_meta_key.Encode(), meta_value);
       s = batch->Commit();
+      UpdateZSetPopHint(s, hint_key, next_hint);
       UpdateSpecificKeyStatistics(DataType::kZSets, key.ToString(), statistic);
       return s;
     }
@@ -170,14 +194,18 @@ Status Redis::ZPopMin(const Slice& key, const int64_t count, std::vector<ScoreMe
     } else if (parsed_zsets_meta_value.Count() == 0) {
       return Status::NotFound();
     } else {
-      int64_t num = parsed_zsets_meta_value.Count();
-      num = num <= count ? num : count;
+      int64_t total = parsed_zsets_meta_value.Count();
+      int64_t num = total <= count ? total : count;
       uint64_t version = parsed_zsets_meta_value.Version();
       ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::lowest(), Slice());
+      std::string seek_key = zsets_score_key.Encode().ToString();
+      std::string hint_key = ZSetPopHintKey(kZSetPopMinHint, key);
+      SeekKeyFromPopHint(hint_key, key, version, &seek_key);
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kZsetsScoreCF]);
+      auto bounds = IterateBounds::ZSetsScore(key, version);
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(default_read_options_), handles_[kZsetsScoreCF]);
       int32_t del_cnt = 0;
-      for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && del_cnt < num; iter->Next()) {
+      for (iter->Seek(seek_key); iter->Valid() && del_cnt < num;) {
         ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
         score_members->emplace_back(
             ScoreMember{parsed_zsets_score_key.score(), parsed_zsets_score_key.member().ToString()});
@@ -186,7 +214,12 @@ Status Redis::ZPopMin(const Slice& key, const int64_t count, std::vector<ScoreMe
         ++del_cnt;
         batch->Delete(kZsetsDataCF, zsets_member_key.Encode());
         batch->Delete(kZsetsScoreCF, iter->key());
+        // stop on the last member, the tombstones after it may run into other keys
+        if (del_cnt < total) {
+          iter->Next();
+        }
       }
+      std::string next_hint = (del_cnt < total && iter->Valid()) ? iter->key().ToString() : std::string();
       delete iter;
       if (!parsed_zsets_meta_value.CheckModifyCount(-del_cnt)) {
         return Status::InvalidArgument("zset size overflow");
@@ -194,6 +227,7 @@ Status Redis::ZPopMin(const Slice& key, const int64_t count, std::vector<ScoreMe
       parsed_zsets_meta_value.ModifyCount(-del_cnt);
       batch->Put(kZsetsMetaCF, base_meta_key.Encode(), meta_value);
       s = batch->Commit();
+      UpdateZSetPopHint(s, hint_key, next_hint);
       UpdateSpecificKeyStatistics(DataType::kZSets, key.ToString(), statistic);
       return s;
     }
@@ -202,6 +236,37 @@ Status Redis::ZPopMin(const Slice& key, const int64_t count, std::vector<ScoreMe
   }
 }
 
+/*
+ * Every score key of the zset below the min hint (or above the max hint) was
+ * popped, so the next pop can seek to the hint instead of stepping over the
+ * tombstones left by the previous pops. A hint is only trusted for the same
+ * version of the key, and every write that can add a score key drops them.
+ */
+void Redis::SeekKeyFromPopHint(const std::string& hint_key, const Slice& key, uint64_t version,
+                               std::string* seek_key) {
+  std::string hint;
+  if (!zset_pop_hints_->Lookup(hint_key, &hint).ok()) {
+    return;
+  }
+  ParsedZSetsScoreKey parsed_zsets_score_key(hint);
+  if (parsed_zsets_score_key.key() == key && parsed_zsets_score_key.Version() == version) {
+    *seek_key = std::move(hint);
+  }
+}
+
+void Redis::UpdateZSetPopHint(const Status& s, const std::string& hint_key, const std::string& next_hint) {
+  if (s.ok() && !next_hint.empty()) {
+    zset_pop_hints_->Insert(hint_key, next_hint);
+  } else {
+    zset_pop_hints_->Remove(hint_key);
+  }
+}
+
+void Redis::InvalidateZSetPopHints(const Slice& key) {
+  zset_pop_hints_->Remove(ZSetPopHintKey(kZSetPopMinHint, key));
+  zset_pop_hints_->Remove(ZSetPopHintKey(kZSetPopMaxHint, key));
+}
+
 Status Redis::ZAdd(const Slice& key, const std::vector<ScoreMember>& score_members, int32_t* ret) {
   *ret = 0;
   uint32_t statistic = 0;
@@ -219,6 +284,7 @@ Status Redis::ZAdd(const Slice& key, const std::vector<ScoreMember>& score_membe
   std::string meta_value;
   auto batch = Batch::CreateBatch(this);
   ScopeRecordLock l(lock_mgr_, key);
+  InvalidateZSetPopHints(key);
 
   BaseMetaKey base_meta_key(key);
   Status s = db_->Get(default_read_options_, handles_[kZsetsMetaCF], base_meta_key.Encode(), &meta_value);
@@ -351,7 +417,8 @@ Status Redis::ZCount(const Slice& key, double min, double max, bool left_close,
       ScoreMember score_member;
       ZSetsScoreKey zsets_score_key(key, version, min, Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
+      auto bounds = IterateBounds::ZSetsScore(key, version);
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kZsetsScoreCF]);
       for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
         bool left_pass = false;
         bool right_pass = false;
@@ -392,6 +459,7 @@ Status Redis::ZIncrby(const Slice& key, const Slice& member, double increment, d
   std::string meta_value;
   rocksdb::WriteBatch batch;
   ScopeRecordLock l(lock_mgr_, key);
+  InvalidateZSetPopHints(key);
 
   BaseMetaKey base_meta_key(key);
   Status s = db_->Get(default_read_options_, handles_[kZsetsMetaCF], base_meta_key.Encode(), &meta_value);
@@ -484,7 +552,8 @@ Status Redis::ZRange(const Slice& key, int32_t start, int32_t stop, std::vector<
 
       ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::lowest(), Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
+      auto bounds = IterateBounds::ZSetsScore(key, version);
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kZsetsScoreCF]);
       for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
         if (cur_index >= start_index) {
           ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
@@ -541,7 +610,8 @@ Status Redis::ZRangeWithTTL(const Slice& key, int32_t start, int32_t stop, std::
       ScoreMember score_member;
       ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::lowest(), Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
+      auto bounds = IterateBounds::ZSetsScore(key, version);
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kZsetsScoreCF]);
       for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
         if (cur_index >= start_index) {
           ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
@@ -582,7 +652,8 @@ Status Redis::ZRangebyscore(const Slice& key, double min, double max, bool left_
       ScoreMember score_member;
       ZSetsScoreKey zsets_score_key(key, version, min, Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
+      auto bounds = IterateBounds::ZSetsScore(key, version);
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kZsetsScoreCF]);
       for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && index <= stop_index; iter->Next(), ++index) {
         bool left_pass = false;
         bool right_pass = false;
@@ -649,7 +720,8 @@ Status Redis::ZRank(const Slice& key, const Slice& member, int32_t* rank) {
       ScoreMember score_member;
       ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::lowest(), Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
+      auto bounds = IterateBounds::ZSetsScore(key, version);
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kZsetsScoreCF]);
       for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && index <= stop_index; iter->Next(), ++index) {
         ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
         if (parsed_zsets_score_key.member().compare(member) == 0) {
@@ -761,7 +833,8 @@ Status Redis::ZRemrangebyrank(const Slice& key, int32_t start, int32_t stop, int
       }
       ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::lowest(), Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kZsetsScoreCF]);
+      auto bounds = IterateBounds::ZSetsScore(key, version);
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(default_read_options_), handles_[kZsetsScoreCF]);
       for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
         if (cur_index >= start_index) {
           ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
@@ -812,7 +885,8 @@ Status Redis::ZRemrangebyscore(const Slice& key, double min, double max, bool le
       uint64_t version = parsed_zsets_meta_value.Version();
       ZSetsScoreKey zsets_score_key(key, version, min, Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(default_read_options_, handles_[kZsetsScoreCF]);
+      auto bounds = IterateBounds::ZSetsScore(key, version);
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(default_read_options_), handles_[kZsetsScoreCF]);
       for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
         bool left_pass = false;
         bool right_pass = false;
@@ -889,7 +963,8 @@ Status Redis::ZRevrange(const Slice& key, int32_t start, int32_t stop, std::vect
       ScoreMember score_member;
       ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::max(), Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
+      auto bounds = IterateBounds::ZSetsScore(key, version);
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kZsetsScoreCF]);
       for (iter->SeekForPrev(zsets_score_key.Encode()); iter->Valid() && cur_index >= start_index;
            iter->Prev(), --cur_index) {
         if (cur_index <= stop_index) {
@@ -930,7 +1005,8 @@ Status Redis::ZRevrangebyscore(const Slice& key, double min, double max, bool le
       ScoreMember score_member;
       ZSetsScoreKey zsets_score_key(key, version, std::nextafter(max, std::numeric_limits<double>::max()), Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
+      auto bounds = IterateBounds::ZSetsScore(key, version);
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kZsetsScoreCF]);
       for (iter->SeekForPrev(zsets_score_key.Encode()); iter->Valid() && left > 0; iter->Prev(), --left) {
         bool left_pass = false;
         bool right_pass = false;
@@ -996,7 +1072,8 @@ Status Redis::ZRevrank(const Slice& key, const Slice& member, int32_t* rank) {
       uint64_t version = parsed_zsets_meta_value.Version();
       ZSetsScoreKey zsets_score_key(key, version, std::numeric_limits<double>::max(), Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
+      auto bounds = IterateBounds::ZSetsScore(key, version);
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kZsetsScoreCF]);
       for (iter->SeekForPrev(zsets_score_key.Encode()); iter->Valid() && left >= 0; iter->Prev(), --left, ++rev_index) {
         ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
         if (parsed_zsets_score_key.member().compare(member) == 0) {
@@ -1072,7 +1149,8 @@ Status Redis::ZGetAll(const Slice& key, double weight, std::map<std::string, dou
       uint64_t version = parsed_zsets_meta_value.Version();
       ZSetsScoreKey zsets_score_key(key.ToString(), version, std::numeric_limits<double>::lowest(), Slice());
       Slice seek_key = zsets_score_key.Encode();
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
+      auto bounds = IterateBounds::ZSetsScore(key, version);
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kZsetsScoreCF]);
       for (iter->Seek(seek_key); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
         ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
         double score = parsed_zsets_score_key.score() * weight;
@@ -1100,6 +1178,7 @@ Status Redis::ZUnionstore(const Slice& destination, const std::vector<std::strin
   ScopeSnapshot ss(db_, &snapshot);
   read_options.snapshot = snapshot;
   ScopeRecordLock l(lock_mgr_, destination);
+  InvalidateZSetPopHints(destination);
   std::map<std::string, double> member_score_map;
 
   Status s;
@@ -1116,7 +1195,8 @@ Status Redis::ZUnionstore(const Slice& destination, const std::vector<std::strin
         version = parsed_zsets_meta_value.Version();
         ZSetsScoreKey zsets_score_key(keys[idx], version, std::numeric_limits<double>::lowest(), Slice());
         KeyStatisticsDurationGuard guard(this, DataType::kZSets, keys[idx]);
-        rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
+        auto bounds = IterateBounds::ZSetsScore(keys[idx], version);
+        rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kZsetsScoreCF]);
         for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && cur_index <= stop_index;
              iter->Next(), ++cur_index) {
           ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
@@ -1202,6 +1282,7 @@ Status Redis::ZInterstore(const Slice& destination, const std::vector<std::strin
   ScopeSnapshot ss(db_, &snapshot);
   read_options.snapshot = snapshot;
   ScopeRecordLock l(lock_mgr_, destination);
+  InvalidateZSetPopHints(destination);
 
   std::string meta_value;
   uint64_t version = 0;
@@ -1238,7 +1319,8 @@ Status Redis::ZInterstore(const Slice& destination, const std::vector<std::strin
     ZSetsScoreKey zsets_score_key(valid_zsets[0].key, valid_zsets[0].version, std::numeric_limits<double>::lowest(),
                                   Slice());
     KeyStatisticsDurationGuard guard(this, DataType::kZSets, valid_zsets[0].key);
-    rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsScoreCF]);
+    auto bounds = IterateBounds::ZSetsScore(valid_zsets[0].key, valid_zsets[0].version);
+    rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kZsetsScoreCF]);
     for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
       ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
       double score = parsed_zsets_score_key.score();
@@ -1349,7 +1431,8 @@ Status Redis::ZRangebylex(const Slice& key, const Slice& min, const Slice& max,
       int32_t stop_index = parsed_zsets_meta_value.Count() - 1;
       ZSetsMemberKey zsets_member_key(key, version, Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsDataCF]);
+      auto bounds = IterateBounds::Prefix(zsets_member_key.EncodeSeekKey());
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kZsetsDataCF]);
       for (iter->Seek(zsets_member_key.Encode()); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
         bool left_pass = false;
         bool right_pass = false;
@@ -1412,7 +1495,8 @@ Status Redis::ZRemrangebylex(const Slice& key, const Slice& min, const Slice& ma
       int32_t stop_index = parsed_zsets_meta_value.Count() - 1;
       ZSetsMemberKey zsets_member_key(key, version, Slice());
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsDataCF]);
+      auto bounds = IterateBounds::Prefix(zsets_member_key.EncodeSeekKey());
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kZsetsDataCF]);
       for (iter->Seek(zsets_member_key.Encode()); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
         bool left_pass = false;
         bool right_pass = false;
@@ -1477,7 +1561,8 @@ Status Redis::ZsetsExpire(const Slice& key, uint64_t ttl) {
     } else {
       parsed_zsets_meta_value.InitialMetaValue();
     }
-    s = db_->Put(default_write_options_, handles_[kZsetsMetaCF], base_meta_key.Encode(), meta_value);
+    s = UpdateMetaWithExpireIndex(DataType::kZSets, key, base_meta_key.Encode(), meta_value,
+                                  parsed_zsets_meta_value.Etime());
   }
   return s;
 }
@@ -1522,7 +1607,8 @@ Status Redis::ZsetsExpireat(const Slice& key, uint64_t timestamp) {
       } else {
         parsed_zsets_meta_value.InitialMetaValue();
       }
-      return db_->Put(default_write_options_, handles_[kZsetsMetaCF], base_meta_key.Encode(), meta_value);
+      return UpdateMetaWithExpireIndex(DataType::kZSets, key, base_meta_key.Encode(), meta_value,
+                                       parsed_zsets_meta_value.Etime());
     }
   }
   return s;
@@ -1572,7 +1658,8 @@ Status Redis::ZScan(const Slice& key, int64_t cursor, const std::string& pattern
       ZSetsMemberKey zsets_member_key(key, version, start_point);
       std::string prefix = zsets_member_prefix.EncodeSeekKey().ToString();
       KeyStatisticsDurationGuard guard(this, DataType::kZSets, key.ToString());
-      rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[kZsetsDataCF]);
+      auto bounds = IterateBounds::Prefix(prefix);
+      rocksdb::Iterator* iter = db_->NewIterator(bounds.Bound(read_options), handles_[kZsetsDataCF]);
       for (iter->Seek(zsets_member_key.Encode()); iter->Valid() && rest > 0 && iter->key().starts_with(prefix);
            iter->Next()) {
         ParsedZSetsMemberKey parsed_zsets_member_key(iter->key());
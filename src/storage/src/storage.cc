@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <filesystem>
 #include <future>
+#include <limits>
 #include <string_view>
 #include <utility>
 #include <vector>
@@ -15,14 +16,19 @@
 #include "pstd/log.h"
 #include "pstd/pikiwidb_slot.h"
 #include "pstd/pstd_string.h"
+#include "rocksdb/unique_id.h"
 #include "rocksdb/utilities/checkpoint.h"
 #include "scope_snapshot.h"
+#include "src/bit_ops.h"
+#include "src/iterate_bounds.h"
+#include "src/lists_data_key_format.h"
 #include "src/lru_cache.h"
 #include "src/mutex_impl.h"
 #include "src/options_helper.h"
 #include "src/redis.h"
 #include "src/redis_hyperloglog.h"
 #include "src/type_iterator.h"
+#include "src/zsets_data_key_format.h"
 #include "storage/slot_indexer.h"
 #include "storage/storage.h"
 #include "storage/util.h"
@@ -31,7 +37,6 @@
 #define SST_FILE_EXTENSION ".sst"
 
 namespace storage {
-extern std::string BitOpOperate(BitOpType op, const std::vector<std::string>& src_values, int64_t max_len);
 class Redis;
 
 Status StorageOptions::ResetOptions(const OptionType& option_type,
@@ -72,6 +77,13 @@ Storage::Storage() {
 
 Storage::~Storage() {
   INFO("Storage begin to clear storage!");
+  if (expire_reaper_thread_id_ != 0) {
+    expire_reaper_should_exit_.store(true);
+    expire_reaper_cond_var_.notify_one();
+    if (int ret = pthread_join(expire_reaper_thread_id_, nullptr); ret != 0) {
+      ERROR("pthread_join failed with expire reaper thread error : {}", ret);
+    }
+  }
   bg_tasks_should_exit_.store(true);
   bg_tasks_cond_var_.notify_one();
   if (is_opened_.load()) {
@@ -144,6 +156,7 @@ Status Storage::Open(const StorageOptions& storage_options, const std::string& d
   db_instance_num_ = storage_options.db_instance_num;
   // Temporarily set to 100000
   LogIndexAndSequenceCollector::max_gap_.store(storage_options.max_gap);
+  LogIndexAndSequenceCollector::max_gap_bytes_.store(storage_options.max_gap_bytes);
   storage_options.options.write_buffer_manager =
       std::make_shared<rocksdb::WriteBufferManager>(storage_options.mem_manager_size);
   for (size_t index = 0; index < db_instance_num_; index++) {
@@ -158,26 +171,42 @@ Status Storage::Open(const StorageOptions& storage_options, const std::string& d
 
   slot_indexer_ = std::make_unique<SlotIndexer>(db_instance_num_);
   db_id_ = storage_options.db_id;
+  storage_options_ = storage_options;
 
   is_opened_.store(true);
+
+  expire_reap_keys_per_second_ = storage_options.expire_reap_keys_per_second;
+  is_leader_function_ = storage_options.is_leader_function;
+  density_compaction_ratio_ = static_cast<double>(storage_options.density_compaction_percent) / 100;
+  density_compaction_max_ranges_ = storage_options.density_compaction_max_ranges;
+  if (expire_reap_keys_per_second_ > 0 || density_compaction_ratio_ > 0) {
+    if (auto s = StartExpireReaper(); !s.ok()) {
+      ERROR("start expire reaper failed, {}", s.ToString());
+    }
+  }
   return Status::OK();
 }
 
-std::vector<std::future<Status>> Storage::CreateCheckpoint(const std::string& checkpoint_path) {
+std::vector<std::future<Status>> Storage::CreateCheckpoint(const std::string& checkpoint_path,
+                                                           uint64_t log_size_for_flush, int index) {
   INFO("DB{} begin to generate a checkpoint to {}", db_id_, checkpoint_path);
   //  auto source_dir = AppendSubDirectory(checkpoint_path, db_id_);
 
   std::vector<std::future<Status>> result;
   result.reserve(db_instance_num_);
   for (int i = 0; i < db_instance_num_; ++i) {
+    if (index != -1 && i != index) {
+      continue;
+    }
     // In a new thread, create a checkpoint for the specified rocksdb i.
-    auto res = std::async(std::launch::async, &Storage::CreateCheckpointInternal, this, checkpoint_path, i);
+    auto res = std::async(std::launch::async, &Storage::CreateCheckpointInternal, this, checkpoint_path, i,
+                          log_size_for_flush);
     result.push_back(std::move(res));
   }
   return result;
 }
 
-Status Storage::CreateCheckpointInternal(const std::string& checkpoint_path, int index) {
+Status Storage::CreateCheckpointInternal(const std::string& checkpoint_path, int index, uint64_t log_size_for_flush) {
   auto source_dir = AppendSubDirectory(checkpoint_path, index);
 
   auto tmp_dir = source_dir + ".tmp";
@@ -198,7 +227,7 @@ Status Storage::CreateCheckpointInternal(const std::string& checkpoint_path, int
 
   // 3) Create a checkpoint
   std::unique_ptr<rocksdb::Checkpoint> checkpoint_guard(checkpoint);
-  s = checkpoint->CreateCheckpoint(tmp_dir, kFlush, nullptr);
+  s = checkpoint->CreateCheckpoint(tmp_dir, log_size_for_flush, nullptr);
   if (!s.ok()) {
     WARN("DB{}'s RocksDB {} create checkpoint failed!. Error: {}", db_id_, index, s.ToString());
     return s;
@@ -227,6 +256,24 @@ Status Storage::CreateCheckpointInternal(const std::string& checkpoint_path, int
   return Status::OK();
 }
 
+Status Storage::GetTableUniqueIds(int index, std::unordered_map<std::string, std::string>* ids) {
+  auto db = insts_[index]->GetDB();
+  for (auto handle : insts_[index]->GetColumnFamilyHandles()) {
+    rocksdb::TablePropertiesCollection props;
+    if (auto s = db->GetPropertiesOfAllTables(handle, &props); !s.ok()) {
+      return s;
+    }
+    for (const auto& [path, table_props] : props) {
+      std::string id;
+      if (!rocksdb::GetUniqueIdFromTableProperties(*table_props, &id).ok()) {
+        continue;
+      }
+      (*ids)[std::filesystem::path(path).filename().string()] = rocksdb::Slice(id).ToString(true);
+    }
+  }
+  return Status::OK();
+}
+
 std::vector<std::future<Status>> Storage::LoadCheckpoint(const std::string& checkpoint_sub_path,
                                                          const std::string& db_sub_path) {
   INFO("DB{} begin to load a checkpoint from {} to {}", db_id_, checkpoint_sub_path, db_sub_path);
@@ -245,6 +292,7 @@ Status Storage::LoadCheckpointInternal(const std::string& checkpoint_sub_path, c
                                        int index) {
   auto rocksdb_path = AppendSubDirectory(db_sub_path, index);  // ./db/db_id/index
   auto tmp_rocksdb_path = rocksdb_path + ".tmp";               // ./db/db_id/index.tmp
+  insts_[index]->SetNeedClose(true);
   insts_[index].reset();
 
   auto source_dir = AppendSubDirectory(checkpoint_sub_path, index);
@@ -276,6 +324,20 @@ Status Storage::LoadCheckpointInternal(const std::string& checkpoint_sub_path, c
   return Status::OK();
 }
 
+Status Storage::LoadInstanceCheckpoint(const std::string& checkpoint_sub_path, const std::string& db_sub_path,
+                                      int index) {
+  INFO("DB{}'s RocksDB {} begin to load a checkpoint from {} to {}", db_id_, index, checkpoint_sub_path, db_sub_path);
+  auto s = LoadCheckpointInternal(checkpoint_sub_path, db_sub_path, index);
+  // the old files are back when the load failed, the instance is opened
+  // again either way
+  insts_[index] = std::make_unique<Redis>(this, index);
+  if (auto open = insts_[index]->Open(storage_options_, AppendSubDirectory(db_sub_path, index)); !open.ok()) {
+    ERROR("DB{}'s RocksDB {} open failed {}", db_id_, index, open.ToString());
+    return open;
+  }
+  return s;
+}
+
 Status Storage::LoadCursorStartKey(const DataType& dtype, int64_t cursor, char* type, std::string* start_key) {
   std::string index_key = DataTypeTag[dtype] + std::to_string(cursor);
   std::string index_value;
@@ -298,10 +360,9 @@ Status Storage::StoreCursorStartKey(const DataType& dtype, int64_t cursor, char
 
 std::unique_ptr<Redis>& Storage::GetDBInstance(const Slice& key) { return GetDBInstance(key.ToString()); }
 
-std::unique_ptr<Redis>& Storage::GetDBInstance(const std::string& key) {
-  auto inst_index = slot_indexer_->GetInstanceID(GetSlotID(key));
-  return insts_[inst_index];
-}
+std::unique_ptr<Redis>& Storage::GetDBInstance(const std::string& key) { return insts_[GetInstanceIndex(key)]; }
+
+size_t Storage::GetInstanceIndex(const std::string& key) { return slot_indexer_->GetInstanceID(GetSlotID(key)); }
 
 // Strings Commands
 Status Storage::Set(const Slice& key, const Slice& value) {
@@ -1479,11 +1540,12 @@ int64_t Storage::Scan(const DataType& dtype, int64_t cursor, const std::string&
     types.push_back(DataTypeTag[dtype]);
   }
 
+  auto bounds = IterateBounds::MetaKeyPrefix(prefix);
   for (const auto& type : types) {
     std::vector<IterSptr> inst_iters;
     for (const auto& inst : insts_) {
       IterSptr iter_sptr;
-      iter_sptr.reset(inst->CreateIterator(type, pattern, nullptr /*lower_bound*/, nullptr /*upper_bound*/));
+      iter_sptr.reset(inst->CreateIterator(type, pattern, bounds.LowerBound(), bounds.UpperBound()));
       inst_iters.push_back(iter_sptr);
     }
 
@@ -1538,11 +1600,13 @@ Status Storage::PKScanRange(const DataType& data_type, const Slice& key_start, c
     return Status::InvalidArgument("error in given range");
   }
 
+  // the meta key of key_end is the greatest one of the range
+  IterateBounds bounds(start_no_limit ? std::string() : base_key_start.Encode().ToString(),
+                       end_no_limit ? std::string() : PrefixSuccessor(base_key_end_slice));
   std::vector<IterSptr> inst_iters;
   for (const auto& inst : insts_) {
     IterSptr iter_sptr;
-    iter_sptr.reset(
-        inst->CreateIterator(data_type, pattern.ToString(), nullptr /*lower_bound*/, nullptr /*upper_bound*/));
+    iter_sptr.reset(inst->CreateIterator(data_type, pattern.ToString(), bounds.LowerBound(), bounds.UpperBound()));
     inst_iters.push_back(iter_sptr);
   }
 
@@ -1586,11 +1650,12 @@ Status Storage::PKRScanRange(const DataType& data_type, const Slice& key_start,
     return Status::InvalidArgument("error in given range");
   }
 
+  IterateBounds bounds(end_no_limit ? std::string() : base_key_end.Encode().ToString(),
+                       start_no_limit ? std::string() : PrefixSuccessor(base_key_start_slice));
   std::vector<IterSptr> inst_iters;
   for (const auto& inst : insts_) {
     IterSptr iter_sptr;
-    iter_sptr.reset(
-        inst->CreateIterator(data_type, pattern.ToString(), nullptr /*lower_bound*/, nullptr /*upper_bound*/));
+    iter_sptr.reset(inst->CreateIterator(data_type, pattern.ToString(), bounds.LowerBound(), bounds.UpperBound()));
     inst_iters.push_back(iter_sptr);
   }
   MergingIterator miter(inst_iters);
@@ -1618,56 +1683,61 @@ Status Storage::PKRScanRange(const DataType& data_type, const Slice& key_start,
 
 Status Storage::PKPatternMatchDel(const DataType& data_type, const std::string& pattern, int32_t* ret) {
   Status s;
+  *ret = 0;
   for (const auto& inst : insts_) {
+    int32_t inst_ret = 0;
     switch (data_type) {
-      case DataType::kStrings: {
-        s = inst->StringsPKPatternMatchDel(pattern, ret);
-        if (!s.ok()) {
-          return s;
-        }
-      }
-      case DataType::kHashes: {
-        s = inst->HashesPKPatternMatchDel(pattern, ret);
-        if (!s.ok()) {
-          return s;
-        }
-      }
-      case DataType::kLists: {
-        s = inst->ListsPKPatternMatchDel(pattern, ret);
-        if (!s.ok()) {
-          return s;
-        }
-      }
-      case DataType::kZSets: {
-        s = inst->ZsetsPKPatternMatchDel(pattern, ret);
-        if (!s.ok()) {
-          return s;
-        }
-      }
-      case DataType::kSets: {
-        s = inst->SetsPKPatternMatchDel(pattern, ret);
-        if (!s.ok()) {
-          return s;
-        }
-      }
+      case DataType::kStrings:
+        s = inst->StringsPKPatternMatchDel(pattern, &inst_ret);
+        break;
+      case DataType::kHashes:
+        s = inst->HashesPKPatternMatchDel(pattern, &inst_ret);
+        break;
+      case DataType::kLists:
+        s = inst->ListsPKPatternMatchDel(pattern, &inst_ret);
+        break;
+      case DataType::kZSets:
+        s = inst->ZsetsPKPatternMatchDel(pattern, &inst_ret);
+        break;
+      case DataType::kSets:
+        s = inst->SetsPKPatternMatchDel(pattern, &inst_ret);
+        break;
       default:
         s = Status::Corruption("Unsupported data types");
         break;
     }
+    if (!s.ok()) {
+      return s;
+    }
+    *ret += inst_ret;
   }
   return s;
 }
 
+Status Storage::FlushDB() {
+  for (const auto& inst : insts_) {
+    Status s = inst->FlushDB();
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  // the range tombstones are compacted away later in the bg thread
+  AddBGTask({kAll, kCleanAll});
+  return Status::OK();
+}
+
 Status Storage::Scanx(const DataType& data_type, const std::string& start_key, const std::string& pattern,
                       int64_t count, std::vector<std::string>* keys, std::string* next_key) {
   Status s;
   keys->clear();
   next_key->clear();
 
+  std::string prefix = isTailWildcard(pattern) ? pattern.substr(0, pattern.size() - 1) : "";
+  auto bounds = IterateBounds::MetaKeyPrefix(prefix);
   std::vector<IterSptr> inst_iters;
   for (const auto& inst : insts_) {
     IterSptr iter_sptr;
-    iter_sptr.reset(inst->CreateIterator(data_type, pattern, nullptr /*lower_bound*/, nullptr /*upper_bound*/));
+    iter_sptr.reset(inst->CreateIterator(data_type, pattern, bounds.LowerBound(), bounds.UpperBound()));
     inst_iters.push_back(iter_sptr);
   }
 
@@ -1680,7 +1750,6 @@ Status Storage::Scanx(const DataType& data_type, const std::string& start_key, c
     count--;
   }
 
-  std::string prefix = isTailWildcard(pattern) ? pattern.substr(0, pattern.size() - 1) : "";
   if (miter.Valid() && (miter.Key().compare(prefix) <= 0 || miter.Key().substr(0, prefix.size()) == prefix)) {
     *next_key = miter.Key();
   } else {
@@ -1912,11 +1981,13 @@ Status Storage::Keys(const DataType& data_type, const std::string& pattern, std:
     types.push_back(data_type);
   }
 
+  std::string prefix = isTailWildcard(pattern) ? pattern.substr(0, pattern.size() - 1) : "";
+  auto bounds = IterateBounds::MetaKeyPrefix(prefix);
   for (const auto& type : types) {
     std::vector<IterSptr> inst_iters;
     for (const auto& inst : insts_) {
       IterSptr inst_iter;
-      inst_iter.reset(inst->CreateIterator(type, pattern, nullptr /*lower_bound*/, nullptr /*upper_bound*/));
+      inst_iter.reset(inst->CreateIterator(type, pattern, bounds.LowerBound(), bounds.UpperBound()));
       inst_iters.push_back(inst_iter);
     }
 
@@ -2057,36 +2128,23 @@ void Storage::ScanDatabase(const DataType& type) {
 }
 
 // HyperLogLog
+// Reads the HyperLogLog of key into log, an empty one if key does not exist
+static Status GetHyperLogLog(const std::unique_ptr<Redis>& inst, const Slice& key, HyperLogLog* log) {
+  std::string value;
+  Status s = inst->Get(key, &value);
+  if (s.ok() && !log->Decode(value)) {
+    return Status::Corruption("Key is not a valid HyperLogLog string value");
+  }
+  return s;
+}
+
 Status Storage::PfAdd(const Slice& key, const std::vector<std::string>& values, bool* update) {
   *update = false;
   if (values.size() >= kMaxKeys) {
     return Status::InvalidArgument("Invalid the number of key");
   }
-
-  std::string value;
-  std::string registers;
-  std::string result;
   auto& inst = GetDBInstance(key);
-  Status s = inst->Get(key, &value);
-  if (s.ok()) {
-    registers = value;
-  } else if (s.IsNotFound()) {
-    registers = "";
-  } else {
-    return s;
-  }
-  HyperLogLog log(kPrecision, registers);
-  auto previous = static_cast<int32_t>(log.Estimate());
-  for (const auto& value : values) {
-    result = log.Add(value.data(), value.size());
-  }
-  HyperLogLog update_log(kPrecision, result);
-  auto now = static_cast<int32_t>(update_log.Estimate());
-  if (previous != now || (s.IsNotFound() && values.empty())) {
-    *update = true;
-  }
-  s = inst->Set(key, result);
-  return s;
+  return inst->PfAdd(key, values, update);
 }
 
 Status Storage::PfCount(const std::vector<std::string>& keys, int64_t* result) {
@@ -2094,31 +2152,19 @@ Status Storage::PfCount(const std::vector<std::string>& keys, int64_t* result) {
     return Status::InvalidArgument("Invalid the number of key");
   }
 
-  std::string value;
-  std::string first_registers;
-  auto& inst = GetDBInstance(keys[0]);
-  Status s = inst->Get(keys[0], &value);
-  if (s.ok()) {
-    first_registers = std::string(value.data(), value.size());
-  } else if (s.IsNotFound()) {
-    first_registers = "";
-  }
-
-  HyperLogLog first_log(kPrecision, first_registers);
-  for (size_t i = 1; i < keys.size(); ++i) {
-    std::string value;
-    std::string registers;
+  HyperLogLog first_log(kPrecision);
+  for (size_t i = 0; i < keys.size(); ++i) {
     auto& inst = GetDBInstance(keys[i]);
-    s = inst->Get(keys[i], &value);
-    if (s.ok()) {
-      registers = value;
-    } else if (s.IsNotFound()) {
+    HyperLogLog log(kPrecision);
+    Status s = GetHyperLogLog(inst, keys[i], i == 0 ? &first_log : &log);
+    if (s.IsNotFound()) {
       continue;
-    } else {
+    } else if (!s.ok()) {
       return s;
     }
-    HyperLogLog log(kPrecision, registers);
-    first_log.Merge(log);
+    if (i != 0) {
+      first_log.Merge(log);
+    }
   }
   *result = static_cast<int32_t>(first_log.Estimate());
   return Status::OK();
@@ -2129,39 +2175,22 @@ Status Storage::PfMerge(const std::vector<std::string>& keys, std::string& value
     return Status::InvalidArgument("Invalid the number of key");
   }
 
-  Status s;
-  std::string value;
-  std::string first_registers;
-  std::string result;
-  auto& inst = GetDBInstance(keys[0]);
-  s = inst->Get(keys[0], &value);
-  if (s.ok()) {
-    first_registers = std::string(value.data(), value.size());
-  } else if (s.IsNotFound()) {
-    first_registers = "";
-  }
-
-  result = first_registers;
-  HyperLogLog first_log(kPrecision, first_registers);
+  // the sources are read first, the destination is read and written under its
+  // record lock by its instance
+  HyperLogLog sources(kPrecision);
   for (size_t i = 1; i < keys.size(); ++i) {
-    std::string value;
-    std::string registers;
-    auto& tmp_inst = GetDBInstance(keys[i]);
-    s = tmp_inst->Get(keys[i], &value);
-    if (s.ok()) {
-      registers = std::string(value.data(), value.size());
-    } else if (s.IsNotFound()) {
+    auto& inst = GetDBInstance(keys[i]);
+    HyperLogLog log(kPrecision);
+    Status s = GetHyperLogLog(inst, keys[i], &log);
+    if (s.IsNotFound()) {
       continue;
-    } else {
+    } else if (!s.ok()) {
       return s;
     }
-    HyperLogLog log(kPrecision, registers);
-    result = first_log.Merge(log);
+    sources.Merge(log);
   }
-  auto& ninst = GetDBInstance(keys[0]);
-  s = ninst->Set(keys[0], result);
-  value_to_dest = std::move(result);
-  return s;
+  auto& inst = GetDBInstance(keys[0]);
+  return inst->PfMerge(keys[0], sources, &value_to_dest);
 }
 
 static void* StartBGThreadWrapper(void* arg) {
@@ -2219,11 +2248,88 @@ Status Storage::RunBGTask() {
       if (task.argv.size() == 2) {
         DoCompactRange(task.type, task.argv.front(), task.argv.back());
       }
+    } else if (task.operation == kCompactDensestRanges) {
+      DoCompactDensestRanges();
     }
   }
   return Status::OK();
 }
 
+static void* StartExpireReaperWrapper(void* arg) {
+  auto s = reinterpret_cast<Storage*>(arg);
+  s->RunExpireReaper();
+  return nullptr;
+}
+
+Status Storage::StartExpireReaper() {
+  int result = pthread_create(&expire_reaper_thread_id_, nullptr, StartExpireReaperWrapper, this);
+  if (result != 0) {
+    expire_reaper_thread_id_ = 0;
+    char msg[128];
+    snprintf(msg, sizeof(msg), "pthread create: %s", strerror(result));
+    return Status::Corruption(msg);
+  }
+  return Status::OK();
+}
+
+// Once a second every instance deletes its share of the due keys of the expire
+// index, so the reaper never issues more than expire_reap_keys_per_second_
+// deletes per second. The ranges of deleted keys are compacted in the bg
+// thread once enough keys were reaped, or once the backlog is drained.
+// The same thread schedules a density compaction round every minute, on every
+// node since the tombstones are local to each replica.
+void Storage::RunExpireReaper() {
+  std::map<DataType, std::pair<std::string, std::string>> pending_ranges;
+  size_t pending_count = 0;
+  size_t limit = std::max<size_t>(1, expire_reap_keys_per_second_ / insts_.size());
+  uint64_t rounds = 0;
+
+  while (!expire_reaper_should_exit_.load()) {
+    {
+      std::unique_lock<std::mutex> lock(expire_reaper_mutex_);
+      expire_reaper_cond_var_.wait_for(lock, std::chrono::seconds(1),
+                                       [this]() { return expire_reaper_should_exit_.load(); });
+    }
+    if (expire_reaper_should_exit_.load()) {
+      break;
+    }
+    if (!is_opened_.load()) {
+      continue;
+    }
+    if (density_compaction_ratio_ > 0 && ++rounds % DENSITY_COMPACTION_INTERVAL == 0) {
+      AddBGTask({kAll, kCompactDensestRanges});
+    }
+    if (expire_reap_keys_per_second_ == 0) {
+      continue;
+    }
+
+    size_t round_count = 0;
+    for (const auto& inst : insts_) {
+      if (is_leader_function_ && !is_leader_function_(inst->GetIndex())) {
+        continue;
+      }
+      size_t reaped = 0;
+      auto s = inst->ReapExpiredKeys(limit, &pending_ranges, &reaped);
+      if (!s.ok()) {
+        WARN("DB{} RocksDB{} reap expired keys failed, {}", db_id_, inst->GetIndex(), s.ToString());
+      }
+      round_count += reaped;
+    }
+    pending_count += round_count;
+
+    if (pending_count != 0 && (pending_count >= COMPACT_THRESHOLD_COUNT || round_count == 0)) {
+      for (const auto& [type, range] : pending_ranges) {
+        AddBGTask({type, kCompactRange, {range.first, range.second}});
+      }
+      for (const auto& inst : insts_) {
+        inst->CompactExpireIndex();
+      }
+      pending_ranges.clear();
+      pending_count = 0;
+    }
+  }
+}
+
 Status Storage::Compact(const DataType& type, bool sync) {
   if (sync) {
     return DoCompactRange(type, "", "");
@@ -2305,6 +2411,42 @@ Status Storage::DoCompactSpecificKey(const DataType& type, const std::string& ke
   return s;
 }
 
+// Picks the densest ranges of all instances and compacts at most
+// density_compaction_max_ranges_ of them, the densest first.
+Status Storage::DoCompactDensestRanges() {
+  std::vector<std::pair<Redis*, DensityCompactionRange>> candidates;
+  for (const auto& inst : insts_) {
+    std::vector<DensityCompactionRange> ranges;
+    auto s = inst->GetDensityCompactionRanges(density_compaction_ratio_, &ranges);
+    if (!s.ok()) {
+      WARN("DB{} RocksDB{} get density compaction ranges failed, {}", db_id_, inst->GetIndex(), s.ToString());
+      continue;
+    }
+    for (auto& range : ranges) {
+      candidates.emplace_back(inst.get(), std::move(range));
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const auto& a, const auto& b) { return a.second.dead_entries > b.second.dead_entries; });
+  if (candidates.size() > density_compaction_max_ranges_) {
+    candidates.resize(density_compaction_max_ranges_);
+  }
+
+  Status s;
+  current_task_type_ = Operation::kCompactDensestRanges;
+  for (const auto& [inst, range] : candidates) {
+    if (bg_tasks_should_exit_.load()) {
+      break;
+    }
+    s = inst->CompactColumnFamilyRange(range);
+    if (!s.ok()) {
+      WARN("DB{} RocksDB{} density compaction failed, {}", db_id_, inst->GetIndex(), s.ToString());
+    }
+  }
+  current_task_type_ = Operation::kNone;
+  return s;
+}
+
 Status Storage::SetMaxCacheStatisticKeys(uint32_t max_cache_statistic_keys) {
   for (const auto& inst : insts_) {
     inst->SetMaxCacheStatisticKeys(max_cache_statistic_keys);
@@ -2341,6 +2483,8 @@ std::string Storage::GetCurrentTaskType() {
       return "Set";
     case kCleanLists:
       return "List";
+    case kCompactDensestRanges:
+      return "DensestRanges";
     case kNone:
     default:
       return "No";
@@ -2377,6 +2521,19 @@ uint64_t Storage::GetProperty(const std::string& property) {
   return result;
 }
 
+Status Storage::GetSpaceUsage(std::vector<SpaceUsage>* usages) {
+  usages->clear();
+  for (const auto& inst : insts_) {
+    SpaceUsage usage;
+    auto s = inst->GetSpaceUsage(&usage);
+    if (!s.ok()) {
+      return s;
+    }
+    usages->push_back(usage);
+  }
+  return Status::OK();
+}
+
 Status Storage::GetKeyNum(std::vector<KeyInfo>* key_infos) {
   KeyInfo key_info;
   key_infos->resize(5);
@@ -2472,49 +2629,114 @@ void Storage::DisableWal(const bool is_wal_disable) {
   }
 }
 
-Status Storage::OnBinlogWrite(const pikiwidb::Binlog& log, LogIndex log_idx) {
-  auto& inst = insts_[log.slot_idx()];
+Status Storage::OnBinlogWrite(const BinlogView& log, LogIndex log_idx) {
+  std::vector<Status> statuses;
+  OnBinlogWrite({{&log, log_idx}}, &statuses);
+  return statuses.front();
+}
+
+void Storage::OnBinlogWrite(const std::vector<std::pair<const BinlogView*, LogIndex>>& logs,
+                            std::vector<Status>* statuses) {
+  statuses->assign(logs.size(), Status::OK());
+  if (logs.empty()) {
+    return;
+  }
+  auto& inst = insts_[logs.front().first->SlotIdx()];
 
   rocksdb::WriteBatch batch;
-  bool is_finished_start = true;
   auto seqno = inst->GetDB()->GetLatestSequenceNumber();
-  for (const auto& entry : log.entries()) {
-    if (inst->IsRestarting() && inst->IsApplied(entry.cf_idx(), log_idx)) [[unlikely]] {
-      // If the starting phase is over, the log must not have been applied
-      // If the starting phase is not over and the log has been applied, skip it.
-      WARN("Log {} has been applied", log_idx);
-      is_finished_start = false;
+  // the first sequence number of each log, the collector maps them back to the logs
+  std::vector<SequenceNumber> first_seqnos(logs.size());
+  // the bytes of the keys and values of each log
+  std::vector<uint64_t> log_bytes(logs.size());
+  // the applied log index of the column families, updated for the logs without errors
+  std::vector<std::pair<uint32_t, SequenceNumber>> applied;
+  for (size_t i = 0; i < logs.size(); i++) {
+    const auto& [log, log_idx] = logs[i];
+    assert(log->SlotIdx() == logs.front().first->SlotIdx());
+    first_seqnos[i] = seqno + 1;
+    batch.SetSavePoint();
+    applied.clear();
+    bool is_finished_start = true;
+    for (const auto& entry : log->Entries()) {
+      if (inst->IsRestarting() && inst->IsApplied(entry.cf_idx, log_idx)) [[unlikely]] {
+        // If the starting phase is over, the log must not have been applied
+        // If the starting phase is not over and the log has been applied, skip it.
+        WARN("Log {} has been applied", log_idx);
+        is_finished_start = false;
+        continue;
+      }
+
+      // the score and list keys of the binlogs written before their bytewise encodings
+      std::string (*to_bytewise)(const Slice&) = nullptr;
+      if (entry.cf_idx == kZsetsScoreCF && log->KeyFormat() < kBytewiseScoreKeyFormat) {
+        to_bytewise = LegacyScoreKeyToBytewise;
+      } else if (entry.cf_idx == kListsDataCF && log->KeyFormat() < kBytewiseListIndexKeyFormat) {
+        to_bytewise = LegacyListsDataKeyToBytewise;
+      }
+      log_bytes[i] += entry.key.size() + entry.value.size();
+      std::string converted_key = to_bytewise ? to_bytewise(entry.key) : std::string();
+      Slice key = to_bytewise ? Slice(converted_key) : entry.key;
+
+      // the keys and values are slices of the raft log, copied once into the batch
+      switch (entry.op_type) {
+        case pikiwidb::OperateType::kPut: {
+          assert(entry.has_value);
+          batch.Put(inst->GetColumnFamilyHandles()[entry.cf_idx], key, entry.value);
+          if (entry.cf_idx == kZsetsScoreCF) {
+            // a member added through the log of another leader
+            inst->InvalidateZSetPopHints(ParsedZSetsScoreKey(key).key());
+          }
+        } break;
+        case pikiwidb::OperateType::kDelete: {
+          assert(!entry.has_value);
+          batch.Delete(inst->GetColumnFamilyHandles()[entry.cf_idx], key);
+        } break;
+        case pikiwidb::OperateType::kMerge: {
+          assert(entry.has_value);
+          batch.Merge(inst->GetColumnFamilyHandles()[entry.cf_idx], key, entry.value);
+        } break;
+        case pikiwidb::OperateType::kDeleteRange: {
+          assert(entry.has_value);
+          batch.DeleteRange(inst->GetColumnFamilyHandles()[entry.cf_idx], key,
+                            to_bytewise ? Slice(to_bytewise(entry.value)) : entry.value);
+        } break;
+        default:
+          static constexpr std::string_view msg = "Unknown operate type in binlog";
+          ERROR(msg);
+          (*statuses)[i] = Status::Incomplete(msg);
+          break;
+      }
+      if (!(*statuses)[i].ok()) {
+        break;
+      }
+      applied.emplace_back(entry.cf_idx, ++seqno);
+    }
+    if (!(*statuses)[i].ok()) {
+      // the log is left out of the batch, the others are still written
+      batch.RollbackToSavePoint();
+      seqno = first_seqnos[i] - 1;
       continue;
     }
-
-    switch (entry.op_type()) {
-      case pikiwidb::OperateType::kPut: {
-        assert(entry.has_value());
-        batch.Put(inst->GetColumnFamilyHandles()[entry.cf_idx()], entry.key(), entry.value());
-      } break;
-      case pikiwidb::OperateType::kDelete: {
-        assert(!entry.has_value());
-        batch.Delete(inst->GetColumnFamilyHandles()[entry.cf_idx()], entry.key());
-      } break;
-      default:
-        static constexpr std::string_view msg = "Unknown operate type in binlog";
-        ERROR(msg);
-        return Status::Incomplete(msg);
+    batch.PopSavePoint();
+    for (auto [cf_idx, entry_seqno] : applied) {
+      inst->UpdateAppliedLogIndexOfColumnFamily(cf_idx, log_idx, entry_seqno);
+    }
+    if (inst->IsRestarting() && is_finished_start) [[unlikely]] {
+      INFO("Redis {} finished start phase", inst->GetIndex());
+      inst->StartingPhaseEnd();
     }
-    inst->UpdateAppliedLogIndexOfColumnFamily(entry.cf_idx(), log_idx, ++seqno);
-  }
-  if (inst->IsRestarting() && is_finished_start) [[unlikely]] {
-    INFO("Redis {} finished start phase", inst->GetIndex());
-    inst->StartingPhaseEnd();
   }
-  auto first_seqno = inst->GetDB()->GetLatestSequenceNumber() + 1;
   auto s = inst->GetDB()->Write(inst->GetWriteOptions(), &batch);
-  if (!s.ok()) {
-    // TODO(longfar): What we should do if the write operation failed ? 💥
-    return s;
+  for (size_t i = 0; i < logs.size(); i++) {
+    if (!s.ok()) {
+      // TODO(longfar): What we should do if the write operation failed ? 💥
+      (*statuses)[i] = s;
+    } else if ((*statuses)[i].ok()) {
+      inst->UpdateLogIndex(logs[i].second, first_seqnos[i], log_bytes[i]);
+    }
   }
-  inst->UpdateLogIndex(log_idx, first_seqno);
-  return s;
+  inst->FlushOldestCFIfPending();
 }
 
 }  //  namespace storage
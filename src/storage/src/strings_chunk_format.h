@@ -0,0 +1,157 @@
+//  Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef SRC_STRINGS_CHUNK_FORMAT_H_
+#define SRC_STRINGS_CHUNK_FORMAT_H_
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "rocksdb/db.h"
+#include "rocksdb/env.h"
+
+#include "src/base_data_key_format.h"
+#include "src/base_data_value_format.h"
+#include "src/coding.h"
+#include "storage/storage_define.h"
+
+namespace storage {
+
+/*
+ * A string value that SETBIT, SETRANGE or APPEND grow past
+ * kStringsChunkThreshold bytes is split into chunks of kStringsChunkSize
+ * bytes in the strings data CF, so the point bit and range operations only
+ * read and rewrite the chunks they touch. Its value in the strings CF is
+ * flagged chunked, see StringsValue::SetChunked, and the user value there is
+ * the chunk meta:
+ * | length | version | chunk size |
+ * |   8B   |    8B   |     4B     |
+ *
+ * A chunk that was never written and the bytes past the end of a short chunk
+ * are zero, a SETBIT far past the end of a bitmap only writes one chunk.
+ */
+const uint64_t kStringsChunkThreshold = 64 * 1024;
+const uint32_t kStringsChunkSize = 16 * 1024;
+
+// Versions of the chunked values, unique in the process and increasing with
+// the time, so the chunks left by an earlier chunked value of a key are
+// never read as the ones of a later value. The version is also past
+// replaced_version, the one of the chunks the key still has, as the clock
+// may be behind it after a restart.
+inline uint64_t NewStringsChunkVersion(uint64_t replaced_version = 0) {
+  static std::atomic<uint64_t> last_version{0};
+  uint64_t now = rocksdb::Env::Default()->NowMicros();
+  uint64_t last = last_version.load();
+  uint64_t version;
+  do {
+    version = std::max({now, last + 1, replaced_version + 1});
+  } while (!last_version.compare_exchange_weak(last, version));
+  return version;
+}
+
+class StringsChunkMeta {
+ public:
+  static const size_t kEncodedLength = 2 * sizeof(uint64_t) + sizeof(uint32_t);
+
+  // the meta of a chunked value with a new version, past replaced_version
+  explicit StringsChunkMeta(uint64_t length = 0, uint32_t chunk_size = kStringsChunkSize,
+                            uint64_t replaced_version = 0)
+      : length_(length), version_(NewStringsChunkVersion(replaced_version)), chunk_size_(chunk_size) {}
+
+  explicit StringsChunkMeta(const Slice& user_value) {
+    if (user_value.size() >= kEncodedLength) {
+      length_ = DecodeFixed64(user_value.data());
+      version_ = DecodeFixed64(user_value.data() + sizeof(uint64_t));
+      chunk_size_ = DecodeFixed32(user_value.data() + 2 * sizeof(uint64_t));
+    }
+  }
+
+  std::string Encode() const {
+    std::string dst(kEncodedLength, '\0');
+    EncodeFixed64(dst.data(), length_);
+    EncodeFixed64(dst.data() + sizeof(uint64_t), version_);
+    EncodeFixed32(dst.data() + 2 * sizeof(uint64_t), chunk_size_);
+    return dst;
+  }
+
+  uint64_t Length() const { return length_; }
+  void SetLength(uint64_t length) { length_ = length; }
+  uint64_t Version() const { return version_; }
+  uint32_t ChunkSize() const { return chunk_size_; }
+
+ private:
+  uint64_t length_ = 0;
+  uint64_t version_ = 0;
+  uint32_t chunk_size_ = kStringsChunkSize;
+};
+
+/*
+ * used for the chunks of a chunked string value. format:
+ * | reserve1 | key | version | index | reserve2 |
+ * |    8B    |     |    8B   |   8B  |   16B    |
+ *
+ * The index is stored big-endian, so the chunks of a value sort in order.
+ */
+class StringsChunkKey {
+ public:
+  StringsChunkKey(const Slice& key, uint64_t version, uint64_t index)
+      : data_key_(key, version, Slice(index_, sizeof(index_))) {
+    EncodeFixed64BigEndian(index_, index);
+  }
+
+  Slice Encode() { return data_key_.Encode(); }
+
+  // the key without reserve2, it sorts before the chunk key
+  Slice EncodeSeekKey() { return data_key_.EncodeSeekKey(); }
+
+ private:
+  char index_[sizeof(uint64_t)];
+  BaseDataKey data_key_;
+};
+
+inline uint64_t StringsChunkIndex(const Slice& chunk_key) {
+  return DecodeFixed64BigEndian(chunk_key.data() + chunk_key.size() - kSuffixReserveLength - sizeof(uint64_t));
+}
+
+// Reads the bytes in [offset, offset + length) of the chunked value of key
+// with one iterator over its chunks, so they are read at one point in time.
+inline Status GetStringsChunks(rocksdb::DB* db, rocksdb::ColumnFamilyHandle* handle,
+                               const rocksdb::ReadOptions& read_options, const Slice& key,
+                               const StringsChunkMeta& chunk_meta, uint64_t offset, uint64_t length,
+                               std::string* value) {
+  value->assign(length, '\0');
+  if (length == 0) {
+    return Status::OK();
+  }
+  uint64_t chunk_size = chunk_meta.ChunkSize();
+  uint64_t first = offset / chunk_size;
+  uint64_t last = (offset + length - 1) / chunk_size;
+  StringsChunkKey first_key(key, chunk_meta.Version(), first);
+  StringsChunkKey upper_key(key, chunk_meta.Version(), last + 1);
+  std::string lower_bound = first_key.EncodeSeekKey().ToString();
+  std::string upper_bound = upper_key.EncodeSeekKey().ToString();
+  Slice upper_bound_slice(upper_bound);
+
+  rocksdb::ReadOptions iterator_options(read_options);
+  iterator_options.iterate_upper_bound = &upper_bound_slice;
+  std::unique_ptr<rocksdb::Iterator> iter(db->NewIterator(iterator_options, handle));
+  for (iter->Seek(lower_bound); iter->Valid(); iter->Next()) {
+    uint64_t chunk_offset = StringsChunkIndex(iter->key()) * chunk_size;
+    ParsedBaseDataValue parsed_chunk(iter->value());
+    Slice chunk = parsed_chunk.UserValue();
+    // the part of the chunk in the range
+    uint64_t begin = std::max(offset, chunk_offset);
+    uint64_t end = std::min({offset + length, chunk_offset + chunk.size(), chunk_offset + chunk_size});
+    if (begin < end) {
+      memcpy(value->data() + (begin - offset), chunk.data() + (begin - chunk_offset), end - begin);
+    }
+  }
+  return iter->status();
+}
+
+}  //  namespace storage
+#endif  // SRC_STRINGS_CHUNK_FORMAT_H_
@@ -8,21 +8,22 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "rocksdb/compaction_filter.h"
+#include "src/base_filter.h"
 #include "src/debug.h"
+#include "src/strings_chunk_format.h"
 #include "src/strings_value_format.h"
 
 namespace storage {
 
 class StringsFilter : public rocksdb::CompactionFilter {
  public:
-  StringsFilter() = default;
+  StringsFilter() { rocksdb::Env::Default()->GetCurrentTime(&unix_time_); }
   bool Filter(int level, const rocksdb::Slice& key, const rocksdb::Slice& value, std::string* new_value,
               bool* value_changed) const override {
-    int64_t unix_time;
-    rocksdb::Env::Default()->GetCurrentTime(&unix_time);
-    auto cur_time = static_cast<int32_t>(unix_time);
+    auto cur_time = static_cast<int32_t>(unix_time_);
     ParsedStringsValue parsed_strings_value(value);
     TRACE("==========================START==========================");
     TRACE("[StringsFilter], key: %s, value = %s, timestamp: %llu, cur_time: %d", key.ToString().c_str(),
@@ -38,6 +39,9 @@ class StringsFilter : public rocksdb::CompactionFilter {
   }
 
   const char* Name() const override { return "StringsFilter"; }
+
+ private:
+  int64_t unix_time_ = 0;
 };
 
 class StringsFilterFactory : public rocksdb::CompactionFilterFactory {
@@ -50,5 +54,106 @@ class StringsFilterFactory : public rocksdb::CompactionFilterFactory {
   const char* Name() const override { return "StringsFilterFactory"; }
 };
 
+/*
+ * Drops the chunks of the strings data CF whose value in the strings CF is
+ * gone, expired, no longer chunked, of another version, or shorter than the
+ * offset of the chunk.
+ */
+class StringsDataFilter : public rocksdb::CompactionFilter {
+ public:
+  StringsDataFilter(rocksdb::DB* db, std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr)
+      : db_(db), cf_handles_ptr_(cf_handles_ptr) {
+    rocksdb::Env::Default()->GetCurrentTime(&unix_time_);
+  }
+
+  bool Filter(int level, const Slice& key, const rocksdb::Slice& value, std::string* new_value,
+              bool* value_changed) const override {
+    UNUSED(level);
+    UNUSED(value);
+    UNUSED(new_value);
+    UNUSED(value_changed);
+    ParsedBaseDataKey parsed_base_data_key(key);
+    uint64_t index = StringsChunkIndex(key);
+    TRACE("==========================START==========================");
+    TRACE("[StringsDataFilter], key: %s, index = %llu, version = %llu", parsed_base_data_key.Key().ToString().c_str(),
+          index, parsed_base_data_key.Version());
+
+    const char* ptr =
+        SeekUserkeyDelim(key.data() + kPrefixReserveLength, static_cast<int>(key.size()) - kPrefixReserveLength);
+    std::string meta_key_enc(key.data(), std::distance(key.data(), ptr));
+    meta_key_enc.append(kSuffixReserveLength, kNeedTransformCharacter);
+
+    if (meta_key_enc != cur_key_) {
+      cur_key_ = meta_key_enc;
+      std::string meta_value;
+      // destroyed when close the database, Reserve Current key value
+      if (cf_handles_ptr_->empty()) {
+        return false;
+      }
+      Status s = meta_lookup_.Lookup(db_, (*cf_handles_ptr_)[kStringsCF], cur_key_, &meta_value);
+      if (s.ok()) {
+        ParsedStringsValue parsed_strings_value(&meta_value);
+        cur_meta_chunked_ = parsed_strings_value.IsChunked();
+        cur_meta_etime_ = parsed_strings_value.Etime();
+        cur_chunk_meta_ = StringsChunkMeta(parsed_strings_value.UserValue());
+        meta_not_found_ = false;
+      } else if (s.IsNotFound()) {
+        meta_not_found_ = true;
+      } else {
+        cur_key_ = "";
+        TRACE("Reserve[Get meta_key faild]");
+        return false;
+      }
+    }
+
+    if (meta_not_found_ || !cur_meta_chunked_) {
+      TRACE("Drop[Meta key not exist or not chunked]");
+      return true;
+    }
+    if (cur_meta_etime_ != 0 && cur_meta_etime_ < static_cast<uint64_t>(unix_time_)) {
+      TRACE("Drop[Timeout]");
+      return true;
+    }
+    if (cur_chunk_meta_.Version() != parsed_base_data_key.Version()) {
+      TRACE("Drop[chunk_version != cur_meta_version]");
+      return true;
+    }
+    if (index * cur_chunk_meta_.ChunkSize() >= cur_chunk_meta_.Length()) {
+      TRACE("Drop[chunk past the end of the value]");
+      return true;
+    }
+    TRACE("Reserve");
+    return false;
+  }
+
+  const char* Name() const override { return "StringsDataFilter"; }
+
+ private:
+  rocksdb::DB* db_ = nullptr;
+  std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr_ = nullptr;
+  mutable MetaValueLookup meta_lookup_;
+  int64_t unix_time_ = 0;
+  mutable std::string cur_key_;
+  mutable bool meta_not_found_ = false;
+  mutable bool cur_meta_chunked_ = false;
+  mutable uint64_t cur_meta_etime_ = 0;
+  mutable StringsChunkMeta cur_chunk_meta_{Slice()};
+};
+
+class StringsDataFilterFactory : public rocksdb::CompactionFilterFactory {
+ public:
+  StringsDataFilterFactory(rocksdb::DB** db_ptr, std::vector<rocksdb::ColumnFamilyHandle*>* handles_ptr)
+      : db_ptr_(db_ptr), cf_handles_ptr_(handles_ptr) {}
+  std::unique_ptr<rocksdb::CompactionFilter> CreateCompactionFilter(
+      const rocksdb::CompactionFilter::Context& context) override {
+    return std::make_unique<StringsDataFilter>(*db_ptr_, cf_handles_ptr_);
+  }
+  const char* Name() const override { return "StringsDataFilterFactory"; }
+
+ private:
+  rocksdb::DB** db_ptr_ = nullptr;
+  std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr_ = nullptr;
+};
+
 }  //  namespace storage
 #endif  // SRC_STRINGS_FILTER_H_
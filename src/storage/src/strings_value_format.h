@@ -12,6 +12,10 @@
 #include "storage/storage_define.h"
 
 namespace storage {
+// reserve[0] of a value whose bytes are in the chunks of the strings data CF,
+// its user value is then the chunk meta, see strings_chunk_format.h
+const char kStringsChunkedFlag = 'c';
+
 /*
  * | value | reserve | cdate | timestamp |
  * |       |   16B   |   8B  |     8B    |
@@ -19,6 +23,7 @@ namespace storage {
 class StringsValue : public InternalValue {
  public:
   explicit StringsValue(const rocksdb::Slice& user_value) : InternalValue(user_value) {}
+  void SetChunked() { reserve_[0] = kStringsChunkedFlag; }
   virtual rocksdb::Slice Encode() override {
     size_t usize = user_value_.size();
     size_t needed = usize + kSuffixReserveLength + 2 * kTimestampLength;
@@ -60,6 +65,8 @@ class ParsedStringsValue : public ParsedInternalValue {
     }
   }
 
+  bool IsChunked() const { return reserve_[0] == kStringsChunkedFlag; }
+
   void StripSuffix() override {
     if (value_) {
       value_->erase(value_->size() - kStringsValueSuffixLength, kStringsValueSuffixLength);
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <cinttypes>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "fmt/core.h"
+#include "rocksdb/env.h"
+#include "rocksdb/table_properties.h"
+
+#include "src/coding.h"
+#include "storage/storage_define.h"
+
+namespace storage {
+
+// How the collector tells an expired value apart, depends on the column family
+enum class DensityValueType {
+  kNone,       // data column families, the value carries no expire time
+  kStrings,    // | value | reserve | cdate | timestamp |
+  kBaseMeta,   // | count 4B | version | reserve | cdate | timestamp |
+  kListsMeta,  // | count 8B | version | left | right | reserve | cdate | timestamp |
+};
+
+// What a TombstoneDensityCollector recorded for one SST file
+struct TombstoneDensity {
+  uint64_t entries = 0;
+  uint64_t deletes = 0;
+  uint64_t expired = 0;
+  std::string first_key;
+  std::string last_key;
+  // the window of kWindowEntries consecutive point entries with the most dead entries
+  uint64_t window_dead = 0;
+  std::string window_start;
+  std::string window_end;
+
+  uint64_t Dead() const { return deletes + expired; }
+};
+
+/*
+ * Counts the deletes and the expired or emptied meta values of every SST file
+ * and the densest window of consecutive entries, so that the storage can
+ * compact the files and ranges queue-like workloads fill with tombstones.
+ * A file whose dead ratio reaches the threshold is also marked for compaction
+ * through NeedCompact().
+ */
+class TombstoneDensityCollector : public rocksdb::TablePropertiesCollector {
+ public:
+  static constexpr std::string_view kPropertyName = "pikiwidb.tombstone-density";
+  static constexpr std::string_view kFirstKeyName = "pikiwidb.tombstone-density.first-key";
+  static constexpr std::string_view kLastKeyName = "pikiwidb.tombstone-density.last-key";
+  static constexpr std::string_view kWindowStartName = "pikiwidb.tombstone-density.window-start";
+  static constexpr std::string_view kWindowEndName = "pikiwidb.tombstone-density.window-end";
+  static constexpr uint64_t kWindowEntries = 1024;
+  // small files are left to the regular compactions
+  static constexpr uint64_t kMinEntriesToMark = 4096;
+
+  TombstoneDensityCollector(DensityValueType value_type, double dead_ratio)
+      : value_type_(value_type), dead_ratio_(dead_ratio) {
+    rocksdb::Env::Default()->GetCurrentTime(&unix_time_);
+  }
+
+  rocksdb::Status AddUserKey(const rocksdb::Slice& key, const rocksdb::Slice& value, rocksdb::EntryType type,
+                             rocksdb::SequenceNumber seq, uint64_t file_size) override {
+    bool dead = false;
+    switch (type) {
+      case rocksdb::kEntryDelete:
+      case rocksdb::kEntrySingleDelete:
+      case rocksdb::kEntryDeleteWithTimestamp:
+        density_.deletes++;
+        dead = true;
+        break;
+      case rocksdb::kEntryRangeDeletion:
+        // range tombstones are kept in their own block, out of the key order
+        density_.entries++;
+        density_.deletes++;
+        return rocksdb::Status::OK();
+      case rocksdb::kEntryPut:
+        if (IsExpired(value)) {
+          density_.expired++;
+          dead = true;
+        }
+        break;
+      default:
+        break;
+    }
+
+    density_.entries++;
+    if (density_.first_key.empty()) {
+      density_.first_key.assign(key.data(), key.size());
+    }
+    if (window_count_ == 0) {
+      window_start_.assign(key.data(), key.size());
+      window_dead_ = 0;
+    }
+    window_count_++;
+    window_dead_ += dead ? 1 : 0;
+    last_key_.assign(key.data(), key.size());
+    if (window_count_ == kWindowEntries) {
+      FinishWindow();
+    }
+    return rocksdb::Status::OK();
+  }
+
+  rocksdb::Status Finish(rocksdb::UserCollectedProperties* properties) override {
+    *properties = GetReadableProperties();
+    return rocksdb::Status::OK();
+  }
+
+  rocksdb::UserCollectedProperties GetReadableProperties() const override {
+    TombstoneDensity density = density_;
+    density.last_key = last_key_;
+    if (window_count_ != 0 && window_dead_ > density.window_dead) {
+      density.window_dead = window_dead_;
+      density.window_start = window_start_;
+      density.window_end = density.last_key;
+    }
+    return rocksdb::UserCollectedProperties{
+        {std::string(kPropertyName),
+         fmt::format("{}/{}/{}/{}", density.entries, density.deletes, density.expired, density.window_dead)},
+        {std::string(kFirstKeyName), density.first_key},
+        {std::string(kLastKeyName), density.last_key},
+        {std::string(kWindowStartName), density.window_start},
+        {std::string(kWindowEndName), density.window_end},
+    };
+  }
+
+  bool NeedCompact() const override {
+    return dead_ratio_ > 0 && density_.entries >= kMinEntriesToMark &&
+           static_cast<double>(density_.Dead()) >= static_cast<double>(density_.entries) * dead_ratio_;
+  }
+
+  const char* Name() const override { return "TombstoneDensityCollector"; }
+
+  static std::optional<TombstoneDensity> ReadFromTableProps(const rocksdb::TableProperties& table_props) {
+    const auto& user_properties = table_props.user_collected_properties;
+    auto it = user_properties.find(std::string(kPropertyName));
+    if (it == user_properties.end()) {
+      return std::nullopt;
+    }
+    TombstoneDensity density;
+    if (sscanf(it->second.c_str(), "%" SCNu64 "/%" SCNu64 "/%" SCNu64 "/%" SCNu64, &density.entries,
+               &density.deletes, &density.expired, &density.window_dead) != 4) {
+      return std::nullopt;
+    }
+    auto read_key = [&user_properties](std::string_view name, std::string* dst) {
+      auto key_it = user_properties.find(std::string(name));
+      if (key_it != user_properties.end()) {
+        *dst = key_it->second;
+      }
+    };
+    read_key(kFirstKeyName, &density.first_key);
+    read_key(kLastKeyName, &density.last_key);
+    read_key(kWindowStartName, &density.window_start);
+    read_key(kWindowEndName, &density.window_end);
+    return density;
+  }
+
+ private:
+  bool IsExpired(const rocksdb::Slice& value) const {
+    if (value_type_ == DensityValueType::kNone || value.size() < kTimestampLength) {
+      return false;
+    }
+    uint64_t etime = DecodeFixed64(value.data() + value.size() - kTimestampLength);
+    if (etime != 0 && etime < static_cast<uint64_t>(unix_time_)) {
+      return true;
+    }
+    // a meta value of a deleted key is kept with a zero count
+    if (value_type_ == DensityValueType::kBaseMeta && value.size() >= sizeof(int32_t)) {
+      return DecodeFixed32(value.data()) == 0;
+    }
+    if (value_type_ == DensityValueType::kListsMeta && value.size() >= sizeof(uint64_t)) {
+      return DecodeFixed64(value.data()) == 0;
+    }
+    return false;
+  }
+
+  void FinishWindow() {
+    if (window_dead_ > density_.window_dead) {
+      density_.window_dead = window_dead_;
+      density_.window_start = window_start_;
+      density_.window_end = last_key_;
+    }
+    window_count_ = 0;
+    window_dead_ = 0;
+  }
+
+  DensityValueType value_type_;
+  double dead_ratio_;
+  int64_t unix_time_ = 0;
+  TombstoneDensity density_;
+  std::string window_start_;
+  uint64_t window_count_ = 0;
+  uint64_t window_dead_ = 0;
+  std::string last_key_;
+};
+
+class TombstoneDensityCollectorFactory : public rocksdb::TablePropertiesCollectorFactory {
+ public:
+  TombstoneDensityCollectorFactory(DensityValueType value_type, double dead_ratio)
+      : value_type_(value_type), dead_ratio_(dead_ratio) {}
+  ~TombstoneDensityCollectorFactory() override = default;
+
+  rocksdb::TablePropertiesCollector* CreateTablePropertiesCollector(
+      [[maybe_unused]] rocksdb::TablePropertiesCollectorFactory::Context context) override {
+    return new TombstoneDensityCollector(value_type_, dead_ratio_);
+  }
+  const char* Name() const override { return "TombstoneDensityCollectorFactory"; }
+
+ private:
+  DensityValueType value_type_;
+  double dead_ratio_;
+};
+
+}  // namespace storage
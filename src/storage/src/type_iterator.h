@@ -21,6 +21,7 @@
 #include "src/debug.h"
 #include "src/lists_meta_value_format.h"
 #include "src/mutex.h"
+#include "src/strings_chunk_format.h"
 #include "src/strings_value_format.h"
 #include "storage/storage_define.h"
 #include "storage/util.h"
@@ -102,8 +103,11 @@ class TypeIterator {
 class StringsIterator : public TypeIterator {
  public:
   StringsIterator(const rocksdb::ReadOptions& options, rocksdb::DB* db, ColumnFamilyHandle* handle,
-                  const std::string& pattern)
-      : TypeIterator(options, db, handle), pattern_(pattern) {}
+                  ColumnFamilyHandle* data_handle, const std::string& pattern)
+      : TypeIterator(options, db, handle), db_(db), data_handle_(data_handle), pattern_(pattern) {
+    chunk_read_options_.snapshot = options.snapshot;
+    chunk_read_options_.fill_cache = options.fill_cache;
+  }
   ~StringsIterator() {}
 
   bool ShouldSkip() override {
@@ -118,11 +122,23 @@ class StringsIterator : public TypeIterator {
     }
 
     user_key_ = parsed_key.Key().ToString();
-    user_value_ = parsed_value.UserValue().ToString();
+    if (parsed_value.IsChunked()) {
+      StringsChunkMeta chunk_meta(parsed_value.UserValue());
+      if (!GetStringsChunks(db_, data_handle_, chunk_read_options_, user_key_, chunk_meta, 0, chunk_meta.Length(),
+                            &user_value_)
+               .ok()) {
+        return true;
+      }
+    } else {
+      user_value_ = parsed_value.UserValue().ToString();
+    }
     return false;
   }
 
  private:
+  rocksdb::DB* db_ = nullptr;
+  ColumnFamilyHandle* data_handle_ = nullptr;
+  rocksdb::ReadOptions chunk_read_options_;
   std::string pattern_;
 };
 
@@ -209,7 +209,7 @@ int CalculateStartAndEndKey(const std::string& key, std::string* start_key, std:
     return 0;
   }
   size_t usize = kPrefixReserveLength + key.size() + kEncodedKeyDelimSize;
-  size_t nzero = std::count(key.begin(), key.end(), kNeedTransformCharacter);
+  size_t nzero = storage::CountNeedTransformCharacters(key);
   usize += nzero;
   auto dst = std::make_unique<char[]>(usize);
   char* ptr = dst.get();
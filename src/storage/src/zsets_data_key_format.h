@@ -6,13 +6,63 @@
 #ifndef SRC_ZSETS_DATA_KEY_FORMAT_H_
 #define SRC_ZSETS_DATA_KEY_FORMAT_H_
 
+#include <cstring>
+#include <string>
+
+#include "src/coding.h"
 #include "storage/storage_define.h"
 
 namespace storage {
 
+/*
+ * The score is stored in an order preserving encoding, so that the score keys
+ * sort bytewise: the sign bit of a positive double is set, all the bits of a
+ * negative one are flipped, and the result is stored big-endian. -0.0 is
+ * stored as 0.0, both are equal scores.
+ */
+inline void EncodeScore(char* dst, double score) {
+  if (score == 0) {
+    score = 0.0;
+  }
+  uint64_t bits;
+  memcpy(&bits, &score, sizeof(bits));
+  bits = (bits & (1ULL << 63)) != 0 ? ~bits : bits | (1ULL << 63);
+  EncodeFixed64BigEndian(dst, bits);
+}
+
+inline double DecodeScore(const char* ptr) {
+  uint64_t bits = DecodeFixed64BigEndian(ptr);
+  bits = (bits & (1ULL << 63)) != 0 ? bits & ~(1ULL << 63) : ~bits;
+  double score;
+  memcpy(&score, &bits, sizeof(score));
+  return score;
+}
+
+// Converts a score key of the legacy encoding, where the score was stored as
+// the little-endian bits of the double and sorted by a custom comparator
+inline std::string LegacyScoreKeyToBytewise(const Slice& legacy_key) {
+  std::string key = legacy_key.ToString();
+  if (key.size() <= static_cast<size_t>(kPrefixReserveLength)) {
+    return key;
+  }
+  const char* encoded_key = key.data() + kPrefixReserveLength;
+  const char* version = SeekUserkeyDelim(encoded_key, static_cast<int>(key.size() - kPrefixReserveLength));
+  size_t score_offset = version - key.data() + kVersionLength;
+  if (version == encoded_key || score_offset + kScoreLength > key.size()) {
+    return key;
+  }
+  uint64_t bits = DecodeFixed64(key.data() + score_offset);
+  double score;
+  memcpy(&score, &bits, sizeof(score));
+  EncodeScore(key.data() + score_offset, score);
+  return key;
+}
+
 /* zset score to member data key format:
  * | reserve1 | key | version | score | member |  reserve2 |
  * |    8B    |     |    8B   |  8B   |        |    16B    |
+ *
+ * The score column family uses the bytewise comparator, see EncodeScore.
  */
 class ZSetsScoreKey {
  public:
@@ -28,7 +78,7 @@ class ZSetsScoreKey {
   Slice Encode() {
     size_t meta_size = sizeof(reserve1_) + sizeof(version_) + sizeof(score_) + sizeof(reserve2_);
     size_t usize = key_.size() + member_.size() + kEncodedKeyDelimSize;
-    size_t nzero = std::count(key_.data(), key_.data() + key_.size(), kNeedTransformCharacter);
+    size_t nzero = CountNeedTransformCharacters(key_);
     usize += nzero;
     size_t needed = meta_size + usize;
     char* dst = nullptr;
@@ -52,8 +102,7 @@ class ZSetsScoreKey {
     EncodeFixed64(dst, version_);
     dst += sizeof(version_);
     // score
-    const void* addr_score = reinterpret_cast<const void*>(&score_);
-    EncodeFixed64(dst, *reinterpret_cast<const uint64_t*>(addr_score));
+    EncodeScore(dst, score_);
     dst += sizeof(score_);
     // member
     memcpy(dst, member_.data(), member_.size());
@@ -98,9 +147,7 @@ class ParsedZSetsScoreKey {
     ptr = DecodeUserKey(ptr, std::distance(ptr, end_ptr), &key_str_);
     version_ = DecodeFixed64(ptr);
     ptr += sizeof(version_);
-    uint64_t tmp = DecodeFixed64(ptr);
-    const void* ptr_tmp = reinterpret_cast<const void*>(&tmp);
-    score_ = *reinterpret_cast<const double*>(ptr_tmp);
+    score_ = DecodeScore(ptr);
     ptr += sizeof(uint64_t);
     member_ = Slice(ptr, std::distance(ptr, end_ptr));
   }
@@ -21,7 +21,9 @@ namespace storage {
 class ZSetsScoreFilter : public rocksdb::CompactionFilter {
  public:
   ZSetsScoreFilter(rocksdb::DB* db, std::vector<rocksdb::ColumnFamilyHandle*>* handles_ptr, int meta_cf_index)
-      : db_(db), cf_handles_ptr_(handles_ptr), meta_cf_index_(meta_cf_index) {}
+      : db_(db), cf_handles_ptr_(handles_ptr), meta_cf_index_(meta_cf_index) {
+    rocksdb::Env::Default()->GetCurrentTime(&unix_time_);
+  }
 
   bool Filter(int level, const rocksdb::Slice& key, const rocksdb::Slice& value, std::string* new_value,
               bool* value_changed) const override {
@@ -48,7 +50,7 @@ class ZSetsScoreFilter : public rocksdb::CompactionFilter {
       if (cf_handles_ptr_->empty()) {
         return false;
       }
-      Status s = db_->Get(default_read_options_, (*cf_handles_ptr_)[meta_cf_index_], cur_key_, &meta_value);
+      Status s = meta_lookup_.Lookup(db_, (*cf_handles_ptr_)[meta_cf_index_], cur_key_, &meta_value);
       if (s.ok()) {
         meta_not_found_ = false;
         ParsedZSetsMetaValue parsed_zsets_meta_value(&meta_value);
@@ -68,9 +70,7 @@ class ZSetsScoreFilter : public rocksdb::CompactionFilter {
       return true;
     }
 
-    int64_t unix_time;
-    rocksdb::Env::Default()->GetCurrentTime(&unix_time);
-    if (cur_meta_etime_ != 0 && cur_meta_etime_ < static_cast<uint64_t>(unix_time)) {
+    if (cur_meta_etime_ != 0 && cur_meta_etime_ < static_cast<uint64_t>(unix_time_)) {
       TRACE("Drop[Timeout]");
       return true;
     }
@@ -88,7 +88,8 @@ class ZSetsScoreFilter : public rocksdb::CompactionFilter {
  private:
   rocksdb::DB* db_ = nullptr;
   std::vector<rocksdb::ColumnFamilyHandle*>* cf_handles_ptr_ = nullptr;
-  rocksdb::ReadOptions default_read_options_;
+  mutable MetaValueLookup meta_lookup_;
+  int64_t unix_time_ = 0;
   mutable std::string cur_key_;
   mutable bool meta_not_found_ = false;
   mutable uint64_t cur_meta_version_ = 0;
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <string>
+#include <vector>
+
+#include "fmt/core.h"
+#include "gtest/gtest.h"
+#include "rocksdb/db.h"
+#include "rocksdb/options.h"
+
+#include "src/base_filter.h"
+#include "src/base_key_format.h"
+#include "storage/util.h"
+
+using namespace storage;  // NOLINT
+
+class MetaValueLookupTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    DeleteFiles(kDbPath);
+    rocksdb::Options options;
+    options.create_if_missing = true;
+    ASSERT_TRUE(rocksdb::DB::Open(options, kDbPath, &db_).ok());
+    // only the even keys have a meta value
+    for (int i = 0; i < kKeyNum; i += 2) {
+      ASSERT_TRUE(db_->Put(rocksdb::WriteOptions(), MetaKey(i), fmt::format("meta_{}", i)).ok());
+    }
+    db_->Flush(rocksdb::FlushOptions());
+  }
+
+  void TearDown() override {
+    db_->Close();
+    delete db_;
+    DeleteFiles(kDbPath);
+  }
+
+  static std::string MetaKey(int i) {
+    std::string key = fmt::format("key_{:04d}", i);
+    BaseMetaKey base_meta_key(key);
+    return base_meta_key.Encode().ToString();
+  }
+
+  void CheckLookup(MetaValueLookup* lookup, int i) {
+    std::string meta_value;
+    Status s = lookup->Lookup(db_, db_->DefaultColumnFamily(), MetaKey(i), &meta_value);
+    if (i % 2 == 0 && i < kKeyNum) {
+      ASSERT_TRUE(s.ok()) << i;
+      ASSERT_EQ(meta_value, fmt::format("meta_{}", i));
+    } else {
+      ASSERT_TRUE(s.IsNotFound()) << i;
+    }
+  }
+
+  static constexpr const char* kDbPath = "./base_filter_test_db";
+  static constexpr int kKeyNum = 1000;
+  rocksdb::DB* db_ = nullptr;
+};
+
+TEST_F(MetaValueLookupTest, ForwardOrder) {
+  MetaValueLookup lookup;
+  for (int i = 0; i < kKeyNum + 10; i++) {
+    CheckLookup(&lookup, i);
+  }
+}
+
+TEST_F(MetaValueLookupTest, GapsAndBackwardJumps) {
+  MetaValueLookup lookup;
+  std::vector<int> order = {0, 1, 500, 3, 2, 998, 999, 1005, 4, 100, 101, 102, 640, 64};
+  for (int i : order) {
+    CheckLookup(&lookup, i);
+  }
+}
+
+TEST_F(MetaValueLookupTest, RefreshesTheIterator) {
+  MetaValueLookup lookup;
+  CheckLookup(&lookup, 0);
+  // written after the iterator was created, so it isn't seen until the
+  // iterator is re-created
+  ASSERT_TRUE(db_->Put(rocksdb::WriteOptions(), MetaKey(1), "meta_1").ok());
+  std::string meta_value;
+  ASSERT_TRUE(lookup.Lookup(db_, db_->DefaultColumnFamily(), MetaKey(1), &meta_value).IsNotFound());
+  for (int i = 2; i < MetaValueLookup::kLookupsBeforeRefresh; i++) {
+    CheckLookup(&lookup, 2 * (i % (kKeyNum / 2)));
+  }
+  ASSERT_TRUE(lookup.Lookup(db_, db_->DefaultColumnFamily(), MetaKey(1), &meta_value).ok());
+  EXPECT_EQ(meta_value, "meta_1");
+}
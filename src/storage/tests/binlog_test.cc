@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <cstdlib>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "binlog.pb.h"
+#include "storage/binlog.h"
+#include "storage/storage_define.h"
+
+using namespace storage;  // NOLINT
+
+namespace {
+
+BinlogWriter MakeBinlog(uint32_t slot_idx, const std::string& key, const std::string& value) {
+  BinlogWriter writer(0, slot_idx, kCurrentKeyFormat);
+  Slice value_slice(value);
+  writer.AddEntry(kStringsCF, pikiwidb::OperateType::kPut, key, &value_slice);
+  writer.AddEntry(kHashesMetaCF, pikiwidb::OperateType::kDelete, key, nullptr);
+  return writer;
+}
+
+}  // namespace
+
+TEST(BinlogTest, ParsesWithProtobuf) {
+  // a value past one byte of length
+  std::string value(300, 'v');
+  auto writer = MakeBinlog(7, "key", value);
+
+  pikiwidb::Binlog log;
+  ASSERT_TRUE(log.ParseFromArray(writer.Data(), static_cast<int>(writer.Size())));
+  EXPECT_EQ(log.db_id(), 0);
+  EXPECT_EQ(log.slot_idx(), 7);
+  EXPECT_EQ(log.key_format(), kCurrentKeyFormat);
+  ASSERT_EQ(log.entries_size(), 2);
+  EXPECT_EQ(log.entries(0).cf_idx(), kStringsCF);
+  EXPECT_EQ(log.entries(0).op_type(), pikiwidb::OperateType::kPut);
+  EXPECT_EQ(log.entries(0).key(), "key");
+  EXPECT_EQ(log.entries(0).value(), value);
+  EXPECT_EQ(log.entries(1).cf_idx(), kHashesMetaCF);
+  EXPECT_EQ(log.entries(1).op_type(), pikiwidb::OperateType::kDelete);
+  EXPECT_FALSE(log.entries(1).has_value());
+
+  // and back
+  std::string data = log.SerializeAsString();
+  BinlogView view;
+  ASSERT_TRUE(view.Parse(data));
+  EXPECT_EQ(view.SlotIdx(), 7);
+  EXPECT_EQ(view.KeyFormat(), kCurrentKeyFormat);
+  ASSERT_EQ(view.Entries().size(), 2);
+  EXPECT_EQ(view.Entries()[0].key, "key");
+  EXPECT_EQ(view.Entries()[0].value, value);
+  EXPECT_TRUE(view.Entries()[0].has_value);
+  EXPECT_EQ(view.Entries()[1].op_type, pikiwidb::OperateType::kDelete);
+  EXPECT_FALSE(view.Entries()[1].has_value);
+}
+
+TEST(BinlogTest, ReleasedBuffer) {
+  auto writer = MakeBinlog(1, "key", "value");
+  size_t size = writer.Size();
+  char* data = writer.Release();
+  EXPECT_EQ(writer.Size(), 0);
+  EXPECT_EQ(writer.Data(), nullptr);
+
+  BinlogView view;
+  ASSERT_TRUE(view.Parse({data, size}));
+  EXPECT_EQ(view.Entries().size(), 2);
+  std::free(data);
+}
+
+TEST(BinlogTest, Group) {
+  // the binlogs of one slot are concatenated in one member of the group,
+  // they parse as one binlog with the entries of both
+  auto first = MakeBinlog(1, "a", "1");
+  auto second = MakeBinlog(1, "b", "2");
+  auto other = MakeBinlog(2, "c", "3");
+  std::string slot1(first.Data(), first.Size());
+  slot1.append(second.Data(), second.Size());
+  std::string slot2(other.Data(), other.Size());
+
+  pikiwidb::Binlog group;
+  ASSERT_TRUE(group.add_group()->ParseFromString(slot1));
+  ASSERT_TRUE(group.add_group()->ParseFromString(slot2));
+  std::string data = group.SerializeAsString();
+
+  BinlogView view;
+  ASSERT_TRUE(view.Parse(data));
+  EXPECT_TRUE(view.Entries().empty());
+  ASSERT_EQ(view.Group().size(), 2);
+  BinlogView member;
+  ASSERT_TRUE(member.Parse(view.Group()[0]));
+  EXPECT_EQ(member.SlotIdx(), 1);
+  ASSERT_EQ(member.Entries().size(), 4);
+  EXPECT_EQ(member.Entries()[0].key, "a");
+  EXPECT_EQ(member.Entries()[2].key, "b");
+  ASSERT_TRUE(member.Parse(view.Group()[1]));
+  EXPECT_EQ(member.SlotIdx(), 2);
+  EXPECT_EQ(member.Entries()[0].value, "3");
+
+  // the group as the raft log of a group commit writes it
+  std::string appended = BinlogWriter::GroupHeader(slot1.size()) + slot1;
+  appended += BinlogWriter::GroupHeader(slot2.size()) + slot2;
+  pikiwidb::Binlog parsed;
+  ASSERT_TRUE(parsed.ParseFromString(appended));
+  ASSERT_EQ(parsed.group_size(), 2);
+  EXPECT_EQ(parsed.group(0).slot_idx(), 1);
+  EXPECT_EQ(parsed.group(0).entries_size(), 4);
+  EXPECT_EQ(parsed.group(1).entries(0).key(), "c");
+}
+
+TEST(BinlogTest, Compressed) {
+  std::string compressed = "not really compressed";
+  std::string data = BinlogWriter::CompressedHeader(pikiwidb::Compression::kLZF, 300, compressed.size()) + compressed;
+  pikiwidb::Binlog log;
+  ASSERT_TRUE(log.ParseFromString(data));
+  EXPECT_EQ(log.compression(), pikiwidb::Compression::kLZF);
+  EXPECT_EQ(log.raw_size(), 300);
+  EXPECT_EQ(log.compressed(), compressed);
+
+  BinlogView view;
+  ASSERT_TRUE(view.Parse(data));
+  EXPECT_EQ(view.Compression(), pikiwidb::Compression::kLZF);
+  EXPECT_EQ(view.RawSize(), 300);
+  EXPECT_EQ(view.Compressed(), compressed);
+  EXPECT_TRUE(view.Entries().empty());
+}
+
+TEST(BinlogTest, Truncated) {
+  auto writer = MakeBinlog(1, "key", "value");
+  BinlogView view;
+  EXPECT_FALSE(view.Parse({writer.Data(), writer.Size() - 1}));
+  EXPECT_TRUE(view.Parse({writer.Data(), 0}));
+  EXPECT_TRUE(view.Entries().empty());
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "src/bit_ops.h"
+
+// The byte at a time implementations the word and vector ones replaced, for
+// bit_ops_test and bit_ops_bench.
+namespace storage::reference {
+
+inline int64_t ReferenceBitCount(const unsigned char* value, int64_t bytes) {
+  static const auto bitsinbyte = []() {
+    std::vector<int> table(256);
+    for (int byte = 0; byte < 256; byte++) {
+      for (int b = byte; b != 0; b >>= 1) {
+        table[byte] += b & 1;
+      }
+    }
+    return table;
+  }();
+  int64_t bit_num = 0;
+  for (int64_t i = 0; i < bytes; i++) {
+    bit_num += bitsinbyte[value[i]];
+  }
+  return bit_num;
+}
+
+inline std::string ReferenceBitOp(BitOpType op, const std::vector<std::string>& src_values, int64_t max_len) {
+  std::string dest_value(max_len, '\0');
+  for (int64_t j = 0; j < max_len; j++) {
+    char output = j < static_cast<int64_t>(src_values[0].size()) ? src_values[0][j] : 0;
+    if (op == kBitOpNot) {
+      output = static_cast<char>(~output);
+    }
+    for (size_t i = 1; i < src_values.size(); i++) {
+      char byte = j < static_cast<int64_t>(src_values[i].size()) ? src_values[i][j] : 0;
+      if (op == kBitOpAnd) {
+        output = static_cast<char>(output & byte);
+      } else if (op == kBitOpOr) {
+        output = static_cast<char>(output | byte);
+      } else if (op == kBitOpXor) {
+        output = static_cast<char>(output ^ byte);
+      }
+    }
+    dest_value[j] = output;
+  }
+  return dest_value;
+}
+
+inline int64_t ReferenceBitPos(const unsigned char* s, int64_t bytes, int bit) {
+  for (int64_t i = 0; i < 8 * bytes; i++) {
+    if (((s[i / 8] >> (7 - i % 8)) & 1) == bit) {
+      return i;
+    }
+  }
+  return bit == 1 ? -1 : 8 * bytes;
+}
+
+inline std::string RandomBytes(std::mt19937* gen, size_t length) {
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::string value;
+  for (size_t i = 0; i < length; i++) {
+    value.push_back(static_cast<char>(byte(*gen)));
+  }
+  return value;
+}
+
+inline const unsigned char* Bytes(const std::string& value) {
+  return reinterpret_cast<const unsigned char*>(value.data());
+}
+
+}  // namespace storage::reference
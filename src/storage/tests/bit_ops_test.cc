@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "src/bit_ops.h"
+#include "tests/bit_ops_reference.h"
+
+using namespace storage;             // NOLINT
+using namespace storage::reference;  // NOLINT
+
+TEST(BitOpsTest, BitCountLikeReference) {
+  std::mt19937 gen(371);
+  // every offset of the vector and word loops, past several 31 vector blocks
+  std::string value = RandomBytes(&gen, 4096);
+  for (size_t offset = 0; offset < 64; offset++) {
+    for (size_t length = 0; offset + length <= value.size(); length += length < 300 ? 1 : 97) {
+      ASSERT_EQ(GetBitCount(Bytes(value) + offset, length), ReferenceBitCount(Bytes(value) + offset, length))
+          << offset << " " << length;
+    }
+  }
+  std::string ones(10000, '\xff');
+  EXPECT_EQ(GetBitCount(Bytes(ones), ones.size()), 8 * 10000);
+}
+
+TEST(BitOpsTest, BitOpLikeReference) {
+  std::mt19937 gen(372);
+  std::uniform_int_distribution<size_t> length(0, 200);
+  for (int round = 0; round < 500; round++) {
+    std::vector<std::string> src_values;
+    int64_t max_len = 0;
+    for (int i = 0; i <= round % 4; i++) {
+      src_values.push_back(RandomBytes(&gen, length(gen)));
+      max_len = std::max(max_len, static_cast<int64_t>(src_values.back().size()));
+    }
+    for (auto op : {kBitOpAnd, kBitOpOr, kBitOpXor, kBitOpDefault}) {
+      ASSERT_EQ(BitOpOperate(op, src_values, max_len), ReferenceBitOp(op, src_values, max_len)) << op;
+    }
+    std::vector<std::string> not_value = {src_values[0]};
+    ASSERT_EQ(BitOpOperate(kBitOpNot, not_value, max_len), ReferenceBitOp(kBitOpNot, not_value, max_len));
+  }
+}
+
+TEST(BitOpsTest, BitPosLikeReference) {
+  // a single differing bit at every position over all zero and all one bytes
+  for (int bit : {0, 1}) {
+    std::string background(100, bit == 1 ? '\0' : '\xff');
+    for (int64_t bytes = 0; bytes <= 100; bytes++) {
+      ASSERT_EQ(GetBitPos(Bytes(background), bytes, bit), ReferenceBitPos(Bytes(background), bytes, bit));
+    }
+    for (int64_t pos = 0; pos < 8 * 100; pos++) {
+      std::string value = background;
+      value[pos / 8] = static_cast<char>(value[pos / 8] ^ (0x80 >> (pos % 8)));
+      for (int64_t bytes : {int64_t{100}, pos / 8 + 1, pos / 8}) {
+        ASSERT_EQ(GetBitPos(Bytes(value), bytes, bit), ReferenceBitPos(Bytes(value), bytes, bit)) << pos;
+      }
+    }
+  }
+
+  std::mt19937 gen(373);
+  for (int round = 0; round < 1000; round++) {
+    std::string value = RandomBytes(&gen, round % 80);
+    for (int bit : {0, 1}) {
+      ASSERT_EQ(GetBitPos(Bytes(value), value.size(), bit), ReferenceBitPos(Bytes(value), value.size(), bit));
+    }
+  }
+}
+
+TEST(BitOpsTest, LargeBitmapsLikeReference) {
+  std::mt19937 gen(374);
+  const size_t kBitmapSize = 8 << 20;
+  std::vector<std::string> src_values;
+  for (int i = 0; i < 4; i++) {
+    src_values.push_back(RandomBytes(&gen, kBitmapSize));
+  }
+  EXPECT_EQ(GetBitCount(Bytes(src_values[0]), kBitmapSize), ReferenceBitCount(Bytes(src_values[0]), kBitmapSize));
+  EXPECT_EQ(BitOpOperate(kBitOpXor, src_values, kBitmapSize), ReferenceBitOp(kBitOpXor, src_values, kBitmapSize));
+
+  std::string zeros(kBitmapSize, '\0');
+  zeros.back() = 1;
+  EXPECT_EQ(GetBitPos(Bytes(zeros), kBitmapSize, 1), 8 * static_cast<int64_t>(kBitmapSize) - 1);
+  EXPECT_EQ(GetBitPos(Bytes(zeros), kBitmapSize, 1), ReferenceBitPos(Bytes(zeros), kBitmapSize, 1));
+}
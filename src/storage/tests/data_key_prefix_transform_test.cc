@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "src/base_data_key_format.h"
+#include "src/data_key_prefix_transform.h"
+#include "src/lists_data_key_format.h"
+#include "src/zsets_data_key_format.h"
+
+// in the namespace, base_data_key_format.h pulls pstd::Slice into the global one
+namespace storage {
+
+TEST(DataKeyPrefixTransformTest, KeyAndVersionPrefix) {
+  DataKeyPrefixTransform transform;
+  // a user key with zero bytes is escaped, the prefix ends after the version
+  std::string user_key("user\0key", 8);
+  HashesDataKey prefix_key(user_key, 100, Slice());
+  std::string prefix = prefix_key.EncodeSeekKey().ToString();
+
+  HashesDataKey hashes_data_key(user_key, 100, "field");
+  ListsDataKey lists_data_key(user_key, 100, 7);
+  ZSetsScoreKey zsets_score_key(user_key, 100, 1.5, "member");
+  for (const Slice& key : {hashes_data_key.Encode(), lists_data_key.Encode(), zsets_score_key.Encode()}) {
+    ASSERT_TRUE(transform.InDomain(key));
+    EXPECT_EQ(transform.Transform(key).ToString(), prefix);
+  }
+  // the prefix is its own prefix
+  ASSERT_TRUE(transform.InDomain(prefix));
+  EXPECT_EQ(transform.Transform(prefix).ToString(), prefix);
+
+  HashesDataKey other_version(user_key, 101, "field");
+  EXPECT_NE(transform.Transform(other_version.Encode()).ToString(), prefix);
+
+  EXPECT_FALSE(transform.InDomain(std::string(8, '\0')));
+  EXPECT_FALSE(transform.InDomain(std::string(8, '\0') + "key"));
+  EXPECT_FALSE(transform.InDomain(prefix.substr(0, prefix.size() - 1)));
+}
+
+}  // namespace storage
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "pstd/scope_record_lock.h"
+#include "storage/storage.h"
+#include "storage/util.h"
+
+using namespace storage;  // NOLINT
+using pstd::lock::DeferredUnlock;
+
+// A write whose raft log is applied after the command returned keeps its keys
+// locked until then, the tests hand the keys of the writes over to a
+// DeferredUnlock like the raft append does.
+class DeferredUnlockTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    DeleteFiles(kDbPath);
+    StorageOptions storage_options;
+    storage_options.options.create_if_missing = true;
+    storage_options.db_instance_num = 1;
+    ASSERT_TRUE(db_.Open(storage_options, kDbPath).ok());
+  }
+
+  void TearDown() override {
+    DeferredUnlock::SetCurrent(nullptr);
+    db_.Close();
+    DeleteFiles(kDbPath);
+  }
+
+  static constexpr const char* kDbPath = "./deferred_unlock_test_db";
+  Storage db_;
+};
+
+TEST_F(DeferredUnlockTest, KeysStayLockedUntilRelease) {
+  auto deferred = std::make_shared<DeferredUnlock>();
+  DeferredUnlock::SetCurrent(deferred);
+  ASSERT_TRUE(db_.Set("key", "1").ok());
+  ASSERT_TRUE(db_.MSet({{"a", "1"}, {"b", "1"}}).ok());
+  DeferredUnlock::SetCurrent(nullptr);
+
+  std::atomic<bool> written = false;
+  std::thread writer([&]() {
+    int64_t ret = 0;
+    db_.Incrby("key", 1, &ret);
+    db_.MSet({{"b", "2"}});
+    written = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(written);
+  // a read does not lock the keys
+  std::string value;
+  ASSERT_TRUE(db_.Get("key", &value).ok());
+  EXPECT_EQ(value, "1");
+
+  deferred->Release();
+  writer.join();
+  EXPECT_TRUE(written);
+  ASSERT_TRUE(db_.Get("key", &value).ok());
+  EXPECT_EQ(value, "2");
+  ASSERT_TRUE(db_.Get("b", &value).ok());
+  EXPECT_EQ(value, "2");
+}
+
+TEST_F(DeferredUnlockTest, ReleasedUnlocksAtOnce) {
+  auto deferred = std::make_shared<DeferredUnlock>();
+  deferred->Release();
+  DeferredUnlock::SetCurrent(deferred);
+  ASSERT_TRUE(db_.Set("key", "1").ok());
+  DeferredUnlock::SetCurrent(nullptr);
+  // would wait for the key forever if it was still locked
+  ASSERT_TRUE(db_.Set("key", "2").ok());
+  std::string value;
+  ASSERT_TRUE(db_.Get("key", &value).ok());
+  EXPECT_EQ(value, "2");
+}
+
+// A command whose first commit hands its key over takes it back for its
+// second commit of the same key, instead of waiting for the first apply.
+TEST_F(DeferredUnlockTest, SameKeyCommitsDoNotWaitForApply) {
+  const std::string path = "./deferred_unlock_raft_test_db";
+  DeleteFiles(path.c_str());
+  // like PRaft::AppendLog, each log keeps the keys of its write locked until it is applied
+  std::mutex mutex;
+  std::vector<std::shared_ptr<DeferredUnlock>> logs;
+  StorageOptions storage_options;
+  storage_options.options.create_if_missing = true;
+  storage_options.db_instance_num = 1;
+  storage_options.append_log_function = [&](BinlogWriter&& log, std::promise<Status>&& promise) {
+    auto keys = std::make_shared<DeferredUnlock>();
+    DeferredUnlock::SetCurrent(keys);
+    {
+      std::lock_guard lock(mutex);
+      logs.push_back(keys);
+    }
+    promise.set_value(Status::OK());
+  };
+  storage_options.do_snapshot_function = [](int32_t index, int64_t log_index, bool sync) {};
+  Storage raft_db;
+  ASSERT_TRUE(raft_db.Open(storage_options, path).ok());
+
+  auto command = std::async(std::launch::async, [&]() {
+    bool ok = raft_db.Set("key", "1").ok() && raft_db.Set("key", "2").ok() && raft_db.Set("other", "1").ok() &&
+              raft_db.MSet({{"key", "3"}, {"other", "2"}}).ok();
+    DeferredUnlock::SetCurrent(nullptr);
+    return ok;
+  });
+  ASSERT_EQ(command.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+  EXPECT_TRUE(command.get());
+
+  // the key stays locked until the last log that wrote it is applied
+  std::vector<std::shared_ptr<DeferredUnlock>> written;
+  {
+    std::lock_guard lock(mutex);
+    written = logs;
+  }
+  ASSERT_EQ(written.size(), 4);
+  auto writer = std::async(std::launch::async, [&]() { return raft_db.Set("key", "4").ok(); });
+  for (size_t i = 0; i + 1 < written.size(); i++) {
+    written[i]->Release();
+  }
+  EXPECT_EQ(writer.wait_for(std::chrono::milliseconds(100)), std::future_status::timeout);
+  written.back()->Release();
+  ASSERT_EQ(writer.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+  EXPECT_TRUE(writer.get());
+
+  std::lock_guard lock(mutex);
+  for (const auto& keys : logs) {
+    keys->Release();
+  }
+  raft_db.Close();
+  DeleteFiles(path.c_str());
+}
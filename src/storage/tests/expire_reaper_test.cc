@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "src/redis.h"
+#include "storage/storage.h"
+#include "tests/sync_raft_storage.h"
+
+using namespace storage;  // NOLINT
+
+// In raft mode, with the logs applied as they are appended.
+class ExpireReaperTest : public ::testing::Test {
+ public:
+  void SetUp() override { ASSERT_TRUE(raft_.Open().ok()); }
+
+  static StorageOptions Options() {
+    StorageOptions options;
+    // the test reaps by itself
+    options.expire_reap_keys_per_second = 0;
+    return options;
+  }
+
+  SyncRaftStorage raft_{"./test_db/expire_reaper_test", Options()};
+  Storage& db_ = raft_.db();
+};
+
+// A pass commits a batch of keys at once, not a raft log per key.
+TEST_F(ExpireReaperTest, ReapsInBatches) {
+  const size_t kKeys = 300;
+  for (size_t i = 0; i < kKeys; i++) {
+    ASSERT_TRUE(db_.Setex("reap" + std::to_string(i), "value", 1).ok());
+  }
+  ASSERT_TRUE(db_.Set("live", "value").ok());
+  std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+
+  auto& inst = db_.GetDBInstance("live");
+  std::map<DataType, std::pair<std::string, std::string>> reaped_ranges;
+  size_t reaped = 0;
+  auto logs = raft_.logs();
+  ASSERT_TRUE(inst->ReapExpiredKeys(1000, &reaped_ranges, &reaped).ok());
+  EXPECT_EQ(reaped, kKeys);
+  EXPECT_EQ(raft_.logs() - logs, static_cast<LogIndex>((kKeys + Redis::kReapBatchKeys - 1) / Redis::kReapBatchKeys));
+  ASSERT_EQ(reaped_ranges.count(DataType::kStrings), 1U);
+  EXPECT_EQ(reaped_ranges[DataType::kStrings].first, "reap0");
+  EXPECT_EQ(reaped_ranges[DataType::kStrings].second, "reap99");
+
+  std::string value;
+  for (size_t i = 0; i < kKeys; i++) {
+    EXPECT_TRUE(db_.Get("reap" + std::to_string(i), &value).IsNotFound());
+  }
+  ASSERT_TRUE(db_.Get("live", &value).ok());
+
+  // the index keys were reaped with their keys
+  logs = raft_.logs();
+  ASSERT_TRUE(inst->ReapExpiredKeys(1000, &reaped_ranges, &reaped).ok());
+  EXPECT_EQ(reaped, 0U);
+  EXPECT_EQ(raft_.logs(), logs);
+}
@@ -42,14 +42,15 @@ using LogIndex = int64_t;
 
 class LogQueue : public pstd::noncopyable {
  public:
-  using WriteCallback = std::function<rocksdb::Status(const pikiwidb::Binlog&, LogIndex idx)>;
+  using WriteCallback = std::function<rocksdb::Status(const storage::BinlogView&, LogIndex idx)>;
 
   explicit LogQueue(WriteCallback&& cb) : write_cb_(std::move(cb)) { consumer_.SetMaxIdleThread(1); }
 
-  void AppendLog(const pikiwidb::Binlog& log, std::promise<rocksdb::Status>&& promise) {
+  void AppendLog(storage::BinlogWriter&& log, std::promise<rocksdb::Status>&& promise) {
     auto task = [&] {
       auto idx = next_log_idx_.fetch_add(1);
-      auto s = write_cb_(log, idx);
+      storage::BinlogView view;
+      auto s = view.Parse({log.Data(), log.Size()}) ? write_cb_(view, idx) : rocksdb::Status::Corruption("Bad binlog");
       promise.set_value(s);
     };
     consumer_.ExecuteTask(std::move(task));
@@ -64,16 +65,20 @@ class LogQueue : public pstd::noncopyable {
 class FlushOldestCFTest : public ::testing::Test {
  public:
   FlushOldestCFTest()
-      : log_queue_([this](const pikiwidb::Binlog& log, LogIndex log_idx) { return db_.OnBinlogWrite(log, log_idx); }) {
+      : log_queue_([this](const storage::BinlogView& log, LogIndex log_idx) {
+          return db_.OnBinlogWrite(log, log_idx);
+        }) {
     options_.options.create_if_missing = true;
     options_.options.max_background_jobs = 10;
     options_.db_instance_num = 1;
     options_.raft_timeout_s = 9000000;
-    options_.append_log_function = [this](const pikiwidb::Binlog& log, std::promise<rocksdb::Status>&& promise) {
-      log_queue_.AppendLog(log, std::move(promise));
+    options_.append_log_function = [this](storage::BinlogWriter&& log, std::promise<rocksdb::Status>&& promise) {
+      log_queue_.AppendLog(std::move(log), std::move(promise));
     };
-    options_.do_snapshot_function = [](int64_t log_index, bool sync) {};
+    options_.do_snapshot_function = [](int32_t index, int64_t log_index, bool sync) {};
     options_.max_gap = 15;
+    // the flushes below are the ones of the test and the ones they start
+    options_.gap_flush_interval_ms = 0;
     write_options_.disableWAL = true;
   }
 
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+
+#include "src/redis_hyperloglog.h"
+
+// The one byte per register implementation the sparse and dense encodings
+// replaced, for hyperloglog_test and hyperloglog_bench.
+namespace storage::reference {
+
+inline constexpr uint8_t kPrecision = 17;
+
+class ReferenceHyperLogLog {
+ public:
+  explicit ReferenceHyperLogLog(std::string registers) : registers_(std::move(registers)) {
+    registers_.resize(1 << kPrecision);
+  }
+
+  std::string Add(const std::string& value) {
+    auto [index, rank] = HyperLogLog(kPrecision).Register(value.data(), value.size());
+    registers_[index] = std::max(registers_[index], static_cast<char>(rank));
+    return registers_;
+  }
+
+  std::string Merge(const ReferenceHyperLogLog& hll) {
+    for (size_t i = 0; i < registers_.size(); i++) {
+      registers_[i] = std::max(registers_[i], hll.registers_[i]);
+    }
+    return registers_;
+  }
+
+  const std::string& Registers() const { return registers_; }
+
+  double Estimate() const {
+    double m = registers_.size();
+    double sum = 0.0;
+    uint32_t zeros = 0;
+    for (char reg : registers_) {
+      sum += 1.0 / (1 << reg);
+      zeros += reg == 0 ? 1 : 0;
+    }
+    double estimate = (0.7213 / (1 + 1.079 / m)) * m * m / sum;
+    if (estimate <= 2.5 * m && zeros != 0) {
+      estimate = m * log(m / zeros);
+    }
+    return estimate;
+  }
+
+ private:
+  std::string registers_;
+};
+
+}  // namespace storage::reference
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "src/redis_hyperloglog.h"
+#include "storage/storage.h"
+#include "storage/util.h"
+#include "tests/hyperloglog_reference.h"
+
+using namespace storage;             // NOLINT
+using namespace storage::reference;  // NOLINT
+
+namespace {
+
+std::vector<std::string> Values(const std::string& prefix, int count) {
+  std::vector<std::string> values;
+  for (int i = 0; i < count; i++) {
+    values.push_back(prefix + std::to_string(i));
+  }
+  return values;
+}
+
+}  // namespace
+
+TEST(HyperLogLogTest, SparseUntilItGrows) {
+  HyperLogLog hll(kPrecision);
+  ASSERT_TRUE(hll.Decode(""));
+  EXPECT_EQ(hll.Estimate(), 0);
+  std::string encoded = hll.Encode();
+  // 8 runs of 16384 zero registers
+  EXPECT_EQ(encoded.size(), HyperLogLog::kHeaderLength + 16);
+
+  ReferenceHyperLogLog reference("");
+  for (const auto& value : Values("a", 500)) {
+    hll.Add(value.data(), value.size());
+    reference.Add(value);
+  }
+  encoded = hll.Encode();
+  EXPECT_TRUE(hll.IsSparse());
+  EXPECT_LE(encoded.size(), HyperLogLog::kHeaderLength + HyperLogLog::kSparseMaxBytes);
+  EXPECT_DOUBLE_EQ(hll.Estimate(), reference.Estimate());
+
+  HyperLogLog decoded(kPrecision);
+  ASSERT_TRUE(decoded.Decode(encoded));
+  EXPECT_TRUE(decoded.IsSparse());
+  EXPECT_EQ(decoded.Encode(), encoded);
+
+  for (const auto& value : Values("b", 20000)) {
+    hll.Add(value.data(), value.size());
+    reference.Add(value);
+  }
+  encoded = hll.Encode();
+  EXPECT_FALSE(hll.IsSparse());
+  // 6 bits per register
+  EXPECT_EQ(encoded.size(), HyperLogLog::kHeaderLength + (1 << kPrecision) / 4 * 3);
+  EXPECT_DOUBLE_EQ(hll.Estimate(), reference.Estimate());
+  ASSERT_TRUE(decoded.Decode(encoded));
+  EXPECT_EQ(decoded.Encode(), encoded);
+  EXPECT_NEAR(decoded.Estimate(), 20500, 20500 * 0.02);
+}
+
+TEST(HyperLogLogTest, AddReportsChangedRegisters) {
+  HyperLogLog hll(kPrecision);
+  EXPECT_TRUE(hll.Add("value", 5));
+  EXPECT_FALSE(hll.Add("value", 5));
+}
+
+TEST(HyperLogLogTest, ReadsOneBytePerRegisterValues) {
+  ReferenceHyperLogLog reference("");
+  std::string registers;
+  for (const auto& value : Values("legacy", 3000)) {
+    registers = reference.Add(value);
+  }
+  HyperLogLog hll(kPrecision);
+  ASSERT_TRUE(hll.Decode(registers));
+  EXPECT_DOUBLE_EQ(hll.Estimate(), reference.Estimate());
+
+  EXPECT_FALSE(hll.Decode("not a hyperloglog"));
+  EXPECT_FALSE(hll.Decode(std::string("HYLL\x01\x11\0\0", 8)));
+  HyperLogLog other_precision(14);
+  EXPECT_FALSE(other_precision.Decode(HyperLogLog(kPrecision).Encode()));
+}
+
+TEST(HyperLogLogTest, MergeIsTheUnion) {
+  // sparse with sparse, sparse with dense and dense with dense
+  for (auto [left_count, right_count] : {std::make_pair(300, 400), std::make_pair(300, 30000),
+                                         std::make_pair(30000, 300), std::make_pair(30000, 40000)}) {
+    HyperLogLog left(kPrecision);
+    HyperLogLog right(kPrecision);
+    HyperLogLog both(kPrecision);
+    for (const auto& value : Values("l", left_count)) {
+      left.Add(value.data(), value.size());
+      both.Add(value.data(), value.size());
+    }
+    for (const auto& value : Values("r", right_count)) {
+      right.Add(value.data(), value.size());
+      both.Add(value.data(), value.size());
+    }
+    left.Merge(right);
+    HyperLogLog decoded(kPrecision);
+    ASSERT_TRUE(decoded.Decode(left.Encode()));
+    ASSERT_TRUE(both.Decode(both.Encode()));
+    EXPECT_EQ(decoded.Encode(), both.Encode()) << left_count << " " << right_count;
+    EXPECT_DOUBLE_EQ(decoded.Estimate(), both.Estimate());
+  }
+}
+
+TEST(HyperLogLogTest, ComparedWithReference) {
+  const int kAdds = 1000;
+  const int kKeys = 8;
+
+  // a PFADD of one value each time, decoded and encoded like the storage does
+  std::string value;
+  std::string registers;
+  for (int i = 0; i < kAdds; i++) {
+    HyperLogLog hll(kPrecision);
+    ASSERT_TRUE(hll.Decode(value));
+    std::string element = std::to_string(i);
+    hll.Add(element.data(), element.size());
+    value = hll.Encode();
+    registers = ReferenceHyperLogLog(registers).Add(element);
+  }
+  HyperLogLog hll(kPrecision);
+  ASSERT_TRUE(hll.Decode(value));
+  EXPECT_DOUBLE_EQ(hll.Estimate(), ReferenceHyperLogLog(registers).Estimate());
+
+  // a PFCOUNT of several dense keys
+  HyperLogLog merged(kPrecision);
+  ReferenceHyperLogLog reference_merged("");
+  for (int key = 0; key < kKeys; key++) {
+    HyperLogLog dense(kPrecision);
+    ReferenceHyperLogLog reference("");
+    for (const auto& element : Values(std::to_string(key) + "_", 50000)) {
+      dense.Add(element.data(), element.size());
+      reference.Add(element);
+    }
+    HyperLogLog decoded(kPrecision);
+    ASSERT_TRUE(decoded.Decode(dense.Encode()));
+    merged.Merge(decoded);
+    reference_merged.Merge(reference);
+  }
+  EXPECT_DOUBLE_EQ(merged.Estimate(), reference_merged.Estimate());
+  EXPECT_NEAR(merged.Estimate(), kKeys * 50000, kKeys * 50000 * 0.02);
+}
+
+// PFADD and PFMERGE through the storage
+class PfCommandsTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    DeleteFiles(kDbPath);
+    StorageOptions storage_options;
+    storage_options.options.create_if_missing = true;
+    storage_options.db_instance_num = 1;
+    ASSERT_TRUE(db_.Open(storage_options, kDbPath).ok());
+  }
+
+  void TearDown() override {
+    db_.Close();
+    DeleteFiles(kDbPath);
+  }
+
+  double Estimate(const std::string& key) {
+    std::string value;
+    EXPECT_TRUE(db_.Get(key, &value).ok());
+    HyperLogLog hll(kPrecision);
+    EXPECT_TRUE(hll.Decode(value));
+    return hll.Estimate();
+  }
+
+  int64_t TTL(const std::string& key) {
+    std::map<DataType, Status> type_status;
+    return db_.TTL(key, &type_status)[DataType::kStrings];
+  }
+
+  static constexpr const char* kDbPath = "./hyperloglog_test_db";
+  Storage db_;
+};
+
+// each PFADD reads and writes the key under its record lock, no add is lost
+TEST_F(PfCommandsTest, ConcurrentPfAdds) {
+  const int kThreads = 8;
+  const int kAdds = 300;
+  HyperLogLog expected(kPrecision);
+  for (int t = 0; t < kThreads; t++) {
+    for (const auto& value : Values(std::to_string(t) + "_", kAdds)) {
+      expected.Add(value.data(), value.size());
+    }
+  }
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([this, t]() {
+      for (const auto& value : Values(std::to_string(t) + "_", kAdds)) {
+        bool update = false;
+        EXPECT_TRUE(db_.PfAdd("hll", {value}, &update).ok());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_DOUBLE_EQ(Estimate("hll"), expected.Estimate());
+}
+
+TEST_F(PfCommandsTest, KeepsTTL) {
+  bool update = false;
+  ASSERT_TRUE(db_.PfAdd("hll", {"a"}, &update).ok());
+  ASSERT_EQ(db_.Expire("hll", 100), 1);
+  ASSERT_TRUE(db_.PfAdd("hll", {"b", "c"}, &update).ok());
+  EXPECT_TRUE(update);
+  EXPECT_GT(TTL("hll"), 0);
+  EXPECT_LE(TTL("hll"), 100);
+
+  ASSERT_TRUE(db_.PfAdd("other", {"d"}, &update).ok());
+  std::string value;
+  ASSERT_TRUE(db_.PfMerge({"hll", "other"}, value).ok());
+  EXPECT_GT(TTL("hll"), 0);
+  EXPECT_LE(TTL("hll"), 100);
+  EXPECT_NEAR(Estimate("hll"), 4, 0.1);
+  // a merge into a new key has no TTL
+  ASSERT_TRUE(db_.PfMerge({"merged", "hll"}, value).ok());
+  EXPECT_EQ(TTL("merged"), -1);
+}
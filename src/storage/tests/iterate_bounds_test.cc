@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <string>
+#include <vector>
+
+#include "fmt/core.h"
+#include "gtest/gtest.h"
+#include "rocksdb/perf_context.h"
+#include "rocksdb/perf_level.h"
+
+#include "src/iterate_bounds.h"
+#include "storage/storage.h"
+#include "storage/util.h"
+
+using namespace storage;  // NOLINT
+
+TEST(PrefixSuccessorTest, SkipsTrailingMaxBytes) {
+  EXPECT_EQ(PrefixSuccessor("abc"), "abd");
+  EXPECT_EQ(PrefixSuccessor(std::string("ab\xff\xff", 4)), "ac");
+  EXPECT_EQ(PrefixSuccessor(std::string("\xff\xff", 2)), "");
+  EXPECT_EQ(PrefixSuccessor(""), "");
+}
+
+// Reading a key must not step over the tombstones of the key next to it. The
+// tests count the deletes skipped by the iterators, like queue_pop_test.
+class IterateBoundsTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    DeleteFiles(kDbPath);
+    StorageOptions storage_options;
+    storage_options.options.create_if_missing = true;
+    storage_options.db_instance_num = 1;
+    ASSERT_TRUE(db_.Open(storage_options, kDbPath).ok());
+  }
+
+  void TearDown() override {
+    db_.Close();
+    DeleteFiles(kDbPath);
+  }
+
+  template <typename ReadFunc>
+  uint64_t SkippedDeletes(ReadFunc&& read) {
+    rocksdb::SetPerfLevel(rocksdb::PerfLevel::kEnableCount);
+    rocksdb::get_perf_context()->Reset();
+    read();
+    uint64_t skipped = rocksdb::get_perf_context()->internal_delete_skipped_count;
+    rocksdb::SetPerfLevel(rocksdb::PerfLevel::kDisable);
+    return skipped;
+  }
+
+  static constexpr const char* kDbPath = "./iterate_bounds_test_db";
+  static constexpr int kDeleted = 10000;
+  Storage db_;
+};
+
+TEST_F(IterateBoundsTest, HashNextToDeletedFields) {
+  int32_t ret = 0;
+  ASSERT_TRUE(db_.HSet("b", "field", "value", &ret).ok());
+  std::vector<FieldValue> fvs;
+  std::vector<std::string> fields;
+  for (int i = 0; i < kDeleted; i++) {
+    fvs.push_back({fmt::format("field_{}", i), "value"});
+    fields.push_back(fvs.back().field);
+  }
+  ASSERT_TRUE(db_.HMSet("c", fvs).ok());
+  ASSERT_TRUE(db_.HDel("c", fields, &ret).ok());
+
+  EXPECT_EQ(SkippedDeletes([&]() { ASSERT_TRUE(db_.HGetall("b", &fvs).ok()); }), 0);
+  ASSERT_EQ(fvs.size(), 1);
+  EXPECT_EQ(fvs[0].field, "field");
+}
+
+TEST_F(IterateBoundsTest, ZSetNextToDeletedMembers) {
+  int32_t ret = 0;
+  ASSERT_TRUE(db_.ZAdd("b", {{1, "member"}}, &ret).ok());
+  std::vector<ScoreMember> score_members;
+  std::vector<std::string> members;
+  for (int i = 0; i < kDeleted; i++) {
+    score_members.push_back({static_cast<double>(i), fmt::format("member_{}", i)});
+    members.push_back(score_members.back().member);
+  }
+  ASSERT_TRUE(db_.ZAdd("c", score_members, &ret).ok());
+  ASSERT_TRUE(db_.ZRem("c", members, &ret).ok());
+
+  EXPECT_EQ(SkippedDeletes([&]() { ASSERT_TRUE(db_.ZRange("b", 0, -1, &score_members).ok()); }), 0);
+  ASSERT_EQ(score_members.size(), 1);
+  EXPECT_EQ(score_members[0].member, "member");
+}
+
+TEST_F(IterateBoundsTest, KeysNextToDeletedKeys) {
+  ASSERT_TRUE(db_.Set("b_key", "value").ok());
+  std::vector<std::string> keys;
+  for (int i = 0; i < kDeleted; i++) {
+    keys.push_back(fmt::format("c_key_{}", i));
+    ASSERT_TRUE(db_.Set(keys.back(), "value").ok());
+  }
+  ASSERT_EQ(db_.Del(keys), kDeleted);
+
+  EXPECT_EQ(SkippedDeletes([&]() { ASSERT_TRUE(db_.Keys(DataType::kStrings, "b_*", &keys).ok()); }), 0);
+  EXPECT_EQ(keys, std::vector<std::string>{"b_key"});
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fmt/core.h"
+#include "gtest/gtest.h"
+#include "rocksdb/db.h"
+
+#include "src/coding.h"
+#include "src/custom_comparator.h"
+#include "src/data_key_prefix_transform.h"
+#include "src/lists_data_key_format.h"
+#include "src/zsets_data_key_format.h"
+#include "storage/storage.h"
+#include "storage/util.h"
+
+// in the namespace, base_data_key_format.h pulls pstd::Slice into the global one
+namespace storage {
+
+// the keys of the bytewise CFs in the encodings of the DBs before them
+static std::string ToLegacyScoreKey(const Slice& key) {
+  std::string legacy = key.ToString();
+  size_t score_offset = DataKeyPrefixTransform().Transform(key).size();
+  double score = ParsedZSetsScoreKey(key).score();
+  uint64_t bits;
+  memcpy(&bits, &score, sizeof(bits));
+  EncodeFixed64(legacy.data() + score_offset, bits);
+  return legacy;
+}
+
+static std::string ToLegacyListsDataKey(const Slice& key) {
+  std::string legacy = key.ToString();
+  size_t index_offset = DataKeyPrefixTransform().Transform(key).size();
+  EncodeFixed64(legacy.data() + index_offset, ParsedListsDataKey(key).index());
+  return legacy;
+}
+
+// Writes with the current storage, then moves the keys of a bytewise CF into
+// its legacy CF, sorted by the legacy comparator, and reopens the storage,
+// which must migrate them back.
+class LegacyCFMigrationTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    DeleteFiles(kDbPath);
+    Open();
+  }
+
+  void TearDown() override {
+    Close();
+    DeleteFiles(kDbPath);
+  }
+
+  void Open() {
+    StorageOptions storage_options;
+    storage_options.options.create_if_missing = true;
+    storage_options.db_instance_num = 1;
+    db_ = std::make_unique<Storage>();
+    ASSERT_TRUE(db_->Open(storage_options, kDbPath).ok());
+  }
+
+  void Close() {
+    if (db_) {
+      db_->Close();
+      db_.reset();
+    }
+  }
+
+  std::vector<std::string> ColumnFamilies() {
+    std::vector<std::string> cf_names;
+    EXPECT_TRUE(rocksdb::DB::ListColumnFamilies(rocksdb::DBOptions(), kInstancePath, &cf_names).ok());
+    return cf_names;
+  }
+
+  // the storage must be closed
+  void MoveToLegacyCF(const std::string& cf_name, const std::string& legacy_cf_name,
+                      const rocksdb::Comparator* legacy_comparator, std::string (*to_legacy)(const Slice&)) {
+    std::vector<std::string> cf_names = ColumnFamilies();
+    auto cf_pos = std::find(cf_names.begin(), cf_names.end(), cf_name);
+    ASSERT_NE(cf_pos, cf_names.end());
+    std::vector<rocksdb::ColumnFamilyDescriptor> column_families;
+    for (const auto& name : cf_names) {
+      column_families.emplace_back(name, rocksdb::ColumnFamilyOptions());
+    }
+    std::vector<rocksdb::ColumnFamilyHandle*> handles;
+    rocksdb::DB* db = nullptr;
+    ASSERT_TRUE(rocksdb::DB::Open(rocksdb::DBOptions(), kInstancePath, column_families, &handles, &db).ok());
+    rocksdb::ColumnFamilyHandle* cf = handles[cf_pos - cf_names.begin()];
+
+    rocksdb::ColumnFamilyOptions legacy_cf_options;
+    legacy_cf_options.comparator = legacy_comparator;
+    rocksdb::ColumnFamilyHandle* legacy_cf = nullptr;
+    ASSERT_TRUE(db->CreateColumnFamily(legacy_cf_options, legacy_cf_name, &legacy_cf).ok());
+    handles.push_back(legacy_cf);
+
+    rocksdb::WriteBatch batch;
+    std::unique_ptr<rocksdb::Iterator> iter(db->NewIterator(rocksdb::ReadOptions(), cf));
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      batch.Put(legacy_cf, to_legacy(iter->key()), iter->value());
+      batch.Delete(cf, iter->key());
+    }
+    ASSERT_TRUE(iter->status().ok());
+    iter.reset();
+    ASSERT_GT(batch.Count(), 0);
+    ASSERT_TRUE(db->Write(rocksdb::WriteOptions(), &batch).ok());
+    ASSERT_TRUE(db->Flush(rocksdb::FlushOptions(), handles).ok());
+
+    for (auto* handle : handles) {
+      db->DestroyColumnFamilyHandle(handle);
+    }
+    delete db;
+  }
+
+  static constexpr const char* kDbPath = "./legacy_cf_migration_test_db";
+  static constexpr const char* kInstancePath = "./legacy_cf_migration_test_db/0";
+  // more than one batch of the migration
+  static constexpr int kListElements = 25000;
+  std::unique_ptr<Storage> db_;
+};
+
+TEST_F(LegacyCFMigrationTest, MigratesZSetScores) {
+  const double inf = std::numeric_limits<double>::infinity();
+  std::vector<ScoreMember> score_members = {{-inf, "a"}, {-2.5, "b"}, {-1, "c"}, {0, "d"},
+                                            {1.5, "e"},  {1e300, "f"}, {inf, "g"}};
+  int32_t added = 0;
+  ASSERT_TRUE(db_->ZAdd("zset", score_members, &added).ok());
+  ASSERT_EQ(added, static_cast<int32_t>(score_members.size()));
+  Close();
+  ZSetsScoreKeyComparatorImpl legacy_comparator;
+  MoveToLegacyCF("zset_score_bytewise_cf", "zset_score_cf", &legacy_comparator, ToLegacyScoreKey);
+
+  Open();
+  std::vector<ScoreMember> ranged;
+  ASSERT_TRUE(db_->ZRangebyscore("zset", -inf, inf, true, true, &ranged).ok());
+  EXPECT_EQ(ranged, score_members);
+  ASSERT_TRUE(db_->ZRangebyscore("zset", -2.5, 1.5, false, true, &ranged).ok());
+  EXPECT_EQ(ranged, std::vector<ScoreMember>(score_members.begin() + 2, score_members.begin() + 5));
+
+  // the migrated keys sort with the new ones
+  ASSERT_TRUE(db_->ZAdd("zset", {{-1.5, "h"}}, &added).ok());
+  ASSERT_TRUE(db_->ZRangebyscore("zset", -2, -1, true, true, &ranged).ok());
+  EXPECT_EQ(ranged, (std::vector<ScoreMember>{{-1.5, "h"}, {-1, "c"}}));
+
+  Close();
+  std::vector<std::string> cf_names = ColumnFamilies();
+  EXPECT_EQ(std::find(cf_names.begin(), cf_names.end(), "zset_score_cf"), cf_names.end());
+}
+
+TEST_F(LegacyCFMigrationTest, MigratesListIndexes) {
+  std::vector<std::string> values;
+  for (int i = 0; i < kListElements; i++) {
+    values.push_back(fmt::format("value_{}", i));
+  }
+  uint64_t len = 0;
+  // on both sides of the initial index
+  ASSERT_TRUE(db_->RPush("list", std::vector<std::string>(values.begin() + 2, values.end()), &len).ok());
+  ASSERT_TRUE(db_->LPush("list", {values[1], values[0]}, &len).ok());
+  ASSERT_EQ(len, static_cast<uint64_t>(kListElements));
+  Close();
+  ListsDataKeyComparatorImpl legacy_comparator;
+  MoveToLegacyCF("list_data_bytewise_cf", "list_data_cf", &legacy_comparator, ToLegacyListsDataKey);
+
+  Open();
+  std::vector<std::string> elements;
+  ASSERT_TRUE(db_->LRange("list", 0, -1, &elements).ok());
+  EXPECT_EQ(elements, values);
+
+  ASSERT_TRUE(db_->RPush("list", {"tail"}, &len).ok());
+  ASSERT_TRUE(db_->LRange("list", -2, -1, &elements).ok());
+  EXPECT_EQ(elements, (std::vector<std::string>{values.back(), "tail"}));
+  ASSERT_TRUE(db_->LPop("list", 1, &elements).ok());
+  EXPECT_EQ(elements, std::vector<std::string>{values.front()});
+
+  Close();
+  std::vector<std::string> cf_names = ColumnFamilies();
+  EXPECT_EQ(std::find(cf_names.begin(), cf_names.end(), "list_data_cf"), cf_names.end());
+}
+
+}  // namespace storage
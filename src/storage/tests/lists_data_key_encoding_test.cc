@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "src/base_data_key_format.h"
+#include "src/coding.h"
+#include "src/data_key_prefix_transform.h"
+#include "src/lists_data_key_format.h"
+#include "src/lists_meta_value_format.h"
+
+// in the namespace, base_data_key_format.h pulls pstd::Slice into the global one
+namespace storage {
+
+TEST(ListsDataKeyEncodingTest, SortsBytewise) {
+  std::vector<uint64_t> indexes = {0, 1, 255, 256, InitalLeftIndex, InitalRightIndex,
+                                   std::numeric_limits<uint64_t>::max()};
+  std::string last = HashesDataKey(Slice("key"), 100, Slice()).EncodeSeekKey().ToString();
+  for (uint64_t index : indexes) {
+    ListsDataKey lists_data_key(Slice("key"), 100, index);
+    std::string encoded = lists_data_key.Encode().ToString();
+    EXPECT_LT(last, encoded) << index;
+    last = encoded;
+
+    ParsedListsDataKey parsed(encoded);
+    EXPECT_EQ(parsed.index(), index);
+  }
+}
+
+TEST(ListsDataKeyEncodingTest, ConvertsLegacyKeys) {
+  DataKeyPrefixTransform transform;
+  std::string user_key("user\0key", 8);
+  ListsDataKey lists_data_key(user_key, 100, InitalLeftIndex + 3);
+  std::string bytewise = lists_data_key.Encode().ToString();
+  std::string legacy = bytewise;
+  size_t index_offset = transform.Transform(bytewise).size();
+  EncodeFixed64(legacy.data() + index_offset, InitalLeftIndex + 3);
+
+  ASSERT_NE(legacy, bytewise);
+  EXPECT_EQ(LegacyListsDataKeyToBytewise(legacy), bytewise);
+  EXPECT_EQ(LegacyListsDataKeyToBytewise(legacy.substr(0, index_offset)), legacy.substr(0, index_offset));
+}
+
+}  // namespace storage
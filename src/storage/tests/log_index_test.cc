@@ -75,14 +75,15 @@ TEST(TablePropertyTest, SimpleTest) {
 
 class LogQueue : public pstd::noncopyable {
  public:
-  using WriteCallback = std::function<rocksdb::Status(const pikiwidb::Binlog&, LogIndex idx)>;
+  using WriteCallback = std::function<rocksdb::Status(const storage::BinlogView&, LogIndex idx)>;
 
   explicit LogQueue(WriteCallback&& cb) : write_cb_(std::move(cb)) { consumer_.SetMaxIdleThread(1); }
 
-  void AppendLog(const pikiwidb::Binlog& log, std::promise<rocksdb::Status>&& promise) {
+  void AppendLog(storage::BinlogWriter&& log, std::promise<rocksdb::Status>&& promise) {
     auto task = [&] {
       auto idx = next_log_idx_.fetch_add(1);
-      auto s = write_cb_(log, idx);
+      storage::BinlogView view;
+      auto s = view.Parse({log.Data(), log.Size()}) ? write_cb_(view, idx) : rocksdb::Status::Corruption("Bad binlog");
       promise.set_value(s);
     };
     consumer_.ExecuteTask(std::move(task));
@@ -97,14 +98,16 @@ class LogQueue : public pstd::noncopyable {
 class LogIndexTest : public ::testing::Test {
  public:
   LogIndexTest()
-      : log_queue_([this](const pikiwidb::Binlog& log, LogIndex log_idx) { return db_.OnBinlogWrite(log, log_idx); }) {
+      : log_queue_([this](const storage::BinlogView& log, LogIndex log_idx) {
+          return db_.OnBinlogWrite(log, log_idx);
+        }) {
     options_.options.create_if_missing = true;
     options_.db_instance_num = 1;
     options_.raft_timeout_s = 10000;
-    options_.append_log_function = [this](const pikiwidb::Binlog& log, std::promise<rocksdb::Status>&& promise) {
-      log_queue_.AppendLog(log, std::move(promise));
+    options_.append_log_function = [this](storage::BinlogWriter&& log, std::promise<rocksdb::Status>&& promise) {
+      log_queue_.AppendLog(std::move(log), std::move(promise));
     };
-    options_.do_snapshot_function = [](int64_t log_index, bool sync) {};
+    options_.do_snapshot_function = [](int32_t index, int64_t log_index, bool sync) {};
   }
   ~LogIndexTest() override { DeleteFiles(db_path_.c_str()); }
 
@@ -272,3 +275,60 @@ TEST_F(LogIndexTest, SimpleTest) {  // NOLINT
     }
   }
 }
+
+TEST_F(LogIndexTest, BatchedApply) {  // NOLINT
+  auto& redis = db_.GetDBInstance(key_);
+  auto make_log = [](const std::vector<std::string>& keys, pikiwidb::OperateType op_type) {
+    BinlogWriter log(0, 0, kCurrentKeyFormat);
+    for (const auto& key : keys) {
+      Slice value(key);
+      log.AddEntry(kStringsCF, op_type, key, &value);
+    }
+    return log;
+  };
+  std::vector<BinlogWriter> writers;
+  writers.push_back(make_log({"a", "b"}, pikiwidb::OperateType::kPut));
+  writers.push_back(make_log({"c"}, pikiwidb::OperateType::kPut));
+  writers.push_back(make_log({"d"}, pikiwidb::OperateType::kNoOperate));
+  writers.push_back(make_log({"e"}, pikiwidb::OperateType::kPut));
+  std::vector<BinlogView> views(writers.size());
+  std::vector<std::pair<const BinlogView*, LogIndex>> logs;
+  for (size_t i = 0; i < writers.size(); i++) {
+    ASSERT_TRUE(views[i].Parse({writers[i].Data(), writers[i].Size()}));
+    logs.emplace_back(&views[i], i + 1);
+  }
+
+  // the logs 1, 2, 3 and 4 in one write batch, the bad log 3 is left out
+  std::vector<Status> statuses;
+  db_.OnBinlogWrite(logs, &statuses);
+  ASSERT_EQ(statuses.size(), 4);
+  EXPECT_TRUE(statuses[0].ok());
+  EXPECT_TRUE(statuses[1].ok());
+  EXPECT_TRUE(statuses[2].IsIncomplete());
+  EXPECT_TRUE(statuses[3].ok());
+
+  auto db = redis->GetDB();
+  EXPECT_EQ(db->GetLatestSequenceNumber(), 4);
+  std::vector<std::pair<std::string, bool>> keys{{"a", true}, {"b", true}, {"c", true}, {"d", false}, {"e", true}};
+  for (const auto& [key, found] : keys) {
+    std::string value;
+    auto s = db->Get(read_options_, redis->GetColumnFamilyHandles()[kStringsCF], key, &value);
+    EXPECT_EQ(s.ok(), found) << key;
+  }
+
+  // each log maps to its first sequence number, like when applied one by one
+  const auto& list = redis->GetCollector().GetList();
+  ASSERT_EQ(list.size(), 3);
+  EXPECT_EQ(list[0].GetAppliedLogIndex(), 1);
+  EXPECT_EQ(list[0].GetSequenceNumber(), 1);
+  EXPECT_EQ(list[1].GetAppliedLogIndex(), 2);
+  EXPECT_EQ(list[1].GetSequenceNumber(), 3);
+  EXPECT_EQ(list[2].GetAppliedLogIndex(), 4);
+  EXPECT_EQ(list[2].GetSequenceNumber(), 4);
+  EXPECT_EQ(redis->GetCollector().FindAppliedLogIndex(2), 1);
+  EXPECT_EQ(redis->GetCollector().FindAppliedLogIndex(3), 2);
+
+  auto& applied = redis->GetLogIndexOfColumnFamilies().GetCFStatus(kStringsCF).applied_index;
+  EXPECT_EQ(applied.GetLogIndex(), 4);
+  EXPECT_EQ(applied.GetSequenceNumber(), 4);
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "rocksdb/db.h"
+#include "rocksdb/options.h"
+
+#include "src/merge_operator.h"
+#include "src/strings_value_format.h"
+#include "storage/storage.h"
+#include "storage/util.h"
+#include "tests/sync_raft_storage.h"
+
+using namespace storage;  // NOLINT
+
+class StringsMergeOperatorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    DeleteFiles(kDbPath);
+    rocksdb::Options options;
+    options.create_if_missing = true;
+    options.merge_operator = std::make_shared<StringsMergeOperator>();
+    ASSERT_TRUE(rocksdb::DB::Open(options, kDbPath, &db_).ok());
+  }
+
+  void TearDown() override {
+    db_->Close();
+    delete db_;
+    DeleteFiles(kDbPath);
+  }
+
+  void PutString(const std::string& key, const std::string& value, uint64_t etime) {
+    StringsValue strings_value(value);
+    strings_value.SetEtime(etime);
+    ASSERT_TRUE(db_->Put(rocksdb::WriteOptions(), key, strings_value.Encode()).ok());
+  }
+
+  void Merge(const std::string& key, const std::string& operand) {
+    ASSERT_TRUE(db_->Merge(rocksdb::WriteOptions(), key, operand).ok());
+  }
+
+  // returns user value and etime of the merged result
+  std::pair<std::string, uint64_t> GetString(const std::string& key) {
+    std::string value;
+    EXPECT_TRUE(db_->Get(rocksdb::ReadOptions(), key, &value).ok());
+    ParsedStringsValue parsed_strings_value(&value);
+    uint64_t etime = parsed_strings_value.Etime();
+    parsed_strings_value.StripSuffix();
+    return {value, etime};
+  }
+
+  static constexpr const char* kDbPath = "./merge_operator_test_db";
+  rocksdb::DB* db_ = nullptr;
+};
+
+TEST_F(StringsMergeOperatorTest, AppendKeepsTimestamp) {
+  PutString("text", "hello", 4102444800);
+  Merge("text", EncodeMergeOperand(kMergeAppend, 4102444800, " world"));
+  Merge("text", EncodeMergeOperand(kMergeAppend, 4102444800, "!"));
+  auto [value, etime] = GetString("text");
+  EXPECT_EQ(value, "hello world!");
+  EXPECT_EQ(etime, 4102444800);
+
+  // Survives flush and compaction
+  db_->Flush(rocksdb::FlushOptions());
+  db_->CompactRange(rocksdb::CompactRangeOptions(), nullptr, nullptr);
+  EXPECT_EQ(GetString("text").first, "hello world!");
+}
+
+TEST_F(StringsMergeOperatorTest, OperandWithoutBaseKeepsOperandTimestamp) {
+  // The base value was dropped, e.g. by the compaction filter after expiring
+  Merge("expired", EncodeMergeOperand(kMergeAppend, 1, "tail"));
+  auto [value, etime] = GetString("expired");
+  EXPECT_EQ(value, "tail");
+  EXPECT_EQ(etime, 1);
+}
+
+TEST_F(StringsMergeOperatorTest, BadOperandFailsTheMerge) {
+  PutString("unknown", "abc", 0);
+  PutString("short", "abc", 0);
+  // an unknown type, and an operand shorter than its header
+  Merge("unknown", std::string(kMergeOperandHeaderLength, 'x'));
+  Merge("short", "a");
+  std::string value;
+  EXPECT_TRUE(db_->Get(rocksdb::ReadOptions(), "unknown", &value).IsCorruption());
+  EXPECT_TRUE(db_->Get(rocksdb::ReadOptions(), "short", &value).IsCorruption());
+}
+
+// In raft mode, with the logs applied as they are appended. The size of a log
+// is what a write costs the raft log, and the WAL and memtable get the same
+// batch.
+class MergeWriteBytesTest : public ::testing::Test {
+ public:
+  void SetUp() override { ASSERT_TRUE(raft_.Open().ok()); }
+
+  SyncRaftStorage raft_{"./test_db/merge_write_bytes_test"};
+  Storage& db_ = raft_.db();
+};
+
+// APPEND still reads the value for its reply, but writes only the appended
+// bytes, not the whole value again.
+TEST_F(MergeWriteBytesTest, AppendWritesOnlyTheAppendedBytes) {
+  const std::string kValue(60 << 10, 'v');
+  const std::string kSuffix = "0123456789";
+  ASSERT_TRUE(db_.Set("text", kValue).ok());
+  EXPECT_GT(raft_.last_log_bytes(), kValue.size());
+
+  int32_t len = 0;
+  ASSERT_TRUE(db_.Append("text", kSuffix, &len).ok());
+  EXPECT_EQ(len, static_cast<int32_t>(kValue.size() + kSuffix.size()));
+  EXPECT_LT(raft_.last_log_bytes(), 128U);
+
+  std::string value;
+  ASSERT_TRUE(db_.Get("text", &value).ok());
+  EXPECT_EQ(value, kValue + kSuffix);
+}
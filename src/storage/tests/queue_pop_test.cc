@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <string>
+#include <vector>
+
+#include "fmt/core.h"
+#include "gtest/gtest.h"
+#include "rocksdb/perf_context.h"
+#include "rocksdb/perf_level.h"
+
+#include "storage/storage.h"
+#include "storage/util.h"
+
+using namespace storage;  // NOLINT
+
+// Pops from the head of a queue must not step over the tombstones left by the
+// previous pops. Instead of timing the pops, which is flaky on shared machines,
+// the tests count the deletes skipped by the iterators of the last pops.
+class QueuePopTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    DeleteFiles(kDbPath);
+    StorageOptions storage_options;
+    storage_options.options.create_if_missing = true;
+    storage_options.db_instance_num = 1;
+    ASSERT_TRUE(db_.Open(storage_options, kDbPath).ok());
+  }
+
+  void TearDown() override {
+    db_.Close();
+    DeleteFiles(kDbPath);
+  }
+
+  // deletes skipped by the iterators of pop()
+  template <typename PopFunc>
+  uint64_t SkippedDeletes(PopFunc&& pop) {
+    rocksdb::SetPerfLevel(rocksdb::PerfLevel::kEnableCount);
+    rocksdb::get_perf_context()->Reset();
+    pop();
+    uint64_t skipped = rocksdb::get_perf_context()->internal_delete_skipped_count;
+    rocksdb::SetPerfLevel(rocksdb::PerfLevel::kDisable);
+    return skipped;
+  }
+
+  static constexpr const char* kDbPath = "./queue_pop_test_db";
+  // large enough to make a rescan of the popped head obvious
+  static constexpr int kElements = 100000;
+  static constexpr int kBatch = 1000;
+  static constexpr uint64_t kMaxSkipped = 16;
+  Storage db_;
+};
+
+TEST_F(QueuePopTest, ListPopsSkipNoTombstones) {
+  for (int i = 0; i < kElements; i += kBatch) {
+    std::vector<std::string> values;
+    for (int j = i; j < i + kBatch; j++) {
+      values.push_back(fmt::format("value_{}", j));
+    }
+    uint64_t len = 0;
+    ASSERT_TRUE(db_.RPush("list", values, &len).ok());
+  }
+
+  std::vector<std::string> elements;
+  for (int i = 0; i < kElements / 2 - 1; i++) {
+    ASSERT_TRUE(db_.LPop("list", 1, &elements).ok());
+    ASSERT_TRUE(db_.RPop("list", 1, &elements).ok());
+  }
+
+  EXPECT_LE(SkippedDeletes([&]() { ASSERT_TRUE(db_.LPop("list", 1, &elements).ok()); }), kMaxSkipped);
+  EXPECT_EQ(elements, std::vector<std::string>{fmt::format("value_{}", kElements / 2 - 1)});
+  EXPECT_LE(SkippedDeletes([&]() { ASSERT_TRUE(db_.RPop("list", 1, &elements).ok()); }), kMaxSkipped);
+  EXPECT_EQ(elements, std::vector<std::string>{fmt::format("value_{}", kElements / 2)});
+  EXPECT_TRUE(db_.LPop("list", 1, &elements).IsNotFound());
+}
+
+TEST_F(QueuePopTest, ZSetPopsSkipNoTombstones) {
+  for (int i = 0; i < kElements; i += kBatch) {
+    std::vector<ScoreMember> score_members;
+    for (int j = i; j < i + kBatch; j++) {
+      score_members.push_back({static_cast<double>(j), fmt::format("member_{}", j)});
+    }
+    int32_t ret = 0;
+    ASSERT_TRUE(db_.ZAdd("zset", score_members, &ret).ok());
+  }
+
+  std::vector<ScoreMember> score_members;
+  for (int i = 0; i < kElements / 2 - 2; i++) {
+    ASSERT_TRUE(db_.ZPopMin("zset", 1, &score_members).ok());
+    ASSERT_TRUE(db_.ZPopMax("zset", 1, &score_members).ok());
+  }
+
+  EXPECT_LE(SkippedDeletes([&]() { ASSERT_TRUE(db_.ZPopMin("zset", 1, &score_members).ok()); }), kMaxSkipped);
+  ASSERT_EQ(score_members.size(), 1);
+  EXPECT_EQ(score_members[0].score, kElements / 2 - 2);
+  EXPECT_LE(SkippedDeletes([&]() { ASSERT_TRUE(db_.ZPopMax("zset", 1, &score_members).ok()); }), kMaxSkipped);
+  ASSERT_EQ(score_members.size(), 1);
+  EXPECT_EQ(score_members[0].score, kElements / 2 + 1);
+
+  // a member added below the popped head is still popped first
+  int32_t ret = 0;
+  ASSERT_TRUE(db_.ZAdd("zset", {{-1, "head"}}, &ret).ok());
+  ASSERT_TRUE(db_.ZPopMin("zset", 1, &score_members).ok());
+  ASSERT_EQ(score_members.size(), 1);
+  EXPECT_EQ(score_members[0].member, "head");
+  ASSERT_TRUE(db_.ZPopMin("zset", 2, &score_members).ok());
+  ASSERT_EQ(score_members.size(), 2);
+  EXPECT_EQ(score_members[0].score, kElements / 2 - 1);
+  EXPECT_EQ(score_members[1].score, kElements / 2);
+  EXPECT_TRUE(db_.ZPopMin("zset", 1, &score_members).IsNotFound());
+}
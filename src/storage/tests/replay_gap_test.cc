@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "rocksdb/db.h"
+#include "rocksdb/options.h"
+
+#include "pstd/log.h"
+#include "pstd/thread_pool.h"
+#include "src/log_index.h"
+#include "src/redis.h"
+#include "storage/storage.h"
+#include "storage/util.h"
+
+using namespace storage;  // NOLINT
+
+class LogIniter {
+ public:
+  LogIniter() {
+    logger::Init("./replay_gap_test.log");
+    spdlog::set_level(spdlog::level::info);
+  }
+};
+static LogIniter initer;
+
+// keeps the logs it applied, like the raft log does
+class LogQueue : public pstd::noncopyable {
+ public:
+  using WriteCallback = std::function<rocksdb::Status(const storage::BinlogView&, LogIndex idx)>;
+
+  explicit LogQueue(WriteCallback&& cb) : write_cb_(std::move(cb)) { consumer_.SetMaxIdleThread(1); }
+
+  void AppendLog(storage::BinlogWriter&& log, std::promise<rocksdb::Status>&& promise) {
+    auto task = [&] {
+      auto idx = next_log_idx_.fetch_add(1);
+      {
+        std::lock_guard lock(mutex_);
+        logs_.emplace(idx, std::string(log.Data(), log.Size()));
+      }
+      storage::BinlogView view;
+      auto s = view.Parse({log.Data(), log.Size()}) ? write_cb_(view, idx) : rocksdb::Status::Corruption("Bad binlog");
+      promise.set_value(s);
+    };
+    consumer_.ExecuteTask(std::move(task));
+  }
+
+  std::map<LogIndex, std::string> GetLogs() {
+    std::lock_guard lock(mutex_);
+    return logs_;
+  }
+
+ private:
+  WriteCallback write_cb_ = nullptr;
+  pstd::ThreadPool consumer_;
+  std::atomic<LogIndex> next_log_idx_{1};
+  std::mutex mutex_;
+  std::map<LogIndex, std::string> logs_;
+};
+
+struct RestartResult {
+  // the logs a restart replayed and their bytes, the keys and values of their
+  // entries like the replay gap counts them
+  LogIndex replayed_logs = 0;
+  uint64_t replayed_bytes = 0;
+  // of the largest replayed log
+  uint64_t max_log_bytes = 0;
+};
+
+class ReplayGapTest : public ::testing::Test {
+ public:
+  ReplayGapTest()
+      : log_queue_([this](const storage::BinlogView& log, LogIndex log_idx) {
+          return db_->OnBinlogWrite(log, log_idx);
+        }) {
+    options_.options.create_if_missing = true;
+    // the memtables are lost like in a crash
+    options_.options.avoid_flush_during_shutdown = true;
+    options_.db_instance_num = 1;
+    options_.raft_timeout_s = 10000;
+    options_.append_log_function = [this](storage::BinlogWriter&& log, std::promise<rocksdb::Status>&& promise) {
+      log_queue_.AppendLog(std::move(log), std::move(promise));
+    };
+    options_.do_snapshot_function = [](int32_t index, int64_t log_index, bool sync) {};
+    // no limit unless a test sets one
+    options_.max_gap = std::numeric_limits<int64_t>::max();
+    options_.gap_flush_interval_ms = 10;
+  }
+  ~ReplayGapTest() override { DeleteFiles(db_path_.c_str()); }
+
+  void SetUp() override {
+    if (access(db_path_.c_str(), F_OK) == 0) {
+      std::filesystem::remove_all(db_path_.c_str());
+    }
+    mkdir(db_path_.c_str(), 0755);
+  }
+
+  void Open() {
+    db_ = std::make_unique<Storage>();
+    auto s = db_->Open(options_, db_path_);
+    ASSERT_TRUE(s.ok());
+    db_->DisableWal(true);
+  }
+
+  // One hash and then kKeys strings, with the strings flushed every
+  // kFlushEvery writes like a full memtable is, so the hash column families
+  // hold the oldest unflushed log unless the policy flushes them. Then a
+  // crash and a restart, which replays the logs from the oldest unflushed
+  // one before the crash, like raft from the last snapshot.
+  RestartResult WriteCrashAndRestart() {
+    Open();
+    auto& redis = db_->GetDBInstance(key_);
+    int32_t res{};
+    EXPECT_TRUE(redis->HSet(key_, "field", "value", &res).ok());
+    for (int i = 0; i < kKeys; i++) {
+      EXPECT_TRUE(redis->Set(key_ + std::to_string(i), std::string(kValueSize, 'v')).ok());
+      if ((i + 1) % kFlushEvery == 0) {
+        EXPECT_TRUE(redis->GetDB()->Flush(rocksdb::FlushOptions(), redis->GetColumnFamilyHandles()[kStringsCF]).ok());
+      }
+    }
+
+    // the flushes the last writes started
+    auto replay_from = [&]() {
+      auto res = redis->GetLogIndexOfColumnFamilies().GetSmallestLogIndex(-1);
+      return res.smallest_flushed_log_index_cf == -1 ? redis->GetCollector().GetLastAppliedLogIndex()
+                                                     : res.smallest_flushed_log_index;
+    };
+    auto last = redis->GetCollector().GetLastAppliedLogIndex();
+    EXPECT_EQ(last, kKeys + 1);
+    auto over_limits = [&]() {
+      auto from = replay_from();
+      return last - from >= options_.max_gap ||
+             (options_.max_gap_bytes > 0 && redis->GetCollector().GetAppliedBytesSince(from) >= options_.max_gap_bytes);
+    };
+    for (int i = 0; i < 50 && options_.gap_flush_interval_ms > 0 && over_limits(); i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    auto start = replay_from();
+
+    db_->Close();
+    db_.reset();
+
+    RestartResult result;
+    auto logs = log_queue_.GetLogs();
+    Open();
+    for (auto it = logs.upper_bound(start); it != logs.end(); ++it) {
+      BinlogView view;
+      EXPECT_TRUE(view.Parse(it->second));
+      EXPECT_TRUE(db_->OnBinlogWrite(view, it->first).ok());
+      uint64_t log_bytes = 0;
+      for (const auto& entry : view.Entries()) {
+        log_bytes += entry.key.size() + entry.value.size();
+      }
+      result.replayed_logs++;
+      result.replayed_bytes += log_bytes;
+      result.max_log_bytes = std::max(result.max_log_bytes, log_bytes);
+    }
+
+    std::string value;
+    EXPECT_TRUE(db_->HGet(key_, "field", &value).ok());
+    EXPECT_EQ(value, "value");
+    for (int i = 0; i < kKeys; i += kKeys / 10) {
+      EXPECT_TRUE(db_->Get(key_ + std::to_string(i), &value).ok());
+      EXPECT_EQ(value, std::string(kValueSize, 'v'));
+    }
+    db_->Close();
+    db_.reset();
+    return result;
+  }
+
+  // the applied bytes are counted from a sample up to kAppliedBytesStep logs
+  // before the oldest unflushed log
+  static uint64_t BytesLimit(const RestartResult& result, uint64_t max_gap_bytes) {
+    return max_gap_bytes + LogIndexAndSequenceCollector::kAppliedBytesStep * result.max_log_bytes;
+  }
+
+  static constexpr int kKeys = 20000;
+  static constexpr int64_t kMaxGap = 1000;
+  static constexpr uint64_t kMaxGapBytes = 64 << 10;
+  static constexpr int kFlushEvery = 2000;
+  static constexpr size_t kValueSize = 100;
+
+  std::string db_path_{"./test_db/replay_gap_test"};
+  StorageOptions options_;
+  std::unique_ptr<Storage> db_;
+  std::string key_ = "replay-gap-test";
+  LogQueue log_queue_;
+};
+
+TEST_F(ReplayGapTest, Unbounded) {
+  options_.gap_flush_interval_ms = 0;
+  auto result = WriteCrashAndRestart();
+  // the hash was never flushed
+  EXPECT_EQ(result.replayed_logs, kKeys + 1);
+  EXPECT_GT(result.replayed_logs, kMaxGap);
+  EXPECT_GT(result.replayed_bytes, BytesLimit(result, kMaxGapBytes));
+}
+
+TEST_F(ReplayGapTest, BoundedByLogs) {
+  options_.max_gap = kMaxGap;
+  auto result = WriteCrashAndRestart();
+  EXPECT_LE(result.replayed_logs, kMaxGap);
+}
+
+TEST_F(ReplayGapTest, BoundedByBytes) {
+  options_.max_gap_bytes = kMaxGapBytes;
+  auto result = WriteCrashAndRestart();
+  EXPECT_LE(result.replayed_bytes, BytesLimit(result, kMaxGapBytes));
+  EXPECT_LT(result.replayed_logs, kMaxGap);
+}
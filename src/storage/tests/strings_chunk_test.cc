@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "src/redis.h"
+#include "src/strings_chunk_format.h"
+#include "storage/storage.h"
+#include "storage/util.h"
+
+using namespace storage;  // NOLINT
+
+// The strings that SETBIT, SETRANGE and APPEND grow past the chunk threshold
+// are kept in chunks, the tests check the commands read them back like the
+// plain values, against a copy of the value kept in the test.
+class StringsChunkTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    DeleteFiles(kDbPath);
+    StorageOptions storage_options;
+    storage_options.options.create_if_missing = true;
+    storage_options.db_instance_num = 1;
+    ASSERT_TRUE(db_.Open(storage_options, kDbPath).ok());
+  }
+
+  void TearDown() override {
+    db_.Close();
+    DeleteFiles(kDbPath);
+  }
+
+  void ExpectValue(const std::string& key, const std::string& expected) {
+    std::string value;
+    ASSERT_TRUE(db_.Get(key, &value).ok());
+    EXPECT_EQ(value, expected);
+    int32_t len = 0;
+    ASSERT_TRUE(db_.Strlen(key, &len).ok());
+    EXPECT_EQ(len, static_cast<int32_t>(expected.size()));
+  }
+
+  // the chunks in the strings data CF, per user key
+  std::map<std::string, int> ChunkCounts() {
+    std::map<std::string, int> counts;
+    auto& inst = db_.GetDBInstance("key");
+    std::unique_ptr<rocksdb::Iterator> iter(
+        inst->GetDB()->NewIterator(rocksdb::ReadOptions(), inst->GetColumnFamilyHandles()[kStringsDataCF]));
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      counts[ParsedBaseDataKey(iter->key()).Key().ToString()]++;
+    }
+    return counts;
+  }
+
+  static constexpr const char* kDbPath = "./strings_chunk_test_db";
+  // past the 64KB threshold and across several 16KB chunks
+  static constexpr int64_t kLargeSize = 200 * 1024;
+  Storage db_;
+};
+
+TEST_F(StringsChunkTest, SetBitFarPastTheEnd) {
+  int32_t ret = 0;
+  int64_t far_bit = 8 * (kLargeSize - 1) + 7;
+  ASSERT_TRUE(db_.SetBit("bitmap", 3, 1, &ret).ok());
+  ASSERT_TRUE(db_.SetBit("bitmap", far_bit, 1, &ret).ok());
+  EXPECT_EQ(ret, 0);
+  ASSERT_TRUE(db_.SetBit("bitmap", far_bit, 1, &ret).ok());
+  EXPECT_EQ(ret, 1);
+
+  std::string expected(kLargeSize, '\0');
+  expected[0] = 0x10;
+  expected[kLargeSize - 1] = 0x01;
+  ExpectValue("bitmap", expected);
+
+  ASSERT_TRUE(db_.GetBit("bitmap", 3, &ret).ok());
+  EXPECT_EQ(ret, 1);
+  ASSERT_TRUE(db_.GetBit("bitmap", 8 * 50000, &ret).ok());
+  EXPECT_EQ(ret, 0);
+  ASSERT_TRUE(db_.GetBit("bitmap", 8 * kLargeSize, &ret).ok());
+  EXPECT_EQ(ret, 0);
+  ASSERT_TRUE(db_.BitCount("bitmap", 0, -1, &ret, false).ok());
+  EXPECT_EQ(ret, 2);
+  ASSERT_TRUE(db_.BitCount("bitmap", 1, -2, &ret, true).ok());
+  EXPECT_EQ(ret, 0);
+}
+
+TEST_F(StringsChunkTest, RangesAcrossChunks) {
+  std::string expected(1000, 'a');
+  ASSERT_TRUE(db_.Set("key", expected).ok());
+  int32_t ret = 0;
+  // grows the plain value past the threshold, the old bytes are kept
+  std::string data(30000, 'b');
+  ASSERT_TRUE(db_.Setrange("key", 70000, data, &ret).ok());
+  expected.resize(70000, '\0');
+  expected += data;
+  EXPECT_EQ(ret, static_cast<int32_t>(expected.size()));
+  ExpectValue("key", expected);
+
+  // overwrites the end of one chunk and the start of the next one
+  std::string cross(100, 'c');
+  ASSERT_TRUE(db_.Setrange("key", 16 * 1024 - 50, cross, &ret).ok());
+  expected.replace(16 * 1024 - 50, cross.size(), cross);
+  ASSERT_TRUE(db_.Append("key", "tail", &ret).ok());
+  expected += "tail";
+  EXPECT_EQ(ret, static_cast<int32_t>(expected.size()));
+  ExpectValue("key", expected);
+
+  std::string range;
+  ASSERT_TRUE(db_.Getrange("key", 16 * 1024 - 60, 16 * 1024 + 60, &range).ok());
+  EXPECT_EQ(range, expected.substr(16 * 1024 - 60, 121));
+  ASSERT_TRUE(db_.Getrange("key", -10, -1, &range).ok());
+  EXPECT_EQ(range, expected.substr(expected.size() - 10));
+
+  // a SET puts a plain value again
+  ASSERT_TRUE(db_.Set("key", "small").ok());
+  ExpectValue("key", "small");
+  ASSERT_TRUE(db_.Getrange("key", 0, -1, &range).ok());
+  EXPECT_EQ(range, "small");
+}
+
+TEST_F(StringsChunkTest, AppendAndRename) {
+  std::string expected;
+  std::string part(10000, 'x');
+  int32_t ret = 0;
+  for (int i = 0; i < 10; i++) {
+    part[0] = static_cast<char>('0' + i);
+    ASSERT_TRUE(db_.Append("key", part, &ret).ok());
+    expected += part;
+    EXPECT_EQ(ret, static_cast<int32_t>(expected.size()));
+  }
+  ExpectValue("key", expected);
+
+  ASSERT_TRUE(db_.Rename("key", "newkey").ok());
+  std::string value;
+  EXPECT_TRUE(db_.Get("key", &value).IsNotFound());
+  ExpectValue("newkey", expected);
+
+  // the renamed value is a copy, a write to it leaves a new value at key alone
+  ASSERT_TRUE(db_.Setrange("key", 0, part, &ret).ok());
+  ASSERT_TRUE(db_.Append("newkey", "end", &ret).ok());
+  expected += "end";
+  ExpectValue("newkey", expected);
+  ExpectValue("key", part);
+}
+
+TEST_F(StringsChunkTest, IncrbyOnChunkedValue) {
+  int32_t ret = 0;
+  ASSERT_TRUE(db_.SetBit("bitmap", 8 * kLargeSize, 1, &ret).ok());
+  int64_t num = 0;
+  EXPECT_TRUE(db_.Incrby("bitmap", 1, &num).IsCorruption());
+}
+
+// The compaction of the strings data CF drops the chunks of the values that
+// were overwritten or renamed away, and keeps the ones of a live value.
+TEST_F(StringsChunkTest, CompactionDropsOrphanedChunks) {
+  int32_t ret = 0;
+  int64_t far_bit = 8 * (kLargeSize - 1);
+  ASSERT_TRUE(db_.SetBit("overwritten", far_bit, 1, &ret).ok());
+  ASSERT_TRUE(db_.SetBit("renamed", far_bit, 1, &ret).ok());
+  ASSERT_TRUE(db_.SetBit("live", 0, 1, &ret).ok());
+  ASSERT_TRUE(db_.SetBit("live", far_bit, 1, &ret).ok());
+  ASSERT_TRUE(db_.Set("overwritten", "small").ok());
+  ASSERT_TRUE(db_.Rename("renamed", "newkey").ok());
+
+  auto counts = ChunkCounts();
+  EXPECT_EQ(counts["overwritten"], 1);
+  EXPECT_EQ(counts["renamed"], 1);
+  EXPECT_EQ(counts["newkey"], 1);
+  EXPECT_EQ(counts["live"], 2);
+
+  ASSERT_TRUE(db_.Compact(DataType::kStrings, true).ok());
+  counts = ChunkCounts();
+  EXPECT_EQ(counts.count("overwritten"), 0U);
+  EXPECT_EQ(counts.count("renamed"), 0U);
+  EXPECT_EQ(counts["newkey"], 1);
+  EXPECT_EQ(counts["live"], 2);
+  ExpectValue("overwritten", "small");
+  std::string expected(kLargeSize, '\0');
+  expected[kLargeSize - 1] = static_cast<char>(0x80);
+  ExpectValue("newkey", expected);
+  expected[0] = static_cast<char>(0x80);
+  ExpectValue("live", expected);
+}
+
+// A new version is past the one of the chunks a key still has, even when the
+// clock is behind it, like after a restart with the clock set back.
+TEST_F(StringsChunkTest, VersionPastTheReplacedOne) {
+  uint64_t future = rocksdb::Env::Default()->NowMicros() + 3600ULL * 1000000;
+  uint64_t version = NewStringsChunkVersion(future);
+  EXPECT_GT(version, future);
+  // and the versions after it stay past it
+  EXPECT_GT(NewStringsChunkVersion(), version);
+}
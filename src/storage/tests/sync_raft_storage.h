@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "storage/storage.h"
+#include "storage/util.h"
+
+namespace storage {
+
+// A storage in raft mode, with each log applied as it is appended instead
+// of going through a raft group, for the tests and benchmarks of the raft
+// writes. It counts the logs and their bytes.
+class SyncRaftStorage {
+ public:
+  // options get the raft functions, the files at path are removed
+  SyncRaftStorage(std::string path, StorageOptions options) : path_(std::move(path)), options_(std::move(options)) {
+    options_.options.create_if_missing = true;
+    options_.db_instance_num = 1;
+    options_.raft_timeout_s = 10000;
+    options_.append_log_function = [this](BinlogWriter&& log, std::promise<Status>&& promise) {
+      logs_++;
+      last_log_bytes_ = log.Size();
+      log_bytes_ += log.Size();
+      BinlogView view;
+      promise.set_value(view.Parse({log.Data(), log.Size()}) ? db_->OnBinlogWrite(view, logs_)
+                                                             : Status::Corruption("Bad binlog"));
+    };
+    options_.do_snapshot_function = [](int32_t index, int64_t log_index, bool sync) {};
+  }
+  explicit SyncRaftStorage(std::string path) : SyncRaftStorage(std::move(path), StorageOptions()) {}
+  SyncRaftStorage(const SyncRaftStorage&) = delete;
+  SyncRaftStorage& operator=(const SyncRaftStorage&) = delete;
+  ~SyncRaftStorage() {
+    db_->Close();
+    db_.reset();
+    DeleteFiles(path_.c_str());
+  }
+
+  Status Open() {
+    std::filesystem::remove_all(path_);
+    std::filesystem::create_directories(path_);
+    return db_->Open(options_, path_);
+  }
+
+  Storage& db() { return *db_; }
+  // the index of the last log
+  LogIndex logs() const { return logs_; }
+  size_t last_log_bytes() const { return last_log_bytes_; }
+  size_t log_bytes() const { return log_bytes_; }
+
+ private:
+  std::string path_;
+  StorageOptions options_;
+  std::unique_ptr<Storage> db_ = std::make_unique<Storage>();
+  LogIndex logs_ = 0;
+  size_t last_log_bytes_ = 0;
+  size_t log_bytes_ = 0;
+};
+
+}  // namespace storage
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <memory>
+#include <string>
+
+#include "fmt/core.h"
+#include "gtest/gtest.h"
+#include "rocksdb/db.h"
+#include "rocksdb/options.h"
+
+#include "src/strings_value_format.h"
+#include "src/tombstone_density_collector.h"
+#include "storage/util.h"
+
+using namespace storage;  // NOLINT
+
+class TombstoneDensityCollectorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    DeleteFiles(kDbPath);
+    rocksdb::Options options;
+    options.create_if_missing = true;
+    options.disable_auto_compactions = true;
+    options.table_properties_collector_factories.push_back(
+        std::make_shared<TombstoneDensityCollectorFactory>(DensityValueType::kStrings, 0.5));
+    ASSERT_TRUE(rocksdb::DB::Open(options, kDbPath, &db_).ok());
+  }
+
+  void TearDown() override {
+    db_->Close();
+    delete db_;
+    DeleteFiles(kDbPath);
+  }
+
+  static std::string Key(int i) { return fmt::format("key_{:06d}", i); }
+
+  void PutString(int i, uint64_t etime) {
+    StringsValue strings_value(std::string("value"));
+    strings_value.SetEtime(etime);
+    ASSERT_TRUE(db_->Put(rocksdb::WriteOptions(), Key(i), strings_value.Encode()).ok());
+  }
+
+  TombstoneDensity ReadOnlyFile() {
+    rocksdb::TablePropertiesCollection collection;
+    EXPECT_TRUE(db_->GetPropertiesOfAllTables(&collection).ok());
+    EXPECT_EQ(collection.size(), 1);
+    auto density = TombstoneDensityCollector::ReadFromTableProps(*collection.begin()->second);
+    EXPECT_TRUE(density.has_value());
+    return density.value_or(TombstoneDensity{});
+  }
+
+  static constexpr const char* kDbPath = "./tombstone_density_collector_test_db";
+  rocksdb::DB* db_ = nullptr;
+};
+
+TEST_F(TombstoneDensityCollectorTest, CountsDeletesAndExpired) {
+  // 0..4095 live, 4096..5119 deleted, 5120..6143 expired
+  for (int i = 0; i < 4096; i++) {
+    PutString(i, 0);
+  }
+  for (int i = 4096; i < 5120; i++) {
+    ASSERT_TRUE(db_->Delete(rocksdb::WriteOptions(), Key(i)).ok());
+  }
+  for (int i = 5120; i < 6144; i++) {
+    PutString(i, 1);
+  }
+  ASSERT_TRUE(db_->Flush(rocksdb::FlushOptions()).ok());
+
+  TombstoneDensity density = ReadOnlyFile();
+  EXPECT_EQ(density.entries, 6144);
+  EXPECT_EQ(density.deletes, 1024);
+  EXPECT_EQ(density.expired, 1024);
+  EXPECT_EQ(density.first_key, Key(0));
+  EXPECT_EQ(density.last_key, Key(6143));
+  // the first fully dead window
+  EXPECT_EQ(density.window_dead, TombstoneDensityCollector::kWindowEntries);
+  EXPECT_EQ(density.window_start, Key(4096));
+  EXPECT_EQ(density.window_end, Key(5119));
+}
+
+TEST(TombstoneDensityCollectorMarkTest, DenseFileNeedsCompaction) {
+  TombstoneDensityCollector collector(DensityValueType::kNone, 0.5);
+  for (int i = 0; i < 8192; i++) {
+    std::string key = fmt::format("key_{:06d}", i);
+    auto type = i % 4 == 0 ? rocksdb::kEntryPut : rocksdb::kEntryDelete;
+    ASSERT_TRUE(collector.AddUserKey(key, "", type, 0, 0).ok());
+    // files smaller than kMinEntriesToMark are never marked
+    if (i == 1) {
+      EXPECT_FALSE(collector.NeedCompact());
+    }
+  }
+  EXPECT_TRUE(collector.NeedCompact());
+
+  TombstoneDensityCollector sparse_collector(DensityValueType::kNone, 0.5);
+  for (int i = 0; i < 8192; i++) {
+    std::string key = fmt::format("key_{:06d}", i);
+    auto type = i % 4 == 0 ? rocksdb::kEntryDelete : rocksdb::kEntryPut;
+    ASSERT_TRUE(sparse_collector.AddUserKey(key, "", type, 0, 0).ok());
+  }
+  EXPECT_FALSE(sparse_collector.NeedCompact());
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "storage/storage_define.h"
+
+using namespace storage;  // NOLINT
+
+// the byte at a time implementations the memchr based ones replaced
+namespace {
+
+std::string ReferenceEncode(const std::string& user_key) {
+  std::string encoded;
+  for (char c : user_key) {
+    if (c == kNeedTransformCharacter) {
+      encoded.append(kEncodedTransformCharacter, 2);
+    } else {
+      encoded.push_back(c);
+    }
+  }
+  encoded.append(kEncodedKeyDelim, 2);
+  return encoded;
+}
+
+const char* ReferenceSeekUserkeyDelim(const char* ptr, int length) {
+  bool zero_ahead = false;
+  for (int i = 0; i < length; i++) {
+    if ((ptr[i] == kNeedTransformCharacter) && zero_ahead) {
+      return ptr + i + 1;
+    }
+    zero_ahead = ptr[i] == kNeedTransformCharacter;
+  }
+  return ptr;
+}
+
+std::string Encode(const std::string& user_key) {
+  size_t nzero = CountNeedTransformCharacters(user_key);
+  std::string encoded(user_key.size() + nzero + kEncodedKeyDelimSize, '\xff');
+  char* end = EncodeUserKey(user_key, encoded.data(), nzero);
+  EXPECT_EQ(end, encoded.data() + encoded.size());
+  return encoded;
+}
+
+// keys of every length up to max_length, with zero bytes at zero_ratio
+std::vector<std::string> RandomKeys(std::mt19937* gen, size_t max_length, double zero_ratio) {
+  std::bernoulli_distribution zero(zero_ratio);
+  std::uniform_int_distribution<int> byte(1, 255);
+  std::vector<std::string> keys;
+  for (size_t length = 0; length <= max_length; length++) {
+    std::string key;
+    for (size_t i = 0; i < length; i++) {
+      key.push_back(zero(*gen) ? '\0' : static_cast<char>(byte(*gen)));
+    }
+    keys.push_back(std::move(key));
+  }
+  return keys;
+}
+
+}  // namespace
+
+TEST(UserKeyEncodingTest, RoundTripsLikeReference) {
+  std::mt19937 gen(301);
+  for (double zero_ratio : {0.0, 0.01, 0.2, 0.9, 1.0}) {
+    for (const auto& key : RandomKeys(&gen, 300, zero_ratio)) {
+      std::string encoded = Encode(key);
+      ASSERT_EQ(encoded, ReferenceEncode(key));
+      EXPECT_EQ(CountNeedTransformCharacters(key),
+                static_cast<size_t>(std::count(key.begin(), key.end(), kNeedTransformCharacter)));
+
+      // followed by a version like the data keys
+      std::string data_key = encoded + std::string(8, '\1');
+      auto length = static_cast<int>(data_key.size());
+      EXPECT_EQ(SeekUserkeyDelim(data_key.data(), length), data_key.data() + encoded.size());
+      EXPECT_EQ(SeekUserkeyDelim(data_key.data(), length), ReferenceSeekUserkeyDelim(data_key.data(), length));
+
+      std::string decoded;
+      EXPECT_EQ(DecodeUserKey(data_key.data(), length, &decoded), data_key.data() + encoded.size());
+      EXPECT_EQ(decoded, key);
+    }
+  }
+}
+
+TEST(UserKeyEncodingTest, NoDelimiter) {
+  for (const std::string& encoded : {std::string(), std::string("\0", 1), std::string("key\0\1", 5),
+                                     std::string("key\0", 4), std::string("\0\1\0\1", 4)}) {
+    auto length = static_cast<int>(encoded.size());
+    EXPECT_EQ(SeekUserkeyDelim(encoded.data(), length), encoded.data());
+    EXPECT_EQ(ReferenceSeekUserkeyDelim(encoded.data(), length), encoded.data());
+    std::string decoded;
+    EXPECT_EQ(DecodeUserKey(encoded.data(), length, &decoded), encoded.data());
+  }
+  // the delimiter past length is not found
+  std::string encoded("key\0\0", 5);
+  EXPECT_EQ(SeekUserkeyDelim(encoded.data(), 4), encoded.data());
+}
+
+TEST(UserKeyEncodingTest, SeekLikeReference) {
+  std::mt19937 gen(302);
+  for (size_t length : {8, 32, 128, 1024}) {
+    for (const auto& key : RandomKeys(&gen, length, 0.001)) {
+      std::string data_key = Encode(key) + std::string(8, '\1');
+      auto size = static_cast<int>(data_key.size());
+      ASSERT_EQ(SeekUserkeyDelim(data_key.data(), size), ReferenceSeekUserkeyDelim(data_key.data(), size));
+    }
+  }
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "src/base_data_key_format.h"
+#include "src/coding.h"
+#include "src/data_key_prefix_transform.h"
+#include "src/zsets_data_key_format.h"
+
+// in the namespace, base_data_key_format.h pulls pstd::Slice into the global one
+namespace storage {
+
+TEST(ZSetsScoreEncodingTest, SortsBytewise) {
+  const double inf = std::numeric_limits<double>::infinity();
+  std::vector<double> scores = {-inf, -1e300, -2.5, -1, -std::numeric_limits<double>::denorm_min(), 0,
+                                std::numeric_limits<double>::denorm_min(), 1, 2.5, 1e300, inf};
+  // the key and version prefix sorts before every score
+  std::string last = HashesDataKey(Slice("key"), 100, Slice()).EncodeSeekKey().ToString();
+  for (double score : scores) {
+    ZSetsScoreKey score_key(Slice("key"), 100, score, "a");
+    std::string encoded = score_key.Encode().ToString();
+    EXPECT_LT(last, encoded) << score;
+    last = encoded;
+
+    ParsedZSetsScoreKey parsed(encoded);
+    EXPECT_EQ(parsed.score(), score);
+  }
+
+  // -0 is the same score as 0
+  ZSetsScoreKey negative_zero(Slice("key"), 100, -0.0, "a");
+  ZSetsScoreKey zero(Slice("key"), 100, 0, "a");
+  EXPECT_EQ(negative_zero.Encode().ToString(), zero.Encode().ToString());
+}
+
+TEST(ZSetsScoreEncodingTest, ConvertsLegacyKeys) {
+  DataKeyPrefixTransform transform;
+  std::string user_key("user\0key", 8);
+  ZSetsScoreKey score_key(user_key, 100, -2.5, "member");
+  std::string bytewise = score_key.Encode().ToString();
+  std::string legacy = bytewise;
+  size_t score_offset = transform.Transform(bytewise).size();
+  double score = -2.5;
+  uint64_t bits;
+  memcpy(&bits, &score, sizeof(bits));
+  EncodeFixed64(legacy.data() + score_offset, bits);
+
+  ASSERT_NE(legacy, bytewise);
+  EXPECT_EQ(LegacyScoreKeyToBytewise(legacy), bytewise);
+  // a key without a score is left alone
+  EXPECT_EQ(LegacyScoreKeyToBytewise(legacy.substr(0, score_offset)), legacy.substr(0, score_offset));
+}
+
+}  // namespace storage
@@ -36,6 +36,11 @@ void PStore::Init(int db_number) {
   INFO("STORE Init success!");
 }
 
+static int InstanceIndex(const TaskContext& task) {
+  auto it = task.args.find(kInstanceIndex);
+  return it == task.args.end() ? -1 : std::stoi(it->second);
+}
+
 void PStore::HandleTaskSpecificDB(const TasksVector& tasks) {
   std::for_each(tasks.begin(), tasks.end(), [this](const auto& task) {
     if (task.db < 0 || task.db >= db_number_) {
@@ -51,7 +56,7 @@ void PStore::HandleTaskSpecificDB(const TasksVector& tasks) {
         }
         auto path = task.args.find(kCheckpointPath)->second;
         pstd::TrimSlash(path);
-        db->CreateCheckpoint(path, task.sync);
+        db->CreateCheckpoint(path, task.sync, storage::kFlush, InstanceIndex(task));
         break;
       }
       case kLoadDBFromCheckpoint: {
@@ -61,7 +66,7 @@ void PStore::HandleTaskSpecificDB(const TasksVector& tasks) {
         }
         auto path = task.args.find(kCheckpointPath)->second;
         pstd::TrimSlash(path);
-        db->LoadDBFromCheckpoint(path, task.sync);
+        db->LoadDBFromCheckpoint(path, task.sync, InstanceIndex(task));
         break;
       }
       case kEmpty: {
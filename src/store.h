@@ -23,6 +23,8 @@ enum TaskType { kCheckpoint = 0, kLoadDBFromCheckpoint, kEmpty };
 
 enum TaskArg {
   kCheckpointPath = 0,
+  // the storage instance of the task, all of them if missing
+  kInstanceIndex,
 };
 
 struct TaskContext {
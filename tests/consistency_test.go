@@ -14,6 +14,7 @@ import (
 	"os/exec"
 	"strconv"
 	"strings"
+	"sync"
 	"time"
 
 	. "github.com/onsi/ginkgo/v2"
@@ -153,6 +154,62 @@ var _ = Describe("Consistency", Ordered, func() {
 		}
 	})
 
+	It("Concurrent Incr Consistency Test", func() {
+		const testKey = "IncrConsistencyTest"
+		const clients = 8
+		const incrs = 100
+		// the replies of the writes come from the raft apply, the record lock of
+		// the key is held until then so no increment is lost
+		var wg sync.WaitGroup
+		for i := 0; i < clients; i++ {
+			wg.Add(1)
+			go func() {
+				defer GinkgoRecover()
+				defer wg.Done()
+				for j := 0; j < incrs; j++ {
+					Expect(leader.Incr(ctx, testKey).Err()).NotTo(HaveOccurred())
+				}
+			}()
+		}
+		wg.Wait()
+
+		readChecker(func(c *redis.Client) {
+			get, err := c.Get(ctx, testKey).Result()
+			Expect(err).NotTo(HaveOccurred())
+			Expect(get).To(Equal(strconv.Itoa(clients * incrs)))
+		})
+	})
+
+	It("Concurrent Set Consistency Test", func() {
+		const clients = 8
+		const sets = 100
+		// the concurrent writes of different keys are committed in shared raft logs
+		var wg sync.WaitGroup
+		for i := 0; i < clients; i++ {
+			wg.Add(1)
+			go func(client int) {
+				defer GinkgoRecover()
+				defer wg.Done()
+				for j := 0; j < sets; j++ {
+					key := "SetConsistencyTest" + strconv.Itoa(client) + "_" + strconv.Itoa(j)
+					Expect(leader.Set(ctx, key, j, 0).Err()).NotTo(HaveOccurred())
+				}
+			}(i)
+		}
+		wg.Wait()
+
+		readChecker(func(c *redis.Client) {
+			for i := 0; i < clients; i++ {
+				for j := 0; j < sets; j++ {
+					key := "SetConsistencyTest" + strconv.Itoa(i) + "_" + strconv.Itoa(j)
+					get, err := c.Get(ctx, key).Result()
+					Expect(err).NotTo(HaveOccurred())
+					Expect(get).To(Equal(strconv.Itoa(j)))
+				}
+			}
+		})
+	})
+
 	It("SAdd & SRem Consistency Test", func() {
 		const testKey = "SetsConsistencyTestKey"
 		testValues := []string{"sa", "sb", "sc", "sd"}
@@ -788,6 +845,307 @@ var _ = Describe("Consistency", Ordered, func() {
 		}
 	})
 
+	It("Compressed Large Values Consistency Test", func() {
+		raftInfo := func(field string) string {
+			info, err := leader.Do(ctx, "info", "raft").Result()
+			Expect(err).NotTo(HaveOccurred())
+			scanner := bufio.NewScanner(strings.NewReader(info.(string)))
+			for scanner.Scan() {
+				if parts := strings.SplitN(scanner.Text(), ":", 2); len(parts) == 2 && parts[0] == field {
+					return strings.TrimSpace(parts[1])
+				}
+			}
+			return ""
+		}
+		Expect(leader.ConfigSet(ctx, "raft-binlog-compression", "yes").Err()).NotTo(HaveOccurred())
+		defer func() {
+			Expect(leader.ConfigSet(ctx, "raft-binlog-compression", "no").Err()).NotTo(HaveOccurred())
+		}()
+		// once the followers report they read compressed logs
+		Eventually(func() string { return raftInfo("raft_binlog_compression") }, "30s", "500ms").Should(Equal("lzf"))
+
+		value := strings.Repeat(`{"id":1,"name":"pikiwidb","tags":["raft","lzf"]},`, 2000)
+		for i := 0; i < 10; i++ {
+			key := "CompressedConsistencyTest" + strconv.Itoa(i)
+			Expect(leader.Set(ctx, key, value+strconv.Itoa(i), 0).Err()).NotTo(HaveOccurred())
+		}
+		Expect(raftInfo("raft_binlog_compressed_logs")).NotTo(Equal("0"))
+		Expect(raftInfo("raft_binlog_decompress_failures")).To(Equal("0"))
+
+		readChecker(func(c *redis.Client) {
+			for i := 0; i < 10; i++ {
+				get, err := c.Get(ctx, "CompressedConsistencyTest"+strconv.Itoa(i)).Result()
+				Expect(err).NotTo(HaveOccurred())
+				Expect(get).To(Equal(value + strconv.Itoa(i)))
+			}
+		})
+	})
+
+	It("Write Ack Levels Consistency Test", func() {
+		ackReplies := func(level string) int {
+			info, err := leader.Do(ctx, "info", "raft").Result()
+			Expect(err).NotTo(HaveOccurred())
+			scanner := bufio.NewScanner(strings.NewReader(info.(string)))
+			for scanner.Scan() {
+				if parts := strings.SplitN(scanner.Text(), ":", 2); len(parts) == 2 &&
+					parts[0] == "raft_write_acks_"+level {
+					n, err := strconv.Atoi(strings.TrimSpace(parts[1]))
+					Expect(err).NotTo(HaveOccurred())
+					return n
+				}
+			}
+			return 0
+		}
+
+		// the level is the one of the connection
+		conn := leader.Conn()
+		defer func() {
+			Expect(conn.Close()).NotTo(HaveOccurred())
+		}()
+		writeAck := func(args ...interface{}) *redis.Cmd {
+			cmd := redis.NewCmd(ctx, append([]interface{}{"RAFT.WRITEACK"}, args...)...)
+			_ = conn.Process(ctx, cmd)
+			return cmd
+		}
+		Expect(writeAck().Result()).To(Equal("apply"))
+		Expect(writeAck("ALWAYS").Err()).To(HaveOccurred())
+
+		for _, level := range []string{"commit", "accepted"} {
+			Expect(writeAck(level).Result()).To(Equal(OK))
+			Expect(writeAck().Result()).To(Equal(level))
+			before := ackReplies(level)
+
+			// the key is locked until the write is applied, so the writes of a
+			// key are applied in the order of their replies
+			incrKey := "WriteAckIncrTest" + level
+			listKey := "WriteAckListTest" + level
+			for i := 0; i < 50; i++ {
+				Expect(conn.Incr(ctx, incrKey).Err()).NotTo(HaveOccurred())
+				Expect(conn.RPush(ctx, listKey, i).Err()).NotTo(HaveOccurred())
+			}
+			Expect(ackReplies(level) - before).To(BeNumerically(">=", 100))
+
+			expected := make([]string, 50)
+			for i := range expected {
+				expected[i] = strconv.Itoa(i)
+			}
+			for _, c := range append([]*redis.Client{leader}, followers...) {
+				Eventually(func() string {
+					get, _ := c.Get(ctx, incrKey).Result()
+					return get
+				}, "10s", "100ms").Should(Equal("50"))
+				Eventually(func() []string {
+					lrange, _ := c.LRange(ctx, listKey, 0, -1).Result()
+					return lrange
+				}, "10s", "100ms").Should(Equal(expected))
+			}
+		}
+
+		Expect(writeAck("DEFAULT").Result()).To(Equal(OK))
+		Expect(writeAck().Result()).To(Equal("apply"))
+	})
+
+	It("Write Ack Read Your Writes Test", func() {
+		conn := leader.Conn()
+		defer func() {
+			Expect(conn.Close()).NotTo(HaveOccurred())
+		}()
+
+		// with apply a read right after the reply sees the write, without waiting
+		for i := 0; i < 50; i++ {
+			key := "WriteAckReadYourWritesTest" + strconv.Itoa(i%5)
+			Expect(conn.Set(ctx, key, i, 0).Err()).NotTo(HaveOccurred())
+			Expect(conn.Get(ctx, key).Result()).To(Equal(strconv.Itoa(i)))
+		}
+
+		// commit and accepted give up read-your-writes, but a write of a key still
+		// sees the writes of the key replied before it
+		for _, level := range []string{"commit", "accepted"} {
+			Expect(conn.Do(ctx, "RAFT.WRITEACK", level).Result()).To(Equal(OK))
+			key := "WriteAckReadYourWritesIncrTest" + level
+			for i := 1; i <= 50; i++ {
+				Expect(conn.Incr(ctx, key).Result()).To(Equal(int64(i)))
+			}
+		}
+		Expect(conn.Do(ctx, "RAFT.WRITEACK", "DEFAULT").Result()).To(Equal(OK))
+	})
+
+	It("Write Ack Accepted Rejected Test", func() {
+		infoRaft := func(c *redis.Client, field string) string {
+			info, err := c.Do(ctx, "info", "raft").Result()
+			Expect(err).NotTo(HaveOccurred())
+			scanner := bufio.NewScanner(strings.NewReader(info.(string)))
+			for scanner.Scan() {
+				if parts := strings.SplitN(scanner.Text(), ":", 2); len(parts) == 2 && parts[0] == field {
+					return strings.TrimSpace(parts[1])
+				}
+			}
+			return ""
+		}
+		failures := func() int {
+			n, err := strconv.Atoi(infoRaft(leader, "raft_write_ack_failures"))
+			Expect(err).NotTo(HaveOccurred())
+			return n
+		}
+		transfer := func(from, to *redis.Client) {
+			peer := infoRaft(to, "raft_peer_id")
+			Expect(from.Do(ctx, "RAFT.NODE", "TRANSFER", peer).Result()).To(Equal(OK))
+			Eventually(func() string {
+				return infoRaft(to, "raft_role")
+			}, "30s", "100ms").Should(Equal("LEADER"))
+		}
+
+		// the logs wait in the group commit window, so the leader is gone
+		// before they are handed to raft
+		window, err := leader.ConfigGet(ctx, "raft-group-commit-window-us").Result()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(leader.ConfigSet(ctx, "raft-group-commit-window-us", "5000000").Err()).NotTo(HaveOccurred())
+
+		before := failures()
+		errs := make([]error, 10)
+		var wg sync.WaitGroup
+		for i := range errs {
+			wg.Add(1)
+			go func(i int) {
+				defer GinkgoRecover()
+				defer wg.Done()
+				conn := leader.Conn()
+				defer conn.Close()
+				Expect(conn.Do(ctx, "RAFT.WRITEACK", "accepted").Result()).To(Equal(OK))
+				errs[i] = conn.Set(ctx, "WriteAckAcceptedTest"+strconv.Itoa(i), i, 0).Err()
+			}(i)
+		}
+		time.Sleep(time.Second)
+		transfer(leader, followers[0])
+		wg.Wait()
+
+		// raft rejects the logs of a node that is no longer the leader, they
+		// are not acked, the writes fail instead of failing after their reply
+		for _, err := range errs {
+			Expect(err).To(HaveOccurred())
+			Expect(err.Error()).To(ContainSubstring("Raft log not applied"))
+		}
+		Expect(failures()).To(Equal(before))
+
+		Expect(leader.ConfigSet(ctx, "raft-group-commit-window-us",
+			window["raft-group-commit-window-us"]).Err()).NotTo(HaveOccurred())
+		transfer(followers[0], leader)
+	})
+
+	It("Write Timeout Reply Test", func() {
+		// the log waits in the group commit window longer than a write waits
+		config, err := leader.ConfigGet(ctx, "raft-*").Result()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(leader.ConfigSet(ctx, "raft-group-commit-window-us", "3000000").Err()).NotTo(HaveOccurred())
+		Expect(leader.ConfigSet(ctx, "raft-timeout-s", "1").Err()).NotTo(HaveOccurred())
+
+		conn := leader.Conn()
+		defer func() {
+			Expect(conn.Close()).NotTo(HaveOccurred())
+		}()
+		err = conn.Set(ctx, "WriteTimeoutReplyTest", "value", 0).Err()
+		Expect(err).To(HaveOccurred())
+		Expect(err.Error()).To(ContainSubstring("Wait for write timeout"))
+		// the error is the only reply of the write, the next reply is the one of
+		// the next command
+		Expect(conn.Ping(ctx).Result()).To(Equal("PONG"))
+		Expect(conn.Do(ctx, "RAFT.WRITEACK").Result()).To(Equal("apply"))
+
+		for _, name := range []string{"raft-group-commit-window-us", "raft-timeout-s"} {
+			Expect(leader.ConfigSet(ctx, name, config[name]).Err()).NotTo(HaveOccurred())
+		}
+		// the write is applied once it leaves the window
+		Eventually(func() string {
+			get, _ := conn.Get(ctx, "WriteTimeoutReplyTest").Result()
+			return get
+		}, "10s", "100ms").Should(Equal("value"))
+	})
+
+	It("Linearizable Follower Read Test", func() {
+		for _, f := range followers {
+			Expect(f.ConfigSet(ctx, "raft-linearizable-read", "yes").Err()).NotTo(HaveOccurred())
+		}
+		defer func() {
+			for _, f := range followers {
+				Expect(f.ConfigSet(ctx, "raft-linearizable-read", "no").Err()).NotTo(HaveOccurred())
+			}
+		}()
+
+		// a follower read right after the write sees it, without waiting
+		for i := 0; i < 20; i++ {
+			key := "LinearizableReadTest" + strconv.Itoa(i)
+			Expect(leader.Set(ctx, key, i, 0).Err()).NotTo(HaveOccurred())
+			for _, f := range followers {
+				get, err := f.Get(ctx, key).Result()
+				Expect(err).NotTo(HaveOccurred())
+				Expect(get).To(Equal(strconv.Itoa(i)))
+			}
+		}
+
+		// the concurrent reads share the rounds to the leader
+		var wg sync.WaitGroup
+		for _, f := range followers {
+			for j := 0; j < 4; j++ {
+				wg.Add(1)
+				go func(c *redis.Client) {
+					defer GinkgoRecover()
+					defer wg.Done()
+					for i := 0; i < 20; i++ {
+						get, err := c.Get(ctx, "LinearizableReadTest"+strconv.Itoa(i)).Result()
+						Expect(err).NotTo(HaveOccurred())
+						Expect(get).To(Equal(strconv.Itoa(i)))
+					}
+				}(f)
+			}
+		}
+		wg.Wait()
+	})
+
+	It("Snapshot Install Test", func() {
+		for i := 0; i < 100; i++ {
+			key := "SnapshotInstallTest" + strconv.Itoa(i)
+			Expect(leader.Set(ctx, key, i, 0).Err()).NotTo(HaveOccurred())
+		}
+		// the logs before the snapshot are gone, so a new node installs it
+		Expect(leader.Do(ctx, "RAFT.NODE", "DOSNAPSHOT").Err()).NotTo(HaveOccurred())
+
+		config := util.GetConfPath(false, 3)
+		s := util.StartServer(config, map[string]string{"port": strconv.Itoa(12000 + 4*111),
+			"use-raft": "yes", "raft-snapshot-max-bytes-per-second": "1048576"}, true)
+		Expect(s).NotTo(BeNil())
+		defer func() {
+			Expect(s.Close()).NotTo(HaveOccurred())
+		}()
+		c := s.NewClient()
+		Expect(c).NotTo(BeNil())
+		defer func() {
+			Expect(c.Close()).NotTo(HaveOccurred())
+		}()
+		Expect(c.Do(ctx, "RAFT.CLUSTER", "JOIN", "127.0.0.1:12111").Result()).To(Equal(OK))
+
+		Eventually(func() string {
+			get, _ := c.Get(ctx, "SnapshotInstallTest99").Result()
+			return get
+		}, "30s", "500ms").Should(Equal("99"))
+		for i := 0; i < 100; i++ {
+			get, err := c.Get(ctx, "SnapshotInstallTest"+strconv.Itoa(i)).Result()
+			Expect(err).NotTo(HaveOccurred())
+			Expect(get).To(Equal(strconv.Itoa(i)))
+		}
+
+		info, err := c.Do(ctx, "info", "raft").Result()
+		Expect(err).NotTo(HaveOccurred())
+		scanner := bufio.NewScanner(strings.NewReader(info.(string)))
+		var peerID string
+		for scanner.Scan() {
+			if parts := strings.SplitN(scanner.Text(), ":", 2); len(parts) == 2 && parts[0] == "raft_peer_id" {
+				peerID = strings.TrimSpace(parts[1])
+			}
+		}
+		Expect(peerID).NotTo(BeEmpty())
+		Expect(c.Do(ctx, "raft.node", "remove", peerID).Result()).To(Equal(OK))
+	})
+
 	It("ThreeNodesClusterConstructionTest", func() {
 		for _, follower := range followers {
 			info, err := follower.Do(ctx, "info", "raft").Result()
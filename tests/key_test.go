@@ -449,6 +449,12 @@ var _ = Describe("Keyspace", Ordered, func() {
 
 		client.Set(ctx, "mykey", "foo", 0)
 		Expect(client.RenameNX(ctx, "mykey", "mykey").Val()).To(Equal(false))
+
+		// an expired newkey is replaced by the value of key
+		client.Set(ctx, "mykey2", "bar", time.Millisecond)
+		time.Sleep(10 * time.Millisecond)
+		Expect(client.RenameNX(ctx, "mykey", "mykey2").Val()).To(Equal(true))
+		Expect(client.Get(ctx, "mykey2").Val()).To(Equal("foo"))
 	})
 
 })
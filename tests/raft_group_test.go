@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+package pikiwidb_test
+
+import (
+	"bufio"
+	"context"
+	"log"
+	"strconv"
+	"strings"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+	"github.com/redis/go-redis/v9"
+
+	"github.com/OpenAtomFoundation/pikiwidb/tests/util"
+)
+
+var _ = Describe("RaftGroupPerInstance", Ordered, func() {
+	var (
+		ctx     = context.TODO()
+		servers []*util.Server
+		clients map[string]*redis.Client
+	)
+
+	// the raft groups this node leads, by INFO RAFT
+	leadGroups := func(c *redis.Client) int {
+		info, err := c.Do(ctx, "info", "raft").Result()
+		if err != nil {
+			return 0
+		}
+		leads := 0
+		scanner := bufio.NewScanner(strings.NewReader(info.(string)))
+		for scanner.Scan() {
+			line := scanner.Text()
+			if strings.HasPrefix(line, "raft_group") && strings.Contains(line, "role=LEADER") {
+				leads++
+			}
+		}
+		return leads
+	}
+
+	// a write goes to the node of the MOVED error, which leads the group of the key
+	set := func(key, value string) {
+		c := clients["127.0.0.1:13111"]
+		for i := 0; i < len(clients); i++ {
+			err := c.Set(ctx, key, value, 0).Err()
+			if err == nil {
+				return
+			}
+			Expect(err.Error()).To(HavePrefix("ERR MOVED "))
+			c = clients[strings.TrimPrefix(err.Error(), "ERR MOVED ")]
+			Expect(c).NotTo(BeNil())
+		}
+		Fail("no node leads the group of " + key)
+	}
+
+	BeforeAll(func() {
+		clients = make(map[string]*redis.Client)
+		for i := 0; i < 3; i++ {
+			config := util.GetConfPath(false, int64(i))
+			port := strconv.Itoa(13000 + (i+1)*111)
+			s := util.StartServer(config, map[string]string{"port": port, "use-raft": "yes",
+				"raft-group-per-instance": "yes", "db-instance-num": "3"}, true)
+			Expect(s).NotTo(BeNil())
+			servers = append(servers, s)
+			c := s.NewClient()
+			Expect(c).NotTo(BeNil())
+			clients["127.0.0.1:"+port] = c
+		}
+
+		Expect(clients["127.0.0.1:13111"].Do(ctx, "RAFT.CLUSTER", "INIT").Result()).To(Equal(OK))
+		for _, addr := range []string{"127.0.0.1:13222", "127.0.0.1:13333"} {
+			Expect(clients[addr].Do(ctx, "RAFT.CLUSTER", "JOIN", "127.0.0.1:13111").Result()).To(Equal(OK))
+		}
+	})
+
+	AfterAll(func() {
+		for _, c := range clients {
+			Expect(c.Close()).NotTo(HaveOccurred())
+		}
+		for _, s := range servers {
+			err := s.Close()
+			if err != nil {
+				log.Println("Close Server fail.", err.Error())
+				return
+			}
+		}
+	})
+
+	It("Leaders Balance Test", func() {
+		// each node leads one of the 3 groups once the leaders moved
+		for _, c := range clients {
+			Eventually(func() int { return leadGroups(c) }, "60s", "1s").Should(Equal(1))
+		}
+	})
+
+	It("Writes Through The Groups Test", func() {
+		for i := 0; i < 30; i++ {
+			set("RaftGroupTest"+strconv.Itoa(i), strconv.Itoa(i))
+		}
+		for _, c := range clients {
+			Eventually(func() string {
+				get, _ := c.Get(ctx, "RaftGroupTest29").Result()
+				return get
+			}, "10s", "100ms").Should(Equal("29"))
+			for i := 0; i < 30; i++ {
+				Eventually(func() string {
+					get, _ := c.Get(ctx, "RaftGroupTest"+strconv.Itoa(i)).Result()
+					return get
+				}, "10s", "100ms").Should(Equal(strconv.Itoa(i)))
+			}
+		}
+	})
+
+	It("Snapshot Of Each Group Test", func() {
+		for _, c := range clients {
+			Expect(c.Do(ctx, "RAFT.NODE", "DOSNAPSHOT").Result()).To(Equal(OK))
+		}
+	})
+})
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2024-present, Qihoo, Inc.  All rights reserved.
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+package pikiwidb_test
+
+import (
+	"context"
+	"log"
+	"strconv"
+	"time"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+	"github.com/redis/go-redis/v9"
+
+	"github.com/OpenAtomFoundation/pikiwidb/tests/util"
+)
+
+var _ = Describe("Replication", Ordered, func() {
+	var (
+		ctx     = context.TODO()
+		servers []*util.Server
+		master  *redis.Client
+		slave   *redis.Client
+	)
+
+	BeforeAll(func() {
+		for i := 0; i < 2; i++ {
+			config := util.GetConfPath(false, int64(i))
+			s := util.StartServer(config, map[string]string{"port": strconv.Itoa(14000 + (i+1)*111)}, true)
+			Expect(s).NotTo(BeNil())
+			servers = append(servers, s)
+		}
+		master = servers[0].NewClient()
+		Expect(master).NotTo(BeNil())
+		slave = servers[1].NewClient()
+		Expect(slave).NotTo(BeNil())
+	})
+
+	AfterAll(func() {
+		Expect(slave.Close()).NotTo(HaveOccurred())
+		Expect(master.Close()).NotTo(HaveOccurred())
+		for _, s := range servers {
+			err := s.Close()
+			if err != nil {
+				log.Println("Close Server fail.", err.Error())
+				return
+			}
+		}
+	})
+
+	It("Full Sync Test", func() {
+		for i := 0; i < 100; i++ {
+			Expect(master.Set(ctx, "ReplicationTest"+strconv.Itoa(i), strconv.Itoa(i), 0).Err()).NotTo(HaveOccurred())
+		}
+		Expect(master.HSet(ctx, "ReplicationTestHash", "field", "value").Err()).NotTo(HaveOccurred())
+
+		Expect(slave.Do(ctx, "slaveof", "127.0.0.1", "14111").Result()).To(Equal(OK))
+		Eventually(func() string {
+			info, _ := slave.Do(ctx, "info", "replication").Result()
+			s, _ := info.(string)
+			return s
+		}, "60s", "1s").Should(ContainSubstring("master_link_status:up"))
+
+		for i := 0; i < 100; i++ {
+			Expect(slave.Get(ctx, "ReplicationTest"+strconv.Itoa(i)).Result()).To(Equal(strconv.Itoa(i)))
+		}
+		Expect(slave.HGet(ctx, "ReplicationTestHash", "field").Result()).To(Equal("value"))
+	})
+
+	It("Propagate Writes Test", func() {
+		for i := 0; i < 100; i++ {
+			Expect(master.Incr(ctx, "ReplicationTestCounter").Err()).NotTo(HaveOccurred())
+			Expect(master.RPush(ctx, "ReplicationTestList", i).Err()).NotTo(HaveOccurred())
+		}
+		Expect(master.Del(ctx, "ReplicationTest0").Err()).NotTo(HaveOccurred())
+
+		// the writes of a key reach the slave in order
+		Eventually(func() string {
+			get, _ := slave.Get(ctx, "ReplicationTestCounter").Result()
+			return get
+		}, "10s", "100ms").Should(Equal("100"))
+		Eventually(func() int64 {
+			return slave.LLen(ctx, "ReplicationTestList").Val()
+		}, "10s", "100ms").Should(Equal(int64(100)))
+		list, err := slave.LRange(ctx, "ReplicationTestList", 0, -1).Result()
+		Expect(err).NotTo(HaveOccurred())
+		for i, v := range list {
+			Expect(v).To(Equal(strconv.Itoa(i)))
+		}
+		Eventually(func() int64 {
+			return slave.Exists(ctx, "ReplicationTest0").Val()
+		}, "10s", "100ms").Should(Equal(int64(0)))
+	})
+
+	It("Propagate Writes Of Other DBs Test", func() {
+		// a new connection, so that SELECT only applies to it
+		conn := master.Conn()
+		defer conn.Close()
+		Expect(conn.Select(ctx, 1).Err()).NotTo(HaveOccurred())
+		Expect(conn.Set(ctx, "ReplicationTestDB1", "db1", 0).Err()).NotTo(HaveOccurred())
+		Expect(master.Set(ctx, "ReplicationTestDB0", "db0", 0).Err()).NotTo(HaveOccurred())
+
+		slaveConn := slave.Conn()
+		defer slaveConn.Close()
+		Expect(slaveConn.Select(ctx, 1).Err()).NotTo(HaveOccurred())
+		Eventually(func() string {
+			get, _ := slaveConn.Get(ctx, "ReplicationTestDB1").Result()
+			return get
+		}, "10s", "100ms").Should(Equal("db1"))
+		Eventually(func() string {
+			get, _ := slave.Get(ctx, "ReplicationTestDB0").Result()
+			return get
+		}, "10s", "100ms").Should(Equal("db0"))
+		Expect(slave.Exists(ctx, "ReplicationTestDB1").Val()).To(Equal(int64(0)))
+	})
+
+	It("Stop Replication Test", func() {
+		Expect(slave.Do(ctx, "slaveof", "no", "one").Result()).To(Equal(OK))
+		// the slave drops the connection to the master on its next replication cron
+		time.Sleep(2 * time.Second)
+		Expect(master.Set(ctx, "ReplicationTestAfterStop", "value", 0).Err()).NotTo(HaveOccurred())
+		Consistently(func() int64 {
+			return slave.Exists(ctx, "ReplicationTestAfterStop").Val()
+		}, "2s", "100ms").Should(Equal(int64(0)))
+	})
+})
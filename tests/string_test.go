@@ -194,6 +194,54 @@ var _ = Describe("String", Ordered, func() {
 		Expect(rDel).To(Equal(int64(1)))
 	})
 
+	It("BitPos", func() {
+		r, e := client.Set(ctx, DefaultKey, "\xff\xf0\x00", 0).Result()
+		Expect(e).NotTo(HaveOccurred())
+		Expect(r).To(Equal(OK))
+
+		pos, err := client.BitPos(ctx, DefaultKey, 0).Result()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(pos).To(Equal(int64(12)))
+
+		pos, err = client.BitPos(ctx, DefaultKey, 1).Result()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(pos).To(Equal(int64(0)))
+
+		pos, err = client.BitPos(ctx, DefaultKey, 1, 1).Result()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(pos).To(Equal(int64(8)))
+
+		pos, err = client.BitPos(ctx, DefaultKey, 1, 2, -1).Result()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(pos).To(Equal(int64(-1)))
+
+		// without an end, a value of all ones is followed by zero bits, with an
+		// end BITPOS 0 looks for a zero bit in the range only
+		Expect(client.Set(ctx, "bitpos_all_ones", "\xff\xff", 0).Err()).NotTo(HaveOccurred())
+		pos, err = client.BitPos(ctx, "bitpos_all_ones", 0).Result()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(pos).To(Equal(int64(16)))
+		pos, err = client.BitPos(ctx, "bitpos_all_ones", 0, 1).Result()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(pos).To(Equal(int64(16)))
+		pos, err = client.BitPos(ctx, "bitpos_all_ones", 0, 0, -1).Result()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(pos).To(Equal(int64(-1)))
+		Expect(client.Del(ctx, "bitpos_all_ones").Err()).NotTo(HaveOccurred())
+
+		pos, err = client.BitPos(ctx, "bitpos_no_key", 0).Result()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(pos).To(Equal(int64(0)))
+
+		pos, err = client.BitPos(ctx, "bitpos_no_key", 1).Result()
+		Expect(err).NotTo(HaveOccurred())
+		Expect(pos).To(Equal(int64(-1)))
+
+		rDel, eDel := client.Del(ctx, DefaultKey).Result()
+		Expect(eDel).NotTo(HaveOccurred())
+		Expect(rDel).To(Equal(int64(1)))
+	})
+
 	It("should GetSet", func() {
 		incr := client.Incr(ctx, DefaultKey)
 		Expect(incr.Err()).NotTo(HaveOccurred())
@@ -267,4 +315,37 @@ var _ = Describe("String", Ordered, func() {
 		Expect(mSetnx.Val()).To(Equal(false))
 	})
 
+	It("PFAdd & PFCount & PFMerge", func() {
+		pfAdd := client.PFAdd(ctx, "hll1", "a", "b", "c", "d")
+		Expect(pfAdd.Err()).NotTo(HaveOccurred())
+		Expect(pfAdd.Val()).To(Equal(int64(1)))
+
+		pfAdd = client.PFAdd(ctx, "hll1", "a", "b")
+		Expect(pfAdd.Err()).NotTo(HaveOccurred())
+		Expect(pfAdd.Val()).To(Equal(int64(0)))
+
+		pfCount := client.PFCount(ctx, "hll1")
+		Expect(pfCount.Err()).NotTo(HaveOccurred())
+		Expect(pfCount.Val()).To(Equal(int64(4)))
+
+		elements := make([]interface{}, 0, 10000)
+		for i := 0; i < 10000; i++ {
+			elements = append(elements, "element_"+strconv.Itoa(i))
+		}
+		Expect(client.PFAdd(ctx, "hll2", elements...).Err()).NotTo(HaveOccurred())
+		pfCount = client.PFCount(ctx, "hll1", "hll2")
+		Expect(pfCount.Err()).NotTo(HaveOccurred())
+		Expect(pfCount.Val()).To(BeNumerically("~", 10004, 200))
+
+		pfMerge := client.PFMerge(ctx, "hll1", "hll2")
+		Expect(pfMerge.Err()).NotTo(HaveOccurred())
+		Expect(pfMerge.Val()).To(Equal("OK"))
+		pfCount = client.PFCount(ctx, "hll1")
+		Expect(pfCount.Err()).NotTo(HaveOccurred())
+		Expect(pfCount.Val()).To(BeNumerically("~", 10004, 200))
+
+		Expect(client.Set(ctx, "not_hll", "value", 0).Err()).NotTo(HaveOccurred())
+		Expect(client.PFAdd(ctx, "not_hll", "a").Err()).To(HaveOccurred())
+	})
+
 })